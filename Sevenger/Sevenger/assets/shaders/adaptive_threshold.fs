@@ -0,0 +1,35 @@
+#version 330 core
+
+in vec2 texCoord;
+out uint edge;
+
+//inclusive summed-area table of the magnitudes (R32UI), texel (x, y) holds the sum over [0, x] x [0, y]
+uniform usampler2D sumTexture;
+
+//the 8-bit edge magnitudes the table was built from (R8UI)
+uniform usampler2D magnitudeTexture;
+
+//see AdaptiveThresholdConfig in IntegralImage.h
+uniform int radius;
+uniform int offset;
+uniform int minMagnitude;
+
+uint table(int x, int y)
+{
+    return x < 0 || y < 0 ? 0u : texelFetch(sumTexture, ivec2(x, y), 0).r;
+}
+
+//bit-exact with adaptive_threshold_u8_scalar: the window is clipped at the borders and the compare is
+//(magnitude - offset) * area >= sum in integers, both sides stay below 2^24
+void main()
+{
+    ivec2 last = textureSize(sumTexture, 0) - 1;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 low = max(p - radius, ivec2(0)) - 1;
+    ivec2 high = min(p + radius, last);
+
+    uint sum = table(high.x, high.y) - table(low.x, high.y) - table(high.x, low.y) + table(low.x, low.y);
+    int area = (high.x - low.x) * (high.y - low.y);
+    int magnitude = int(texelFetch(magnitudeTexture, p, 0).r);
+    edge = magnitude >= minMagnitude && (magnitude - offset) * area >= int(sum) ? 255u : 0u;
+}
@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 fragment_color;
+
+in vec2 texCoord;
+
+//packed rows of a BinaryEdgeMap (R8UI), 8 pixels per texel with the first in bit 7
+uniform usampler2D packedEdges;
+
+//size of the edge map in pixels
+uniform ivec2 edgeSize;
+
+//expands the bits while drawing, the map stays at one bit per pixel in video memory
+void main()
+{
+    ivec2 p = clamp(ivec2(texCoord * vec2(edgeSize)), ivec2(0), edgeSize - 1);
+    uint bits = texelFetch(packedEdges, ivec2(p.x >> 3, p.y), 0).r;
+    float edge = float((bits >> uint(7 - (p.x & 7))) & 1u);
+    fragment_color = vec4(vec3(edge), 1.0);
+}
@@ -0,0 +1,39 @@
+#version 330 core
+
+in vec2 texCoord;
+out uvec4 sum;
+
+//the values to smooth on the first pass of a box: 8-bit color, or the levels the previous box left in a
+//float target; the partial sums (RGBA32UI or R32UI) on the passes after that
+uniform sampler2D valueTexture;
+uniform usampler2D sumTexture;
+uniform bool firstPass;
+
+//valueTexture times this is in 1/65536 of a level: 255 * 65536 for color, 65536 for levels
+uniform float valueScale;
+
+//(s, 0) along rows, (0, s) along columns, s = 1, 4, 16, ... until it covers the line
+uniform ivec2 step;
+
+//16 fraction bits keep the sum of every box window below 2^32 (129 pixels wide at the largest sigma), so the
+//uint prefix sums may wrap and the differences box_smoothing.fs takes are still exact
+uvec4 value(ivec2 p)
+{
+    if (firstPass)
+        return uvec4(texelFetch(valueTexture, p, 0) * valueScale + 0.5);
+    return texelFetch(sumTexture, p, 0);
+}
+
+//one pass of the radix-4 inclusive scan of integral_scan.fs, along a single direction
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    uvec4 total = value(p);
+    for (int i = 1; i < 4; ++i)
+    {
+        ivec2 q = p - i * step;
+        if (q.x >= 0 && q.y >= 0)
+            total += value(q);
+    }
+    sum = total;
+}
@@ -0,0 +1,44 @@
+#version 330 core
+
+in vec2 texCoord;
+out vec4 FragColor;
+
+//inclusive prefix sums along direction of values in 1/65536 of a level (box_scan.fs)
+uniform usampler2D sumTexture;
+
+//(1, 0) along rows, (0, 1) along columns
+uniform ivec2 direction;
+uniform int radius;
+
+//true rounds to whole levels for an 8-bit target, false keeps the fraction for the next box (float target)
+uniform bool toColor;
+
+//the window [p - radius, p + radius] is two prefix sums whatever its width; positions past either end of the
+//line count the end pixel again, the clamp-to-edge border of smooth_u8_scalar
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    int position = p.x * direction.x + p.y * direction.y;
+    ivec2 size = textureSize(sumTexture, 0);
+    int last = size.x * direction.x + size.y * direction.y - 1;
+    ivec2 first = p - position * direction;
+
+    uvec4 sum = texelFetch(sumTexture, first + min(position + radius, last) * direction, 0);
+    if (position - radius - 1 >= 0)
+        sum -= texelFetch(sumTexture, first + (position - radius - 1) * direction, 0);
+    int before = max(0, radius - position);
+    int after = max(0, position + radius - last);
+    if (before > 0)
+        sum += uint(before) * texelFetch(sumTexture, first, 0);
+    if (after > 0)
+    {
+        uvec4 end = texelFetch(sumTexture, first + last * direction, 0);
+        if (last > 0)
+            end -= texelFetch(sumTexture, first + (last - 1) * direction, 0);
+        sum += uint(after) * end;
+    }
+
+    uint width = uint(2 * radius + 1);
+    vec4 levels = vec4((sum + width / 2u) / width) / 65536.0;
+    FragColor = toColor ? floor(levels + 0.5) / 255.0 : levels;
+}
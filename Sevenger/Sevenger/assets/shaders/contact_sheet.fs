@@ -0,0 +1,41 @@
+#version 330 core
+
+in vec2 texCoord;
+flat in int layer;
+out vec4 FragColor;
+
+uniform sampler2DArray thumbnails;
+uniform bool detectEdges;
+
+void main()
+{
+    vec2 size = vec2(textureSize(thumbnails, 0).xy);
+    if (!detectEdges)
+    {
+        FragColor = texture(thumbnails, vec3(texCoord, layer));
+        return;
+    }
+
+    //run the Sobel at the mip level matching the on-screen thumbnail size,
+    //so tiny cells show coarse edges instead of aliased full resolution ones
+    vec2 footprint = max(abs(dFdx(texCoord * size)), abs(dFdy(texCoord * size)));
+    float lod = max(0.0, log2(max(footprint.x, footprint.y)));
+    vec2 texelSize = exp2(lod) / size;
+
+    mat3 sobelX = mat3(-1, 0, 1, -2, 0, 2, -1, 0, 1);
+    mat3 sobelY = mat3(-1, -2, -1, 0, 0, 0, 1, 2, 1);
+    vec3 gradientX = vec3(0.0);
+    vec3 gradientY = vec3(0.0);
+    for (int i = -1; i <= 1; ++i)
+    {
+        for (int j = -1; j <= 1; ++j)
+        {
+            vec3 color = textureLod(thumbnails, vec3(texCoord + vec2(i, j) * texelSize, layer), lod).rgb;
+            gradientX += color * sobelX[i + 1][j + 1];
+            gradientY += color * sobelY[i + 1][j + 1];
+        }
+    }
+
+    float edgeMagnitude = length(gradientX) + length(gradientY);
+    FragColor = vec4(vec3(edgeMagnitude), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec2 a_corner;
+
+out vec2 texCoord;
+flat out int layer;
+
+//cells per row and per column
+uniform ivec2 grid;
+uniform int layerCount;
+
+void main()
+{
+    ivec2 cell = ivec2(gl_InstanceID % grid.x, gl_InstanceID / grid.x);
+    vec2 cellSize = 2.0 / vec2(grid);
+
+    //small gap between thumbnails, first cell in the top left corner
+    vec2 inset = mix(vec2(0.03), vec2(0.97), a_corner);
+    vec2 position = vec2(-1.0, 1.0) + vec2(cell.x + inset.x, -(cell.y + 1) + inset.y) * cellSize;
+
+    gl_Position = vec4(position, 0.0, 1.0);
+    texCoord = a_corner;
+    layer = gl_InstanceID % layerCount;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#version 330 core
+
+in vec2 texCoord;
+out uint edgeMagnitude;
+
+//8-bit luma (R8UI) or color (RGB8UI/RGBA8UI)
+uniform usampler2D inputTexture;
+
+//see GradientKernel in SobelCpu.h, [a b a] smoothing and the magnitude shift
+uniform ivec2 smoothing;
+uniform int magnitudeShift;
+
+//1 for luma, 3 for the strongest edge of R, G and B
+uniform int channelCount;
+
+//magnitudes below x become 0, magnitudes at or above y become 255
+uniform ivec2 thresholds;
+
+//integer gradients, bit-exact with gradient_u8_scalar/gradient_u8_simd in SobelCpu.cpp:
+//clamp-to-edge borders and magnitude = min((|gx| + |gy|) >> shift, 255)
+ivec3 color(ivec2 position, ivec2 last)
+{
+    return ivec3(texelFetch(inputTexture, clamp(position, ivec2(0), last), 0).rgb);
+}
+
+void main()
+{
+    ivec2 last = textureSize(inputTexture, 0) - 1;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    ivec3 up_l   = color(p + ivec2(-1, -1), last);
+    ivec3 up_c   = color(p + ivec2( 0, -1), last);
+    ivec3 up_r   = color(p + ivec2( 1, -1), last);
+    ivec3 mid_l  = color(p + ivec2(-1,  0), last);
+    ivec3 mid_r  = color(p + ivec2( 1,  0), last);
+    ivec3 down_l = color(p + ivec2(-1,  1), last);
+    ivec3 down_c = color(p + ivec2( 0,  1), last);
+    ivec3 down_r = color(p + ivec2( 1,  1), last);
+
+    int a = smoothing.x;
+    int b = smoothing.y;
+    ivec3 gx = a * (up_r - up_l) + b * (mid_r - mid_l) + a * (down_r - down_l);
+    ivec3 gy = (a * down_l + b * down_c + a * down_r) - (a * up_l + b * up_c + a * up_r);
+    ivec3 magnitude = min((abs(gx) + abs(gy)) >> magnitudeShift, ivec3(255));
+
+    int edge = channelCount == 1 ? magnitude.r : max(magnitude.r, max(magnitude.g, magnitude.b));
+    edge = edge < thresholds.x ? 0 : (edge >= thresholds.y ? 255 : edge);
+    edgeMagnitude = uint(edge);
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#version 330 core
+
+in vec3 f_color;
+in vec2 texCoord;
+out vec4 FragColor;
+
+uniform sampler2D inputTexture;
+
+//pyramid levels [baseLevel, baseLevel + levelCount) of the input mip chain
+uniform int baseLevel;
+uniform int levelCount;
+
+float sobelAtLevel(vec2 uv, int level)
+{
+    vec2 texelSize = 1.0 / vec2(textureSize(inputTexture, level));
+
+    mat3 sobelX = mat3(-1, 0, 1, -2, 0, 2, -1, 0, 1);
+    mat3 sobelY = mat3(-1, -2, -1, 0, 0, 0, 1, 2, 1);
+    vec3 gradientX = vec3(0.0);
+    vec3 gradientY = vec3(0.0);
+    for (int i = -1; i <= 1; ++i)
+    {
+        for (int j = -1; j <= 1; ++j)
+        {
+            vec3 color = textureLod(inputTexture, uv + vec2(i, j) * texelSize, float(level)).rgb;
+            gradientX += color * sobelX[i + 1][j + 1];
+            gradientY += color * sobelY[i + 1][j + 1];
+        }
+    }
+    return length(gradientX) + length(gradientY);
+}
+
+void main()
+{
+    //strongest response over the scales, fine detail from the low levels and
+    //long soft boundaries from the coarse ones
+    float edgeMagnitude = 0.0;
+    for (int level = baseLevel; level < baseLevel + levelCount; ++level)
+        edgeMagnitude = max(edgeMagnitude, sobelAtLevel(texCoord, level));
+
+    FragColor = vec4(vec3(edgeMagnitude), 1.0);
+}
\ No newline at end of file
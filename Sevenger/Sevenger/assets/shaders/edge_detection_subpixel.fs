@@ -0,0 +1,95 @@
+#version 330 core
+
+in vec2 texCoord;
+out uvec4 subpixelEdge;
+
+//8-bit luma (R8UI)
+uniform usampler2D inputTexture;
+
+//see GradientKernel in SobelCpu.h, [a b a] smoothing and the magnitude shift
+uniform ivec2 smoothing;
+uniform int magnitudeShift;
+
+//magnitudes below x become 0, magnitudes at or above y become 255
+uniform ivec2 thresholds;
+
+//arctangent of i / 256 in 1/256 turns, subpixel_atan_table in SubpixelEdges.cpp
+uniform int atanTable[257];
+
+//integer gradients of edge_detection_int.fs, bit-exact with subpixel_edges_u8_scalar in SubpixelEdges.cpp
+int luma(ivec2 position, ivec2 last)
+{
+    return int(texelFetch(inputTexture, clamp(position, ivec2(0), last), 0).r);
+}
+
+ivec2 gradient(ivec2 p, ivec2 last)
+{
+    int up_l   = luma(p + ivec2(-1, -1), last);
+    int up_c   = luma(p + ivec2( 0, -1), last);
+    int up_r   = luma(p + ivec2( 1, -1), last);
+    int mid_l  = luma(p + ivec2(-1,  0), last);
+    int mid_r  = luma(p + ivec2( 1,  0), last);
+    int down_l = luma(p + ivec2(-1,  1), last);
+    int down_c = luma(p + ivec2( 0,  1), last);
+    int down_r = luma(p + ivec2( 1,  1), last);
+
+    int a = smoothing.x;
+    int b = smoothing.y;
+    int gx = a * (up_r - up_l) + b * (mid_r - mid_l) + a * (down_r - down_l);
+    int gy = (a * down_l + b * down_c + a * down_r) - (a * up_l + b * up_c + a * up_r);
+    return ivec2(gx, gy);
+}
+
+int magnitude(ivec2 g)
+{
+    return (abs(g.x) + abs(g.y)) >> magnitudeShift;
+}
+
+//integer divisions on non-negative operands only, their result is defined
+int direction(ivec2 g)
+{
+    int ax = abs(g.x);
+    int ay = abs(g.y);
+    if (ax == 0 && ay == 0)
+        return 0;
+    int angle = ax >= ay ? atanTable[(ay * 256 + ax / 2) / ax] : 64 - atanTable[(ax * 256 + ay / 2) / ay];
+    if (g.x < 0)
+        angle = 128 - angle;
+    if (g.y < 0)
+        angle = 256 - angle;
+    return angle & 255;
+}
+
+void main()
+{
+    ivec2 last = textureSize(inputTexture, 0) - 1;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    ivec2 g = gradient(p, last);
+    int m = magnitude(g);
+    int edge = min(m, 255);
+    edge = edge < thresholds.x ? 0 : (edge >= thresholds.y ? 255 : edge);
+    if (edge == 0)
+    {
+        subpixelEdge = uvec4(0u);
+        return;
+    }
+
+    //the neighbours along the gradient's axis, their gradients come from the same texels in cache
+    bool vertical = abs(g.y) > abs(g.x);
+    ivec2 axis = vertical ? ivec2(0, 1) : ivec2(1, 0);
+    int before = magnitude(gradient(clamp(p - axis, ivec2(0), last), last));
+    int after = magnitude(gradient(clamp(p + axis, ivec2(0), last), last));
+    int flags = vertical ? 2 : 0;
+    int offset = 0;
+    if (m > before && m >= after)
+    {
+        //peak of the parabola through the three magnitudes, in 1/128 pixels
+        int curvature = 2 * m - before - after;
+        int rise = after - before;
+        offset = (64 * abs(rise) + curvature / 2) / curvature;
+        offset = rise < 0 ? -offset : offset;
+        flags |= 1;
+    }
+    subpixelEdge = uvec4(uint(edge), uint(direction(g)), uint(offset & 255), uint(flags));
+}
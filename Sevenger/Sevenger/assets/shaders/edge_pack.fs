@@ -0,0 +1,26 @@
+#version 330 core
+
+out uint packedEdges;
+
+//R8UI edge map of edge_detection_int.fs
+uniform usampler2D inputTexture;
+
+//pixels of a row, the last byte of a row only holds its first (edgeWidth & 7) pixels
+uniform int edgeWidth;
+
+//magnitudes at or above it are edges
+uniform int threshold;
+
+//8 pixels per texel with the first in bit 7, the row layout of BinaryEdgeMap in BinaryEdges.h
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    int first = p.x * 8;
+    uint bits = 0u;
+    for (int i = 0; i < 8; ++i)
+    {
+        if (first + i < edgeWidth && texelFetch(inputTexture, ivec2(first + i, p.y), 0).r >= uint(threshold))
+            bits |= 0x80u >> i;
+    }
+    packedEdges = bits;
+}
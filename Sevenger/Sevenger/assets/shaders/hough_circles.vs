@@ -0,0 +1,27 @@
+#version 330 core
+
+//a cell of a circle around the origin and the layer of its radius (hough_circle_offsets in HoughTransform.cpp)
+layout(location = 0) in ivec3 offset;
+//the edge point, one instance per point
+layout(location = 1) in ivec2 point;
+
+//one layer is the image, the layers of a pass are tiles of the accumulator, tileColumns to a row,
+//starting with firstLayer
+uniform ivec2 imageSize;
+uniform ivec2 accumulatorSize;
+uniform int tileColumns;
+uniform int firstLayer;
+
+void main()
+{
+    ivec2 center = point + offset.xy;
+    if (any(lessThan(center, ivec2(0))) || any(greaterThanEqual(center, imageSize)))
+    {
+        //outside the image, clipped
+        gl_Position = vec4(2.0, 2.0, 0.0, 1.0);
+        return;
+    }
+    int tile = offset.z - firstLayer;
+    vec2 cell = vec2(ivec2(tile % tileColumns, tile / tileColumns) * imageSize + center) + 0.5;
+    gl_Position = vec4(cell / vec2(accumulatorSize) * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+//cos and sin of one theta bin in 1/32768, one vertex per bin (hough_line_directions in HoughTransform.cpp)
+layout(location = 0) in ivec2 direction;
+//the edge point, one instance per point
+layout(location = 1) in ivec2 point;
+
+//rho offset in 1/32768 plus a half for the rounding, keeps the sum positive before the shift
+uniform int rhoBias;
+uniform ivec2 accumulatorSize;
+
+//the vote of the point for this theta bin, the same integer rho as hough_lines_accumulate
+void main()
+{
+    int rho = (point.x * direction.x + point.y * direction.y + rhoBias) >> 15;
+    vec2 cell = vec2(gl_VertexID, rho) + 0.5;
+    gl_Position = vec4(cell / vec2(accumulatorSize) * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+
+out float vote;
+
+//one vote, the additive blend of HoughPass sums them
+void main()
+{
+    vote = 1.0;
+}
@@ -0,0 +1,26 @@
+#version 330 core
+
+in vec2 texCoord;
+out uint sum;
+
+//8-bit input (R8UI) on the first pass, the partial sums (R32UI) after that
+uniform usampler2D inputTexture;
+
+//(s, 0) along rows, (0, s) along columns, s = 1, 4, 16, ... until it covers the image
+uniform ivec2 step;
+
+//one pass of a radix-4 inclusive scan (Hensley et al., recursive doubling with four samples): every texel
+//adds the texels s, 2s and 3s before it, after the pass with step s it holds the sum of the 4s texels up
+//to itself; uint addition wraps like the 32-bit sums of integral_image_u8_scalar
+void main()
+{
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    uint total = texelFetch(inputTexture, p, 0).r;
+    for (int i = 1; i < 4; ++i)
+    {
+        ivec2 q = p - i * step;
+        if (q.x >= 0 && q.y >= 0)
+            total += texelFetch(inputTexture, q, 0).r;
+    }
+    sum = total;
+}
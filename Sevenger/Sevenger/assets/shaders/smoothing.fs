@@ -0,0 +1,29 @@
+#version 330 core
+
+in vec2 texCoord;
+out vec4 FragColor;
+
+uniform sampler2D inputTexture;
+
+//one pass of a separable smoothing filter (see Smoothing.h): (1, 0) along rows, (0, 1) along columns
+uniform ivec2 direction;
+
+//half of a symmetric kernel, weights[0] at the center and weights[i] at +-i, i up to radius
+uniform int radius;
+uniform float weights[64];
+
+//clamp-to-edge borders like smooth_u8_scalar, whatever wrap mode the texture has
+void main()
+{
+    ivec2 last = textureSize(inputTexture, 0) - 1;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    vec4 sum = weights[0] * texelFetch(inputTexture, p, 0);
+    for (int i = 1; i <= radius; ++i)
+    {
+        vec4 before = texelFetch(inputTexture, clamp(p - i * direction, ivec2(0), last), 0);
+        vec4 after = texelFetch(inputTexture, clamp(p + i * direction, ivec2(0), last), 0);
+        sum += weights[i] * (before + after);
+    }
+    FragColor = sum;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "MappedFile.h"
+#include "Shader.h"
+
+//single archive holding every file under assets/, mapped once at startup
+//entries are named by the path they would have on disk ("assets/shaders/texture.fs"),
+//so callers look them up with the same strings they use for loose files
+//shader sources are stored verbatim, PNGs as texture cache blobs (decoded pixels + mips)
+
+constexpr uint32_t ASSET_PACK_VERSION = 1;
+
+enum class AssetKind : uint32_t
+{
+    RAW = 0,
+    IMAGE = 1  //TextureCacheHeader followed by its levels, offsets relative to the entry
+};
+
+//index is sorted by name for binary search, offsets are from the start of the file
+struct AssetPackEntry
+{
+    uint64_t name_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t name_length;
+    AssetKind kind;
+};
+
+struct AssetPackHeader
+{
+    char magic[4];  //"SVPK"
+    uint32_t version;
+    uint64_t entry_count;
+    uint64_t index_offset;
+};
+
+//zero-copy view into the mapping, valid while the pack stays open
+struct AssetView
+{
+    AssetKind kind = AssetKind::RAW;
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    std::string_view text() const { return std::string_view((const char*)data, size); }
+};
+
+class AssetPack
+{
+public:
+
+    bool open(const std::string& path);
+    bool is_open() const { return file.is_open(); }
+
+    bool find(std::string_view name, AssetView& view) const;
+
+private:
+
+    MappedFile file;
+    const AssetPackEntry* index = nullptr;
+    size_t entry_count = 0;
+};
+
+//packs every file below directory (recursively) into pack_path
+bool build_asset_pack(const std::string& directory, const std::string& pack_path);
+
+//compiles straight from the mapped sources, falls back to the loose files when they are not packed
+Shader load_shader(const AssetPack& pack, const char* vertex_path, const char* fragment_path);
+
+//uploads a packed image with its mip chain, 0 if the pack does not contain it
+GLuint load_texture_packed(const AssetPack& pack, const char* path);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "EdgePass.h"
+#include "Image.h"
+#include "Shader.h"
+#include "SobelCpu.h"
+
+//one image of a batch: 1 channel luma, or 3/4 interleaved channels for the strongest edge of R, G and B
+//the pixels only have to stay valid until submit returns
+struct BatchImage
+{
+    const unsigned char* pixels = nullptr;
+    size_t stride = 0;
+    int width = 0;
+    int height = 0;
+    int channels = 1;
+};
+
+//input bytes of one group draw, larger groups are split so a batch of big images does not
+//need the whole batch in VRAM twice
+constexpr size_t BATCH_MAX_GROUP_BYTES = 256u << 20;
+
+//at most this many collected groups keep their textures for later batches of the same shape
+constexpr size_t BATCH_MAX_FREE_GROUPS = 16;
+
+struct BatchSobelStats
+{
+    uint64_t batches = 0;
+    uint64_t images = 0;
+    uint64_t draws = 0;        //one per group, split groups count once per part
+    uint64_t reused_groups = 0;
+};
+
+//fixed-point edges (edge_detection_batch.fs, bit-exact with SobelCpu.h) of many images with few
+//state changes: images of the same size and channel count become the layers of one texture array,
+//one program bind per batch, one draw and one readback per group
+//
+//GL 3.3 can only select a framebuffer layer from a geometry shader, so instead of a layered target
+//the layers are drawn stacked into one tall R8UI texture, which also makes the readback a single
+//glReadPixels per group
+//
+//results come back asynchronously: submit queues the work and a fenced readback into a pixel
+//buffer, ready polls the fence and collect copies the edge maps out
+class BatchSobelPass
+{
+public:
+
+    explicit BatchSobelPass(Shader& batch_edge_shader);
+    ~BatchSobelPass();
+
+    BatchSobelPass(const BatchSobelPass&) = delete;
+    BatchSobelPass& operator=(const BatchSobelPass&) = delete;
+
+    //kernel and thresholds of the following batches, same meaning as in IntegerSobelPass
+    void set_kernel(GradientKernel kernel);
+    void set_thresholds(int low, int high);
+
+    //uploads and draws every image, returns the ticket of the batch (never 0)
+    //images larger than GL_MAX_TEXTURE_SIZE or with 2 channels are skipped and come back empty
+    uint64_t submit(const std::vector<BatchImage>& images);
+
+    //true once the GPU finished the batch, never blocks
+    bool ready(uint64_t ticket);
+
+    //single channel edge maps in submission order, rows bottom-up like the input
+    //without wait returns false while the batch is still running, false for unknown tickets
+    bool collect(uint64_t ticket, std::vector<Image>& edges, bool wait = true);
+
+    //same into caller memory: destination(index, width, height, stride) returns where image index
+    //goes and sets the stride, it is not called for skipped images
+    using BatchDestination = std::function<unsigned char*(size_t index, int width, int height, size_t& stride)>;
+    bool collect(uint64_t ticket, const BatchDestination& destination, bool wait = true);
+
+    size_t pending() const { return batches.size(); }
+    const BatchSobelStats& stats() const { return totals; }
+
+private:
+
+    //images of one shape, drawn and read back together
+    struct Group
+    {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        int layers = 0;
+        GLuint input_array = 0;
+        RenderTarget target;
+        GLuint readback_pbo = 0;
+        std::vector<size_t> indices;  //submission index of every layer
+    };
+
+    struct Batch
+    {
+        uint64_t ticket = 0;
+        size_t image_count = 0;
+        std::vector<Group> groups;
+        GLsync fence = nullptr;
+    };
+
+    bool acquire_group(Group& group);
+    void release_group(Group& group);
+    void upload_layer(const Group& group, int layer, const BatchImage& image);
+
+    Shader& batch_edge_shader;
+    EdgePass edge_pass;
+    GradientKernel kernel = GradientKernel::SOBEL;
+    int low_threshold = 0;
+    int high_threshold = 255;
+    int max_target_size = 0;  //GL_MAX_TEXTURE_SIZE, or the viewport limit if that is smaller
+    int max_layers = 0;
+    uint64_t next_ticket = 1;
+    std::vector<Batch> batches;
+    std::vector<Group> free_groups;
+    BatchSobelStats totals;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+
+class BinaryEdgeMap;
+class Shader;
+
+//a BinaryEdgeMap in video memory at one bit per pixel: the packed rows become an R8UI texture an eighth
+//of the width, binary_edges.fs expands the bits while drawing
+class BinaryEdgeTexture
+{
+public:
+
+    BinaryEdgeTexture() = default;
+    ~BinaryEdgeTexture();
+
+    BinaryEdgeTexture(const BinaryEdgeTexture&) = delete;
+    BinaryEdgeTexture& operator=(const BinaryEdgeTexture&) = delete;
+
+    void upload(const BinaryEdgeMap& map);
+    void release();
+
+    //binds the texture and binary_edges.fs with its uniforms, the caller draws the textured quad
+    void bind(Shader& binary_edge_shader) const;
+
+    GLuint texture() const { return texture_id; }
+    int width() const { return map_width; }
+    int height() const { return map_height; }
+    size_t memory_bytes() const { return ((size_t)map_width + 7) / 8 * map_height; }
+
+private:
+
+    GLuint texture_id = 0;
+    int map_width = 0;
+    int map_height = 0;
+};
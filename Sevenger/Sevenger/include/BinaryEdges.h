@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//magnitudes at or above it are edges once an edge map is reduced to one bit per pixel
+constexpr int BINARY_EDGE_THRESHOLD = 128;
+
+//thresholded edge map at one bit per pixel, 1 is an edge
+//rows are bottom-up like Image, bits MSB-first within a byte like PBM (bit 7 of byte 0 is x = 0),
+//every row is padded with zero bits to a multiple of 8 bytes so readers can scan 64 pixels at a time
+class BinaryEdgeMap
+{
+public:
+
+    BinaryEdgeMap() = default;
+    BinaryEdgeMap(int width, int height) { resize(width, height); }
+
+    //every bit cleared
+    void resize(int width, int height);
+
+    int width() const { return map_width; }
+    int height() const { return map_height; }
+    bool empty() const { return bits.empty(); }
+    //bytes between two rows, a multiple of 8
+    size_t stride() const { return row_stride; }
+    size_t size_bytes() const { return bits.size(); }
+
+    unsigned char* row(int y) { return bits.data() + (size_t)y * row_stride; }
+    const unsigned char* row(int y) const { return bits.data() + (size_t)y * row_stride; }
+
+    bool test(int x, int y) const { return (row(y)[x >> 3] >> (7 - (x & 7))) & 1; }
+    void set(int x, int y) { row(y)[x >> 3] |= (unsigned char)(0x80 >> (x & 7)); }
+
+    //number of edge pixels
+    size_t count() const;
+
+private:
+
+    int map_width = 0;
+    int map_height = 0;
+    size_t row_stride = 0;
+    std::vector<unsigned char> bits;
+};
+
+//horizontal run of edge pixels [x, x + length) in row y
+struct EdgeRun
+{
+    int x;
+    int y;
+    int length;
+};
+
+struct EdgePoint
+{
+    int x;
+    int y;
+};
+
+//packs 8-bit magnitudes into map, pixels at or above threshold (0 to 255) become edges
+//the SIMD version compares 16 pixels at once and gathers the results with movemask
+void pack_edges_u8_scalar(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map);
+void pack_edges_u8_simd(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map);
+//pack_edges_u8_simd split into row bands across threads, thread_count 0 uses every hardware thread
+void pack_edges_u8_threaded(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map,
+                            int thread_count = 0);
+
+//0 and 255 per pixel again, edges must be width x height
+void unpack_edges_u8(const BinaryEdgeMap& map, unsigned char* edges, size_t edges_stride);
+
+//sparse forms for maps with few edges, both ordered by row and then x, skipping 64 empty pixels at a time
+void edge_runs(const BinaryEdgeMap& map, std::vector<EdgeRun>& runs);
+void edge_points(const BinaryEdgeMap& map, std::vector<EdgePoint>& points);
+
+//file encodings of a binary edge map, AUTO picks the smallest for each map
+//    BITS    the packed rows, like PBM without padding to 8 bytes
+//    RUNS    per row the number of runs, then gap and length of each run as varints
+//    POINTS  the number of edges, then the distance of each from the previous in row order as varints
+enum class EdgeMapEncoding
+{
+    AUTO,
+    BITS,
+    RUNS,
+    POINTS
+};
+
+const char* edge_map_encoding_name(EdgeMapEncoding encoding);
+
+//"SVEB" file: the magic, version, encoding, width and height (little-endian 32-bit), then the rows
+//top row first; with AUTO every encoding is sized first, which only costs a scan of the runs
+void encode_binary_edges(const BinaryEdgeMap& map, std::vector<unsigned char>& file, EdgeMapEncoding encoding = EdgeMapEncoding::AUTO);
+bool decode_binary_edges(const unsigned char* file, size_t size, BinaryEdgeMap& map, EdgeMapEncoding* encoding = nullptr);
+bool is_binary_edge_file(const unsigned char* file, size_t size);
+
+bool write_binary_edges(const std::string& path, const BinaryEdgeMap& map, EdgeMapEncoding encoding = EdgeMapEncoding::AUTO);
+bool read_binary_edges(const std::string& path, BinaryEdgeMap& map);
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+//fixed-capacity queue shared between pipeline stages
+//producers either block until there is room or evict the oldest element,
+//consumers block until an element arrives or the queue is closed
+template <typename T>
+class BoundedQueue
+{
+public:
+
+    explicit BoundedQueue(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    //blocks while the queue is full, returns false if the queue was closed
+    bool push(T value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+
+        items.push_back(std::move(value));
+        not_empty.notify_one();
+        return true;
+    }
+
+    //never blocks: if the queue is full the oldest element is moved into
+    //dropped and true is returned so the caller can account for it
+    bool push_drop_oldest(T value, T& dropped)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bool did_drop = false;
+        if (items.size() >= capacity)
+        {
+            dropped = std::move(items.front());
+            items.pop_front();
+            did_drop = true;
+        }
+
+        items.push_back(std::move(value));
+        not_empty.notify_one();
+        return did_drop;
+    }
+
+    //blocks until an element is available, returns false once the queue is closed and drained
+    bool pop(T& value)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+
+        value = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.empty())
+            return false;
+
+        value = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    //wakes every waiting producer and consumer, remaining elements can still be popped
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    bool is_closed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return items.size();
+    }
+
+private:
+
+    size_t capacity;
+    bool closed = false;
+    std::deque<T> items;
+    mutable std::mutex mutex;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//another program started with a plain argument list (no shell), move-only
+//the destructor does not wait, a child that is still running keeps running
+class ChildProcess
+{
+public:
+
+    ChildProcess() = default;
+    ~ChildProcess();
+
+    ChildProcess(ChildProcess&& other) noexcept;
+    ChildProcess& operator=(ChildProcess&& other) noexcept;
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    //arguments[0] is the program, looked up like the shell would when it has no directory
+    bool start(const std::vector<std::string>& arguments);
+
+    bool is_running() const { return started; }
+
+    //true once the child exited, exit_code is -1 when it was killed by a signal
+    bool try_wait(int& exit_code);
+    //blocks until the child exits and returns its exit code
+    int wait();
+
+    //ends the child without giving it a chance to clean up
+    void kill();
+
+private:
+
+    bool started = false;
+#ifdef _WIN32
+    void* process_handle = nullptr;
+#else
+    intptr_t pid = 0;
+#endif
+};
+
+//names that tell processes apart across machines sharing a directory
+std::string host_name();
+uint32_t current_process_id();
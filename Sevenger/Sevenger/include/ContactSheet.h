@@ -0,0 +1,45 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "Shader.h"
+#include "TextureCache.h"
+
+//grid of thumbnails drawn with one instanced draw call
+//every image is letterboxed into a square layer of one GL_TEXTURE_2D_ARRAY, instance i
+//shows layer i % layer_count, so the grid can hold many more cells than distinct images
+class ContactSheet
+{
+public:
+
+    ContactSheet(Shader& sheet_shader, int thumbnail_size = 256);
+    ~ContactSheet();
+
+    ContactSheet(const ContactSheet&) = delete;
+    ContactSheet& operator=(const ContactSheet&) = delete;
+
+    //resamples 1, 3 or 4 channel pixels into a new layer, rows bottom-up like load_texture
+    void add_image(const unsigned char* pixels, int width, int height, int channels);
+
+    //picks the smallest cached mip level that still covers a thumbnail, the levels must be uncompressed
+    void add_cached_image(const TextureCacheHeader& header, const unsigned char* base);
+
+    //(re)uploads every layer added so far into the texture array
+    void upload();
+
+    int layer_count() const { return layers; }
+    GLuint texture() const { return texture_array; }
+
+    //draws cell_count thumbnails filling the current viewport
+    void draw(int cell_count, float viewport_aspect, bool detect_edges);
+
+private:
+
+    Shader& sheet_shader;
+    int thumbnail_size;
+    int layers = 0;
+    std::vector<unsigned char> staging;
+    GLuint texture_array = 0;
+    GLuint VAO_id = 0;
+    GLuint VBO_id = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class BinaryEdgeMap;
+
+//pixel coordinates with pixel centers at whole numbers, y counts rows bottom-up like the maps
+//contour vertices fall on half pixels, between an edge pixel and a background pixel
+struct ContourPoint
+{
+    float x;
+    float y;
+};
+
+//closed polygon, the last point connects back to the first; outlines run counterclockwise
+//(edge pixels on the left), the outlines of holes clockwise
+struct EdgeContour
+{
+    std::vector<ContourPoint> points;
+};
+
+struct ContourConfig
+{
+    float epsilon = 1.0f;   //Douglas-Peucker tolerance in pixels, 0 only drops collinear points
+    int tile_size = 256;    //cells traced by one thread at a time
+    int thread_count = 0;   //0 uses every hardware thread
+};
+
+//outlines of the edge regions of a binary map (marching squares, diagonal neighbours connected)
+//every tile is traced on its own across threads, contours that leave a tile end on its seams
+//and are stitched to the pieces of the neighbouring tiles afterwards; the result does not depend
+//on the tile size or thread count, contours start at their lowest, leftmost point and are sorted by it;
+//filling the contours at epsilon 0 gives the map back exactly
+void trace_contours(const BinaryEdgeMap& map, std::vector<EdgeContour>& contours, const ContourConfig& config = {});
+
+//Douglas-Peucker on closed contours, split across threads, keeps at least two points of each
+void simplify_contours(std::vector<EdgeContour>& contours, float epsilon, int thread_count = 0);
+
+size_t contour_point_count(const std::vector<EdgeContour>& contours);
+
+//even-odd fill of the contours at the pixel centers, map becomes width x height
+void rasterize_contours(const std::vector<EdgeContour>& contours, int width, int height, BinaryEdgeMap& map);
+
+//vector files
+//    SVG   one path of relative moves, top row first like every image viewer expects
+//    SVEC  "SVEC", version, width and height (little-endian 32-bit), the contour count, then per contour its
+//          point count, the first point and the differences to the next as zigzag varints in half pixels
+enum class ContourFormat
+{
+    SVG,
+    SVEC
+};
+
+//parses "svg" or "svec"
+bool parse_contour_format(const std::string& name, ContourFormat& format);
+const char* contour_format_name(ContourFormat format);
+//".svg" or ".svec"
+const char* contour_format_extension(ContourFormat format);
+
+void encode_contours(ContourFormat format, const std::vector<EdgeContour>& contours, int width, int height,
+                     std::vector<unsigned char>& file);
+//SVEC only
+bool decode_contours(const unsigned char* file, size_t size, std::vector<EdgeContour>& contours, int& width, int& height);
+
+bool write_contours(const std::string& path, ContourFormat format, const std::vector<EdgeContour>& contours, int width, int height);
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Image.h"
+#include "IntegralImage.h"
+#include "Smoothing.h"
+#include "SobelCpu.h"
+
+class BatchSobelPass;
+class BinaryEdgeMap;
+class IntegerSobelPass;
+class Shader;
+
+enum class EdgeBackend
+{
+    AUTO,      //picked per image by EdgeDetector::select_backend
+    SCALAR,
+    SIMD,
+    THREADED,
+    GL         //edge_detection_int.fs, needs enable_gl
+};
+
+enum class EdgeChannels
+{
+    LUMA,  //edges of the luma image
+    MAX    //strongest edge of R, G and B, finds edges between colors of equal brightness
+};
+
+//auto selection thresholds, from SevengerBench runs: below a quarter megapixel starting threads
+//costs about as much as the work, and a GL round trip (upload, draw, readback) only beats the
+//CPU for large images on machines with few cores
+constexpr int64_t EDGE_THREADED_MIN_PIXELS = 512 * 512;
+constexpr int64_t EDGE_GL_MIN_PIXELS = 2048 * 2048;
+constexpr unsigned EDGE_GL_MAX_CPU_THREADS = 4;
+
+struct EdgeDetectorConfig
+{
+    GradientKernel kernel = GradientKernel::SOBEL;
+    EdgeChannels channels = EdgeChannels::LUMA;
+    int low_threshold = 0;     //magnitudes below become 0
+    int high_threshold = 255;  //magnitudes at or above become 255
+    EdgeBackend backend = EdgeBackend::AUTO;
+    int thread_count = 0;      //THREADED backend, 0 uses every hardware thread
+    SmoothingFilter smoothing = SmoothingFilter::NONE;  //applied to every plane before the gradients
+    float smoothing_sigma = 1.5f;
+    bool adaptive_threshold = false;    //then the thresholded magnitudes are compared against their local mean,
+    AdaptiveThresholdConfig adaptive;   //edges become 0 or 255 (see IntegralImage.h); thread_count above applies
+};
+
+//parses "auto", "scalar", "simd", "threaded" or "gl"
+bool parse_edge_backend(const std::string& name, EdgeBackend& backend);
+//parses "sobel", "prewitt" or "scharr"
+bool parse_gradient_kernel(const std::string& name, GradientKernel& kernel);
+const char* edge_backend_name(EdgeBackend backend);
+
+//magnitude from which a pixel is an edge of process_binary: the thresholded magnitude is at least
+//BINARY_EDGE_THRESHOLD, so binary maps match thresholding and then writing PBM
+int binary_edge_threshold(const EdgeDetectorConfig& config);
+
+//fixed-point edge detection on 8-bit images behind one interface, every backend gives the same
+//result for the same configuration (see SobelCpu.h), so the backend is purely a speed choice
+//
+//the CPU backends can run on any thread, GL runs on the thread whose context was current in enable_gl
+//
+//pre-smoothing and the adaptive threshold run on the CPU with the backend's flavour of smooth_u8 and
+//the integral image (THREADED for GL, before the upload and after the readback), so they stay bit-exact
+//across backends as well
+class EdgeDetector
+{
+public:
+
+    explicit EdgeDetector(const EdgeDetectorConfig& config = {});
+    ~EdgeDetector();
+
+    EdgeDetector(const EdgeDetector&) = delete;
+    EdgeDetector& operator=(const EdgeDetector&) = delete;
+
+    void configure(const EdgeDetectorConfig& config);
+    const EdgeDetectorConfig& config() const { return settings; }
+
+    //makes the GL backend available, needs a current context and edge_detection_int.fs
+    void enable_gl(Shader& int_edge_shader);
+    bool gl_enabled() const { return gl_pass != nullptr; }
+
+    //lets GL batches draw every group of same-sized images at once, needs the context of enable_gl
+    //and edge_detection_batch.fs; without it, or with smoothing or the adaptive threshold configured,
+    //GL batches run image by image
+    void enable_gl_batch(Shader& batch_edge_shader);
+
+    //lets process_binary pack on the GPU with edge_pack.fs and read back one bit per pixel, call after
+    //enable_gl; without it the GL backend reads back bytes and packs them on the CPU
+    void enable_gl_packing(Shader& pack_edges_shader);
+
+    //the configured backend, or for AUTO the one expected to be fastest for an image of this size:
+    //GL on hardware renderers from EDGE_GL_MIN_PIXELS up when the CPU has fewer than EDGE_GL_MAX_CPU_THREADS,
+    //THREADED from EDGE_THREADED_MIN_PIXELS up on multi-core CPUs, SIMD below (SCALAR without SSE2)
+    EdgeBackend select_backend(int width, int height) const;
+
+    //edges of a 1 to 4 channel image in either layout, edges becomes a single channel image of the same size
+    //returns false if the chosen backend cannot run (GL not enabled or image larger than GL_MAX_TEXTURE_SIZE)
+    bool process(const Image& image, Image& edges);
+
+    //interleaved pixels with rows stride bytes apart, edges_stride bytes between output rows
+    bool process(const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                 unsigned char* edges, size_t edges_stride);
+
+    //edges at one bit per pixel (see binary_edge_threshold), straight from the gradients: the CPU backends
+    //skip the threshold pass and pack with SIMD compares, GL packs on the GPU when enabled
+    bool process_binary(const Image& image, BinaryEdgeMap& edges);
+
+    //lets process_subpixel run on the GPU with edge_detection_subpixel.fs, call after enable_gl
+    void enable_gl_subpixel(Shader& subpixel_edge_shader);
+
+    //sub-pixel edges of the image's luma (see SubpixelEdges.h), edges becomes a 4 channel interleaved image;
+    //the channels setting does not apply, the backends run without GL unless enable_gl_subpixel was called
+    bool process_subpixel(const Image& image, Image& edges);
+
+    //backend of a whole batch: AUTO picks GL for batches of at least EDGE_GL_MIN_PIXELS in total under the
+    //same conditions as select_backend, a batch of small images amortizes the upload and draw overhead;
+    //otherwise every image gets its own select_backend choice (reported as AUTO)
+    EdgeBackend select_batch_backend(const std::vector<const Image*>& images) const;
+
+    //queues edge detection of every image, the images only have to stay valid until it returns
+    //GL batches run asynchronously through BatchSobelPass, CPU batches are done before it returns
+    //returns the ticket for collect_batch
+    uint64_t submit_batch(const std::vector<const Image*>& images);
+
+    //true once collect_batch would not block
+    bool batch_ready(uint64_t ticket);
+
+    //single channel edge maps in submission order, images that failed come back empty
+    //without wait returns false while the batch is still running, false for unknown tickets
+    bool collect_batch(uint64_t ticket, std::vector<Image>& edges, bool wait = true);
+
+    //submit_batch and collect_batch, edges is resized to match, returns how many succeeded
+    size_t process_batch(const std::vector<const Image*>& images, std::vector<Image>& edges);
+
+    //backend of the last process() or submit_batch() call
+    EdgeBackend last_backend() const { return used_backend; }
+
+private:
+
+    //the configured smoothing of one plane, src and dst may be the same
+    void smooth_plane(EdgeBackend backend, const unsigned char* src, size_t src_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height);
+
+    //the configured adaptive threshold of an edge map, in place
+    void threshold_adaptive(EdgeBackend backend, unsigned char* edges, size_t edges_stride, int width, int height);
+
+    //CPU backends, the strongest edge over the planes, then the thresholds
+    void detect_planes(EdgeBackend backend, const unsigned char* const* planes, size_t plane_stride, int plane_count,
+                       unsigned char* edges, size_t edges_stride, int width, int height);
+
+    EdgeDetectorConfig settings;
+    EdgeBackend used_backend = EdgeBackend::AUTO;
+    //batch whose edges are either finished (CPU) or still on the GPU (gl_ticket)
+    struct PendingBatch
+    {
+        uint64_t ticket = 0;
+        uint64_t gl_ticket = 0;
+        std::vector<Image> edges;
+    };
+
+    std::unique_ptr<IntegerSobelPass> gl_pass;
+    std::unique_ptr<BatchSobelPass> batch_pass;
+    uint64_t next_ticket = 1;
+    std::vector<PendingBatch> pending_batches;
+    std::vector<Image> batch_luma;
+    std::vector<std::vector<unsigned char>> batch_interleaved;
+    bool gl_hardware = false;
+    int gl_max_texture_size = 0;
+    Image luma;
+    Image smoothed;
+    Image planar;
+    Image channel_edges;
+    std::vector<unsigned char> interleaved;
+    Image binary_magnitude;
+    IntegralImage magnitude_sums;
+    //set during process_binary: the CPU backends leave the thresholds out, GL may pack into it directly
+    BinaryEdgeMap* binary_output = nullptr;
+    bool binary_packed = false;
+};
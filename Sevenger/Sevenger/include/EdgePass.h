@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "Region.h"
+#include "Shader.h"
+
+//color texture with its framebuffer, used to run the edge shader off screen
+struct RenderTarget
+{
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    GLenum internal_format = GL_RGBA8;
+    int width = 0;
+    int height = 0;
+};
+
+//(re)allocates a render target, returns false if the framebuffer is incomplete
+//integer formats (GL_R8UI, GL_R32UI, GL_RGBA8UI, GL_RGBA32UI) are sampled with nearest filtering
+bool create_render_target(RenderTarget& target, int width, int height, GLenum internal_format = GL_RGBA8);
+void destroy_render_target(RenderTarget& target);
+
+//glTexSubImage2D of one rect of a tightly or loosely packed 8-bit image, stride is in bytes
+void upload_texture_region(GLuint texture, const unsigned char* pixels, size_t stride, int channels, const Rect& region);
+
+//runs the Sobel fragment shader over a full screen quad into a render target
+class EdgePass
+{
+public:
+
+    explicit EdgePass(Shader& edge_shader);
+    ~EdgePass();
+
+    EdgePass(const EdgePass&) = delete;
+    EdgePass& operator=(const EdgePass&) = delete;
+
+    //leaves the default framebuffer bound afterwards
+    void run(GLuint input_texture, const RenderTarget& target);
+
+    //only the pixels inside the regions are shaded (scissor), the rest of the target is kept
+    void run(GLuint input_texture, const RenderTarget& target, const std::vector<Rect>& regions);
+
+    //draws the quad over width x height pixels of the target with the program and textures the caller
+    //bound, so passes that draw several times bind them once; leaves the target and the quad bound
+    void draw(const RenderTarget& target, int width, int height);
+
+private:
+
+    Shader& edge_shader;
+    GLuint VAO_id = 0;
+    GLuint VBO_id = 0;
+    GLuint EBO_id = 0;
+};
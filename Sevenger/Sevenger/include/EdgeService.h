@@ -0,0 +1,186 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EdgeDetector.h"
+#include "LocalSocket.h"
+#include "SharedMemory.h"
+
+class BatchSobelPass;
+class Shader;
+
+//local edge detection service: one process owns the GL context and the compiled shaders, clients send
+//fixed-size requests over a Unix domain socket and exchange pixels through a shared memory segment
+//they create, so images never go through the socket
+
+constexpr uint32_t EDGE_SERVICE_MAGIC = 0x53564553;  //"SEVS"
+constexpr uint32_t EDGE_SERVICE_VERSION = 1;
+
+enum class EdgeServiceCommand : uint32_t
+{
+    DETECT = 1,
+    SHUTDOWN = 2
+};
+
+enum class EdgeServiceStatus : uint32_t
+{
+    OK = 0,
+    BAD_REQUEST = 1,          //wrong magic/version, bad size or offsets outside the segment
+    SEGMENT_UNAVAILABLE = 2,  //the server could not map the client's segment
+    FAILED = 3                //the backend could not process the image
+};
+
+//input: interleaved 1 to 4 channel pixels at input_offset, rows input_stride bytes apart
+//output: width x height single channel edge map written to output_offset, rows output_stride apart
+//both rows bottom-up or top-down, the service keeps the order
+struct EdgeServiceRequest
+{
+    uint32_t magic = EDGE_SERVICE_MAGIC;
+    uint32_t version = EDGE_SERVICE_VERSION;
+    uint32_t command = (uint32_t)EdgeServiceCommand::DETECT;
+    uint32_t kernel = 0;         //GradientKernel
+    uint32_t channel_mode = 0;   //EdgeChannels
+    int32_t low_threshold = 0;
+    int32_t high_threshold = 255;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t channels = 0;
+    uint64_t id = 0;
+    uint64_t segment_size = 0;
+    uint64_t input_offset = 0;
+    uint64_t input_stride = 0;
+    uint64_t output_offset = 0;
+    uint64_t output_stride = 0;
+    char segment[64] = {};
+};
+
+struct EdgeServiceResponse
+{
+    uint32_t magic = EDGE_SERVICE_MAGIC;
+    uint32_t status = (uint32_t)EdgeServiceStatus::OK;
+    uint64_t id = 0;
+    uint32_t backend = 0;      //EdgeBackend that ran the request
+    uint32_t batch_size = 0;   //requests served together with this one
+    double service_ms = 0.0;   //from reading the request to sending the response
+};
+
+struct EdgeServerConfig
+{
+    std::string socket_path;
+    EdgeBackend backend = EdgeBackend::GL;  //GL batches every request of a round, the others run them one by one
+    size_t max_batch = 64;                  //requests per round
+    int batch_window_ms = 0;                //extra time a round waits for more requests, 0 takes what is queued
+    int thread_count = 0;                   //THREADED backend
+};
+
+struct EdgeServerStats
+{
+    uint64_t connections = 0;
+    uint64_t requests = 0;
+    uint64_t failed = 0;
+    uint64_t rounds = 0;
+    uint64_t largest_round = 0;
+};
+
+//single threaded server: every round polls the sockets, reads what each readable client sent without
+//blocking, runs the requests that are complete together and answers; a request that arrives in pieces
+//waits in its connection until the rest is there, so a stalled client never holds up the others;
+//requests from different clients that arrive while a round runs end up in the same next round
+class EdgeServer
+{
+public:
+
+    explicit EdgeServer(const EdgeServerConfig& config);
+    ~EdgeServer();
+
+    EdgeServer(const EdgeServer&) = delete;
+    EdgeServer& operator=(const EdgeServer&) = delete;
+
+    //listens on the socket; the GL backend needs a current context and both shaders
+    bool start(Shader* int_edge_shader, Shader* batch_edge_shader);
+
+    //serves until stop() or a SHUTDOWN request
+    void run();
+
+    //safe from signal handlers and other threads
+    void stop() { stopping = true; }
+
+    const EdgeServerStats& stats() const { return totals; }
+
+private:
+
+    struct Connection
+    {
+        LocalSocket socket;
+        SharedMemory segment;
+        //the bytes of the next request received so far
+        EdgeServiceRequest partial;
+        size_t partial_size = 0;
+    };
+
+    struct Pending
+    {
+        size_t connection = 0;
+        EdgeServiceRequest request;
+        EdgeServiceResponse response;
+        unsigned char* input = nullptr;
+        unsigned char* output = nullptr;
+        double received = 0.0;
+    };
+
+    enum class ReadResult
+    {
+        COMPLETE,
+        INCOMPLETE,
+        CLOSED
+    };
+
+    //reads what has arrived on a readable connection, pending is filled in once the request is complete
+    ReadResult read_request(size_t connection, Pending& pending);
+    void run_round(std::vector<Pending>& round);
+    void run_gl_round(std::vector<Pending>& round);
+
+    EdgeServerConfig settings;
+    std::atomic<bool> stopping = false;
+    LocalSocket listener;
+    std::vector<std::unique_ptr<Connection>> connections;
+    EdgeDetector detector;
+    std::unique_ptr<BatchSobelPass> batch_pass;
+    std::vector<Image> round_luma;
+    EdgeServerStats totals;
+};
+
+//one connection and one shared segment, requests are synchronous
+class EdgeClient
+{
+public:
+
+    EdgeClient() = default;
+
+    //connects and creates a segment with room for capacity input bytes and capacity output bytes
+    bool connect(const std::string& socket_path, size_t capacity);
+    void close();
+
+    //where to put the input pixels before detect, and where the edges arrive
+    unsigned char* input() { return segment.data(); }
+    const unsigned char* output() const { return segment.data() + output_offset; }
+    size_t capacity() const { return output_offset; }
+
+    //edges of the pixels in input(), tightly packed rows of width bytes in output()
+    //false if the connection failed, response.status tells whether the server could run it
+    bool detect(int width, int height, int channels, size_t stride, const EdgeDetectorConfig& config,
+                EdgeServiceResponse& response);
+
+    //asks the server to exit after the current round
+    bool shutdown_server();
+
+private:
+
+    LocalSocket socket;
+    SharedMemory segment;
+    size_t output_offset = 0;
+    uint64_t next_id = 1;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "EdgePass.h"
+#include "FrameSource.h"
+
+struct FramePipelineConfig
+{
+    //frames buffered between stages, also the number of frames in flight on the GPU
+    size_t queue_depth = 3;
+    //live source behaviour: evict the oldest waiting frame instead of stalling the source
+    bool drop_when_full = false;
+    //pace the source like a camera, 0 decodes as fast as possible
+    double source_fps = 0.0;
+};
+
+struct FramePipelineMetrics
+{
+    uint64_t frames_decoded = 0;
+    uint64_t frames_completed = 0;
+    uint64_t frames_dropped = 0;
+    double latency_mean_ms = 0.0;
+    double latency_p50_ms = 0.0;
+    double latency_p95_ms = 0.0;
+    double latency_p99_ms = 0.0;
+    double latency_max_ms = 0.0;
+    double elapsed_seconds = 0.0;
+    double throughput_fps = 0.0;
+};
+
+//decode -> upload -> edge detect -> readback, each stage running concurrently:
+//decoding and the sink run on their own threads, upload/edge/readback are issued
+//by pump() on the thread owning the GL context and overlap through PBOs and fences
+//the sink receives RGBA edge maps, bottom-up as returned by glReadPixels
+class FramePipeline
+{
+public:
+
+    using FrameSink = std::function<void(const Frame&)>;
+
+    FramePipeline(std::unique_ptr<FrameSource> source, Shader& edge_shader, const FramePipelineConfig& config, FrameSink sink = nullptr);
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    void start();
+
+    //GL thread: retires finished readbacks and submits newly decoded frames without blocking
+    //returns false once every frame of the source has reached the sink
+    bool pump();
+
+    //pumps until the source is exhausted, sleeping on the oldest fence in between instead of spinning
+    void run();
+
+    //stops the source early, frames already in flight are still delivered
+    void stop();
+
+    //edge texture of the most recently completed frame, 0 before the first one; the pipeline keeps it
+    //until the next frame completes, so it can be drawn while later frames are in flight
+    GLuint latest_output_texture() const;
+
+    FramePipelineMetrics metrics() const;
+
+private:
+
+    struct Slot
+    {
+        GLuint upload_pbo = 0;
+        GLuint readback_pbo = 0;
+        GLuint input_texture = 0;
+        int input_width = 0;
+        int input_height = 0;
+        int input_channels = 0;
+        RenderTarget target;
+        GLsync fence = nullptr;
+        Frame frame;
+    };
+
+    void decode_loop();
+    void sink_loop();
+    bool retire_oldest();
+    //false (and the frame dropped) if its render target could not be created
+    bool submit(Slot& slot, Frame&& frame);
+    void count_drop();
+
+    std::unique_ptr<FrameSource> source;
+    FramePipelineConfig config;
+    FrameSink sink;
+    EdgePass edge_pass;
+
+    BoundedQueue<Frame> decoded;
+    BoundedQueue<Frame> completed;
+    std::thread decode_thread;
+    std::thread sink_thread;
+    std::atomic<bool> stopping{ false };
+    bool started = false;
+    bool finished = false;
+
+    //ring of GPU slots, [oldest, oldest + in_flight) are waiting on their fence
+    std::vector<Slot> slots;
+    size_t oldest = 0;
+    size_t in_flight = 0;
+    //copy of the most recently retired output, stays valid while the slots are reused
+    RenderTarget display_target;
+
+    mutable std::mutex metrics_mutex;
+    std::vector<double> latencies_ms;
+    uint64_t frames_decoded = 0;
+    uint64_t frames_dropped = 0;
+    std::chrono::steady_clock::time_point start_time;
+    std::chrono::steady_clock::time_point end_time;
+};
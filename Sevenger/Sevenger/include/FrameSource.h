@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+//one decoded frame travelling through the pipeline
+//rows are stored bottom-up (same convention as load_texture) so they can be uploaded as-is
+struct Frame
+{
+    int index = -1;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::vector<unsigned char> pixels;
+    std::chrono::steady_clock::time_point capture_time;
+};
+
+enum class RawFormat
+{
+    GRAY8,
+    RGB24,
+    RGBA32,
+    YUV420P  //planar I420: full size Y plane followed by quarter size U and V planes
+};
+
+//parses "gray8", "rgb24", "rgba32" or "yuv420p"
+bool parse_raw_format(const std::string& name, RawFormat& format);
+
+//size in bytes of one frame of the given format as stored on disk
+size_t raw_frame_size(RawFormat format, int width, int height);
+
+class FrameSource
+{
+public:
+
+    virtual ~FrameSource() = default;
+
+    //decodes the next frame, returns false when the source is exhausted
+    virtual bool next(Frame& frame) = 0;
+};
+
+//numbered image files, e.g. "frames/frame_%04d.png"
+//reading stops at the first index that cannot be loaded
+class ImageSequenceSource : public FrameSource
+{
+public:
+
+    ImageSequenceSource(const std::string& pattern, int first_index = 0);
+
+    bool next(Frame& frame) override;
+
+private:
+
+    std::string pattern;
+    int next_index;
+};
+
+//headerless file of back to back raw frames, stand-in for a camera feed
+class RawFrameSource : public FrameSource
+{
+public:
+
+    RawFrameSource(const std::string& path, int width, int height, RawFormat format, bool loop = false);
+    ~RawFrameSource() override;
+
+    RawFrameSource(const RawFrameSource&) = delete;
+    RawFrameSource& operator=(const RawFrameSource&) = delete;
+
+    bool next(Frame& frame) override;
+
+private:
+
+    std::FILE* file = nullptr;
+    int width;
+    int height;
+    RawFormat format;
+    bool loop;
+    int next_index = 0;
+    std::vector<unsigned char> staging;
+};
+
+//static background with a sprite bouncing over it, a stand-in for a mostly static camera feed
+//both images are decoded on the first call to next(), on the decoding thread
+class SyntheticSequenceSource : public FrameSource
+{
+public:
+
+    SyntheticSequenceSource(const std::string& background_path, const std::string& sprite_path, int frame_count);
+
+    bool next(Frame& frame) override;
+
+private:
+
+    bool load();
+
+    std::string background_path;
+    std::string sprite_path;
+    int frame_count;
+    int next_index = 0;
+    int width = 0;
+    int height = 0;
+    int sprite_width = 0;
+    int sprite_height = 0;
+    std::vector<unsigned char> background;  //RGB
+    std::vector<unsigned char> sprite;      //RGBA
+};
@@ -0,0 +1,10 @@
+#pragma once
+
+//offscreen OpenGL 3.3 core context for tools that never show a window (benchmarks, tests)
+//a hidden GLFW window by default, EGL without any surface when built with SEVENGER_USE_EGL
+//so it also runs on headless Linux machines with Mesa's llvmpipe
+bool create_headless_gl_context();
+void destroy_headless_gl_context();
+
+//"renderer (version)" of the current context, for reports
+const char* gl_renderer_name();
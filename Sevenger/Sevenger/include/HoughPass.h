@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "EdgePass.h"
+#include "HoughTransform.h"
+#include "Shader.h"
+
+//GPU half of HoughTransform.h: every edge point is an instance of a point list with one vertex per vote
+//(theta bins for lines, circle cells for circles), hough_lines.vs / hough_circles.vs place each vertex on
+//its accumulator cell and additive blending into an R32F target counts the votes
+//
+//OpenGL 3.3 has neither compute shaders nor image atomics, the blend unit does the atomic increment;
+//float counts are exact up to 2^24 votes per cell, so the accumulators match the CPU ones exactly
+class HoughPass
+{
+public:
+
+    //both with hough_vote.fs
+    HoughPass(Shader& line_shader, Shader& circle_shader);
+    ~HoughPass();
+
+    HoughPass(const HoughPass&) = delete;
+    HoughPass& operator=(const HoughPass&) = delete;
+
+    //the same accumulators as hough_lines_accumulate and hough_circles_accumulate, read back synchronously
+    //circles tile their layers into the target, as many radii per pass as fit; false only if one
+    //layer (or the line accumulator) is larger than a texture
+    bool accumulate_lines(const std::vector<EdgePoint>& points, int width, int height, int theta_bins, HoughAccumulator& accumulator);
+    bool accumulate_circles(const std::vector<EdgePoint>& points, int width, int height, int min_radius, int max_radius,
+                            HoughAccumulator& accumulator);
+
+private:
+
+    bool prepare_target(int width, int height);
+    void upload_points(const std::vector<EdgePoint>& points);
+    //clears the target and draws every point once per vertex of the range
+    void vote(GLuint vertex_array, GLint first_vertex, GLsizei vertex_count);
+    //layers first_layer to first_layer + layer_count from the tiles of the target
+    void read(HoughAccumulator& accumulator, int first_layer, int layer_count, int tile_columns);
+
+    Shader& line_shader;
+    Shader& circle_shader;
+    GLuint line_VAO_id = 0;
+    GLuint circle_VAO_id = 0;
+    GLuint direction_VBO_id = 0;
+    GLuint offset_VBO_id = 0;
+    GLuint point_VBO_id = 0;
+    int theta_bins = 0;
+    int min_radius = 0;
+    int max_radius = -1;
+    GLsizei point_count = 0;
+    //first vertex of each radius in the circle cells, and the end
+    std::vector<GLint> layer_first_vertex;
+    int max_target_size = 0;
+    int reported_width = 0;
+    int reported_height = 0;
+    RenderTarget target;
+    std::vector<float> readback;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BinaryEdges.h"
+
+//vote counts of a Hough transform, layers of width x height cells
+//    lines    width theta bins over [0, pi), height rho bins of one pixel, one layer
+//    circles  width x height centers (the image), one layer per radius
+struct HoughAccumulator
+{
+    int width = 0;
+    int height = 0;
+    int layers = 0;
+    std::vector<uint32_t> votes;
+
+    void resize(int width, int height, int layers);
+    uint32_t at(int x, int y, int layer = 0) const { return votes[((size_t)layer * height + y) * width + x]; }
+};
+
+//x cos(theta) + y sin(theta) = rho in map coordinates (pixel centers at whole numbers, rows bottom-up)
+struct HoughLine
+{
+    float theta;
+    float rho;
+    int votes;
+};
+
+struct HoughCircle
+{
+    int x;
+    int y;
+    int radius;
+    int votes;
+};
+
+struct HoughLineConfig
+{
+    int theta_bins = 180;
+    int max_lines = 16;
+    int min_votes = 32;
+    int suppression = 4;    //peaks closer than this many theta and rho bins to a stronger one are dropped
+    int thread_count = 0;   //0 uses every hardware thread
+};
+
+struct HoughCircleConfig
+{
+    int min_radius = 8;
+    int max_radius = 32;
+    int max_circles = 16;
+    float min_coverage = 0.5f;  //votes needed as a share of the cells on the circle
+    int suppression = 4;        //peaks closer than this in x, y and radius to a stronger one are dropped
+    int thread_count = 0;
+};
+
+//rho bins cover [-diagonal, diagonal] of a width x height map, rho r lands in bin r + hough_rho_offset
+int hough_rho_offset(int width, int height);
+
+//cos and sin of every theta bin in 1/32768, rho = (x * cos + y * sin) / 32768 rounded; the same integers
+//go into hough_lines.vs so the GPU counts exactly the same votes, 32-bit sums hold maps up to 16384 pixels
+void hough_line_directions(int theta_bins, std::vector<int32_t>& directions);
+
+//cells at a rounded distance of radius from the center, dx and dy interleaved
+void hough_circle_offsets(int radius, std::vector<int32_t>& offsets);
+
+//every point votes once per theta bin; the points are split across threads, each counts into its own
+//accumulator and the accumulators are summed afterwards, so threads never share a cell
+void hough_lines_accumulate(const std::vector<EdgePoint>& points, int width, int height, int theta_bins,
+                            HoughAccumulator& accumulator, int thread_count = 0);
+
+//every point votes for the centers of the circles through it; threads take whole radii, each owns its
+//layers, so no cell is shared and nothing has to be summed
+void hough_circles_accumulate(const std::vector<EdgePoint>& points, int width, int height, int min_radius, int max_radius,
+                              HoughAccumulator& accumulator, int thread_count = 0);
+
+//the strongest local maxima, at most max_lines / max_circles, strongest first; a peak within the suppression
+//distance of a stronger one is dropped (for lines also across theta = 0, where rho changes sign)
+void hough_line_peaks(const HoughAccumulator& accumulator, const HoughLineConfig& config, std::vector<HoughLine>& lines);
+void hough_circle_peaks(const HoughAccumulator& accumulator, const HoughCircleConfig& config, std::vector<HoughCircle>& circles);
+
+//edge_points, accumulation and peaks in one call
+void hough_lines(const BinaryEdgeMap& map, const HoughLineConfig& config, std::vector<HoughLine>& lines);
+void hough_circles(const BinaryEdgeMap& map, const HoughCircleConfig& config, std::vector<HoughCircle>& circles);
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+//rows start on 64-byte boundaries (one cache line, one AVX-512 register)
+constexpr size_t IMAGE_ALIGNMENT = 64;
+
+enum class PixelLayout
+{
+    INTERLEAVED,  //RGBARGBA..., one plane
+    PLANAR        //RRRR..., GGGG..., one plane per channel
+};
+
+void* aligned_allocate(size_t size, size_t alignment);
+void aligned_free(void* pointer);
+
+//recycles image buffers so steady-state batch processing does not touch the heap
+//a released buffer is handed out again for any request it can hold without
+//wasting more than half of it
+class ImagePool
+{
+public:
+
+    ImagePool() = default;
+    ~ImagePool();
+
+    ImagePool(const ImagePool&) = delete;
+    ImagePool& operator=(const ImagePool&) = delete;
+
+    void* acquire(size_t size, size_t& capacity);
+    void release(void* pointer, size_t capacity);
+
+    //frees every buffer currently held by the pool
+    void trim();
+
+    uint64_t heap_allocations() const;
+    uint64_t reuses() const;
+    size_t bytes_cached() const;
+
+private:
+
+    struct Block
+    {
+        void* pointer;
+        size_t capacity;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Block> free_blocks;
+    uint64_t allocation_count = 0;
+    uint64_t reuse_count = 0;
+    size_t cached_bytes = 0;
+};
+
+//owning 8-bit image with padded rows, move-only
+//the buffer carries IMAGE_ALIGNMENT bytes of slack after the last row so vector
+//loads that run past the right border never leave the allocation
+class Image
+{
+public:
+
+    Image() = default;
+    Image(int width, int height, int channels, PixelLayout layout = PixelLayout::INTERLEAVED, ImagePool* pool = nullptr);
+    ~Image();
+
+    Image(Image&& other) noexcept;
+    Image& operator=(Image&& other) noexcept;
+    Image(const Image&) = delete;
+    Image& operator=(const Image&) = delete;
+
+    //gives the buffer back to its pool (or the heap)
+    void release();
+
+    bool empty() const { return pixels == nullptr; }
+    int width() const { return image_width; }
+    int height() const { return image_height; }
+    int channels() const { return image_channels; }
+    PixelLayout layout() const { return pixel_layout; }
+
+    int plane_count() const { return pixel_layout == PixelLayout::PLANAR ? image_channels : 1; }
+    //channels stored per pixel within one plane
+    int pixel_stride() const { return pixel_layout == PixelLayout::PLANAR ? 1 : image_channels; }
+    //bytes between two rows of the same plane, a multiple of IMAGE_ALIGNMENT
+    size_t stride() const { return row_stride; }
+
+    unsigned char* plane(int index) { return pixels + (size_t)index * plane_size(); }
+    const unsigned char* plane(int index) const { return pixels + (size_t)index * plane_size(); }
+    unsigned char* row(int y, int plane_index = 0) { return plane(plane_index) + (size_t)y * row_stride; }
+    const unsigned char* row(int y, int plane_index = 0) const { return plane(plane_index) + (size_t)y * row_stride; }
+
+    //copies tightly or loosely packed interleaved pixels in, converting to the image layout
+    void copy_from_interleaved(const unsigned char* src, size_t src_stride);
+    //writes interleaved pixels out, e.g. for upload with glTexImage2D
+    void copy_to_interleaved(unsigned char* dst, size_t dst_stride) const;
+
+private:
+
+    size_t plane_size() const { return row_stride * (size_t)image_height; }
+
+    unsigned char* pixels = nullptr;
+    size_t capacity = 0;
+    ImagePool* pool = nullptr;
+    int image_width = 0;
+    int image_height = 0;
+    int image_channels = 0;
+    PixelLayout pixel_layout = PixelLayout::INTERLEAVED;
+    size_t row_stride = 0;
+};
+
+//decodes with stb_image into a (pooled) image, desired_channels 0 keeps the file's channel count
+bool load_image(const char* path, Image& image, int desired_channels = 0,
+                PixelLayout layout = PixelLayout::INTERLEAVED, ImagePool* pool = nullptr);
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//per-pixel comparison of two 8-bit single channel images
+struct ImageDiff
+{
+    int max_error = 0;
+    double mean_error = 0.0;
+    double psnr = 0.0;          //dB, 99 for identical images
+    size_t over_tolerance = 0;  //pixels whose error is above the tolerance
+};
+
+ImageDiff diff_images(const unsigned char* a, size_t a_stride, const unsigned char* b, size_t b_stride,
+                      int width, int height, int tolerance);
+
+//binary PGM (P5), rows are bottom-up in memory like every other image here and are
+//flipped on disk so the files open the right way up in image viewers
+bool write_pgm(const std::string& path, const unsigned char* pixels, size_t stride, int width, int height);
+bool read_pgm(const std::string& path, std::vector<unsigned char>& pixels, int& width, int& height);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "BinaryEdges.h"
+
+//output formats for edge maps (and any other 8-bit image)
+//    PGM    8-bit gray, uncompressed (P5)
+//    PBM    1 bit per pixel (P4), rows padded to whole bytes; set bits are edges, which
+//           image viewers show as black on white
+//    PNG    deflate with our own encoder, rows split across threads
+//    QOI    "Quite OK Image" format, much faster than PNG at a larger size, also split across threads
+//    EDGES  1 bit per pixel like PBM, stored as runs or points instead when that is smaller (see BinaryEdges.h)
+//PBM and EDGES keep the pixels at or above BINARY_EDGE_THRESHOLD
+enum class ImageFormat
+{
+    PGM,
+    PBM,
+    PNG,
+    QOI,
+    EDGES
+};
+
+//parses "pgm", "pbm", "png", "qoi" or "edges"
+bool parse_image_format(const std::string& name, ImageFormat& format);
+const char* image_format_name(ImageFormat format);
+//".pgm", ".pbm", ".png", ".qoi" or ".edges"
+const char* image_format_extension(ImageFormat format);
+
+struct ImageEncoderConfig
+{
+    int thread_count = 0;  //0 uses every hardware thread, small images always use one
+    int png_level = 6;     //0 stores uncompressed, 1 is the fastest, 9 the smallest
+};
+
+//encodes rows that are bottom-up in memory into a file image (top row first, like every format stores it)
+//PGM, PBM and EDGES take 1 channel, PNG and QOI 1, 3 or 4; QOI has no gray mode, 1 channel is stored as RGB
+bool encode_image(ImageFormat format, const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                  std::vector<unsigned char>& file, const ImageEncoderConfig& config = {});
+
+bool write_image(const std::string& path, ImageFormat format, const unsigned char* pixels, size_t stride, int width, int height,
+                 int channels, const ImageEncoderConfig& config = {});
+
+//reads any file encode_image writes back into tightly packed bottom-up rows, for round-trip checks:
+//PBM and EDGES become 0/255 gray, QOI 3 or 4 channels, PNG and PGM go through stb_image
+bool decode_image(const unsigned char* file, size_t size, std::vector<unsigned char>& pixels, int& width, int& height, int& channels);
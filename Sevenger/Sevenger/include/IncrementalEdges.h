@@ -0,0 +1,72 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "EdgePass.h"
+#include "Image.h"
+#include "Region.h"
+#include "Shader.h"
+
+//edge maps of a frame that changes in places (annotations, partial updates, static backgrounds)
+//update() takes the rects that changed since the last call: only those are converted/uploaded,
+//and the Sobel reruns on them grown by a 1 pixel halo, the reach of its 3x3 kernel
+//an optional region of interest limits all work to that rect, edges outside it stay stale
+
+//fixed-point Sobel, the result matches sobel_u8_simd on the whole frame inside the ROI
+class IncrementalEdgesCpu
+{
+public:
+
+    //empty rect for the whole frame, takes effect on the next reset
+    void set_roi(const Rect& roi) { roi_rect = roi; }
+
+    //recomputes everything, needed first and whenever the size or channel count changes
+    void reset(const unsigned char* pixels, size_t stride, int width, int height, int channels);
+    void update(const unsigned char* pixels, size_t stride, const std::vector<Rect>& dirty);
+
+    const Image& edges() const { return edge_map; }
+    //edge pixels computed by the last reset/update
+    size_t pixels_processed() const { return processed; }
+
+private:
+
+    void recompute(const unsigned char* pixels, size_t stride, const Rect& changed);
+
+    Image luma;
+    Image edge_map;
+    int channels = 0;
+    Rect roi_rect;
+    Rect active;
+    size_t processed = 0;
+};
+
+//edge_detection.fs through an EdgePass, uploads with glTexSubImage2D and shades with a scissor
+class IncrementalEdgesGpu
+{
+public:
+
+    explicit IncrementalEdgesGpu(Shader& edge_shader);
+    ~IncrementalEdgesGpu();
+
+    IncrementalEdgesGpu(const IncrementalEdgesGpu&) = delete;
+    IncrementalEdgesGpu& operator=(const IncrementalEdgesGpu&) = delete;
+
+    void set_roi(const Rect& roi) { roi_rect = roi; }
+
+    void reset(const unsigned char* pixels, size_t stride, int width, int height, int channels);
+    void update(const unsigned char* pixels, size_t stride, const std::vector<Rect>& dirty);
+
+    GLuint output_texture() const { return target.texture; }
+    const RenderTarget& render_target() const { return target; }
+    size_t pixels_processed() const { return processed; }
+
+private:
+
+    EdgePass pass;
+    GLuint input_texture = 0;
+    RenderTarget target;
+    int channels = 0;
+    Rect roi_rect;
+    Rect active;
+    size_t processed = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include "EdgePass.h"
+#include "Shader.h"
+#include "SobelCpu.h"
+
+class BinaryEdgeMap;
+
+//GPU half of the fixed-point Sobel path (see SobelCpu.h): luma is uploaded as R8UI,
+//edge_detection_int.fs writes an R8UI edge map that matches the CPU backends bit for bit
+class IntegerSobelPass
+{
+public:
+
+    explicit IntegerSobelPass(Shader& int_edge_shader);
+    ~IntegerSobelPass();
+
+    IntegerSobelPass(const IntegerSobelPass&) = delete;
+    IntegerSobelPass& operator=(const IntegerSobelPass&) = delete;
+
+    //kernel and thresholds of the following runs, the defaults are plain Sobel with no thresholds:
+    //magnitudes below low become 0, magnitudes at or above high become 255
+    void set_kernel(GradientKernel kernel);
+    void set_thresholds(int low, int high);
+
+    //uploads, runs and reads back synchronously, rows keep their order
+    void run(const unsigned char* luma, size_t luma_stride,
+             unsigned char* dst, size_t dst_stride, int width, int height);
+
+    //3 or 4 interleaved channels, writes the strongest edge of R, G and B
+    void run_color(const unsigned char* pixels, size_t stride, int channels,
+                   unsigned char* dst, size_t dst_stride, int width, int height);
+
+    //packs edges on the GPU too: edge_pack.fs gathers 8 pixels into a byte, so only a bit per pixel is read back
+    void enable_packing(Shader& pack_edges_shader);
+    bool packing_enabled() const { return pack_pass != nullptr; }
+
+    //run or run_color (channels 1 or 3 to 4) reduced to a BinaryEdgeMap, magnitudes at or above threshold
+    //after the thresholds are edges; needs enable_packing
+    void run_packed(const unsigned char* pixels, size_t stride, int channels, int width, int height, int threshold,
+                    BinaryEdgeMap& map);
+
+    //sub-pixel edges of luma with edge_detection_subpixel.fs, 4 bytes per pixel (see SubpixelEdges.h)
+    //computed in the same draw as the magnitude, the thresholds apply, the kernel too
+    void enable_subpixel(Shader& subpixel_edge_shader);
+    bool subpixel_enabled() const { return subpixel_pass != nullptr; }
+    void run_subpixel(const unsigned char* luma, size_t luma_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height);
+
+    GLuint output_texture() const;
+
+private:
+
+    void upload(const unsigned char* pixels, size_t stride, int channels, int width, int height);
+    void render(int channel_count, int width, int height);
+    void run_and_read(int channel_count, unsigned char* dst, size_t dst_stride, int width, int height);
+
+    Shader& int_edge_shader;
+    EdgePass edge_pass;
+    GradientKernel kernel = GradientKernel::SOBEL;
+    int low_threshold = 0;
+    int high_threshold = 255;
+    GLuint input_texture = 0;
+    int input_width = 0;
+    int input_height = 0;
+    int input_channels = 0;
+    RenderTarget target;
+    Shader* pack_shader = nullptr;
+    std::unique_ptr<EdgePass> pack_pass;
+    RenderTarget packed_target;
+    Shader* subpixel_shader = nullptr;
+    std::unique_ptr<EdgePass> subpixel_pass;
+    RenderTarget subpixel_target;
+};
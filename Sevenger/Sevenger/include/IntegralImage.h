@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//summed-area table of an 8-bit plane: the sum over any rectangle in four lookups, whatever its size
+//sums has a zero first row and column, entry (x, y) holds the sum over [0, x) x [0, y)
+//
+//the sums are 32-bit and wrap on images above 16.8 megapixels, but box_sum subtracts modulo 2^32 as
+//well, so every rectangle of up to 16.8 megapixels still comes out exact
+struct IntegralImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint32_t> sums;
+
+    void resize(int width, int height);
+    size_t stride() const { return (size_t)width + 1; }
+    uint32_t at(int x, int y) const { return sums[(size_t)y * stride() + x]; }
+    //sum over [x0, x1) x [y0, y1)
+    uint32_t box_sum(int x0, int y0, int x1, int y1) const { return at(x1, y1) - at(x0, y1) - at(x1, y0) + at(x0, y0); }
+};
+
+//every backend (scalar, SIMD, threaded and IntegralImagePass) gives the same table
+//the SIMD version scans 4 pixels at once in registers (two shifted adds and the carry of the last 4)
+//and adds the row above 4 columns at a time
+void integral_image_u8_scalar(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral);
+void integral_image_u8_simd(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral);
+//block scan over row bands: every thread builds the table of its band as if it were alone, the last
+//rows of the bands are scanned one after the other, then every thread adds the rows above its band
+void integral_image_u8_threaded(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral,
+                                int thread_count = 0);
+
+//windows up to this radius keep the threshold compare exact in single precision floats
+constexpr int ADAPTIVE_THRESHOLD_MAX_RADIUS = 127;
+
+struct AdaptiveThresholdConfig
+{
+    int radius = 7;          //window of (2 radius + 1)^2 pixels, clipped at the borders
+    int offset = 8;          //how far above the window's mean a magnitude has to be
+    int min_magnitude = 16;  //weaker magnitudes are never edges, keeps flat areas from turning into noise
+    int thread_count = 0;    //threaded version, 0 uses every hardware thread
+};
+
+//local-mean thresholding of an edge magnitude plane, integral is its summed-area table:
+//a pixel becomes 255 when magnitude >= min_magnitude and magnitude - offset >= the window's mean, else 0;
+//edges of a dim region count as much as edges of a busy one, unlike one global threshold
+//the compare is done as (magnitude - offset) * area >= sum, so all backends agree exactly
+void adaptive_threshold_u8_scalar(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                  unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config);
+void adaptive_threshold_u8_simd(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config);
+void adaptive_threshold_u8_threaded(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                    unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "EdgePass.h"
+#include "IntegralImage.h"
+#include "Shader.h"
+
+//GPU half of IntegralImage.h: the summed-area table is built by integral_scan.fs, log4(width) passes
+//along rows and log4(height) along columns ping-ponging between R32UI targets, and adaptive_threshold.fs
+//thresholds against it without the table ever leaving the GPU
+//
+//OpenGL 3.3 has no compute shaders, so there is no shared memory for a work-efficient (Blelloch) scan;
+//every fragment pass recomputes its texel from the previous pass, which costs O(n log n) additions
+//instead of O(n), but the passes run at full fragment rate and the sums are the exact integers of the CPU
+class IntegralImagePass
+{
+public:
+
+    //integral_scan.fs and adaptive_threshold.fs
+    IntegralImagePass(Shader& scan_shader, Shader& threshold_shader);
+    ~IntegralImagePass();
+
+    IntegralImagePass(const IntegralImagePass&) = delete;
+    IntegralImagePass& operator=(const IntegralImagePass&) = delete;
+
+    //uploads, scans and reads back synchronously, the same table as integral_image_u8_scalar
+    void run(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral);
+
+    //adaptive_threshold_u8_scalar of magnitudes including its table, only the 0/255 result is read back
+    void run_adaptive(const unsigned char* magnitude, size_t magnitude_stride, unsigned char* dst, size_t dst_stride,
+                      int width, int height, const AdaptiveThresholdConfig& config);
+
+private:
+
+    //scans the uploaded plane, returns the target holding the table
+    const RenderTarget& scan(const unsigned char* src, size_t src_stride, int width, int height);
+
+    Shader& scan_shader;
+    Shader& threshold_shader;
+    EdgePass scan_pass;
+    EdgePass threshold_pass;
+    GLuint input_texture = 0;
+    int input_width = 0;
+    int input_height = 0;
+    RenderTarget targets[2];
+    RenderTarget threshold_target;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//blocking stream socket on a Unix domain socket path, move-only
+//AF_UNIX also exists on Windows 10 1803 and later (afunix.h), so both platforms share the protocol
+class LocalSocket
+{
+public:
+
+    LocalSocket() = default;
+    ~LocalSocket();
+
+    LocalSocket(LocalSocket&& other) noexcept;
+    LocalSocket& operator=(LocalSocket&& other) noexcept;
+    LocalSocket(const LocalSocket&) = delete;
+    LocalSocket& operator=(const LocalSocket&) = delete;
+
+    //server side, replaces a stale socket file left by a crashed server
+    bool listen(const std::string& path, int backlog = 64);
+    //next pending connection of a listening socket, not open on failure
+    LocalSocket accept();
+
+    bool connect(const std::string& path);
+
+    //block until every byte went out / came in, false on errors and when the peer closed
+    bool send_all(const void* data, size_t size);
+    bool receive_all(void* data, size_t size);
+    //one receive of up to size bytes, whatever has arrived; does not block once poll_readable reported
+    //the socket, false on errors and when the peer closed
+    bool receive_some(void* data, size_t size, size_t& received);
+
+    bool is_open() const { return handle != -1; }
+    void close();
+
+private:
+
+    friend bool poll_readable(const std::vector<LocalSocket*>& sockets, int timeout_ms, std::vector<bool>& readable);
+
+    intptr_t handle = -1;
+    std::string bound_path;  //unlinked again by the listening socket
+};
+
+//waits up to timeout_ms (-1 forever) until at least one socket can be read or accepted from,
+//readable[i] tells which; false on errors, a timeout returns true with nothing readable
+bool poll_readable(const std::vector<LocalSocket*>& sockets, int timeout_ms, std::vector<bool>& readable);
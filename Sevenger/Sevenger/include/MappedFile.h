@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//read-only memory mapping of a whole file, move-only
+class MappedFile
+{
+public:
+
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //returns false if the file does not exist or cannot be mapped, empty files map to size 0
+    bool open(const std::string& path);
+    void close();
+
+    bool is_open() const { return opened; }
+    const unsigned char* data() const { return (const unsigned char*)view; }
+    size_t size() const { return view_size; }
+
+private:
+
+    void* view = nullptr;
+    size_t view_size = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
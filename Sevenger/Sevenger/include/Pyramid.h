@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include "Image.h"
+
+//2x2 box filter of one 8-bit plane, (a + b + c + d + 2) >> 2 like the texture cache mips
+//the result is max(1, width / 2) x max(1, height / 2), odd edges reuse the last row/column
+void downsample_2x2_u8_scalar(const unsigned char* src, size_t src_stride,
+                              unsigned char* dst, size_t dst_stride, int width, int height);
+
+//SSE2 when available, bit-exact with the scalar path
+void downsample_2x2_u8_simd(const unsigned char* src, size_t src_stride,
+                            unsigned char* dst, size_t dst_stride, int width, int height);
+
+//mip chain of a single channel image, level 0 is the source itself and is not copied
+class LumaPyramid
+{
+public:
+
+    //keeps a pointer to luma, which must outlive the pyramid
+    void build(const Image& luma, int level_count, ImagePool* pool = nullptr);
+
+    int level_count() const { return base ? (int)levels.size() + 1 : 0; }
+    const Image& level(int index) const { return index == 0 ? *base : levels[index - 1]; }
+
+private:
+
+    const Image* base = nullptr;
+    std::vector<Image> levels;
+};
+
+//fixed-point Sobel on levels [first_level, first_level + level_count), combined by taking the maximum
+//edges is sized like first_level, coarser responses are upsampled with nearest neighbour
+void sobel_multiscale_u8(const LumaPyramid& pyramid, int first_level, int level_count, Image& edges, ImagePool* pool = nullptr);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//pixel rectangle, x/y is the first column/row in the same bottom-up row order as the images
+struct Rect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    size_t area() const { return empty() ? 0 : (size_t)width * height; }
+};
+
+Rect intersect_rects(const Rect& a, const Rect& b);
+Rect bounding_rect(const Rect& a, const Rect& b);
+
+//grows a rect by halo pixels on every side and clips it to a width x height image
+Rect expand_rect(const Rect& rect, int halo, int width, int height);
+
+//changed areas of an image between two updates
+//overlapping or touching rects are merged as they are added, and past max_rects
+//everything collapses into one bounding rect so the list stays short
+class DirtyRegion
+{
+public:
+
+    explicit DirtyRegion(size_t max_rects = 16) : max_rects(max_rects) {}
+
+    void add(const Rect& rect);
+    void clear() { rect_list.clear(); }
+
+    bool empty() const { return rect_list.empty(); }
+    const std::vector<Rect>& rects() const { return rect_list; }
+    size_t area() const;
+
+private:
+
+    size_t max_rects;
+    std::vector<Rect> rect_list;
+};
@@ -5,6 +5,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -46,39 +47,18 @@ public:
         {
             std::cout << "ERROR: SHADER FILE READING FAILED: " << e.what() << std::endl;
         }
-        const char* vertex_shader_code = vertex_code.c_str();
-        const char* fragment_shader_code = fragment_code.c_str();
         // ------------------------------------------------------
-        
-        //compile shader
-        // -------------
-        GLuint vertex_shader_id, fragment_shader_id;
-
-        //vertex shader
-        vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex_shader_id, 1, &vertex_shader_code, nullptr);
-        glCompileShader(vertex_shader_id);
-        check_compile_errors(vertex_shader_id, "VERTEX SHADER");
 
-        //fragment shader
-        fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment_shader_id, 1, &fragment_shader_code, nullptr);
-        glCompileShader(fragment_shader_id);
-        check_compile_errors(fragment_shader_id, "FRAGMENT SHADER");
+        compile(vertex_code, fragment_code);
+    }
 
-        //shader program
-        shader_program_id = glCreateProgram();
-        glAttachShader(shader_program_id, vertex_shader_id);
-        glAttachShader(shader_program_id, fragment_shader_id);
-        glLinkProgram(shader_program_id);
-        check_compile_errors(shader_program_id, "SHADER PROGRAM");
-        // ------------------------------------------------
-        
-        //delete shaders after they are linked
-        glDetachShader(shader_program_id, vertex_shader_id);
-        glDetachShader(shader_program_id, fragment_shader_id);
-        glDeleteShader(vertex_shader_id);
-        glDeleteShader(fragment_shader_id);
+    //compiles sources that are already in memory, e.g. views into an AssetPack
+    //the views do not need to be null terminated
+    static Shader from_source(std::string_view vertex_code, std::string_view fragment_code)
+    {
+        Shader shader;
+        shader.compile(vertex_code, fragment_code);
+        return shader;
     }
     
     void use()
@@ -107,7 +87,52 @@ public:
         glUniform2fv(glGetUniformLocation(shader_program_id, name.c_str()), 1, &value[0]);
     }
 
+    void set_ivec2(const std::string& name, int x, int y) const
+    {
+        glUniform2i(glGetUniformLocation(shader_program_id, name.c_str()), x, y);
+    }
+
 private:
+
+    Shader() = default;
+
+    void compile(std::string_view vertex_code, std::string_view fragment_code)
+    {
+        const char* vertex_shader_code = vertex_code.data();
+        const char* fragment_shader_code = fragment_code.data();
+        GLint vertex_shader_length = (GLint)vertex_code.size();
+        GLint fragment_shader_length = (GLint)fragment_code.size();
+
+        //compile shader
+        // -------------
+        GLuint vertex_shader_id, fragment_shader_id;
+
+        //vertex shader
+        vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex_shader_id, 1, &vertex_shader_code, &vertex_shader_length);
+        glCompileShader(vertex_shader_id);
+        check_compile_errors(vertex_shader_id, "VERTEX SHADER");
+
+        //fragment shader
+        fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment_shader_id, 1, &fragment_shader_code, &fragment_shader_length);
+        glCompileShader(fragment_shader_id);
+        check_compile_errors(fragment_shader_id, "FRAGMENT SHADER");
+
+        //shader program
+        shader_program_id = glCreateProgram();
+        glAttachShader(shader_program_id, vertex_shader_id);
+        glAttachShader(shader_program_id, fragment_shader_id);
+        glLinkProgram(shader_program_id);
+        check_compile_errors(shader_program_id, "SHADER PROGRAM");
+        // ------------------------------------------------
+        
+        //delete shaders after they are linked
+        glDetachShader(shader_program_id, vertex_shader_id);
+        glDetachShader(shader_program_id, fragment_shader_id);
+        glDeleteShader(vertex_shader_id);
+        glDeleteShader(fragment_shader_id);
+    }
     
     void check_compile_errors(unsigned int shader, std::string type)
     {
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//named read-write shared memory segment, move-only
+//the creator owns the name: on POSIX it unlinks it in close(), on Windows the segment lives
+//until the last handle is closed
+class SharedMemory
+{
+public:
+
+    SharedMemory() = default;
+    ~SharedMemory();
+
+    SharedMemory(SharedMemory&& other) noexcept;
+    SharedMemory& operator=(SharedMemory&& other) noexcept;
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    //creates a new segment of size bytes, fails if the name is taken
+    bool create(const std::string& name, size_t size);
+    //maps an existing segment, size must not exceed the size it was created with
+    bool open(const std::string& name, size_t size);
+    void close();
+
+    bool is_open() const { return view != nullptr; }
+    unsigned char* data() { return (unsigned char*)view; }
+    const unsigned char* data() const { return (const unsigned char*)view; }
+    size_t size() const { return view_size; }
+    const std::string& name() const { return segment_name; }
+
+private:
+
+    void* view = nullptr;
+    size_t view_size = 0;
+    bool owner = false;
+    std::string segment_name;
+#ifdef _WIN32
+    void* mapping_handle = nullptr;
+#endif
+};
+
+//process unique segment name, tag tells segments of one process apart
+std::string shared_memory_name(const std::string& prefix, unsigned tag);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//pre-smoothing of 8-bit planes before the gradients, keeps noise and fine texture from turning into edges
+//    GAUSSIAN  separable convolution with a kernel of radius ceil(3 sigma), cost grows with sigma
+//    BOX       three running-sum box passes whose sizes approximate the Gaussian, cost independent of sigma
+//    DERICHE   Deriche's recursive smoothing filter k (a|x| + 1) e^(-a|x|) with a = 2 / sigma (the same variance
+//              as the Gaussian), a causal and an anticausal second-order pass, cost independent of sigma
+//every filter runs rows first, rounds to 8 bits, then columns; borders repeat the edge pixel
+enum class SmoothingFilter
+{
+    NONE,
+    GAUSSIAN,
+    BOX,
+    DERICHE
+};
+
+//sigmas are clamped to this, larger ones smooth away everything but the largest structures anyway
+constexpr float SMOOTHING_MAX_SIGMA = 64.0f;
+
+//parses "none", "gaussian", "box" or "deriche"
+bool parse_smoothing_filter(const std::string& name, SmoothingFilter& filter);
+const char* smoothing_filter_name(SmoothingFilter filter);
+
+//half of a symmetric convolution kernel, weights[0] is the center, weights[i] applies at +-i, sums to 1:
+//the Gaussian, or for DERICHE its impulse response cut off below 1/1000 of the peak (what smoothing.fs
+//convolves with, a fragment shader cannot run a recursion along a line); empty for NONE and BOX
+void smoothing_weights(SmoothingFilter filter, float sigma, std::vector<float>& weights);
+
+//odd widths of the three box passes for sigma (Kovesi's choice of two neighbouring widths)
+void smoothing_box_widths(float sigma, int widths[3]);
+
+//src and dst may be the same plane; NONE or a sigma of 0 copies
+//the SIMD version filters 4 rows and then 16 columns at once, the lanes do exactly the scalar float
+//operations so both give the same bytes
+void smooth_u8_scalar(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height);
+void smooth_u8_simd(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                    unsigned char* dst, size_t dst_stride, int width, int height);
+//smooth_u8_simd with the row pass split into row bands and the column pass into column strips across
+//threads, thread_count 0 uses every hardware thread
+void smooth_u8_threaded(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                        unsigned char* dst, size_t dst_stride, int width, int height, int thread_count = 0);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <vector>
+#include "EdgePass.h"
+#include "Shader.h"
+#include "Smoothing.h"
+
+//the widest kernel half smoothing.fs takes (its weights array minus the center)
+constexpr int SMOOTHING_GL_MAX_RADIUS = 63;
+
+//largest difference to smooth_u8_scalar, from float rounding and the convolution standing in for DERICHE
+constexpr int SMOOTHING_GL_TOLERANCE = 2;
+
+//largest sigma whose GAUSSIAN or DERICHE kernel fits SMOOTHING_GL_MAX_RADIUS (21 and about 13.6),
+//SMOOTHING_MAX_SIGMA for the filters the GL pass runs at any sigma
+float smoothing_gl_max_sigma(SmoothingFilter filter);
+
+//GPU half of Smoothing.h: rows and then columns, float intermediates between the passes of a direction and
+//8 bits between the directions like the CPU
+//
+//a fragment computes its pixel on its own, so the recursions along a line that make DERICHE independent
+//of sigma on the CPU do not map onto it: GAUSSIAN and DERICHE convolve with smoothing_weights in
+//smoothing.fs, one fullscreen pass per direction at O(radius) per pixel, with sigma clamped to
+//smoothing_gl_max_sigma; BOX takes the running sums as prefix sums instead, log4(length) passes of the
+//box_scan.fs scan and one box_smoothing.fs lookup per box, the same cost at every sigma; results are
+//within SMOOTHING_GL_TOLERANCE of the CPU ones, not bit-exact
+class SmoothingPass
+{
+public:
+
+    SmoothingPass(Shader& smoothing_shader, Shader& box_scan_shader, Shader& box_shader);
+    ~SmoothingPass();
+
+    SmoothingPass(const SmoothingPass&) = delete;
+    SmoothingPass& operator=(const SmoothingPass&) = delete;
+
+    //smooths every channel of a width x height texture into output_texture() (RGBA8)
+    //false if a render target cannot be created, NONE copies
+    bool run(GLuint input_texture, int width, int height, SmoothingFilter filter, float sigma);
+    GLuint output_texture() const { return output_target.texture; }
+
+    //uploads 8-bit luma, runs and reads back synchronously, rows keep their order
+    bool run(const unsigned char* luma, size_t luma_stride, unsigned char* dst, size_t dst_stride,
+             int width, int height, SmoothingFilter filter, float sigma);
+
+private:
+
+    //single_channel keeps the BOX sums in R32UI and R32F targets for the luma upload, a quarter of the memory
+    bool run(GLuint input_texture, int width, int height, SmoothingFilter filter, float sigma, bool single_channel);
+    void draw(GLuint input_texture, const RenderTarget& target, int dx, int dy, const std::vector<float>& weights);
+    bool run_box(GLuint input_texture, int width, int height, const std::vector<int>& radii, bool single_channel);
+
+    Shader& smoothing_shader;
+    Shader& box_scan_shader;
+    Shader& box_shader;
+    EdgePass pass;
+    EdgePass scan_pass;
+    EdgePass box_pass;
+    //BOX: the prefix sums ping-pong between sum_targets, a box leaves its levels in level_target for the next one
+    RenderTarget sum_targets[2];
+    RenderTarget level_target;
+    RenderTarget row_target;
+    RenderTarget output_target;
+    GLuint luma_texture = 0;
+    int luma_width = 0;
+    int luma_height = 0;
+};
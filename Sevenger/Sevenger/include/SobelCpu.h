@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+
+class Image;
+struct Rect;
+
+//fixed-point Sobel on 8-bit luma
+//every backend (scalar, SIMD and edge_detection_int.fs) computes exactly
+//    luma      = (77 * r + 150 * g + 29 * b + 128) >> 8
+//    magnitude = min(|gx| + |gy|, 255)
+//with 16-bit accumulators and clamp-to-edge borders, so their outputs are bit-exact
+//
+//the gradient_u8 functions take the kernel as a parameter, all kernels share that contract with
+//[a b a] smoothing across the derivative and magnitude = min((|gx| + |gy|) >> shift, 255)
+//    SOBEL    a = 1, b = 2
+//    PREWITT  a = 1, b = 1
+//    SCHARR   a = 3, b = 10, shift 2 keeps the magnitude in the Sobel range
+
+//converts 1, 2, 3 or 4 channel pixels to luma, gray and gray+alpha inputs are copied
+void luma_u8(const unsigned char* src, size_t src_stride, int channels,
+             unsigned char* dst, size_t dst_stride, int width, int height);
+
+//same weights on separate R, G and B planes, the planar layout lets the compiler vectorize it
+void luma_u8_planar(const unsigned char* r, const unsigned char* g, const unsigned char* b, size_t src_stride,
+                    unsigned char* dst, size_t dst_stride, int width, int height);
+
+//dispatches on the image layout, luma must be a single channel image of the same size
+void luma_u8(const Image& src, Image& luma);
+
+enum class GradientKernel
+{
+    SOBEL,
+    PREWITT,
+    SCHARR
+};
+
+struct GradientWeights
+{
+    int a;
+    int b;
+    int shift;
+};
+
+GradientWeights gradient_weights(GradientKernel kernel);
+
+void gradient_u8_scalar(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                        unsigned char* dst, size_t dst_stride, int width, int height);
+
+//SSE2 when available (always on x64), falls back to the scalar path otherwise
+void gradient_u8_simd(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height);
+
+//only the pixels inside region, neighbours outside it are still read with clamp-to-edge
+//so the result matches the same pixels of a full image pass
+void gradient_u8_simd_region(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                             unsigned char* dst, size_t dst_stride, int width, int height, const Rect& region);
+
+//gradient_u8_simd split into row bands across threads, thread_count 0 uses every hardware thread
+void gradient_u8_threaded(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, int thread_count = 0);
+
+//the same with GradientKernel::SOBEL
+void sobel_u8_scalar(const unsigned char* src, size_t src_stride,
+                     unsigned char* dst, size_t dst_stride, int width, int height);
+void sobel_u8_simd(const unsigned char* src, size_t src_stride,
+                   unsigned char* dst, size_t dst_stride, int width, int height);
+void sobel_u8_simd_region(const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, const Rect& region);
+void sobel_u8_threaded(const unsigned char* src, size_t src_stride,
+                       unsigned char* dst, size_t dst_stride, int width, int height, int thread_count = 0);
+
+//float port of edge_detection.fs, used to check the GPU reference pass rather than for speed
+//per channel Sobel on up to three color channels (gray images only have R, like a GL_RED texture),
+//magnitude = |gx| + |gy| with |g| the length of the RGB gradient, rounded and clamped to 255
+//borders wrap like the GL_REPEAT textures created by load_texture
+void sobel_rgb_reference(const unsigned char* src, size_t src_stride, int channels,
+                         unsigned char* dst, size_t dst_stride, int width, int height);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SobelCpu.h"
+
+class Image;
+
+//sub-pixel edges: the fixed-point gradients of SobelCpu.h with the edge position refined by a parabola
+//through the magnitudes of the pixel and its two neighbours along the gradient, written as 4 bytes per pixel
+//    0  magnitude, the same value gradient_u8 and the thresholds give
+//    1  gradient direction in 1/256 turns, counterclockwise from +x with y counting rows as stored (bottom-up)
+//    2  offset of the parabola's peak from the pixel center in 1/128 pixels, signed (-64 to 64)
+//    3  SUBPIXEL_EDGE_* flags
+//the parabola is fitted along x when |gx| >= |gy| and along y otherwise (Devernay's choice), the offset
+//runs along that axis; pixels whose thresholded magnitude is 0 are all zero
+//
+//every backend (scalar, SIMD and edge_detection_subpixel.fs) computes the direction from the integer
+//gradients through the same arctangent table and the offset with integer division, so they are bit-exact
+constexpr unsigned char SUBPIXEL_EDGE_MAXIMUM = 1;   //local maximum along the fit axis, the offset is set
+constexpr unsigned char SUBPIXEL_EDGE_VERTICAL = 2;  //fitted along y
+
+//arctangent of i / 256 in 1/256 turns for i = 0 to 256, the table edge_detection_subpixel.fs is given
+const int* subpixel_atan_table();
+
+//src is 8-bit luma, dst 4 bytes per pixel; magnitudes below low become 0, at or above high 255
+//the SIMD version does the gradients and the fit 8 pixels at once; every row's gradients are computed once
+//and kept for the row above and below, so the image is read a single time
+void subpixel_edges_u8_scalar(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                              unsigned char* dst, size_t dst_stride, int width, int height,
+                              int low_threshold = 0, int high_threshold = 255);
+void subpixel_edges_u8_simd(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                            unsigned char* dst, size_t dst_stride, int width, int height,
+                            int low_threshold = 0, int high_threshold = 255);
+//subpixel_edges_u8_simd split into row bands across threads, thread_count 0 uses every hardware thread
+void subpixel_edges_u8_threaded(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                                unsigned char* dst, size_t dst_stride, int width, int height,
+                                int low_threshold = 0, int high_threshold = 255, int thread_count = 0);
+
+//position of a local maximum in pixels (centers at whole numbers, rows bottom-up), direction in radians
+struct SubpixelEdgePoint
+{
+    float x;
+    float y;
+    float direction;
+    int magnitude;
+};
+
+//the SUBPIXEL_EDGE_MAXIMUM pixels of a 4 channel sub-pixel edge image in row order
+void subpixel_edge_points(const Image& edges, std::vector<SubpixelEdgePoint>& points);
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+//decoded images stored in a flat binary file that is mapped and uploaded as-is
+//file name is the FNV-1a hash of the source bytes plus the build flags, so edited
+//sources and different flags simply miss instead of serving stale data
+
+constexpr uint32_t TEXTURE_CACHE_VERSION = 2;
+constexpr int TEXTURE_CACHE_MAX_LEVELS = 16;
+
+enum TextureCacheFlags : uint32_t
+{
+    TEXTURE_CACHE_MIPMAPS = 1,  //store the full mip chain, box filtered on the CPU
+    TEXTURE_CACHE_EDGES = 2,    //store the fixed-point Sobel edge map of level 0
+    TEXTURE_CACHE_COMPRESSED = 4  //store every level BC1/BC4/BC7 compressed, see TextureCompression.h
+};
+
+//offsets are from the start of the file and 64-byte aligned
+struct TextureCacheLevel
+{
+    uint64_t offset;
+    uint64_t size;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct TextureCacheHeader
+{
+    char magic[4];  //"SVTC"
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t flags;
+    uint32_t level_count;
+    uint32_t format;  //compressed GL internal format of the levels, 0 for raw pixels
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+    TextureCacheLevel edges;  //size 0 when not stored
+};
+
+//a mapped cache file, pixel pointers stay valid while it is alive
+//rows are bottom-up like load_texture and tightly packed, or 4x4 blocks when header->format is set
+struct CachedImage
+{
+    MappedFile file;
+    const TextureCacheHeader* header = nullptr;
+
+    const unsigned char* level(int index) const { return file.data() + header->levels[index].offset; }
+    const unsigned char* edges() const { return header->edges.size ? file.data() + header->edges.offset : nullptr; }
+};
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+//true if the header is a cache header whose levels and edge map lie inside a blob of size bytes and
+//hold as many bytes as their dimensions need, so uploading it cannot read past the blob
+bool cached_image_fits(const TextureCacheHeader& header, size_t size);
+
+//decodes an encoded image (PNG, ...) into a complete cache blob: header followed by the levels
+bool encode_cached_image(const unsigned char* source, size_t source_size, uint64_t source_hash, uint32_t flags, std::vector<unsigned char>& blob);
+
+class TextureCache
+{
+public:
+
+    explicit TextureCache(const std::string& directory, uint32_t flags = TEXTURE_CACHE_MIPMAPS);
+
+    //maps the cached image of a source file, decoding and writing it first on a miss
+    bool load(const char* path, CachedImage& image);
+
+    uint64_t hits() const { return hit_count; }
+    uint64_t misses() const { return miss_count; }
+
+private:
+
+    bool build(const std::vector<unsigned char>& source, uint64_t source_hash, const std::string& cache_path);
+    bool validate(const CachedImage& image, uint64_t source_hash) const;
+
+    std::string directory;
+    uint32_t flags;
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+};
+
+//uploads every stored level, no glGenerateMipmap needed when the chain is complete
+//compressed levels go through glCompressedTexImage2D, check compressed_formats_supported first
+GLuint upload_cached_texture(const CachedImage& image);
+//same for a blob that lives elsewhere, e.g. inside an asset pack, offsets are relative to base
+GLuint upload_cached_texture(const TextureCacheHeader& header, const unsigned char* base);
+
+//single channel R8 texture swizzled to gray, 0 if the cache holds no edge map
+GLuint upload_cached_edges(const CachedImage& image);
+
+//decodes a PNG/JPG with stb_image (rows flipped bottom-up) into a mipmapped texture, 0 on failure
+GLuint load_texture(const char* path);
+
+//drop-in for load_texture that goes through the cache
+GLuint load_texture_cached(TextureCache& cache, const char* path);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+//block compression for uploads, 4x4 texel blocks
+//    BC1 (S3TC DXT1)  RGB,  8 bytes per block, used for 3 channel images
+//    BC4 (RGTC1)      R,    8 bytes per block, used for 1 channel images
+//    BC7 (BPTC)       RGBA, 16 bytes per block (mode 6 only), used for 4 channel images
+//partial blocks at the right and top edges repeat the last column/row
+
+//not in the core 3.3 loader, BC1 and BC7 come from extensions
+constexpr GLenum COMPRESSED_RGB_BC1 = 0x83F0;   //GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+constexpr GLenum COMPRESSED_RED_BC4 = 0x8DBB;   //GL_COMPRESSED_RED_RGTC1
+constexpr GLenum COMPRESSED_RGBA_BC7 = 0x8E8C;  //GL_COMPRESSED_RGBA_BPTC_UNORM
+
+//BC format used for an image with this many channels (1, 3 or 4)
+GLenum compressed_format(int channels);
+size_t compressed_block_size(GLenum format);
+size_t compressed_size(GLenum format, int width, int height);
+
+//true when the current context can sample BC1, BC4 and BC7
+bool compressed_formats_supported();
+
+//compresses tightly packed pixels, block rows are split across threads when the image is large
+void compress_image(GLenum format, const unsigned char* pixels, int width, int height, int channels, std::vector<unsigned char>& blocks);
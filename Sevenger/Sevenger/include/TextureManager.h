@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+//byte size of every level (and layer) of a texture as reported by the driver,
+//compressed formats use their stored size, uncompressed ones texel size * area
+size_t texture_bytes(GLenum target, GLuint texture);
+
+struct TextureMemoryStats
+{
+    size_t budget_bytes = 0;
+    size_t resident_bytes = 0;  //managed textures, evictable
+    size_t pinned_bytes = 0;    //tracked textures, render targets and buffers owned elsewhere
+    size_t resident_count = 0;
+    size_t pinned_count = 0;
+    uint64_t hits = 0;
+    uint64_t loads = 0;
+    uint64_t evictions = 0;
+};
+
+//creates the texture of a path, 0 on failure
+using TextureLoader = std::function<GLuint(const std::string& path)>;
+
+//owns textures loaded by path and keeps them under a VRAM budget
+//acquire marks a texture as most recently used and evicts the least recently used
+//ones until resident + pinned bytes fit, evicted textures are reloaded on the next acquire
+//so callers must not keep the returned id across frames
+class TextureManager
+{
+public:
+
+    TextureManager(size_t budget_bytes, TextureLoader loader);
+    ~TextureManager();
+
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    GLuint acquire(const std::string& path);
+    void release(const std::string& path);
+
+    //deletes every managed texture, call before the context goes away
+    void clear();
+
+    //counts a texture (or the color attachment of a framebuffer) the manager does not own, again after it
+    //is resized; pinned bytes are never evicted but still take room, the next acquire evicts to make it
+    void track(GLenum target, GLuint texture);
+    void untrack(GLuint texture);
+
+    //the same for a buffer (PBOs), bytes as passed to glBufferData
+    void track_buffer(GLuint buffer, size_t bytes);
+    void untrack_buffer(GLuint buffer);
+
+    //the track_*_memory functions below report to this manager from now on, until it is destroyed
+    void make_current();
+
+    void set_budget(size_t budget_bytes);
+    const TextureMemoryStats& stats() const { return memory; }
+
+private:
+
+    struct Entry
+    {
+        GLuint texture;
+        size_t bytes;
+        std::list<std::string>::iterator lru_position;
+    };
+
+    void evict_to_budget(const std::string& keep);
+
+    TextureLoader loader;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru;  //most recently used first
+    std::unordered_map<GLuint, size_t> pinned;
+    std::unordered_map<GLuint, size_t> pinned_buffers;
+    TextureMemoryStats memory;
+};
+
+//the passes, pipelines and textures that allocate GL memory themselves report it here after every (re)allocation
+//and before deleting it, the current TextureManager counts it as pinned; without one (the bench and the other
+//tools) these do nothing
+void track_texture_memory(GLenum target, GLuint texture);
+void untrack_texture_memory(GLuint texture);
+void track_buffer_memory(GLuint buffer, size_t bytes);
+void untrack_buffer_memory(GLuint buffer);
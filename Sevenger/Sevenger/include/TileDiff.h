@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Region.h"
+
+enum class TileCompare
+{
+    SIMD,  //byte compare against a copy of the previous frame, exact
+    HASH   //64-bit hash per tile, no frame copy but a collision would miss a change
+};
+
+//finds the tiles of a frame that differ from the previous frame
+//changed tiles come back as rects, horizontally adjacent ones merged into runs,
+//ready for IncrementalEdgesCpu/Gpu::update so unchanged tiles keep their edges
+class TileDiff
+{
+public:
+
+    explicit TileDiff(int tile_size = 32, TileCompare mode = TileCompare::SIMD);
+
+    //the first frame, and any frame of a different size, marks every tile changed
+    const std::vector<Rect>& compare(const unsigned char* pixels, size_t stride, int width, int height, int channels);
+
+    size_t tile_count() const { return tiles_x * tiles_y; }
+    size_t changed_tiles() const { return changed; }
+
+private:
+
+    bool tile_changed(const unsigned char* pixels, size_t stride, int tile_x, int tile_y);
+
+    int tile_size;
+    TileCompare mode;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    size_t tiles_x = 0;
+    size_t tiles_y = 0;
+    size_t changed = 0;
+    std::vector<unsigned char> previous;
+    std::vector<uint64_t> hashes;
+    std::vector<Rect> changed_rects;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//what a worker reports when it finishes a chunk
+struct ChunkResult
+{
+    std::string worker;
+    size_t processed = 0;
+    size_t failed = 0;
+    double seconds = 0.0;
+};
+
+//work list of a sharded batch job, kept in a directory every worker can reach: a local disk for the
+//processes of one machine, a shared filesystem for several machines
+//
+//    job.txt           the settings line, the chunk size and the items, written once by create()
+//    claims/<chunk>    created exclusively by the worker that takes the chunk, holds its name
+//    done/<chunk>      the ChunkResult, written once every item of the chunk is finished
+//
+//workers take the next free chunk whenever they finish one, so faster workers take more of them;
+//an interrupted job resumes from the chunks without a done marker once their claims are released
+class WorkQueue
+{
+public:
+
+    WorkQueue() = default;
+
+    //writes a new job, fails if the directory already holds one
+    bool create(const std::string& directory, const std::vector<std::string>& items, size_t chunk_size,
+                const std::string& settings);
+    bool open(const std::string& directory);
+
+    const std::string& directory() const { return job_directory; }
+    const std::string& settings() const { return job_settings; }
+    size_t item_count() const { return items.size(); }
+    size_t chunk_count() const { return (items.size() + chunk_size - 1) / chunk_size; }
+    const std::string& item(size_t index) const { return items[index]; }
+    //items [first, last) belong to the chunk
+    void chunk_items(size_t chunk, size_t& first, size_t& last) const;
+
+    //takes the next chunk nobody has claimed, false once every chunk is claimed
+    bool claim(const std::string& worker, size_t& chunk);
+    bool complete(size_t chunk, const ChunkResult& result);
+
+    bool is_complete(size_t chunk) const;
+    bool read_result(size_t chunk, ChunkResult& result) const;
+
+    //removes the claims of unfinished chunks so they are handed out again: the ones of a worker that
+    //died, or with an empty name every one, which is only safe while no worker runs
+    size_t release_unfinished(const std::string& worker = {});
+
+    //progress from the markers on disk
+    size_t completed_count() const;
+    size_t unclaimed_count() const;
+
+private:
+
+    std::string claim_path(size_t chunk) const;
+    std::string done_path(size_t chunk) const;
+
+    std::string job_directory;
+    std::string job_settings;
+    size_t chunk_size = 1;
+    std::vector<std::string> items;
+    size_t next_chunk = 0;
+};
@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include "AssetPack.h"
+#include "TextureCache.h"
+
+static size_t align_offset(size_t offset)
+{
+    return (offset + 63) / 64 * 64;
+}
+
+bool AssetPack::open(const std::string& path)
+{
+    index = nullptr;
+    entry_count = 0;
+    if (!file.open(path))
+    {
+        std::cout << "Failed to open asset pack: " << path << std::endl;
+        return false;
+    }
+
+    const AssetPackHeader* header = (const AssetPackHeader*)file.data();
+    size_t size = file.size();
+    if (size < sizeof(AssetPackHeader) || std::memcmp(header->magic, "SVPK", 4) != 0 ||
+        header->version != ASSET_PACK_VERSION || header->index_offset > size || header->index_offset % alignof(AssetPackEntry) != 0 ||
+        header->entry_count > (size - header->index_offset) / sizeof(AssetPackEntry))
+    {
+        std::cout << "ERROR: INVALID ASSET PACK: " << path << std::endl;
+        file.close();
+        return false;
+    }
+
+    //find() and the loaders trust the index, so every range is checked once here; a truncated or
+    //corrupt pack is rejected as a whole instead of reading past the mapping later
+    const AssetPackEntry* entries = (const AssetPackEntry*)(file.data() + header->index_offset);
+    for (size_t i = 0; i < (size_t)header->entry_count; ++i)
+    {
+        const AssetPackEntry& entry = entries[i];
+        bool valid = entry.name_offset <= size && entry.name_length <= size - entry.name_offset &&
+                     entry.data_offset <= size && entry.data_size <= size - entry.data_offset;
+        if (valid && entry.kind == AssetKind::IMAGE)
+            valid = entry.data_offset % alignof(TextureCacheHeader) == 0 &&
+                    cached_image_fits(*(const TextureCacheHeader*)(file.data() + entry.data_offset), (size_t)entry.data_size);
+        else if (valid)
+            valid = entry.kind == AssetKind::RAW;
+        //the binary search in find() needs the names in order
+        if (valid && i > 0)
+        {
+            const AssetPackEntry& previous = entries[i - 1];
+            valid = std::string_view((const char*)file.data() + previous.name_offset, previous.name_length) <
+                    std::string_view((const char*)file.data() + entry.name_offset, entry.name_length);
+        }
+        if (!valid)
+        {
+            std::cout << "ERROR: INVALID ASSET PACK ENTRY " << i << ": " << path << std::endl;
+            file.close();
+            return false;
+        }
+    }
+
+    index = entries;
+    entry_count = (size_t)header->entry_count;
+    return true;
+}
+
+bool AssetPack::find(std::string_view name, AssetView& view) const
+{
+    auto entry_name = [this](const AssetPackEntry& entry)
+    {
+        return std::string_view((const char*)file.data() + entry.name_offset, entry.name_length);
+    };
+
+    const AssetPackEntry* end = index + entry_count;
+    const AssetPackEntry* entry = std::lower_bound(index, end, name,
+        [&](const AssetPackEntry& candidate, std::string_view key) { return entry_name(candidate) < key; });
+    if (entry == end || entry_name(*entry) != name)
+        return false;
+
+    view.kind = entry->kind;
+    view.data = file.data() + entry->data_offset;
+    view.size = (size_t)entry->data_size;
+    return true;
+}
+
+bool build_asset_pack(const std::string& directory, const std::string& pack_path)
+{
+    struct PendingEntry
+    {
+        std::string name;
+        AssetKind kind;
+        std::vector<unsigned char> data;
+    };
+
+    std::vector<PendingEntry> pending;
+    std::error_code error;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (!item.is_regular_file())
+            continue;
+
+        std::ifstream input(item.path(), std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+        PendingEntry entry;
+        entry.name = (std::filesystem::path(directory) / std::filesystem::relative(item.path(), directory)).generic_string();
+        entry.kind = AssetKind::RAW;
+        if (item.path().extension() == ".png")
+        {
+            //decode now so loading is a plain upload from the mapping
+            entry.kind = AssetKind::IMAGE;
+            if (!encode_cached_image(bytes.data(), bytes.size(), hash_bytes(bytes.data(), bytes.size()), TEXTURE_CACHE_MIPMAPS, entry.data))
+            {
+                std::cout << "Failed to decode texture: " << entry.name << std::endl;
+                continue;
+            }
+        }
+        else
+        {
+            entry.data = std::move(bytes);
+        }
+        pending.push_back(std::move(entry));
+    }
+    if (error)
+    {
+        std::cout << "Failed to read asset directory: " << directory << std::endl;
+        return false;
+    }
+
+    std::sort(pending.begin(), pending.end(), [](const PendingEntry& a, const PendingEntry& b) { return a.name < b.name; });
+
+    //layout: header, index, names, then 64-byte aligned data so image levels stay aligned
+    AssetPackHeader header = {};
+    std::memcpy(header.magic, "SVPK", 4);
+    header.version = ASSET_PACK_VERSION;
+    header.entry_count = pending.size();
+    header.index_offset = sizeof(AssetPackHeader);
+
+    std::vector<AssetPackEntry> index(pending.size());
+    size_t offset = sizeof(AssetPackHeader) + index.size() * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        index[i].name_offset = offset;
+        index[i].name_length = (uint32_t)pending[i].name.size();
+        index[i].kind = pending[i].kind;
+        offset += pending[i].name.size();
+    }
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        offset = align_offset(offset);
+        index[i].data_offset = offset;
+        index[i].data_size = pending[i].data.size();
+        offset += pending[i].data.size();
+    }
+
+    std::vector<unsigned char> pack(offset, 0);
+    std::memcpy(pack.data(), &header, sizeof(header));
+    std::memcpy(pack.data() + header.index_offset, index.data(), index.size() * sizeof(AssetPackEntry));
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+        std::memcpy(pack.data() + index[i].name_offset, pending[i].name.data(), pending[i].name.size());
+        std::memcpy(pack.data() + index[i].data_offset, pending[i].data.data(), pending[i].data.size());
+    }
+
+    std::FILE* output = std::fopen(pack_path.c_str(), "wb");
+    bool ok = output && std::fwrite(pack.data(), 1, pack.size(), output) == pack.size();
+    if (output)
+        ok = std::fclose(output) == 0 && ok;
+    if (!ok)
+    {
+        std::cout << "Failed to write asset pack: " << pack_path << std::endl;
+        return false;
+    }
+
+    std::cout << "packed " << pending.size() << " assets into " << pack_path << " (" << pack.size() << " bytes)" << std::endl;
+    return true;
+}
+
+Shader load_shader(const AssetPack& pack, const char* vertex_path, const char* fragment_path)
+{
+    AssetView vertex_view, fragment_view;
+    if (pack.is_open() && pack.find(vertex_path, vertex_view) && pack.find(fragment_path, fragment_view))
+        return Shader::from_source(vertex_view.text(), fragment_view.text());
+
+    return Shader(vertex_path, fragment_path);
+}
+
+GLuint load_texture_packed(const AssetPack& pack, const char* path)
+{
+    AssetView view;
+    //open() checked the level table of every image against its entry
+    if (!pack.is_open() || !pack.find(path, view) || view.kind != AssetKind::IMAGE)
+        return 0;
+
+    return upload_cached_texture(*(const TextureCacheHeader*)view.data, view.data);
+}
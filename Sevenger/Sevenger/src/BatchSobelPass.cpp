@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include "BatchSobelPass.h"
+#include "TextureManager.h"
+
+BatchSobelPass::BatchSobelPass(Shader& batch_edge_shader)
+    : batch_edge_shader(batch_edge_shader), edge_pass(batch_edge_shader)
+{
+    GLint texture_size = 0, layers = 0;
+    GLint viewport_size[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &texture_size);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layers);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport_size);
+    max_target_size = std::min({ texture_size, viewport_size[0], viewport_size[1] });
+    max_layers = layers;
+}
+
+BatchSobelPass::~BatchSobelPass()
+{
+    for (Batch& batch : batches)
+    {
+        glDeleteSync(batch.fence);
+        for (Group& group : batch.groups)
+            free_groups.push_back(group);
+    }
+    for (Group& group : free_groups)
+    {
+        untrack_texture_memory(group.input_array);
+        untrack_buffer_memory(group.readback_pbo);
+        glDeleteTextures(1, &group.input_array);
+        destroy_render_target(group.target);
+        glDeleteBuffers(1, &group.readback_pbo);
+    }
+}
+
+void BatchSobelPass::set_kernel(GradientKernel kernel)
+{
+    this->kernel = kernel;
+}
+
+void BatchSobelPass::set_thresholds(int low, int high)
+{
+    low_threshold = low;
+    high_threshold = high;
+}
+
+bool BatchSobelPass::acquire_group(Group& group)
+{
+    //a collected group of the same shape still has everything allocated
+    for (size_t i = 0; i < free_groups.size(); ++i)
+    {
+        const Group& free_group = free_groups[i];
+        if (free_group.width == group.width && free_group.height == group.height &&
+            free_group.channels == group.channels && free_group.layers == group.layers)
+        {
+            group.input_array = free_group.input_array;
+            group.target = free_group.target;
+            group.readback_pbo = free_group.readback_pbo;
+            free_groups.erase(free_groups.begin() + i);
+            ++totals.reused_groups;
+            return true;
+        }
+    }
+
+    static const GLenum internal_formats[] = { GL_R8UI, GL_RG8UI, GL_RGB8UI, GL_RGBA8UI };
+    static const GLenum formats[] = { GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER };
+    glGenTextures(1, &group.input_array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, group.input_array);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_formats[group.channels - 1], group.width, group.height, group.layers, 0,
+                 formats[group.channels - 1], GL_UNSIGNED_BYTE, nullptr);
+    //integer textures cannot be filtered
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    track_texture_memory(GL_TEXTURE_2D_ARRAY, group.input_array);
+
+    glGenBuffers(1, &group.readback_pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, group.readback_pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)group.width * group.height * group.layers, nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    track_buffer_memory(group.readback_pbo, (size_t)group.width * group.height * group.layers);
+
+    if (!create_render_target(group.target, group.width, group.height * group.layers, GL_R8UI))
+    {
+        untrack_texture_memory(group.input_array);
+        untrack_buffer_memory(group.readback_pbo);
+        glDeleteTextures(1, &group.input_array);
+        glDeleteBuffers(1, &group.readback_pbo);
+        group.input_array = 0;
+        group.readback_pbo = 0;
+        return false;
+    }
+    return true;
+}
+
+void BatchSobelPass::release_group(Group& group)
+{
+    if (free_groups.size() < BATCH_MAX_FREE_GROUPS)
+    {
+        group.indices.clear();
+        free_groups.push_back(group);
+        return;
+    }
+    untrack_texture_memory(group.input_array);
+    untrack_buffer_memory(group.readback_pbo);
+    glDeleteTextures(1, &group.input_array);
+    destroy_render_target(group.target);
+    glDeleteBuffers(1, &group.readback_pbo);
+}
+
+void BatchSobelPass::upload_layer(const Group& group, int layer, const BatchImage& image)
+{
+    static const GLenum formats[] = { GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER };
+    GLenum format = formats[group.channels - 1];
+
+    //the row length is counted in pixels, strides that are not a whole number of pixels go row by row
+    if (image.stride % image.channels == 0)
+    {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(image.stride / image.channels));
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, image.width, image.height, 1, format, GL_UNSIGNED_BYTE, image.pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    else
+    {
+        for (int y = 0; y < image.height; ++y)
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, y, layer, image.width, 1, 1, format, GL_UNSIGNED_BYTE, image.pixels + (size_t)y * image.stride);
+    }
+}
+
+uint64_t BatchSobelPass::submit(const std::vector<BatchImage>& images)
+{
+    //images of one shape form a group, in submission order
+    std::map<std::tuple<int, int, int>, std::vector<size_t>> shapes;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const BatchImage& image = images[i];
+        if (image.width <= 0 || image.height <= 0 || image.width > max_target_size || image.height > max_target_size)
+        {
+            std::cout << "ERROR: BATCH IMAGE " << i << " IS LARGER THAN GL_MAX_TEXTURE_SIZE: " << image.width << "x" << image.height << std::endl;
+            continue;
+        }
+        if (image.channels != 1 && image.channels != 3 && image.channels != 4)
+        {
+            std::cout << "ERROR: BATCH IMAGE " << i << " HAS " << image.channels << " CHANNELS, EXPECTED 1, 3 OR 4" << std::endl;
+            continue;
+        }
+        shapes[{ image.width, image.height, image.channels }].push_back(i);
+    }
+
+    Batch batch;
+    batch.ticket = next_ticket++;
+    batch.image_count = images.size();
+
+    GradientWeights weights = gradient_weights(kernel);
+    batch_edge_shader.use();
+    batch_edge_shader.set_ivec2("smoothing", weights.a, weights.b);
+    batch_edge_shader.set_int("magnitudeShift", weights.shift);
+    batch_edge_shader.set_ivec2("thresholds", low_threshold, high_threshold);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (const auto& [shape, indices] : shapes)
+    {
+        auto [width, height, channels] = shape;
+
+        //layers per draw: the array limit, the stacked target height and the memory cap
+        size_t layer_bytes = (size_t)width * height * channels;
+        size_t group_layers = std::min({ (size_t)max_layers, (size_t)(max_target_size / height),
+                                         std::max<size_t>(1, BATCH_MAX_GROUP_BYTES / layer_bytes) });
+
+        batch_edge_shader.set_int("channelCount", channels == 1 ? 1 : 3);
+        batch_edge_shader.set_int("layerHeight", height);
+        for (size_t first = 0; first < indices.size(); first += group_layers)
+        {
+            Group group;
+            group.width = width;
+            group.height = height;
+            group.channels = channels;
+            group.layers = (int)std::min(group_layers, indices.size() - first);
+            group.indices.assign(indices.begin() + first, indices.begin() + first + group.layers);
+            if (!acquire_group(group))
+                continue;
+
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.input_array);
+            for (int layer = 0; layer < group.layers; ++layer)
+                upload_layer(group, layer, images[group.indices[layer]]);
+
+            edge_pass.draw(group.target, width, height * group.layers);
+            ++totals.draws;
+
+            //asynchronous readback, completion is signalled by the batch fence
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, group.readback_pbo);
+            glReadPixels(0, 0, width, height * group.layers, GL_RED_INTEGER, GL_UNSIGNED_BYTE, (void*)0);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            batch.groups.push_back(std::move(group));
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    //flush so the fence can signal without anyone waiting on it
+    batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    ++totals.batches;
+    totals.images += images.size();
+    uint64_t ticket = batch.ticket;
+    batches.push_back(std::move(batch));
+    return ticket;
+}
+
+bool BatchSobelPass::ready(uint64_t ticket)
+{
+    auto batch = std::find_if(batches.begin(), batches.end(), [&](const Batch& candidate) { return candidate.ticket == ticket; });
+    if (batch == batches.end())
+        return false;
+    GLenum wait_result = glClientWaitSync(batch->fence, 0, 0);
+    return wait_result == GL_ALREADY_SIGNALED || wait_result == GL_CONDITION_SATISFIED;
+}
+
+bool BatchSobelPass::collect(uint64_t ticket, std::vector<Image>& edges, bool wait)
+{
+    auto batch = std::find_if(batches.begin(), batches.end(), [&](const Batch& candidate) { return candidate.ticket == ticket; });
+    if (batch == batches.end() || (!wait && !ready(ticket)))
+        return false;
+
+    //images that were skipped stay empty
+    edges.resize(batch->image_count);
+    std::vector<bool> filled(edges.size(), false);
+    collect(ticket, [&](size_t index, int width, int height, size_t& stride)
+    {
+        Image& out = edges[index];
+        if (out.width() != width || out.height() != height || out.channels() != 1 || out.layout() != PixelLayout::PLANAR)
+            out = Image(width, height, 1, PixelLayout::PLANAR);
+        filled[index] = true;
+        stride = out.stride();
+        return out.row(0);
+    });
+    for (size_t i = 0; i < edges.size(); ++i)
+    {
+        if (!filled[i])
+            edges[i] = Image();
+    }
+    return true;
+}
+
+bool BatchSobelPass::collect(uint64_t ticket, const BatchDestination& destination, bool wait)
+{
+    auto batch = std::find_if(batches.begin(), batches.end(), [&](const Batch& candidate) { return candidate.ticket == ticket; });
+    if (batch == batches.end())
+        return false;
+
+    if (!wait && !ready(ticket))
+        return false;
+    while (glClientWaitSync(batch->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+    glDeleteSync(batch->fence);
+
+    for (Group& group : batch->groups)
+    {
+        size_t readback_size = (size_t)group.width * group.height * group.layers;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, group.readback_pbo);
+        const unsigned char* mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback_size, GL_MAP_READ_BIT);
+        if (mapped)
+        {
+            for (int layer = 0; layer < group.layers; ++layer)
+            {
+                size_t stride = 0;
+                unsigned char* out = destination(group.indices[layer], group.width, group.height, stride);
+                const unsigned char* layer_rows = mapped + (size_t)layer * group.height * group.width;
+                for (int y = 0; y < group.height; ++y)
+                    std::memcpy(out + (size_t)y * stride, layer_rows + (size_t)y * group.width, group.width);
+            }
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        release_group(group);
+    }
+
+    batches.erase(batch);
+    return true;
+}
@@ -0,0 +1,52 @@
+#include "BinaryEdgeTexture.h"
+#include "BinaryEdges.h"
+#include "Shader.h"
+#include "TextureManager.h"
+
+BinaryEdgeTexture::~BinaryEdgeTexture()
+{
+    release();
+}
+
+void BinaryEdgeTexture::upload(const BinaryEdgeMap& map)
+{
+    int packed_width = (map.width() + 7) / 8;
+    if (texture_id == 0)
+    {
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        //integer textures cannot be filtered
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)map.stride());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, packed_width, map.height(), 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, map.row(0));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    track_texture_memory(GL_TEXTURE_2D, texture_id);
+
+    map_width = map.width();
+    map_height = map.height();
+}
+
+void BinaryEdgeTexture::release()
+{
+    if (texture_id)
+    {
+        untrack_texture_memory(texture_id);
+        glDeleteTextures(1, &texture_id);
+    }
+    texture_id = 0;
+    map_width = 0;
+    map_height = 0;
+}
+
+void BinaryEdgeTexture::bind(Shader& binary_edge_shader) const
+{
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    binary_edge_shader.use();
+    binary_edge_shader.set_ivec2("edgeSize", map_width, map_height);
+}
@@ -0,0 +1,483 @@
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include "BinaryEdges.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void BinaryEdgeMap::resize(int width, int height)
+{
+    map_width = std::max(width, 0);
+    map_height = std::max(height, 0);
+    row_stride = ((size_t)map_width + 63) / 64 * 8;
+    bits.assign(row_stride * map_height, 0);
+}
+
+//64 pixels with x = 0 in the top bit, the byte order of the rows
+static uint64_t load_bits(const unsigned char* bytes)
+{
+    uint64_t word = 0;
+    for (int i = 0; i < 8; ++i)
+        word = word << 8 | bytes[i];
+    return word;
+}
+
+size_t BinaryEdgeMap::count() const
+{
+    size_t edges = 0;
+    for (size_t i = 0; i < bits.size(); i += 8)
+        edges += std::popcount(load_bits(bits.data() + i));
+    return edges;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//packing
+
+static void prepare_map(BinaryEdgeMap& map, int width, int height)
+{
+    //the packers write every byte of a row, padding included, so a map of the same size is reused as it is
+    if (map.width() != width || map.height() != height || map.empty())
+        map.resize(width, height);
+}
+
+static void pack_row_scalar(const unsigned char* in, int first_x, int width, int threshold, unsigned char* out, size_t stride)
+{
+    for (int x = first_x; x < width; x += 8)
+    {
+        unsigned bits = 0;
+        for (int i = 0; i < 8 && x + i < width; ++i)
+            bits |= (unsigned)(in[x + i] >= threshold) << (7 - i);
+        out[x >> 3] = (unsigned char)bits;
+    }
+    size_t used = ((size_t)width + 7) / 8;
+    std::memset(out + used, 0, stride - used);
+}
+
+void pack_edges_u8_scalar(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map)
+{
+    prepare_map(map, width, height);
+    for (int y = 0; y < height; ++y)
+        pack_row_scalar(src + (size_t)y * src_stride, 0, width, threshold, map.row(y), map.stride());
+}
+
+static void pack_rows_simd(const unsigned char* src, size_t src_stride, int width, int first_y, int last_y, int threshold,
+                           BinaryEdgeMap& map)
+{
+    for (int y = first_y; y < last_y; ++y)
+    {
+        const unsigned char* in = src + (size_t)y * src_stride;
+        unsigned char* out = map.row(y);
+        int x = 0;
+#ifdef SEVENGER_SSE2
+        __m128i limit = _mm_set1_epi8((char)threshold);
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(in + x));
+            //unsigned pixels >= threshold, as max(pixels, threshold) == pixels
+            __m128i edges = _mm_cmpeq_epi8(_mm_max_epu8(pixels, limit), pixels);
+            //reverse the bytes of each half so movemask puts the first pixel of a byte in its top bit
+            edges = _mm_shufflehi_epi16(_mm_shufflelo_epi16(edges, 0x1B), 0x1B);
+            edges = _mm_or_si128(_mm_slli_epi16(edges, 8), _mm_srli_epi16(edges, 8));
+            int mask = _mm_movemask_epi8(edges);
+            out[x >> 3] = (unsigned char)mask;
+            out[(x >> 3) + 1] = (unsigned char)(mask >> 8);
+        }
+#endif
+        pack_row_scalar(in, x, width, threshold, out, map.stride());
+    }
+}
+
+void pack_edges_u8_simd(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map)
+{
+    prepare_map(map, width, height);
+    pack_rows_simd(src, src_stride, width, 0, height, threshold, map);
+}
+
+void pack_edges_u8_threaded(const unsigned char* src, size_t src_stride, int width, int height, int threshold, BinaryEdgeMap& map,
+                            int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max(1, std::min(thread_count, height / 16));
+
+    prepare_map(map, width, height);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+    {
+        int y0 = height * i / thread_count;
+        int y1 = height * (i + 1) / thread_count;
+        workers.emplace_back(pack_rows_simd, src, src_stride, width, y0, y1, threshold, std::ref(map));
+    }
+    pack_rows_simd(src, src_stride, width, 0, height / thread_count, threshold, map);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void unpack_edges_u8(const BinaryEdgeMap& map, unsigned char* edges, size_t edges_stride)
+{
+    //the 8 output bytes of every input byte
+    static const auto expand = []
+    {
+        std::vector<uint64_t> table(256);
+        for (int bits = 0; bits < 256; ++bits)
+        {
+            unsigned char bytes[8];
+            for (int i = 0; i < 8; ++i)
+                bytes[i] = (bits >> (7 - i)) & 1 ? 255 : 0;
+            std::memcpy(&table[bits], bytes, 8);
+        }
+        return table;
+    }();
+
+    int width = map.width();
+    for (int y = 0; y < map.height(); ++y)
+    {
+        const unsigned char* in = map.row(y);
+        unsigned char* out = edges + (size_t)y * edges_stride;
+        for (int x = 0; x < width; x += 8)
+            std::memcpy(out + x, &expand[in[x >> 3]], std::min(8, width - x));
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//runs and points
+
+//calls run(x, length) for every run of edges in a packed row, skipping whole empty or full words
+template <typename Function>
+static void for_each_run(const unsigned char* row, int width, const Function& run)
+{
+    int run_start = -1;
+    for (int word_x = 0; word_x < width; word_x += 64)
+    {
+        uint64_t word = load_bits(row + word_x / 8);
+        if (run_start < 0 ? word == 0 : word == ~0ull)
+            continue;
+        int bit = 0;
+        while (bit < 64)
+        {
+            if (run_start < 0)
+            {
+                uint64_t rest = word << bit;
+                if (rest == 0)
+                    break;
+                bit += std::countl_zero(rest);
+                run_start = word_x + bit;
+            }
+            else
+            {
+                bit += std::countl_one(word << bit);
+                if (bit < 64)
+                {
+                    run(run_start, word_x + bit - run_start);
+                    run_start = -1;
+                }
+            }
+        }
+    }
+    //the padding bits are 0, so only a row that fills its last word ends inside a run
+    if (run_start >= 0)
+        run(run_start, width - run_start);
+}
+
+void edge_runs(const BinaryEdgeMap& map, std::vector<EdgeRun>& runs)
+{
+    runs.clear();
+    for (int y = 0; y < map.height(); ++y)
+        for_each_run(map.row(y), map.width(), [&](int x, int length) { runs.push_back({ x, y, length }); });
+}
+
+void edge_points(const BinaryEdgeMap& map, std::vector<EdgePoint>& points)
+{
+    points.clear();
+    for (int y = 0; y < map.height(); ++y)
+    {
+        for_each_run(map.row(y), map.width(), [&](int x, int length)
+        {
+            for (int i = 0; i < length; ++i)
+                points.push_back({ x + i, y });
+        });
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//files
+
+constexpr unsigned char EDGE_FILE_MAGIC[4] = { 'S', 'V', 'E', 'B' };
+constexpr unsigned char EDGE_FILE_VERSION = 1;
+constexpr size_t EDGE_FILE_HEADER_SIZE = 16;
+
+const char* edge_map_encoding_name(EdgeMapEncoding encoding)
+{
+    switch (encoding)
+    {
+    case EdgeMapEncoding::AUTO: return "auto";
+    case EdgeMapEncoding::BITS: return "bits";
+    case EdgeMapEncoding::RUNS: return "runs";
+    case EdgeMapEncoding::POINTS: return "points";
+    }
+    return "unknown";
+}
+
+static size_t varint_size(uint64_t value)
+{
+    size_t size = 1;
+    for (; value >= 0x80; value >>= 7)
+        ++size;
+    return size;
+}
+
+static void put_varint(std::vector<unsigned char>& out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out.push_back((unsigned char)(value | 0x80));
+    out.push_back((unsigned char)value);
+}
+
+static bool get_varint(const unsigned char*& in, const unsigned char* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7)
+    {
+        unsigned char byte = *in++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void put_u32_le(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+static uint32_t get_u32_le(const unsigned char* bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+//sets bits [first, last) of a packed row
+static void set_bit_range(unsigned char* row, int first, int last)
+{
+    for (; first < last && (first & 7); ++first)
+        row[first >> 3] |= (unsigned char)(0x80 >> (first & 7));
+    int whole = (last - first) / 8;
+    if (whole > 0)
+    {
+        std::memset(row + (first >> 3), 0xFF, whole);
+        first += whole * 8;
+    }
+    for (; first < last; ++first)
+        row[first >> 3] |= (unsigned char)(0x80 >> (first & 7));
+}
+
+void encode_binary_edges(const BinaryEdgeMap& map, std::vector<unsigned char>& file, EdgeMapEncoding encoding)
+{
+    int width = map.width(), height = map.height();
+    size_t row_bytes = ((size_t)width + 7) / 8;
+
+    //runs in file order (top row first), sized in both sparse encodings on the way
+    std::vector<EdgeRun> runs;
+    size_t runs_size = 0, points_size = 0, edge_count = 0;
+    if (encoding != EdgeMapEncoding::BITS)
+    {
+        uint64_t previous = UINT64_MAX;  //index of the previous edge, one before 0 at the start
+        for (int file_y = 0; file_y < height; ++file_y)
+        {
+            size_t row_start = runs.size();
+            int end = 0;
+            for_each_run(map.row(height - 1 - file_y), width, [&](int x, int length)
+            {
+                runs.push_back({ x, file_y, length });
+                runs_size += varint_size((uint64_t)(x - end)) + varint_size((uint64_t)length - 1);
+                end = x + length;
+
+                uint64_t index = (uint64_t)file_y * width + x;
+                points_size += varint_size(index - previous - 1) + (length - 1);
+                previous = index + length - 1;
+                edge_count += length;
+            });
+            runs_size += varint_size(runs.size() - row_start);
+        }
+        points_size += varint_size(edge_count);
+    }
+
+    if (encoding == EdgeMapEncoding::AUTO)
+    {
+        size_t bits_size = row_bytes * height;
+        encoding = EdgeMapEncoding::BITS;
+        if (runs_size < bits_size)
+            encoding = EdgeMapEncoding::RUNS;
+        if (points_size < std::min(runs_size, bits_size))
+            encoding = EdgeMapEncoding::POINTS;
+    }
+
+    file.clear();
+    file.insert(file.end(), EDGE_FILE_MAGIC, EDGE_FILE_MAGIC + 4);
+    file.push_back(EDGE_FILE_VERSION);
+    file.push_back((unsigned char)encoding);
+    file.push_back(0);
+    file.push_back(0);
+    put_u32_le(file, (uint32_t)width);
+    put_u32_le(file, (uint32_t)height);
+
+    if (encoding == EdgeMapEncoding::BITS)
+    {
+        size_t offset = file.size();
+        file.resize(offset + row_bytes * height);
+        for (int file_y = 0; file_y < height; ++file_y)
+            std::memcpy(file.data() + offset + (size_t)file_y * row_bytes, map.row(height - 1 - file_y), row_bytes);
+    }
+    else if (encoding == EdgeMapEncoding::RUNS)
+    {
+        file.reserve(file.size() + runs_size);
+        size_t next = 0;
+        for (int file_y = 0; file_y < height; ++file_y)
+        {
+            size_t row_end = next;
+            while (row_end < runs.size() && runs[row_end].y == file_y)
+                ++row_end;
+            put_varint(file, row_end - next);
+            int end = 0;
+            for (; next < row_end; ++next)
+            {
+                put_varint(file, (uint64_t)(runs[next].x - end));
+                put_varint(file, (uint64_t)runs[next].length - 1);
+                end = runs[next].x + runs[next].length;
+            }
+        }
+    }
+    else
+    {
+        file.reserve(file.size() + points_size);
+        put_varint(file, edge_count);
+        uint64_t previous = UINT64_MAX;
+        for (const EdgeRun& run : runs)
+        {
+            uint64_t index = (uint64_t)run.y * width + run.x;
+            put_varint(file, index - previous - 1);
+            file.insert(file.end(), run.length - 1, 0);
+            previous = index + run.length - 1;
+        }
+    }
+}
+
+bool is_binary_edge_file(const unsigned char* file, size_t size)
+{
+    return size >= EDGE_FILE_HEADER_SIZE && std::memcmp(file, EDGE_FILE_MAGIC, 4) == 0;
+}
+
+bool decode_binary_edges(const unsigned char* file, size_t size, BinaryEdgeMap& map, EdgeMapEncoding* encoding)
+{
+    if (!is_binary_edge_file(file, size) || file[4] != EDGE_FILE_VERSION ||
+        file[5] < (unsigned char)EdgeMapEncoding::BITS || file[5] > (unsigned char)EdgeMapEncoding::POINTS)
+        return false;
+
+    EdgeMapEncoding file_encoding = (EdgeMapEncoding)file[5];
+    uint32_t width = get_u32_le(file + 8), height = get_u32_le(file + 12);
+    if (width == 0 || height == 0 || width > (1u << 30) || height > (1u << 30) || (uint64_t)width * height > (1ull << 36))
+        return false;
+
+    const unsigned char* in = file + EDGE_FILE_HEADER_SIZE;
+    const unsigned char* end = file + size;
+    size_t row_bytes = ((size_t)width + 7) / 8;
+    //every row takes at least a byte in the bit and run encodings, a short file cannot claim a huge map
+    if ((file_encoding == EdgeMapEncoding::BITS && (size_t)(end - in) < row_bytes * height) ||
+        (file_encoding == EdgeMapEncoding::RUNS && (size_t)(end - in) < height))
+        return false;
+
+    map.resize((int)width, (int)height);
+    if (file_encoding == EdgeMapEncoding::BITS)
+    {
+        //the bits past the width have to stay 0
+        unsigned char last_mask = (unsigned char)(0xFF00 >> (((width - 1) & 7) + 1));
+        for (uint32_t file_y = 0; file_y < height; ++file_y)
+        {
+            unsigned char* row = map.row((int)(height - 1 - file_y));
+            std::memcpy(row, in + (size_t)file_y * row_bytes, row_bytes);
+            row[row_bytes - 1] &= last_mask;
+        }
+    }
+    else if (file_encoding == EdgeMapEncoding::RUNS)
+    {
+        for (uint32_t file_y = 0; file_y < height; ++file_y)
+        {
+            unsigned char* row = map.row((int)(height - 1 - file_y));
+            uint64_t count = 0;
+            if (!get_varint(in, end, count))
+                return false;
+            uint64_t x = 0;
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                uint64_t gap = 0, length = 0;
+                if (!get_varint(in, end, gap) || !get_varint(in, end, length) || gap > width || length >= width ||
+                    x + gap + length + 1 > width)
+                    return false;
+                x += gap;
+                set_bit_range(row, (int)x, (int)(x + length + 1));
+                x += length + 1;
+            }
+        }
+    }
+    else
+    {
+        uint64_t count = 0, previous = UINT64_MAX, pixel_count = (uint64_t)width * height;
+        if (!get_varint(in, end, count) || count > pixel_count)
+            return false;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t delta = 0;
+            if (!get_varint(in, end, delta) || delta >= pixel_count - (previous + 1))
+                return false;
+            previous += delta + 1;
+            map.set((int)(previous % width), (int)(height - 1 - previous / width));
+        }
+    }
+
+    if (encoding)
+        *encoding = file_encoding;
+    return true;
+}
+
+bool write_binary_edges(const std::string& path, const BinaryEdgeMap& map, EdgeMapEncoding encoding)
+{
+    std::vector<unsigned char> file;
+    encode_binary_edges(map, file, encoding);
+
+    std::FILE* output = std::fopen(path.c_str(), "wb");
+    bool ok = output && std::fwrite(file.data(), 1, file.size(), output) == file.size();
+    ok = output && std::fclose(output) == 0 && ok;
+    if (!ok)
+        std::cout << "Failed to write edge map: " << path << std::endl;
+    return ok;
+}
+
+bool read_binary_edges(const std::string& path, BinaryEdgeMap& map)
+{
+    std::FILE* input = std::fopen(path.c_str(), "rb");
+    if (!input)
+    {
+        std::cout << "Failed to open edge map: " << path << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> file;
+    unsigned char buffer[65536];
+    for (size_t read; (read = std::fread(buffer, 1, sizeof(buffer), input)) > 0;)
+        file.insert(file.end(), buffer, buffer + read);
+    std::fclose(input);
+
+    if (!decode_binary_edges(file.data(), file.size(), map))
+    {
+        std::cout << "ERROR: INVALID EDGE MAP: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,190 @@
+#include <utility>
+#include "ChildProcess.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+ChildProcess::~ChildProcess()
+{
+#ifdef _WIN32
+    if (process_handle)
+        CloseHandle(process_handle);
+#endif
+}
+
+ChildProcess::ChildProcess(ChildProcess&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+ChildProcess& ChildProcess::operator=(ChildProcess&& other) noexcept
+{
+    if (this != &other)
+    {
+        std::swap(started, other.started);
+#ifdef _WIN32
+        std::swap(process_handle, other.process_handle);
+#else
+        std::swap(pid, other.pid);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+//CommandLineToArgvW rules: backslashes only escape a following quote
+static std::string quote_argument(const std::string& argument)
+{
+    if (!argument.empty() && argument.find_first_of(" \t\"") == std::string::npos)
+        return argument;
+
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for (char c : argument)
+    {
+        if (c == '\\')
+        {
+            ++backslashes;
+            continue;
+        }
+        quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        quoted += c;
+    }
+    quoted.append(backslashes * 2, '\\');
+    return quoted + "\"";
+}
+
+bool ChildProcess::start(const std::vector<std::string>& arguments)
+{
+    if (started || arguments.empty())
+        return false;
+
+    std::string command_line;
+    for (const std::string& argument : arguments)
+        command_line += (command_line.empty() ? "" : " ") + quote_argument(argument);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    PROCESS_INFORMATION info = {};
+    if (!CreateProcessA(nullptr, command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &info))
+        return false;
+    CloseHandle(info.hThread);
+    process_handle = info.hProcess;
+    started = true;
+    return true;
+}
+
+bool ChildProcess::try_wait(int& exit_code)
+{
+    if (!started || WaitForSingleObject(process_handle, 0) != WAIT_OBJECT_0)
+        return false;
+    DWORD code = 0;
+    GetExitCodeProcess(process_handle, &code);
+    CloseHandle(process_handle);
+    process_handle = nullptr;
+    started = false;
+    exit_code = (int)code;
+    return true;
+}
+
+int ChildProcess::wait()
+{
+    if (!started)
+        return -1;
+    WaitForSingleObject(process_handle, INFINITE);
+    int exit_code = -1;
+    try_wait(exit_code);
+    return exit_code;
+}
+
+void ChildProcess::kill()
+{
+    if (started)
+        TerminateProcess(process_handle, 1);
+}
+
+std::string host_name()
+{
+    char name[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD size = sizeof(name);
+    return GetComputerNameA(name, &size) ? std::string(name, size) : "localhost";
+}
+
+uint32_t current_process_id()
+{
+    return (uint32_t)GetCurrentProcessId();
+}
+
+#else
+
+bool ChildProcess::start(const std::vector<std::string>& arguments)
+{
+    if (started || arguments.empty())
+        return false;
+
+    std::vector<char*> argv;
+    for (const std::string& argument : arguments)
+        argv.push_back((char*)argument.c_str());
+    argv.push_back(nullptr);
+
+    pid_t child = 0;
+    if (posix_spawnp(&child, argv[0], nullptr, nullptr, argv.data(), environ) != 0)
+        return false;
+    pid = child;
+    started = true;
+    return true;
+}
+
+static int exit_code_of(int status)
+{
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool ChildProcess::try_wait(int& exit_code)
+{
+    int status = 0;
+    if (!started || waitpid((pid_t)pid, &status, WNOHANG) != (pid_t)pid)
+        return false;
+    started = false;
+    exit_code = exit_code_of(status);
+    return true;
+}
+
+int ChildProcess::wait()
+{
+    int status = 0;
+    if (!started || waitpid((pid_t)pid, &status, 0) != (pid_t)pid)
+        return -1;
+    started = false;
+    return exit_code_of(status);
+}
+
+void ChildProcess::kill()
+{
+    if (started)
+        ::kill((pid_t)pid, SIGKILL);
+}
+
+std::string host_name()
+{
+    char name[256] = {};
+    return gethostname(name, sizeof(name) - 1) == 0 && name[0] ? std::string(name) : "localhost";
+}
+
+uint32_t current_process_id()
+{
+    return (uint32_t)getpid();
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "ContactSheet.h"
+#include "TextureManager.h"
+
+ContactSheet::ContactSheet(Shader& sheet_shader, int thumbnail_size)
+    : sheet_shader(sheet_shader), thumbnail_size(thumbnail_size)
+{
+    //unit quad as a triangle strip, cells are placed by the vertex shader
+    float corners[] = {
+        0.0f, 0.0f,
+        1.0f, 0.0f,
+        0.0f, 1.0f,
+        1.0f, 1.0f
+    };
+
+    glGenVertexArrays(1, &VAO_id);
+    glBindVertexArray(VAO_id);
+
+    glGenBuffers(1, &VBO_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindVertexArray(0);
+}
+
+ContactSheet::~ContactSheet()
+{
+    glDeleteVertexArrays(1, &VAO_id);
+    glDeleteBuffers(1, &VBO_id);
+    if (texture_array)
+    {
+        untrack_texture_memory(texture_array);
+        glDeleteTextures(1, &texture_array);
+    }
+}
+
+void ContactSheet::add_image(const unsigned char* pixels, int width, int height, int channels)
+{
+    size_t layer_size = (size_t)thumbnail_size * thumbnail_size * 4;
+    staging.resize(staging.size() + layer_size, 0);
+    unsigned char* layer = staging.data() + staging.size() - layer_size;
+
+    //fit the longer side, center the shorter one (letterbox stays transparent black)
+    float scale = (float)thumbnail_size / (float)std::max(width, height);
+    int fit_width = std::max(1, (int)std::lround(width * scale));
+    int fit_height = std::max(1, (int)std::lround(height * scale));
+    int offset_x = (thumbnail_size - fit_width) / 2;
+    int offset_y = (thumbnail_size - fit_height) / 2;
+
+    //bilinear, the source is at most twice the thumbnail size when it comes from a mip chain
+    for (int y = 0; y < fit_height; ++y)
+    {
+        float source_y = std::clamp((y + 0.5f) / scale - 0.5f, 0.0f, (float)(height - 1));
+        int y0 = (int)source_y;
+        int y1 = std::min(y0 + 1, height - 1);
+        float fy = source_y - (float)y0;
+        unsigned char* out = layer + ((size_t)(offset_y + y) * thumbnail_size + offset_x) * 4;
+        for (int x = 0; x < fit_width; ++x)
+        {
+            float source_x = std::clamp((x + 0.5f) / scale - 0.5f, 0.0f, (float)(width - 1));
+            int x0 = (int)source_x;
+            int x1 = std::min(x0 + 1, width - 1);
+            float fx = source_x - (float)x0;
+
+            const unsigned char* p00 = pixels + ((size_t)y0 * width + x0) * channels;
+            const unsigned char* p01 = pixels + ((size_t)y0 * width + x1) * channels;
+            const unsigned char* p10 = pixels + ((size_t)y1 * width + x0) * channels;
+            const unsigned char* p11 = pixels + ((size_t)y1 * width + x1) * channels;
+            for (int c = 0; c < 4; ++c)
+            {
+                //gray expands to RGB, missing alpha is opaque
+                int source_c = channels >= 3 ? std::min(c, channels - 1) : 0;
+                if (c == 3 && channels != 4)
+                {
+                    out[x * 4 + c] = 255;
+                    continue;
+                }
+                float top = p00[source_c] + (p01[source_c] - p00[source_c]) * fx;
+                float bottom = p10[source_c] + (p11[source_c] - p10[source_c]) * fx;
+                out[x * 4 + c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+    ++layers;
+}
+
+void ContactSheet::add_cached_image(const TextureCacheHeader& header, const unsigned char* base)
+{
+    if (header.format)
+    {
+        std::cout << "ERROR: CONTACT SHEET NEEDS UNCOMPRESSED LEVELS" << std::endl;
+        return;
+    }
+
+    uint32_t level = 0;
+    while (level + 1 < header.level_count &&
+           (int)std::max(header.levels[level + 1].width, header.levels[level + 1].height) >= thumbnail_size)
+        ++level;
+
+    const TextureCacheLevel& chosen = header.levels[level];
+    add_image(base + chosen.offset, (int)chosen.width, (int)chosen.height, (int)header.channels);
+}
+
+void ContactSheet::upload()
+{
+    if (layers == 0)
+        return;
+
+    if (!texture_array)
+        glGenTextures(1, &texture_array);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, thumbnail_size, thumbnail_size, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, staging.data());
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    track_texture_memory(GL_TEXTURE_2D_ARRAY, texture_array);
+}
+
+void ContactSheet::draw(int cell_count, float viewport_aspect, bool detect_edges)
+{
+    if (!texture_array || cell_count <= 0)
+        return;
+
+    //roughly square cells on screen
+    int columns = std::max(1, (int)std::ceil(std::sqrt((float)cell_count * viewport_aspect)));
+    int rows = (cell_count + columns - 1) / columns;
+
+    sheet_shader.use();
+    sheet_shader.set_ivec2("grid", columns, rows);
+    sheet_shader.set_int("layerCount", layers);
+    sheet_shader.set_bool("detectEdges", detect_edges);
+    sheet_shader.set_int("thumbnails", 0);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array);
+    glBindVertexArray(VAO_id);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, cell_count);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
@@ -0,0 +1,644 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include "BinaryEdges.h"
+#include "EdgeContours.h"
+
+//---------------------------------------------------------------------------------------------------------------------
+//tracing
+//
+//cell (cx, cy) has the pixels (cx, cy), (cx + 1, cy), (cx + 1, cy + 1) and (cx, cy + 1) as corners, pixels outside
+//the map count as background, so the cells from (-1, -1) to (width - 1, height - 1) close every contour
+//a contour crosses a cell from the middle of one side to the middle of another with the edge pixels on its left;
+//in half pixels those points are whole numbers, which the tracing works in
+
+struct HalfPoint
+{
+    int x;
+    int y;
+};
+
+//a traced piece of contour, closed or running from one tile seam to another
+struct ContourChain
+{
+    std::vector<HalfPoint> points;
+    bool closed = false;
+};
+
+//sides of a cell: bottom, right, top, left
+constexpr int SIDE_STEP_X[4] = { 0, 1, 0, -1 };
+constexpr int SIDE_STEP_Y[4] = { -1, 0, 1, 0 };
+
+//side the contour leaves through for each corner case (bit 0 bottom left, 1 bottom right, 2 top right, 3 top left)
+//and side it entered through, -1 where no contour enters; the two saddles cut off their background corners
+//so diagonal edge pixels stay connected
+constexpr signed char EXIT_SIDE[16][4] = {
+    { -1, -1, -1, -1 }, {  3, -1, -1, -1 }, { -1,  0, -1, -1 }, { -1,  3, -1, -1 },
+    { -1, -1,  1, -1 }, {  1, -1,  3, -1 }, { -1, -1,  0, -1 }, { -1, -1,  3, -1 },
+    { -1, -1, -1,  2 }, {  2, -1, -1, -1 }, { -1,  2, -1,  0 }, { -1,  2, -1, -1 },
+    { -1, -1, -1,  1 }, {  1, -1, -1, -1 }, { -1, -1, -1,  0 }, { -1, -1, -1, -1 }
+};
+
+static HalfPoint side_point(int cx, int cy, int side)
+{
+    switch (side)
+    {
+    case 0: return { 2 * cx + 1, 2 * cy };
+    case 1: return { 2 * cx + 2, 2 * cy + 1 };
+    case 2: return { 2 * cx + 1, 2 * cy + 2 };
+    default: return { 2 * cx, 2 * cy + 1 };
+    }
+}
+
+static bool collinear_between(HalfPoint a, HalfPoint b, HalfPoint c)
+{
+    int dx1 = b.x - a.x, dy1 = b.y - a.y, dx2 = c.x - b.x, dy2 = c.y - b.y;
+    return dx1 * dy2 == dy1 * dx2 && dx1 * dx2 + dy1 * dy2 > 0;
+}
+
+//straight runs keep only their ends
+static void append_point(std::vector<HalfPoint>& points, HalfPoint point)
+{
+    size_t count = points.size();
+    if (count >= 2 && collinear_between(points[count - 2], points[count - 1], point))
+        points[count - 1] = point;
+    else
+        points.push_back(point);
+}
+
+static bool pixel_set(const BinaryEdgeMap& map, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < map.width() && y < map.height() && map.test(x, y);
+}
+
+//whether row y has an edge among the pixels [first, last), whole bytes so it may also see a few neighbours
+static bool row_has_edges(const BinaryEdgeMap& map, int y, int first, int last)
+{
+    first = std::max(first, 0);
+    last = std::min(last, map.width());
+    if (y < 0 || y >= map.height() || first >= last)
+        return false;
+    const unsigned char* row = map.row(y);
+    for (int byte = first >> 3; byte <= (last - 1) >> 3; ++byte)
+    {
+        if (row[byte])
+            return true;
+    }
+    return false;
+}
+
+//traces the cells [x0, x1) x [y0, y1): first the contours entering from outside the tile, which end when they leave
+//it again, then whatever is left, which can only be contours closing inside the tile
+static void trace_tile(const BinaryEdgeMap& map, int x0, int y0, int x1, int y1, std::vector<ContourChain>& chains,
+                       std::vector<unsigned char>& cases, std::vector<unsigned char>& visited)
+{
+    int tile_width = x1 - x0, tile_height = y1 - y0;
+    cases.assign((size_t)tile_width * tile_height, 0);
+    visited.assign(cases.size(), 0);
+    bool any = false;
+    for (int j = 0; j < tile_height; ++j)
+    {
+        int cy = y0 + j;
+        if (!row_has_edges(map, cy, x0, x1 + 1) && !row_has_edges(map, cy + 1, x0, x1 + 1))
+            continue;
+        any = true;
+        unsigned char* row = cases.data() + (size_t)j * tile_width;
+        for (int i = 0; i < tile_width; ++i)
+        {
+            int cx = x0 + i;
+            row[i] = (unsigned char)(pixel_set(map, cx, cy) | pixel_set(map, cx + 1, cy) << 1 |
+                                     pixel_set(map, cx + 1, cy + 1) << 2 | pixel_set(map, cx, cy + 1) << 3);
+        }
+    }
+    if (!any)
+        return;
+
+    auto trace = [&](int i, int j, int entry)
+    {
+        ContourChain chain;
+        int start_i = i, start_j = j, start_entry = entry;
+        chain.points.push_back(side_point(x0 + i, y0 + j, entry));
+        while (true)
+        {
+            size_t cell = (size_t)j * tile_width + i;
+            int exit = EXIT_SIDE[cases[cell]][entry];
+            if (exit < 0)
+                break;
+            visited[cell] |= (unsigned char)(1 << entry);
+            append_point(chain.points, side_point(x0 + i, y0 + j, exit));
+            i += SIDE_STEP_X[exit];
+            j += SIDE_STEP_Y[exit];
+            entry = (exit + 2) & 3;
+            if (i < 0 || j < 0 || i >= tile_width || j >= tile_height)
+                break;
+            if (i == start_i && j == start_j && entry == start_entry)
+            {
+                //the last point is the first again
+                chain.closed = true;
+                chain.points.pop_back();
+                break;
+            }
+        }
+        chains.push_back(std::move(chain));
+    };
+    auto trace_unvisited = [&](int i, int j, int entry)
+    {
+        size_t cell = (size_t)j * tile_width + i;
+        if (EXIT_SIDE[cases[cell]][entry] >= 0 && !(visited[cell] & (1 << entry)))
+            trace(i, j, entry);
+    };
+
+    for (int i = 0; i < tile_width; ++i)
+    {
+        trace_unvisited(i, 0, 0);
+        trace_unvisited(i, tile_height - 1, 2);
+    }
+    for (int j = 0; j < tile_height; ++j)
+    {
+        trace_unvisited(0, j, 3);
+        trace_unvisited(tile_width - 1, j, 1);
+    }
+    for (int j = 0; j < tile_height; ++j)
+    {
+        for (int i = 0; i < tile_width; ++i)
+        {
+            if (cases[(size_t)j * tile_width + i] == 0)
+                continue;
+            for (int entry = 0; entry < 4; ++entry)
+                trace_unvisited(i, j, entry);
+        }
+    }
+}
+
+static uint64_t point_key(HalfPoint point)
+{
+    return (uint64_t)(uint32_t)point.x << 32 | (uint32_t)point.y;
+}
+
+//the same contour comes out of any tiling: the straight run through the start (where tracing began,
+//which append_point never merged) is merged too, and the contour starts at its lowest, leftmost point
+static void add_contour(std::vector<HalfPoint>& points, std::vector<EdgeContour>& contours)
+{
+    size_t first = 0, count = points.size();
+    while (count - first >= 3)
+    {
+        if (collinear_between(points[count - 1], points[first], points[first + 1]))
+            ++first;
+        else if (collinear_between(points[count - 2], points[count - 1], points[first]))
+            --count;
+        else
+            break;
+    }
+
+    size_t start = first;
+    for (size_t i = first; i < count; ++i)
+    {
+        if (points[i].y < points[start].y || (points[i].y == points[start].y && points[i].x < points[start].x))
+            start = i;
+    }
+
+    EdgeContour contour;
+    contour.points.reserve(count - first);
+    for (size_t i = 0; i < count - first; ++i)
+    {
+        HalfPoint point = points[first + (start - first + i) % (count - first)];
+        contour.points.push_back({ point.x * 0.5f, point.y * 0.5f });
+    }
+    contours.push_back(std::move(contour));
+}
+
+static int contour_threads(int thread_count, size_t work_items)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    return (int)std::clamp<size_t>(work_items, 1, (size_t)thread_count);
+}
+
+void trace_contours(const BinaryEdgeMap& map, std::vector<EdgeContour>& contours, const ContourConfig& config)
+{
+    contours.clear();
+    int tile_size = std::max(config.tile_size, 8);
+    int cells_x = map.width() + 1, cells_y = map.height() + 1;
+    int tiles_x = (cells_x + tile_size - 1) / tile_size, tiles_y = (cells_y + tile_size - 1) / tile_size;
+    size_t tile_count = (size_t)tiles_x * tiles_y;
+    if (map.empty())
+        return;
+
+    //tiles are handed out one at a time, so a thread that hits the busy parts of the map takes fewer of them
+    std::vector<std::vector<ContourChain>> tile_chains(tile_count);
+    std::atomic<size_t> next_tile = 0;
+    auto work = [&]
+    {
+        std::vector<unsigned char> cases, visited;
+        for (size_t tile; (tile = next_tile++) < tile_count;)
+        {
+            int x0 = (int)(tile % tiles_x) * tile_size - 1, y0 = (int)(tile / tiles_x) * tile_size - 1;
+            int x1 = std::min(x0 + tile_size, cells_x - 1), y1 = std::min(y0 + tile_size, cells_y - 1);
+            trace_tile(map, x0, y0, x1, y1, tile_chains[tile], cases, visited);
+        }
+    };
+    int threads = contour_threads(config.thread_count, tile_count);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i)
+        workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    //closed chains are finished contours, the open ones are joined end to start across the seams; every point
+    //has exactly one contour leaving it, so the chain to continue with is the one starting at the end
+    std::vector<ContourChain*> open_chains;
+    std::unordered_map<uint64_t, size_t> chain_starting_at;
+    for (std::vector<ContourChain>& chains : tile_chains)
+    {
+        for (ContourChain& chain : chains)
+        {
+            if (chain.closed)
+                add_contour(chain.points, contours);
+            else
+            {
+                chain_starting_at[point_key(chain.points.front())] = open_chains.size();
+                open_chains.push_back(&chain);
+            }
+        }
+    }
+
+    std::vector<bool> used(open_chains.size(), false);
+    std::vector<HalfPoint> points;
+    for (size_t first = 0; first < open_chains.size(); ++first)
+    {
+        if (used[first])
+            continue;
+        points = open_chains[first]->points;
+        used[first] = true;
+        for (size_t steps = 0; steps < open_chains.size(); ++steps)
+        {
+            auto next = chain_starting_at.find(point_key(points.back()));
+            if (next == chain_starting_at.end() || next->second == first || used[next->second])
+                break;
+            used[next->second] = true;
+            const std::vector<HalfPoint>& more = open_chains[next->second]->points;
+            for (size_t i = 1; i < more.size(); ++i)
+                append_point(points, more[i]);
+        }
+        //back at the start
+        if (points.size() > 1 && point_key(points.back()) == point_key(points.front()))
+            points.pop_back();
+        add_contour(points, contours);
+    }
+
+    //no two contours share a point, ordering them by their start leaves nothing to the tiling
+    std::sort(contours.begin(), contours.end(), [](const EdgeContour& a, const EdgeContour& b)
+    {
+        const ContourPoint& p = a.points.front();
+        const ContourPoint& q = b.points.front();
+        return p.y < q.y || (p.y == q.y && p.x < q.x);
+    });
+    if (config.epsilon > 0.0f)
+        simplify_contours(contours, config.epsilon, config.thread_count);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//simplification
+
+static double segment_distance_squared(const ContourPoint& p, const ContourPoint& a, const ContourPoint& b)
+{
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double px = p.x - a.x, py = p.y - a.y;
+    double length_squared = dx * dx + dy * dy;
+    double t = length_squared > 0.0 ? std::clamp((px * dx + py * dy) / length_squared, 0.0, 1.0) : 0.0;
+    double ex = px - t * dx, ey = py - t * dy;
+    return ex * ex + ey * ey;
+}
+
+//the closed polygon is split at its first point and the point farthest from it, both halves are simplified
+//with an explicit stack, contours of millions of points would overflow a recursive one
+static void simplify_contour(std::vector<ContourPoint>& points, double epsilon, std::vector<unsigned char>& keep,
+                             std::vector<std::pair<size_t, size_t>>& stack)
+{
+    size_t count = points.size();
+    if (count <= 2)
+        return;
+
+    size_t far = 0;
+    double far_distance = -1.0;
+    for (size_t i = 1; i < count; ++i)
+    {
+        double dx = points[i].x - points[0].x, dy = points[i].y - points[0].y;
+        if (dx * dx + dy * dy > far_distance)
+        {
+            far_distance = dx * dx + dy * dy;
+            far = i;
+        }
+    }
+
+    keep.assign(count, 0);
+    keep[0] = keep[far] = 1;
+    stack.clear();
+    stack.push_back({ 0, far });
+    stack.push_back({ far, count });
+    double limit = epsilon * epsilon;
+    while (!stack.empty())
+    {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        const ContourPoint& a = points[first];
+        const ContourPoint& b = points[last % count];
+        size_t worst = 0;
+        double worst_distance = limit;
+        for (size_t i = first + 1; i < last; ++i)
+        {
+            double distance = segment_distance_squared(points[i], a, b);
+            if (distance > worst_distance)
+            {
+                worst_distance = distance;
+                worst = i;
+            }
+        }
+        if (worst != 0)
+        {
+            keep[worst] = 1;
+            stack.push_back({ first, worst });
+            stack.push_back({ worst, last });
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (keep[i])
+            points[kept++] = points[i];
+    }
+    points.resize(kept);
+}
+
+void simplify_contours(std::vector<EdgeContour>& contours, float epsilon, int thread_count)
+{
+    //contours in interleaved order, their lengths vary too much for contiguous ranges to balance
+    int threads = contour_threads(thread_count, contours.size() / 64);
+    auto work = [&](int index)
+    {
+        std::vector<unsigned char> keep;
+        std::vector<std::pair<size_t, size_t>> stack;
+        for (size_t i = index; i < contours.size(); i += threads)
+            simplify_contour(contours[i].points, epsilon, keep, stack);
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i)
+        workers.emplace_back(work, i);
+    work(0);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+size_t contour_point_count(const std::vector<EdgeContour>& contours)
+{
+    size_t count = 0;
+    for (const EdgeContour& contour : contours)
+        count += contour.points.size();
+    return count;
+}
+
+void rasterize_contours(const std::vector<EdgeContour>& contours, int width, int height, BinaryEdgeMap& map)
+{
+    map.resize(width, height);
+
+    //crossings of every pixel row with the contour sides, a side covers the rows from its lower end up to
+    //but not including its upper end so a vertex on a row counts once
+    std::vector<std::vector<float>> crossings(std::max(height, 0));
+    for (const EdgeContour& contour : contours)
+    {
+        size_t count = contour.points.size();
+        for (size_t i = 0; i < count; ++i)
+        {
+            ContourPoint a = contour.points[i], b = contour.points[(i + 1) % count];
+            if (a.y == b.y)
+                continue;
+            if (a.y > b.y)
+                std::swap(a, b);
+            int first = std::max((int)std::ceil(a.y), 0), last = std::min((int)std::ceil(b.y), height);
+            for (int y = first; y < last; ++y)
+                crossings[y].push_back(a.x + (y - a.y) * (b.x - a.x) / (b.y - a.y));
+        }
+    }
+
+    for (int y = 0; y < height; ++y)
+    {
+        std::vector<float>& row = crossings[y];
+        std::sort(row.begin(), row.end());
+        for (size_t i = 0; i + 1 < row.size(); i += 2)
+        {
+            int first = std::max((int)std::ceil(row[i]), 0), last = std::min((int)std::ceil(row[i + 1]), width);
+            for (int x = first; x < last; ++x)
+                map.set(x, y);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//files
+
+constexpr unsigned char CONTOUR_FILE_MAGIC[4] = { 'S', 'V', 'E', 'C' };
+constexpr unsigned char CONTOUR_FILE_VERSION = 1;
+constexpr size_t CONTOUR_FILE_HEADER_SIZE = 16;
+
+bool parse_contour_format(const std::string& name, ContourFormat& format)
+{
+    if (name == "svg" || name == "svec")
+    {
+        format = name == "svg" ? ContourFormat::SVG : ContourFormat::SVEC;
+        return true;
+    }
+    return false;
+}
+
+const char* contour_format_name(ContourFormat format)
+{
+    return format == ContourFormat::SVG ? "svg" : "svec";
+}
+
+const char* contour_format_extension(ContourFormat format)
+{
+    return format == ContourFormat::SVG ? ".svg" : ".svec";
+}
+
+static void put_varint(std::vector<unsigned char>& out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out.push_back((unsigned char)(value | 0x80));
+    out.push_back((unsigned char)value);
+}
+
+static bool get_varint(const unsigned char*& in, const unsigned char* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7)
+    {
+        unsigned char byte = *in++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static uint64_t zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int half_pixels(float value)
+{
+    return (int)std::lround(value * 2.0f);
+}
+
+//a value in half pixels as decimal pixels, "3", "-1.5"
+static void put_half(std::string& out, int value)
+{
+    if (value < 0)
+    {
+        out += '-';
+        value = -value;
+    }
+    out += std::to_string(value / 2);
+    if (value & 1)
+        out += ".5";
+}
+
+static void encode_svg(const std::vector<EdgeContour>& contours, int width, int height, std::vector<unsigned char>& file)
+{
+    char header[256];
+    std::snprintf(header, sizeof(header),
+                  "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\" viewBox=\"0 0 %d %d\">\n"
+                  "<path fill=\"none\" stroke=\"black\" stroke-width=\"1\" d=\"",
+                  width, height, width, height);
+    std::string text = header;
+
+    //SVG puts the top left corner of the top row at 0, 0: pixel centers move by half a pixel and y flips
+    for (const EdgeContour& contour : contours)
+    {
+        if (contour.points.empty())
+            continue;
+        int x = half_pixels(contour.points[0].x) + 1, y = 2 * height - 1 - half_pixels(contour.points[0].y);
+        text += 'M';
+        put_half(text, x);
+        text += ' ';
+        put_half(text, y);
+        if (contour.points.size() > 1)
+            text += 'l';
+        for (size_t i = 1; i < contour.points.size(); ++i)
+        {
+            int next_x = half_pixels(contour.points[i].x) + 1, next_y = 2 * height - 1 - half_pixels(contour.points[i].y);
+            if (i > 1)
+                text += ' ';
+            put_half(text, next_x - x);
+            text += ' ';
+            put_half(text, next_y - y);
+            x = next_x;
+            y = next_y;
+        }
+        text += 'z';
+    }
+    text += "\"/>\n</svg>\n";
+    file.assign(text.begin(), text.end());
+}
+
+static void encode_svec(const std::vector<EdgeContour>& contours, int width, int height, std::vector<unsigned char>& file)
+{
+    file.clear();
+    file.insert(file.end(), CONTOUR_FILE_MAGIC, CONTOUR_FILE_MAGIC + 4);
+    file.push_back(CONTOUR_FILE_VERSION);
+    file.insert(file.end(), 3, 0);
+    for (uint32_t value : { (uint32_t)width, (uint32_t)height })
+    {
+        for (int i = 0; i < 4; ++i)
+            file.push_back((unsigned char)(value >> (8 * i)));
+    }
+
+    put_varint(file, contours.size());
+    for (const EdgeContour& contour : contours)
+    {
+        put_varint(file, contour.points.size());
+        int64_t x = 0, y = 0;
+        for (const ContourPoint& point : contour.points)
+        {
+            int64_t next_x = half_pixels(point.x), next_y = half_pixels(point.y);
+            put_varint(file, zigzag(next_x - x));
+            put_varint(file, zigzag(next_y - y));
+            x = next_x;
+            y = next_y;
+        }
+    }
+}
+
+void encode_contours(ContourFormat format, const std::vector<EdgeContour>& contours, int width, int height,
+                     std::vector<unsigned char>& file)
+{
+    if (format == ContourFormat::SVG)
+        encode_svg(contours, width, height, file);
+    else
+        encode_svec(contours, width, height, file);
+}
+
+bool decode_contours(const unsigned char* file, size_t size, std::vector<EdgeContour>& contours, int& width, int& height)
+{
+    contours.clear();
+    if (size < CONTOUR_FILE_HEADER_SIZE || std::memcmp(file, CONTOUR_FILE_MAGIC, 4) != 0 || file[4] != CONTOUR_FILE_VERSION)
+        return false;
+    auto get_u32 = [](const unsigned char* bytes) { return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24; };
+    uint32_t file_width = get_u32(file + 8), file_height = get_u32(file + 12);
+    if (file_width > (1u << 30) || file_height > (1u << 30))
+        return false;
+    width = (int)file_width;
+    height = (int)file_height;
+
+    const unsigned char* in = file + CONTOUR_FILE_HEADER_SIZE;
+    const unsigned char* end = file + size;
+    uint64_t count = 0;
+    //every contour and point takes at least a byte, a short file cannot claim more
+    if (!get_varint(in, end, count) || count > (uint64_t)(end - in))
+        return false;
+    contours.resize(count);
+    for (EdgeContour& contour : contours)
+    {
+        uint64_t point_count = 0;
+        if (!get_varint(in, end, point_count) || point_count > (uint64_t)(end - in))
+            return false;
+        contour.points.resize(point_count);
+        int64_t x = 0, y = 0;
+        for (ContourPoint& point : contour.points)
+        {
+            uint64_t dx = 0, dy = 0;
+            if (!get_varint(in, end, dx) || !get_varint(in, end, dy))
+                return false;
+            x += unzigzag(dx);
+            y += unzigzag(dy);
+            point = { x * 0.5f, y * 0.5f };
+        }
+    }
+    return true;
+}
+
+bool write_contours(const std::string& path, ContourFormat format, const std::vector<EdgeContour>& contours, int width, int height)
+{
+    std::vector<unsigned char> file;
+    encode_contours(format, contours, width, height, file);
+
+    std::FILE* output = std::fopen(path.c_str(), "wb");
+    bool ok = output && std::fwrite(file.data(), 1, file.size(), output) == file.size();
+    ok = output && std::fclose(output) == 0 && ok;
+    if (!ok)
+        std::cout << "Failed to write contours: " << path << std::endl;
+    return ok;
+}
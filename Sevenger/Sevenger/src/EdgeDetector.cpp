@@ -0,0 +1,579 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include "BatchSobelPass.h"
+#include "BinaryEdges.h"
+#include "EdgeDetector.h"
+#include "IntegralImage.h"
+#include "IntegerSobelPass.h"
+#include "Shader.h"
+#include "Smoothing.h"
+#include "SubpixelEdges.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#endif
+
+bool parse_edge_backend(const std::string& name, EdgeBackend& backend)
+{
+    static const std::pair<const char*, EdgeBackend> names[] = {
+        { "auto", EdgeBackend::AUTO },
+        { "scalar", EdgeBackend::SCALAR },
+        { "simd", EdgeBackend::SIMD },
+        { "threaded", EdgeBackend::THREADED },
+        { "gl", EdgeBackend::GL }
+    };
+    for (const auto& [candidate, value] : names)
+    {
+        if (name == candidate)
+        {
+            backend = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_gradient_kernel(const std::string& name, GradientKernel& kernel)
+{
+    if (name == "sobel")
+        kernel = GradientKernel::SOBEL;
+    else if (name == "prewitt")
+        kernel = GradientKernel::PREWITT;
+    else if (name == "scharr")
+        kernel = GradientKernel::SCHARR;
+    else
+        return false;
+    return true;
+}
+
+const char* edge_backend_name(EdgeBackend backend)
+{
+    switch (backend)
+    {
+    case EdgeBackend::SCALAR:
+        return "scalar";
+    case EdgeBackend::SIMD:
+        return "simd";
+    case EdgeBackend::THREADED:
+        return "threaded";
+    case EdgeBackend::GL:
+        return "gl";
+    default:
+        return "auto";
+    }
+}
+
+//reallocates only when the shape changes, so repeated calls on same-sized images reuse the buffers
+static void ensure_image(Image& image, int width, int height, int channels, PixelLayout layout)
+{
+    if (image.width() != width || image.height() != height || image.channels() != channels || image.layout() != layout)
+        image = Image(width, height, channels, layout);
+}
+
+EdgeDetector::EdgeDetector(const EdgeDetectorConfig& config)
+    : settings(config)
+{
+}
+
+EdgeDetector::~EdgeDetector() = default;
+
+void EdgeDetector::configure(const EdgeDetectorConfig& config)
+{
+    settings = config;
+}
+
+void EdgeDetector::enable_gl(Shader& int_edge_shader)
+{
+    gl_pass = std::make_unique<IntegerSobelPass>(int_edge_shader);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &gl_max_texture_size);
+
+    //software rasterizers lose to the SIMD backend at every size, auto selection skips them
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    std::string renderer_name = renderer ? renderer : "";
+    gl_hardware = true;
+    for (const char* software : { "llvmpipe", "softpipe", "SwiftShader", "GDI Generic" })
+    {
+        if (renderer_name.find(software) != std::string::npos)
+            gl_hardware = false;
+    }
+}
+
+void EdgeDetector::enable_gl_batch(Shader& batch_edge_shader)
+{
+    batch_pass = std::make_unique<BatchSobelPass>(batch_edge_shader);
+}
+
+int binary_edge_threshold(const EdgeDetectorConfig& config)
+{
+    //below low becomes 0 and from high on 255, in between the magnitude stays
+    return std::max(config.low_threshold, std::min(config.high_threshold, BINARY_EDGE_THRESHOLD));
+}
+
+void EdgeDetector::enable_gl_packing(Shader& pack_edges_shader)
+{
+    if (gl_pass)
+        gl_pass->enable_packing(pack_edges_shader);
+}
+
+void EdgeDetector::enable_gl_subpixel(Shader& subpixel_edge_shader)
+{
+    if (gl_pass)
+        gl_pass->enable_subpixel(subpixel_edge_shader);
+}
+
+EdgeBackend EdgeDetector::select_backend(int width, int height) const
+{
+    if (settings.backend != EdgeBackend::AUTO)
+        return settings.backend;
+
+    int64_t pixels = (int64_t)width * height;
+    unsigned threads = settings.thread_count > 0 ? (unsigned)settings.thread_count : std::max(1u, std::thread::hardware_concurrency());
+    if (gl_pass && gl_hardware && pixels >= EDGE_GL_MIN_PIXELS && threads < EDGE_GL_MAX_CPU_THREADS &&
+        width <= gl_max_texture_size && height <= gl_max_texture_size)
+        return EdgeBackend::GL;
+    if (threads > 1 && pixels >= EDGE_THREADED_MIN_PIXELS)
+        return EdgeBackend::THREADED;
+#ifdef SEVENGER_SSE2
+    return EdgeBackend::SIMD;
+#else
+    return EdgeBackend::SCALAR;
+#endif
+}
+
+void EdgeDetector::smooth_plane(EdgeBackend backend, const unsigned char* src, size_t src_stride,
+                                unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    if (backend == EdgeBackend::SCALAR)
+        smooth_u8_scalar(settings.smoothing, settings.smoothing_sigma, src, src_stride, dst, dst_stride, width, height);
+    else if (backend == EdgeBackend::SIMD)
+        smooth_u8_simd(settings.smoothing, settings.smoothing_sigma, src, src_stride, dst, dst_stride, width, height);
+    else
+        smooth_u8_threaded(settings.smoothing, settings.smoothing_sigma, src, src_stride, dst, dst_stride, width, height, settings.thread_count);
+}
+
+void EdgeDetector::detect_planes(EdgeBackend backend, const unsigned char* const* planes, size_t plane_stride, int plane_count,
+                                 unsigned char* edges, size_t edges_stride, int width, int height)
+{
+    auto gradient = [&](const unsigned char* plane, unsigned char* dst, size_t dst_stride)
+    {
+        if (backend == EdgeBackend::SCALAR)
+            gradient_u8_scalar(settings.kernel, plane, plane_stride, dst, dst_stride, width, height);
+        else if (backend == EdgeBackend::THREADED)
+            gradient_u8_threaded(settings.kernel, plane, plane_stride, dst, dst_stride, width, height, settings.thread_count);
+        else
+            gradient_u8_simd(settings.kernel, plane, plane_stride, dst, dst_stride, width, height);
+    };
+
+    gradient(planes[0], edges, edges_stride);
+    if (plane_count > 1)
+        ensure_image(channel_edges, width, height, 1, PixelLayout::PLANAR);
+    for (int i = 1; i < plane_count; ++i)
+    {
+        gradient(planes[i], channel_edges.row(0), channel_edges.stride());
+        for (int y = 0; y < height; ++y)
+        {
+            const unsigned char* in = channel_edges.row(y);
+            unsigned char* out = edges + (size_t)y * edges_stride;
+            for (int x = 0; x < width; ++x)
+                out[x] = std::max(out[x], in[x]);
+        }
+    }
+
+    //same mapping as the thresholds in edge_detection_int.fs, binary maps compare against binary_edge_threshold instead
+    //unless the adaptive threshold comes after
+    if ((!binary_output || settings.adaptive_threshold) && (settings.low_threshold > 0 || settings.high_threshold < 255))
+    {
+        unsigned char table[256];
+        for (int i = 0; i < 256; ++i)
+            table[i] = (unsigned char)(i < settings.low_threshold ? 0 : (i >= settings.high_threshold ? 255 : i));
+        for (int y = 0; y < height; ++y)
+        {
+            unsigned char* out = edges + (size_t)y * edges_stride;
+            for (int x = 0; x < width; ++x)
+                out[x] = table[out[x]];
+        }
+    }
+    threshold_adaptive(backend, edges, edges_stride, width, height);
+}
+
+void EdgeDetector::threshold_adaptive(EdgeBackend backend, unsigned char* edges, size_t edges_stride, int width, int height)
+{
+    if (!settings.adaptive_threshold)
+        return;
+
+    //in place, every pixel only reads its own magnitude besides the table
+    AdaptiveThresholdConfig config = settings.adaptive;
+    config.thread_count = settings.thread_count;
+    if (backend == EdgeBackend::SCALAR)
+    {
+        integral_image_u8_scalar(edges, edges_stride, width, height, magnitude_sums);
+        adaptive_threshold_u8_scalar(magnitude_sums, edges, edges_stride, edges, edges_stride, config);
+    }
+    else if (backend == EdgeBackend::SIMD)
+    {
+        integral_image_u8_simd(edges, edges_stride, width, height, magnitude_sums);
+        adaptive_threshold_u8_simd(magnitude_sums, edges, edges_stride, edges, edges_stride, config);
+    }
+    else
+    {
+        integral_image_u8_threaded(edges, edges_stride, width, height, magnitude_sums, settings.thread_count);
+        adaptive_threshold_u8_threaded(magnitude_sums, edges, edges_stride, edges, edges_stride, config);
+    }
+}
+
+bool EdgeDetector::process(const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                           unsigned char* edges, size_t edges_stride)
+{
+    EdgeBackend backend = select_backend(width, height);
+    used_backend = backend;
+
+    //color only matters for MAX, everything else runs on one luma plane
+    bool color = settings.channels == EdgeChannels::MAX && channels >= 3;
+    const unsigned char* source = pixels;
+    size_t source_stride = stride;
+    if (!color && channels > 1)
+    {
+        ensure_image(luma, width, height, 1, PixelLayout::PLANAR);
+        luma_u8(pixels, stride, channels, luma.row(0), luma.stride(), width, height);
+        source = luma.row(0);
+        source_stride = luma.stride();
+    }
+
+    //smoothed color goes on in planes, the GL pass gets it interleaved again
+    bool color_planes = false;
+    if (settings.smoothing != SmoothingFilter::NONE)
+    {
+        if (!color)
+        {
+            ensure_image(smoothed, width, height, 1, PixelLayout::PLANAR);
+            smooth_plane(backend, source, source_stride, smoothed.row(0), smoothed.stride(), width, height);
+            source = smoothed.row(0);
+            source_stride = smoothed.stride();
+        }
+        else
+        {
+            ensure_image(planar, width, height, channels, PixelLayout::PLANAR);
+            planar.copy_from_interleaved(pixels, stride);
+            for (int c = 0; c < 3; ++c)
+                smooth_plane(backend, planar.row(0, c), planar.stride(), planar.row(0, c), planar.stride(), width, height);
+            color_planes = true;
+            if (backend == EdgeBackend::GL)
+            {
+                interleaved.resize((size_t)width * height * channels);
+                planar.copy_to_interleaved(interleaved.data(), (size_t)width * channels);
+                pixels = interleaved.data();
+                stride = (size_t)width * channels;
+            }
+        }
+    }
+
+    if (backend == EdgeBackend::GL)
+    {
+        if (!gl_pass)
+        {
+            std::cout << "ERROR: EDGE DETECTOR GL BACKEND IS NOT ENABLED" << std::endl;
+            return false;
+        }
+        if (width > gl_max_texture_size || height > gl_max_texture_size)
+        {
+            std::cout << "ERROR: IMAGE IS LARGER THAN GL_MAX_TEXTURE_SIZE: " << width << "x" << height << std::endl;
+            return false;
+        }
+
+        gl_pass->set_kernel(settings.kernel);
+        gl_pass->set_thresholds(settings.low_threshold, settings.high_threshold);
+        if (binary_output && gl_pass->packing_enabled() && !settings.adaptive_threshold && (!color || stride % channels == 0))
+        {
+            gl_pass->run_packed(color ? pixels : source, color ? stride : source_stride, color ? channels : 1, width, height,
+                                binary_edge_threshold(settings), *binary_output);
+            binary_packed = true;
+            return true;
+        }
+        if (!color)
+        {
+            gl_pass->run(source, source_stride, edges, edges_stride, width, height);
+            threshold_adaptive(backend, edges, edges_stride, width, height);
+            return true;
+        }
+
+        //rows that are not a whole number of pixels would be uploaded one by one, repack them
+        if (stride % channels != 0)
+        {
+            interleaved.resize((size_t)width * height * channels);
+            for (int y = 0; y < height; ++y)
+                std::copy(pixels + (size_t)y * stride, pixels + (size_t)y * stride + (size_t)width * channels, interleaved.begin() + (size_t)y * width * channels);
+            pixels = interleaved.data();
+            stride = (size_t)width * channels;
+        }
+        gl_pass->run_color(pixels, stride, channels, edges, edges_stride, width, height);
+        threshold_adaptive(backend, edges, edges_stride, width, height);
+        return true;
+    }
+
+    if (!color)
+    {
+        detect_planes(backend, &source, source_stride, 1, edges, edges_stride, width, height);
+        return true;
+    }
+
+    if (!color_planes)
+    {
+        ensure_image(planar, width, height, channels, PixelLayout::PLANAR);
+        planar.copy_from_interleaved(pixels, stride);
+    }
+    const unsigned char* planes[3] = { planar.row(0, 0), planar.row(0, 1), planar.row(0, 2) };
+    detect_planes(backend, planes, planar.stride(), 3, edges, edges_stride, width, height);
+    return true;
+}
+
+bool EdgeDetector::process(const Image& image, Image& edges)
+{
+    int width = image.width(), height = image.height(), channels = image.channels();
+    ensure_image(edges, width, height, 1, PixelLayout::PLANAR);
+
+    if (image.layout() == PixelLayout::INTERLEAVED || channels == 1)
+        return process(image.row(0), image.stride(), width, height, channels, edges.row(0), edges.stride());
+
+    //planar color: luma converts straight from the planes
+    if (settings.channels == EdgeChannels::LUMA || channels < 3)
+    {
+        ensure_image(luma, width, height, 1, PixelLayout::PLANAR);
+        luma_u8(image, luma);
+        return process(luma.row(0), luma.stride(), width, height, 1, edges.row(0), edges.stride());
+    }
+
+    //the GL pass uploads interleaved pixels, the CPU backends read the planes as they are unless they get smoothed
+    EdgeBackend backend = select_backend(width, height);
+    if (backend == EdgeBackend::GL || settings.smoothing != SmoothingFilter::NONE)
+    {
+        interleaved.resize((size_t)width * height * channels);
+        image.copy_to_interleaved(interleaved.data(), (size_t)width * channels);
+        return process(interleaved.data(), (size_t)width * channels, width, height, channels, edges.row(0), edges.stride());
+    }
+
+    used_backend = backend;
+    const unsigned char* planes[3] = { image.row(0, 0), image.row(0, 1), image.row(0, 2) };
+    detect_planes(backend, planes, image.stride(), 3, edges.row(0), edges.stride(), width, height);
+    return true;
+}
+
+EdgeBackend EdgeDetector::select_batch_backend(const std::vector<const Image*>& images) const
+{
+    if (settings.backend != EdgeBackend::AUTO)
+        return settings.backend;
+
+    int64_t pixels = 0;
+    bool fits = true;
+    for (const Image* image : images)
+    {
+        pixels += (int64_t)image->width() * image->height();
+        fits = fits && image->width() <= gl_max_texture_size && image->height() <= gl_max_texture_size;
+    }
+    unsigned threads = settings.thread_count > 0 ? (unsigned)settings.thread_count : std::max(1u, std::thread::hardware_concurrency());
+    if (batch_pass && gl_hardware && fits && pixels >= EDGE_GL_MIN_PIXELS && threads < EDGE_GL_MAX_CPU_THREADS)
+        return EdgeBackend::GL;
+    return EdgeBackend::AUTO;
+}
+
+uint64_t EdgeDetector::submit_batch(const std::vector<const Image*>& images)
+{
+    PendingBatch batch;
+    batch.ticket = next_ticket++;
+
+    //BatchSobelPass uploads the images as they are and reads back the plain magnitudes, smoothing and the
+    //adaptive threshold need the image by image path
+    EdgeBackend backend = select_batch_backend(images);
+    if (backend != EdgeBackend::GL || !batch_pass || settings.smoothing != SmoothingFilter::NONE || settings.adaptive_threshold)
+    {
+        batch.edges.resize(images.size());
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            if (!process(*images[i], batch.edges[i]))
+                batch.edges[i] = Image();
+        }
+        used_backend = backend;
+        pending_batches.push_back(std::move(batch));
+        return pending_batches.back().ticket;
+    }
+
+    //the same conversions as process(): luma unless MAX sees color, color goes up interleaved
+    //with whole-pixel rows so every layer is a single upload
+    batch_luma.resize(images.size());
+    batch_interleaved.resize(images.size());
+    std::vector<BatchImage> inputs(images.size());
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        const Image& image = *images[i];
+        int width = image.width(), height = image.height(), channels = image.channels();
+        BatchImage& input = inputs[i];
+        input.width = width;
+        input.height = height;
+
+        bool color = settings.channels == EdgeChannels::MAX && channels >= 3;
+        if (channels == 1)
+        {
+            input.pixels = image.row(0);
+            input.stride = image.stride();
+        }
+        else if (!color)
+        {
+            ensure_image(batch_luma[i], width, height, 1, PixelLayout::PLANAR);
+            if (image.layout() == PixelLayout::INTERLEAVED)
+                luma_u8(image.row(0), image.stride(), channels, batch_luma[i].row(0), batch_luma[i].stride(), width, height);
+            else
+                luma_u8(image, batch_luma[i]);
+            input.pixels = batch_luma[i].row(0);
+            input.stride = batch_luma[i].stride();
+        }
+        else if (image.layout() == PixelLayout::INTERLEAVED && image.stride() % channels == 0)
+        {
+            input.pixels = image.row(0);
+            input.stride = image.stride();
+            input.channels = channels;
+        }
+        else
+        {
+            std::vector<unsigned char>& packed = batch_interleaved[i];
+            packed.resize((size_t)width * height * channels);
+            image.copy_to_interleaved(packed.data(), (size_t)width * channels);
+            input.pixels = packed.data();
+            input.stride = (size_t)width * channels;
+            input.channels = channels;
+        }
+    }
+
+    batch_pass->set_kernel(settings.kernel);
+    batch_pass->set_thresholds(settings.low_threshold, settings.high_threshold);
+    batch.gl_ticket = batch_pass->submit(inputs);
+    used_backend = EdgeBackend::GL;
+    pending_batches.push_back(std::move(batch));
+    return pending_batches.back().ticket;
+}
+
+bool EdgeDetector::batch_ready(uint64_t ticket)
+{
+    for (PendingBatch& batch : pending_batches)
+    {
+        if (batch.ticket == ticket)
+            return batch.gl_ticket == 0 || batch_pass->ready(batch.gl_ticket);
+    }
+    return false;
+}
+
+bool EdgeDetector::collect_batch(uint64_t ticket, std::vector<Image>& edges, bool wait)
+{
+    auto batch = std::find_if(pending_batches.begin(), pending_batches.end(), [&](const PendingBatch& candidate) { return candidate.ticket == ticket; });
+    if (batch == pending_batches.end())
+        return false;
+
+    if (batch->gl_ticket != 0)
+    {
+        if (!batch_pass->collect(batch->gl_ticket, edges, wait))
+            return false;
+    }
+    else
+    {
+        edges = std::move(batch->edges);
+    }
+    pending_batches.erase(batch);
+    return true;
+}
+
+size_t EdgeDetector::process_batch(const std::vector<const Image*>& images, std::vector<Image>& edges)
+{
+    uint64_t ticket = submit_batch(images);
+    collect_batch(ticket, edges);
+    edges.resize(images.size());
+
+    size_t processed = 0;
+    for (const Image& image : edges)
+        processed += image.empty() ? 0 : 1;
+    return processed;
+}
+
+bool EdgeDetector::process_binary(const Image& image, BinaryEdgeMap& edges)
+{
+    binary_output = &edges;
+    binary_packed = false;
+    bool ok = process(image, binary_magnitude);
+    binary_output = nullptr;
+    if (!ok || binary_packed)
+        return ok;
+
+    int threshold = binary_edge_threshold(settings);
+    int width = image.width(), height = image.height();
+    if (used_backend == EdgeBackend::SCALAR)
+        pack_edges_u8_scalar(binary_magnitude.row(0), binary_magnitude.stride(), width, height, threshold, edges);
+    else if (used_backend == EdgeBackend::THREADED)
+        pack_edges_u8_threaded(binary_magnitude.row(0), binary_magnitude.stride(), width, height, threshold, edges, settings.thread_count);
+    else
+        pack_edges_u8_simd(binary_magnitude.row(0), binary_magnitude.stride(), width, height, threshold, edges);
+    return true;
+}
+
+bool EdgeDetector::process_subpixel(const Image& image, Image& edges)
+{
+    int width = image.width(), height = image.height();
+    ensure_image(edges, width, height, 4, PixelLayout::INTERLEAVED);
+
+    const unsigned char* source = image.row(0);
+    size_t source_stride = image.stride();
+    if (image.channels() > 1)
+    {
+        ensure_image(luma, width, height, 1, PixelLayout::PLANAR);
+        if (image.layout() == PixelLayout::INTERLEAVED)
+            luma_u8(image.row(0), image.stride(), image.channels(), luma.row(0), luma.stride(), width, height);
+        else
+            luma_u8(image, luma);
+        source = luma.row(0);
+        source_stride = luma.stride();
+    }
+
+    EdgeBackend backend = select_backend(width, height);
+    //AUTO only picks GL when the sub-pixel pass is there
+    if (backend == EdgeBackend::GL && settings.backend == EdgeBackend::AUTO && !gl_pass->subpixel_enabled())
+        backend = EdgeBackend::SIMD;
+    used_backend = backend;
+
+    if (settings.smoothing != SmoothingFilter::NONE)
+    {
+        ensure_image(smoothed, width, height, 1, PixelLayout::PLANAR);
+        smooth_plane(backend, source, source_stride, smoothed.row(0), smoothed.stride(), width, height);
+        source = smoothed.row(0);
+        source_stride = smoothed.stride();
+    }
+
+    switch (backend)
+    {
+    case EdgeBackend::GL:
+        if (!gl_pass || !gl_pass->subpixel_enabled())
+        {
+            std::cout << "ERROR: EDGE DETECTOR GL SUB-PIXEL PASS IS NOT ENABLED" << std::endl;
+            return false;
+        }
+        if (width > gl_max_texture_size || height > gl_max_texture_size)
+        {
+            std::cout << "ERROR: IMAGE IS LARGER THAN GL_MAX_TEXTURE_SIZE: " << width << "x" << height << std::endl;
+            return false;
+        }
+        gl_pass->set_kernel(settings.kernel);
+        gl_pass->set_thresholds(settings.low_threshold, settings.high_threshold);
+        gl_pass->run_subpixel(source, source_stride, edges.row(0), edges.stride(), width, height);
+        break;
+    case EdgeBackend::SCALAR:
+        subpixel_edges_u8_scalar(settings.kernel, source, source_stride, edges.row(0), edges.stride(), width, height,
+                                 settings.low_threshold, settings.high_threshold);
+        break;
+    case EdgeBackend::THREADED:
+        subpixel_edges_u8_threaded(settings.kernel, source, source_stride, edges.row(0), edges.stride(), width, height,
+                                   settings.low_threshold, settings.high_threshold, settings.thread_count);
+        break;
+    default:
+        subpixel_edges_u8_simd(settings.kernel, source, source_stride, edges.row(0), edges.stride(), width, height,
+                               settings.low_threshold, settings.high_threshold);
+        break;
+    }
+    return true;
+}
@@ -0,0 +1,176 @@
+#include "EdgePass.h"
+#include "TextureManager.h"
+
+bool create_render_target(RenderTarget& target, int width, int height, GLenum internal_format)
+{
+    if (target.framebuffer != 0 && target.width == width && target.height == height && target.internal_format == internal_format)
+        return true;
+
+    destroy_render_target(target);
+
+    bool is_integer = internal_format == GL_R8UI || internal_format == GL_R32UI || internal_format == GL_RGBA8UI || internal_format == GL_RGBA32UI;
+    bool is_single = internal_format == GL_R8UI || internal_format == GL_R32UI || internal_format == GL_R32F;
+    GLenum format = is_integer ? (is_single ? GL_RED_INTEGER : GL_RGBA_INTEGER) : (is_single ? GL_RED : GL_RGBA);
+    GLenum type = GL_UNSIGNED_BYTE;
+    if (internal_format == GL_R32UI || internal_format == GL_RGBA32UI)
+        type = GL_UNSIGNED_INT;
+    else if (internal_format == GL_R32F || internal_format == GL_RGBA32F)
+        type = GL_FLOAT;
+    GLint filter = is_integer ? GL_NEAREST : GL_LINEAR;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    target.internal_format = internal_format;
+    target.width = width;
+    target.height = height;
+
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR: FRAMEBUFFER INCOMPLETE: 0x" << std::hex << status << std::dec << std::endl;
+        destroy_render_target(target);
+        return false;
+    }
+    track_texture_memory(GL_TEXTURE_2D, target.texture);
+    return true;
+}
+
+void destroy_render_target(RenderTarget& target)
+{
+    if (target.framebuffer)
+        glDeleteFramebuffers(1, &target.framebuffer);
+    if (target.texture)
+    {
+        untrack_texture_memory(target.texture);
+        glDeleteTextures(1, &target.texture);
+    }
+    target = RenderTarget();
+}
+
+EdgePass::EdgePass(Shader& edge_shader)
+    : edge_shader(edge_shader)
+{
+    //same attribute layout as the viewer quad but covering the whole target
+    float vertices[] = {
+          // positions         // colors           // texture coords
+          1.0f,  1.0f, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 1.0f, // top right
+          1.0f, -1.0f, 0.0f,   1.0f, 1.0f, 1.0f,   1.0f, 0.0f, // bottom right
+         -1.0f, -1.0f, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 0.0f, // bottom left
+         -1.0f,  1.0f, 0.0f,   1.0f, 1.0f, 1.0f,   0.0f, 1.0f  // top left
+    };
+
+    unsigned int indices[] = {
+        0, 1, 3,  // first Triangle
+        1, 2, 3   // second Triangle
+    };
+
+    glGenVertexArrays(1, &VAO_id);
+    glBindVertexArray(VAO_id);
+
+    glGenBuffers(1, &VBO_id);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO_id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &EBO_id);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    glBindVertexArray(0);
+}
+
+EdgePass::~EdgePass()
+{
+    glDeleteVertexArrays(1, &VAO_id);
+    glDeleteBuffers(1, &VBO_id);
+    glDeleteBuffers(1, &EBO_id);
+}
+
+void EdgePass::run(GLuint input_texture, const RenderTarget& target)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    edge_shader.use();
+    glBindVertexArray(VAO_id);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void EdgePass::run(GLuint input_texture, const RenderTarget& target, const std::vector<Rect>& regions)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    edge_shader.use();
+    glBindVertexArray(VAO_id);
+    glEnable(GL_SCISSOR_TEST);
+    for (const Rect& region : regions)
+    {
+        if (region.empty())
+            continue;
+        glScissor(region.x, region.y, region.width, region.height);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glBindVertexArray(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void EdgePass::draw(const RenderTarget& target, int width, int height)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, width, height);
+    glBindVertexArray(VAO_id);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+void upload_texture_region(GLuint texture, const unsigned char* pixels, size_t stride, int channels, const Rect& region)
+{
+    if (region.empty())
+        return;
+
+    GLenum format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    //the row length is counted in pixels, strides that are not a whole number of pixels go row by row
+    if (stride % channels == 0)
+    {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(stride / channels));
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, region.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, region.y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, format, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    else
+    {
+        for (int y = region.y; y < region.y + region.height; ++y)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, y, region.width, 1, format, GL_UNSIGNED_BYTE,
+                            pixels + (size_t)y * stride + (size_t)region.x * channels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,395 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include "BatchSobelPass.h"
+#include "EdgeService.h"
+#include "Shader.h"
+
+static double now_ms()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//an image of height rows, stride bytes apart, has to lie inside the segment, the last row only needs row_bytes
+static bool fits_segment(uint64_t offset, uint64_t stride, uint64_t row_bytes, int height, uint64_t segment_size)
+{
+    //stride comes from the client, divide instead of multiplying so a huge stride cannot wrap the size
+    if (stride < row_bytes || height < 1 || offset > segment_size || row_bytes > segment_size - offset)
+        return false;
+    return height == 1 || stride <= (segment_size - offset - row_bytes) / (uint64_t)(height - 1);
+}
+
+EdgeServer::EdgeServer(const EdgeServerConfig& config)
+    : settings(config)
+{
+}
+
+EdgeServer::~EdgeServer() = default;
+
+bool EdgeServer::start(Shader* int_edge_shader, Shader* batch_edge_shader)
+{
+    EdgeDetectorConfig detector_config;
+    detector_config.backend = settings.backend;
+    detector_config.thread_count = settings.thread_count;
+    detector.configure(detector_config);
+    if (int_edge_shader)
+        detector.enable_gl(*int_edge_shader);
+
+    if (settings.backend == EdgeBackend::GL)
+    {
+        if (!batch_edge_shader)
+        {
+            std::cout << "ERROR: THE GL BACKEND NEEDS edge_detection_batch.fs" << std::endl;
+            return false;
+        }
+        batch_pass = std::make_unique<BatchSobelPass>(*batch_edge_shader);
+    }
+
+    if (!listener.listen(settings.socket_path))
+    {
+        std::cout << "Failed to listen on " << settings.socket_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+EdgeServer::ReadResult EdgeServer::read_request(size_t connection_index, Pending& pending)
+{
+    Connection& connection = *connections[connection_index];
+    size_t received = 0;
+    if (!connection.socket.receive_some((char*)&connection.partial + connection.partial_size, sizeof(EdgeServiceRequest) - connection.partial_size, received))
+        return ReadResult::CLOSED;
+    connection.partial_size += received;
+    if (connection.partial_size < sizeof(EdgeServiceRequest))
+        return ReadResult::INCOMPLETE;
+    connection.partial_size = 0;
+
+    EdgeServiceRequest& request = pending.request;
+    request = connection.partial;
+
+    pending.connection = connection_index;
+    pending.received = now_ms();
+    pending.response.id = request.id;
+
+    uint32_t& status = pending.response.status;
+    if (request.magic != EDGE_SERVICE_MAGIC || request.version != EDGE_SERVICE_VERSION)
+    {
+        status = (uint32_t)EdgeServiceStatus::BAD_REQUEST;
+        return ReadResult::COMPLETE;
+    }
+    if (request.command == (uint32_t)EdgeServiceCommand::SHUTDOWN)
+    {
+        stop();
+        return ReadResult::COMPLETE;
+    }
+    if (request.command != (uint32_t)EdgeServiceCommand::DETECT || request.width <= 0 || request.height <= 0 ||
+        request.channels < 1 || request.channels > 4 || request.kernel > (uint32_t)GradientKernel::SCHARR ||
+        request.channel_mode > (uint32_t)EdgeChannels::MAX || request.low_threshold < 0 ||
+        request.high_threshold > 255 || request.low_threshold > request.high_threshold)
+    {
+        status = (uint32_t)EdgeServiceStatus::BAD_REQUEST;
+        return ReadResult::COMPLETE;
+    }
+
+    //the segment stays mapped for the connection, clients normally keep one for their lifetime
+    request.segment[sizeof(request.segment) - 1] = '\0';
+    if (connection.segment.name() != request.segment || connection.segment.size() != request.segment_size)
+    {
+        if (!connection.segment.open(request.segment, (size_t)request.segment_size))
+        {
+            status = (uint32_t)EdgeServiceStatus::SEGMENT_UNAVAILABLE;
+            return ReadResult::COMPLETE;
+        }
+    }
+
+    if (!fits_segment(request.input_offset, request.input_stride, (uint64_t)request.width * request.channels, request.height, request.segment_size) ||
+        !fits_segment(request.output_offset, request.output_stride, (uint64_t)request.width, request.height, request.segment_size))
+    {
+        status = (uint32_t)EdgeServiceStatus::BAD_REQUEST;
+        return ReadResult::COMPLETE;
+    }
+
+    pending.input = connection.segment.data() + request.input_offset;
+    pending.output = connection.segment.data() + request.output_offset;
+    return ReadResult::COMPLETE;
+}
+
+void EdgeServer::run_gl_round(std::vector<Pending>& round)
+{
+    //one batch per kernel and threshold combination, they are shader uniforms
+    std::map<std::tuple<uint32_t, int32_t, int32_t>, std::vector<size_t>> configurations;
+    for (size_t i = 0; i < round.size(); ++i)
+    {
+        if (round[i].input)
+            configurations[{ round[i].request.kernel, round[i].request.low_threshold, round[i].request.high_threshold }].push_back(i);
+    }
+
+    round_luma.resize(round.size());
+    std::vector<std::pair<uint64_t, const std::vector<size_t>*>> tickets;
+    for (const auto& [configuration, members] : configurations)
+    {
+        //color goes up straight from the client's segment, luma is converted here
+        std::vector<BatchImage> images(members.size());
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            const EdgeServiceRequest& request = round[members[i]].request;
+            BatchImage& image = images[i];
+            image.width = request.width;
+            image.height = request.height;
+            bool color = request.channel_mode == (uint32_t)EdgeChannels::MAX && request.channels >= 3;
+            if (color || request.channels == 1)
+            {
+                image.pixels = round[members[i]].input;
+                image.stride = (size_t)request.input_stride;
+                image.channels = request.channels;
+                continue;
+            }
+            Image& luma = round_luma[members[i]];
+            if (luma.width() != request.width || luma.height() != request.height)
+                luma = Image(request.width, request.height, 1, PixelLayout::PLANAR);
+            luma_u8(round[members[i]].input, (size_t)request.input_stride, request.channels, luma.row(0), luma.stride(), request.width, request.height);
+            image.pixels = luma.row(0);
+            image.stride = luma.stride();
+        }
+
+        auto [kernel, low, high] = configuration;
+        batch_pass->set_kernel((GradientKernel)kernel);
+        batch_pass->set_thresholds(low, high);
+        tickets.push_back({ batch_pass->submit(images), &members });
+    }
+
+    //every batch is queued before the first readback waits
+    std::vector<bool> filled(round.size(), false);
+    for (const auto& [ticket, members] : tickets)
+    {
+        batch_pass->collect(ticket, [&](size_t index, int, int, size_t& stride)
+        {
+            Pending& pending = round[(*members)[index]];
+            filled[(*members)[index]] = true;
+            stride = (size_t)pending.request.output_stride;
+            return pending.output;
+        });
+    }
+
+    for (size_t i = 0; i < round.size(); ++i)
+    {
+        if (!round[i].input)
+            continue;
+        round[i].response.backend = (uint32_t)EdgeBackend::GL;
+        if (!filled[i])
+            round[i].response.status = (uint32_t)EdgeServiceStatus::FAILED;
+    }
+}
+
+void EdgeServer::run_round(std::vector<Pending>& round)
+{
+    ++totals.rounds;
+    totals.largest_round = std::max<uint64_t>(totals.largest_round, round.size());
+
+    if (batch_pass)
+    {
+        run_gl_round(round);
+    }
+    else
+    {
+        for (Pending& pending : round)
+        {
+            if (!pending.input)
+                continue;
+            const EdgeServiceRequest& request = pending.request;
+            EdgeDetectorConfig config = detector.config();
+            config.kernel = (GradientKernel)request.kernel;
+            config.channels = (EdgeChannels)request.channel_mode;
+            config.low_threshold = request.low_threshold;
+            config.high_threshold = request.high_threshold;
+            detector.configure(config);
+            if (!detector.process(pending.input, (size_t)request.input_stride, request.width, request.height, request.channels,
+                                  pending.output, (size_t)request.output_stride))
+                pending.response.status = (uint32_t)EdgeServiceStatus::FAILED;
+            pending.response.backend = (uint32_t)detector.last_backend();
+        }
+    }
+
+    for (const Pending& pending : round)
+    {
+        if (pending.request.command != (uint32_t)EdgeServiceCommand::DETECT)
+            continue;
+        ++totals.requests;
+        if (pending.response.status != (uint32_t)EdgeServiceStatus::OK)
+            ++totals.failed;
+    }
+}
+
+void EdgeServer::run()
+{
+    std::vector<Pending> round;
+    std::vector<bool> readable;
+    while (!stopping)
+    {
+        //the timeout only bounds how long stop() takes to be noticed
+        std::vector<LocalSocket*> sockets = { &listener };
+        for (auto& connection : connections)
+            sockets.push_back(&connection->socket);
+        if (!poll_readable(sockets, 100, readable))
+        {
+            std::cout << "ERROR: EDGE SERVICE POLL FAILED" << std::endl;
+            break;
+        }
+        bool connection_waiting = readable[0];
+
+        //one request from every client that has sent a whole one
+        round.clear();
+        std::vector<bool> closed(connections.size(), false);
+        std::vector<bool> in_round(connections.size(), false);
+        for (size_t i = 0; i < connections.size() && round.size() < settings.max_batch; ++i)
+        {
+            if (!readable[i + 1])
+                continue;
+            Pending pending;
+            ReadResult result = read_request(i, pending);
+            if (result == ReadResult::COMPLETE)
+            {
+                round.push_back(pending);
+                in_round[i] = true;
+            }
+            else if (result == ReadResult::CLOSED)
+            {
+                closed[i] = true;
+            }
+        }
+
+        //optionally give the other clients a moment to join the round
+        double deadline = now_ms() + settings.batch_window_ms;
+        while (!round.empty() && round.size() < settings.max_batch && !stopping)
+        {
+            double remaining = deadline - now_ms();
+            std::vector<LocalSocket*> waiting;
+            std::vector<size_t> waiting_index;
+            for (size_t i = 0; i < connections.size(); ++i)
+            {
+                if (!in_round[i] && !closed[i])
+                {
+                    waiting.push_back(&connections[i]->socket);
+                    waiting_index.push_back(i);
+                }
+            }
+            if (remaining <= 0.0 || waiting.empty() || !poll_readable(waiting, (int)std::ceil(remaining), readable))
+                break;
+
+            bool joined = false;
+            for (size_t j = 0; j < waiting.size() && round.size() < settings.max_batch; ++j)
+            {
+                if (!readable[j])
+                    continue;
+                Pending pending;
+                ReadResult result = read_request(waiting_index[j], pending);
+                if (result == ReadResult::COMPLETE)
+                {
+                    round.push_back(pending);
+                    in_round[waiting_index[j]] = true;
+                    joined = true;
+                }
+                else if (result == ReadResult::CLOSED)
+                {
+                    closed[waiting_index[j]] = true;
+                }
+            }
+            if (!joined)
+                break;
+        }
+
+        if (!round.empty())
+            run_round(round);
+        for (Pending& pending : round)
+        {
+            pending.response.batch_size = (uint32_t)round.size();
+            pending.response.service_ms = now_ms() - pending.received;
+            if (!connections[pending.connection]->socket.send_all(&pending.response, sizeof(pending.response)))
+                closed[pending.connection] = true;
+        }
+
+        for (size_t i = closed.size(); i-- > 0;)
+        {
+            if (closed[i])
+                connections.erase(connections.begin() + i);
+        }
+
+        //new clients join after the round so the indices above stay valid
+        if (connection_waiting)
+        {
+            auto connection = std::make_unique<Connection>();
+            connection->socket = listener.accept();
+            if (connection->socket.is_open())
+            {
+                connections.push_back(std::move(connection));
+                ++totals.connections;
+            }
+        }
+    }
+}
+
+bool EdgeClient::connect(const std::string& socket_path, size_t capacity)
+{
+    close();
+
+    //several clients of one process each get their own segment
+    static std::atomic<unsigned> segment_tag = 0;
+    output_offset = (capacity + 63) / 64 * 64;
+    if (!segment.create(shared_memory_name("sevenger", segment_tag++), 2 * output_offset))
+    {
+        std::cout << "Failed to create shared memory of " << 2 * output_offset << " bytes" << std::endl;
+        return false;
+    }
+    if (!socket.connect(socket_path))
+    {
+        std::cout << "Failed to connect to " << socket_path << std::endl;
+        segment.close();
+        return false;
+    }
+    return true;
+}
+
+void EdgeClient::close()
+{
+    socket.close();
+    segment.close();
+    output_offset = 0;
+}
+
+bool EdgeClient::detect(int width, int height, int channels, size_t stride, const EdgeDetectorConfig& config,
+                        EdgeServiceResponse& response)
+{
+    EdgeServiceRequest request;
+    request.kernel = (uint32_t)config.kernel;
+    request.channel_mode = (uint32_t)config.channels;
+    request.low_threshold = config.low_threshold;
+    request.high_threshold = config.high_threshold;
+    request.width = width;
+    request.height = height;
+    request.channels = channels;
+    request.id = next_id++;
+    request.segment_size = segment.size();
+    request.input_offset = 0;
+    request.input_stride = stride;
+    request.output_offset = output_offset;
+    request.output_stride = (uint64_t)width;
+    std::strncpy(request.segment, segment.name().c_str(), sizeof(request.segment) - 1);
+
+    if (!socket.send_all(&request, sizeof(request)) || !socket.receive_all(&response, sizeof(response)))
+        return false;
+    return response.magic == EDGE_SERVICE_MAGIC && response.id == request.id;
+}
+
+bool EdgeClient::shutdown_server()
+{
+    EdgeServiceRequest request;
+    request.command = (uint32_t)EdgeServiceCommand::SHUTDOWN;
+    request.id = next_id++;
+    EdgeServiceResponse response;
+    return socket.send_all(&request, sizeof(request)) && socket.receive_all(&response, sizeof(response));
+}
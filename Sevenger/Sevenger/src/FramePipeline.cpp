@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cstring>
+#include "FramePipeline.h"
+#include "TextureManager.h"
+
+static GLenum pixel_format(int channels)
+{
+    if (channels == 1)
+        return GL_RED;
+    else if (channels == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    if (sorted.empty())
+        return 0.0;
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+FramePipeline::FramePipeline(std::unique_ptr<FrameSource> source, Shader& edge_shader, const FramePipelineConfig& config, FrameSink sink)
+    : source(std::move(source)),
+      config(config),
+      sink(std::move(sink)),
+      edge_pass(edge_shader),
+      decoded(config.queue_depth),
+      completed(config.queue_depth),
+      slots(std::max<size_t>(config.queue_depth, 1))
+{
+    for (Slot& slot : slots)
+    {
+        glGenBuffers(1, &slot.upload_pbo);
+        glGenBuffers(1, &slot.readback_pbo);
+        glGenTextures(1, &slot.input_texture);
+        glBindTexture(GL_TEXTURE_2D, slot.input_texture);
+        //no mipmaps are generated per frame, so sample level 0 only
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+FramePipeline::~FramePipeline()
+{
+    stopping = true;
+    decoded.close();
+    completed.close();
+    if (decode_thread.joinable())
+        decode_thread.join();
+    if (sink_thread.joinable())
+        sink_thread.join();
+
+    for (Slot& slot : slots)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        untrack_buffer_memory(slot.upload_pbo);
+        untrack_buffer_memory(slot.readback_pbo);
+        untrack_texture_memory(slot.input_texture);
+        glDeleteBuffers(1, &slot.upload_pbo);
+        glDeleteBuffers(1, &slot.readback_pbo);
+        glDeleteTextures(1, &slot.input_texture);
+        destroy_render_target(slot.target);
+    }
+    destroy_render_target(display_target);
+}
+
+void FramePipeline::start()
+{
+    if (started)
+        return;
+
+    started = true;
+    start_time = std::chrono::steady_clock::now();
+    decode_thread = std::thread(&FramePipeline::decode_loop, this);
+    sink_thread = std::thread(&FramePipeline::sink_loop, this);
+}
+
+void FramePipeline::stop()
+{
+    stopping = true;
+}
+
+void FramePipeline::count_drop()
+{
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    ++frames_dropped;
+}
+
+void FramePipeline::decode_loop()
+{
+    using clock = std::chrono::steady_clock;
+    auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(config.source_fps > 0.0 ? 1.0 / config.source_fps : 0.0));
+    auto next_capture = clock::now();
+
+    while (!stopping)
+    {
+        if (config.source_fps > 0.0)
+        {
+            std::this_thread::sleep_until(next_capture);
+            next_capture += period;
+        }
+
+        Frame frame;
+        auto capture_time = clock::now();
+        if (!source->next(frame))
+            break;
+        frame.capture_time = capture_time;
+
+        {
+            std::lock_guard<std::mutex> lock(metrics_mutex);
+            ++frames_decoded;
+        }
+
+        if (config.drop_when_full)
+        {
+            Frame evicted;
+            if (decoded.push_drop_oldest(std::move(frame), evicted))
+                count_drop();
+        }
+        else if (!decoded.push(std::move(frame)))
+        {
+            break;
+        }
+    }
+    decoded.close();
+}
+
+void FramePipeline::sink_loop()
+{
+    Frame frame;
+    while (completed.pop(frame))
+    {
+        if (sink)
+            sink(frame);
+
+        double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame.capture_time).count();
+        std::lock_guard<std::mutex> lock(metrics_mutex);
+        latencies_ms.push_back(latency_ms);
+        end_time = std::chrono::steady_clock::now();
+    }
+}
+
+bool FramePipeline::submit(Slot& slot, Frame&& frame)
+{
+    //without a target there is nothing to render or read back into, the frame is dropped
+    if (!create_render_target(slot.target, frame.width, frame.height))
+    {
+        count_drop();
+        return false;
+    }
+
+    //upload through a PBO so the copy into driver memory does not wait for the GPU
+    size_t upload_size = frame.pixels.size();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.upload_pbo);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, upload_size, nullptr, GL_STREAM_DRAW);
+    track_buffer_memory(slot.upload_pbo, upload_size);
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, upload_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped)
+    {
+        std::memcpy(mapped, frame.pixels.data(), upload_size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    GLenum format = pixel_format(frame.channels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, slot.input_texture);
+    if (slot.input_width != frame.width || slot.input_height != frame.height || slot.input_channels != frame.channels)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, format, frame.width, frame.height, 0, format, GL_UNSIGNED_BYTE, (void*)0);
+        track_texture_memory(GL_TEXTURE_2D, slot.input_texture);
+        slot.input_width = frame.width;
+        slot.input_height = frame.height;
+        slot.input_channels = frame.channels;
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height, format, GL_UNSIGNED_BYTE, (void*)0);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    //edge detect
+    edge_pass.run(slot.input_texture, slot.target);
+
+    //asynchronous readback, completion is signalled by the fence
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, slot.target.framebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.readback_pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, (size_t)frame.width * frame.height * 4, nullptr, GL_STREAM_READ);
+    track_buffer_memory(slot.readback_pbo, (size_t)frame.width * frame.height * 4);
+    glReadPixels(0, 0, frame.width, frame.height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = std::move(frame);
+    return true;
+}
+
+bool FramePipeline::retire_oldest()
+{
+    Slot& slot = slots[oldest];
+    GLenum wait_result = glClientWaitSync(slot.fence, 0, 0);
+    if (wait_result == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    Frame& frame = slot.frame;
+    size_t readback_size = (size_t)frame.width * frame.height * 4;
+    frame.channels = 4;
+    frame.pixels.resize(readback_size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.readback_pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback_size, GL_MAP_READ_BIT);
+    if (mapped)
+    {
+        std::memcpy(frame.pixels.data(), mapped, readback_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    //the slot is rendered into again (and reallocated on a size change) while the viewer may still
+    //sample its output, so the output is copied into a texture only this function writes
+    if (create_render_target(display_target, frame.width, frame.height))
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, slot.target.framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, display_target.framebuffer);
+        glBlitFramebuffer(0, 0, frame.width, frame.height, 0, 0, frame.width, frame.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    if (config.drop_when_full)
+    {
+        Frame evicted;
+        if (completed.push_drop_oldest(std::move(frame), evicted))
+            count_drop();
+    }
+    else
+    {
+        completed.push(std::move(frame));
+    }
+
+    oldest = (oldest + 1) % slots.size();
+    --in_flight;
+    return true;
+}
+
+bool FramePipeline::pump()
+{
+    if (!started)
+        start();
+    if (finished)
+        return false;
+
+    while (in_flight > 0 && retire_oldest())
+    {
+    }
+
+    bool submitted = false;
+    while (in_flight < slots.size())
+    {
+        Frame frame;
+        if (!decoded.try_pop(frame))
+            break;
+
+        if (submit(slots[(oldest + in_flight) % slots.size()], std::move(frame)))
+        {
+            ++in_flight;
+            submitted = true;
+        }
+    }
+    if (submitted)
+        glFlush();
+
+    if (in_flight == 0 && decoded.is_closed() && decoded.size() == 0)
+    {
+        completed.close();
+        if (decode_thread.joinable())
+            decode_thread.join();
+        if (sink_thread.joinable())
+            sink_thread.join();
+        finished = true;
+        return false;
+    }
+    return true;
+}
+
+void FramePipeline::run()
+{
+    while (pump())
+    {
+        if (in_flight > 0)
+            glClientWaitSync(slots[oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+GLuint FramePipeline::latest_output_texture() const
+{
+    return display_target.texture;
+}
+
+FramePipelineMetrics FramePipeline::metrics() const
+{
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+
+    FramePipelineMetrics result;
+    result.frames_decoded = frames_decoded;
+    result.frames_completed = latencies_ms.size();
+    result.frames_dropped = frames_dropped;
+
+    std::vector<double> sorted = latencies_ms;
+    std::sort(sorted.begin(), sorted.end());
+    if (!sorted.empty())
+    {
+        double sum = 0.0;
+        for (double latency : sorted)
+            sum += latency;
+        result.latency_mean_ms = sum / (double)sorted.size();
+        result.latency_p50_ms = percentile(sorted, 0.50);
+        result.latency_p95_ms = percentile(sorted, 0.95);
+        result.latency_p99_ms = percentile(sorted, 0.99);
+        result.latency_max_ms = sorted.back();
+
+        result.elapsed_seconds = std::chrono::duration<double>(end_time - start_time).count();
+        if (result.elapsed_seconds > 0.0)
+            result.throughput_fps = (double)result.frames_completed / result.elapsed_seconds;
+    }
+    return result;
+}
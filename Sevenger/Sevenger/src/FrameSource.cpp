@@ -0,0 +1,241 @@
+#include <stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "FrameSource.h"
+
+bool parse_raw_format(const std::string& name, RawFormat& format)
+{
+    if (name == "gray8")
+        format = RawFormat::GRAY8;
+    else if (name == "rgb24")
+        format = RawFormat::RGB24;
+    else if (name == "rgba32")
+        format = RawFormat::RGBA32;
+    else if (name == "yuv420p")
+        format = RawFormat::YUV420P;
+    else
+        return false;
+
+    return true;
+}
+
+size_t raw_frame_size(RawFormat format, int width, int height)
+{
+    size_t pixels = (size_t)width * (size_t)height;
+    switch (format)
+    {
+    case RawFormat::GRAY8:   return pixels;
+    case RawFormat::RGB24:   return pixels * 3;
+    case RawFormat::RGBA32:  return pixels * 4;
+    case RawFormat::YUV420P: return pixels + 2 * ((size_t)((width + 1) / 2) * (size_t)((height + 1) / 2));
+    }
+    return 0;
+}
+
+static unsigned char clamp_to_byte(int value)
+{
+    return (unsigned char)std::clamp(value, 0, 255);
+}
+
+//BT.601 limited range to RGB, 8 bit fixed point
+static void yuv420p_to_rgb(const unsigned char* src, int width, int height, unsigned char* dst)
+{
+    int chroma_width = (width + 1) / 2;
+    int chroma_height = (height + 1) / 2;
+    const unsigned char* y_plane = src;
+    const unsigned char* u_plane = y_plane + (size_t)width * height;
+    const unsigned char* v_plane = u_plane + (size_t)chroma_width * chroma_height;
+
+    for (int y = 0; y < height; ++y)
+    {
+        //write rows bottom-up
+        unsigned char* out = dst + (size_t)(height - 1 - y) * width * 3;
+        const unsigned char* y_row = y_plane + (size_t)y * width;
+        const unsigned char* u_row = u_plane + (size_t)(y / 2) * chroma_width;
+        const unsigned char* v_row = v_plane + (size_t)(y / 2) * chroma_width;
+        for (int x = 0; x < width; ++x)
+        {
+            int c = 298 * (y_row[x] - 16);
+            int d = u_row[x / 2] - 128;
+            int e = v_row[x / 2] - 128;
+            out[0] = clamp_to_byte((c + 409 * e + 128) >> 8);
+            out[1] = clamp_to_byte((c - 100 * d - 208 * e + 128) >> 8);
+            out[2] = clamp_to_byte((c + 516 * d + 128) >> 8);
+            out += 3;
+        }
+    }
+}
+
+ImageSequenceSource::ImageSequenceSource(const std::string& pattern, int first_index)
+    : pattern(pattern), next_index(first_index)
+{
+}
+
+bool ImageSequenceSource::next(Frame& frame)
+{
+    char path[1024];
+    std::snprintf(path, sizeof(path), pattern.c_str(), next_index);
+
+    //flip flag is per thread so decoder threads do not race with load_texture
+    stbi_set_flip_vertically_on_load_thread(true);
+    int width, height, channels;
+    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+    if (!data)
+        return false;
+
+    frame.index = next_index++;
+    frame.width = width;
+    frame.height = height;
+    //the pipeline uploads 1, 3 or 4 channels, gray+alpha frames are expanded to RGBA like the texture cache does
+    //expanded here rather than decoded twice, this runs for every frame
+    if (channels == 2)
+    {
+        size_t pixel_count = (size_t)width * height;
+        frame.channels = 4;
+        frame.pixels.resize(pixel_count * 4);
+        for (size_t i = 0; i < pixel_count; ++i)
+        {
+            unsigned char gray = data[i * 2];
+            frame.pixels[i * 4] = gray;
+            frame.pixels[i * 4 + 1] = gray;
+            frame.pixels[i * 4 + 2] = gray;
+            frame.pixels[i * 4 + 3] = data[i * 2 + 1];
+        }
+    }
+    else
+    {
+        frame.channels = channels;
+        frame.pixels.assign(data, data + (size_t)width * height * channels);
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+RawFrameSource::RawFrameSource(const std::string& path, int width, int height, RawFormat format, bool loop)
+    : width(width), height(height), format(format), loop(loop)
+{
+    file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        std::cout << "Failed to open raw frame file: " << path << std::endl;
+    staging.resize(raw_frame_size(format, width, height));
+}
+
+RawFrameSource::~RawFrameSource()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool RawFrameSource::next(Frame& frame)
+{
+    if (!file || staging.empty())
+        return false;
+
+    if (std::fread(staging.data(), 1, staging.size(), file) != staging.size())
+    {
+        if (!loop || next_index == 0)
+            return false;
+        std::rewind(file);
+        if (std::fread(staging.data(), 1, staging.size(), file) != staging.size())
+            return false;
+    }
+
+    frame.index = next_index++;
+    frame.width = width;
+    frame.height = height;
+
+    if (format == RawFormat::YUV420P)
+    {
+        frame.channels = 3;
+        frame.pixels.resize((size_t)width * height * 3);
+        yuv420p_to_rgb(staging.data(), width, height, frame.pixels.data());
+        return true;
+    }
+
+    frame.channels = format == RawFormat::GRAY8 ? 1 : (format == RawFormat::RGB24 ? 3 : 4);
+    size_t row_size = (size_t)width * frame.channels;
+    frame.pixels.resize(row_size * height);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(frame.pixels.data() + (size_t)(height - 1 - y) * row_size, staging.data() + (size_t)y * row_size, row_size);
+
+    return true;
+}
+
+SyntheticSequenceSource::SyntheticSequenceSource(const std::string& background_path, const std::string& sprite_path, int frame_count)
+    : background_path(background_path), sprite_path(sprite_path), frame_count(frame_count)
+{
+}
+
+bool SyntheticSequenceSource::load()
+{
+    stbi_set_flip_vertically_on_load_thread(true);
+    int channels;
+    unsigned char* data = stbi_load(background_path.c_str(), &width, &height, &channels, 3);
+    if (!data)
+    {
+        std::cout << "Failed to load image: " << background_path << std::endl;
+        return false;
+    }
+    background.assign(data, data + (size_t)width * height * 3);
+    stbi_image_free(data);
+
+    int source_width, source_height;
+    data = stbi_load(sprite_path.c_str(), &source_width, &source_height, &channels, 4);
+    if (!data)
+    {
+        std::cout << "Failed to load image: " << sprite_path << std::endl;
+        return false;
+    }
+
+    //an eighth of the background width, nearest neighbour is fine for a moving test pattern
+    sprite_width = std::max(1, std::min(width / 8, source_width));
+    sprite_height = std::max(1, std::min(height, sprite_width * source_height / source_width));
+    sprite.resize((size_t)sprite_width * sprite_height * 4);
+    for (int y = 0; y < sprite_height; ++y)
+    {
+        const unsigned char* in = data + (size_t)(y * source_height / sprite_height) * source_width * 4;
+        for (int x = 0; x < sprite_width; ++x)
+            std::memcpy(&sprite[((size_t)y * sprite_width + x) * 4], in + (size_t)(x * source_width / sprite_width) * 4, 4);
+    }
+    stbi_image_free(data);
+    return true;
+}
+
+bool SyntheticSequenceSource::next(Frame& frame)
+{
+    if (next_index >= frame_count || (background.empty() && !load()))
+        return false;
+
+    frame.index = next_index;
+    frame.width = width;
+    frame.height = height;
+    frame.channels = 3;
+    frame.pixels = background;
+
+    //bounce between the edges, a few pixels per frame
+    auto bounce = [](int t, int range)
+    {
+        if (range <= 0)
+            return 0;
+        int position = t % (2 * range);
+        return position < range ? position : 2 * range - position;
+    };
+    int origin_x = bounce(next_index * 7, width - sprite_width);
+    int origin_y = bounce(next_index * 5, height - sprite_height);
+
+    for (int y = 0; y < sprite_height; ++y)
+    {
+        unsigned char* out = frame.pixels.data() + ((size_t)(origin_y + y) * width + origin_x) * 3;
+        const unsigned char* in = sprite.data() + (size_t)y * sprite_width * 4;
+        for (int x = 0; x < sprite_width; ++x, out += 3, in += 4)
+        {
+            int alpha = in[3];
+            for (int c = 0; c < 3; ++c)
+                out[c] = (unsigned char)((in[c] * alpha + out[c] * (255 - alpha) + 127) / 255);
+        }
+    }
+
+    ++next_index;
+    return true;
+}
@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <iostream>
+#include "HoughPass.h"
+
+HoughPass::HoughPass(Shader& line_shader, Shader& circle_shader)
+    : line_shader(line_shader), circle_shader(circle_shader)
+{
+    GLint texture_size = 0;
+    GLint viewport_size[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &texture_size);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport_size);
+    max_target_size = std::min({ texture_size, viewport_size[0], viewport_size[1] });
+
+    glGenBuffers(1, &direction_VBO_id);
+    glGenBuffers(1, &offset_VBO_id);
+    glGenBuffers(1, &point_VBO_id);
+
+    //per vertex the vote (a theta bin's direction or a circle cell), per instance the edge point
+    glGenVertexArrays(1, &line_VAO_id);
+    glBindVertexArray(line_VAO_id);
+    glBindBuffer(GL_ARRAY_BUFFER, direction_VBO_id);
+    glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(int32_t), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, point_VBO_id);
+    glVertexAttribIPointer(1, 2, GL_INT, sizeof(EdgePoint), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    glGenVertexArrays(1, &circle_VAO_id);
+    glBindVertexArray(circle_VAO_id);
+    glBindBuffer(GL_ARRAY_BUFFER, offset_VBO_id);
+    glVertexAttribIPointer(0, 3, GL_INT, 3 * sizeof(int32_t), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, point_VBO_id);
+    glVertexAttribIPointer(1, 2, GL_INT, sizeof(EdgePoint), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+HoughPass::~HoughPass()
+{
+    glDeleteVertexArrays(1, &line_VAO_id);
+    glDeleteVertexArrays(1, &circle_VAO_id);
+    glDeleteBuffers(1, &direction_VBO_id);
+    glDeleteBuffers(1, &offset_VBO_id);
+    glDeleteBuffers(1, &point_VBO_id);
+    destroy_render_target(target);
+}
+
+bool HoughPass::prepare_target(int width, int height)
+{
+    if (width > max_target_size || height > max_target_size)
+    {
+        //reported once per size, the bench calls again on every timed run
+        if (width != reported_width || height != reported_height)
+            std::cout << "ERROR: HOUGH ACCUMULATOR IS LARGER THAN THE MAXIMUM TARGET SIZE: " << width << "x" << height << std::endl;
+        reported_width = width;
+        reported_height = height;
+        return false;
+    }
+    return create_render_target(target, width, height, GL_R32F);
+}
+
+void HoughPass::upload_points(const std::vector<EdgePoint>& points)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, point_VBO_id);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(EdgePoint), points.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    point_count = (GLsizei)points.size();
+}
+
+void HoughPass::vote(GLuint vertex_array, GLint first_vertex, GLsizei vertex_count)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glViewport(0, 0, target.width, target.height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(vertex_array);
+    if (point_count > 0 && vertex_count > 0)
+        glDrawArraysInstanced(GL_POINTS, first_vertex, vertex_count, point_count);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+}
+
+void HoughPass::read(HoughAccumulator& accumulator, int first_layer, int layer_count, int tile_columns)
+{
+    readback.resize((size_t)target.width * target.height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, target.width, target.height, GL_RED, GL_FLOAT, readback.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    //tile i of the target is layer first_layer + i of the accumulator
+    int width = accumulator.width, height = accumulator.height;
+    for (int tile = 0; tile < layer_count; ++tile)
+    {
+        const float* origin = readback.data() + (size_t)(tile / tile_columns) * height * target.width + (size_t)(tile % tile_columns) * width;
+        uint32_t* plane = accumulator.votes.data() + (size_t)(first_layer + tile) * width * height;
+        for (int y = 0; y < height; ++y)
+        {
+            const float* in = origin + (size_t)y * target.width;
+            uint32_t* out = plane + (size_t)y * width;
+            for (int x = 0; x < width; ++x)
+                out[x] = (uint32_t)in[x];
+        }
+    }
+}
+
+bool HoughPass::accumulate_lines(const std::vector<EdgePoint>& points, int width, int height, int theta_bins,
+                                 HoughAccumulator& accumulator)
+{
+    int rho_offset = hough_rho_offset(width, height);
+    accumulator.resize(theta_bins, 2 * rho_offset + 1, 1);
+    if (this->theta_bins != theta_bins)
+    {
+        std::vector<int32_t> directions;
+        hough_line_directions(theta_bins, directions);
+        glBindBuffer(GL_ARRAY_BUFFER, direction_VBO_id);
+        glBufferData(GL_ARRAY_BUFFER, directions.size() * sizeof(int32_t), directions.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        this->theta_bins = theta_bins;
+    }
+    if (!prepare_target(accumulator.width, accumulator.height))
+        return false;
+
+    upload_points(points);
+    line_shader.use();
+    line_shader.set_int("rhoBias", (rho_offset << 15) + (1 << 14));
+    line_shader.set_ivec2("accumulatorSize", accumulator.width, accumulator.height);
+    vote(line_VAO_id, 0, theta_bins);
+    read(accumulator, 0, 1, 1);
+    return true;
+}
+
+bool HoughPass::accumulate_circles(const std::vector<EdgePoint>& points, int width, int height, int min_radius, int max_radius,
+                                   HoughAccumulator& accumulator)
+{
+    int layers = std::max(0, max_radius - min_radius + 1);
+    accumulator.resize(width, height, layers);
+    if (layers == 0)
+        return true;
+    if (this->min_radius != min_radius || this->max_radius != max_radius)
+    {
+        //dx, dy and the layer of every cell of every radius, layer by layer so a pass draws a range of them
+        std::vector<int32_t> offsets, cells;
+        layer_first_vertex.assign(1, 0);
+        for (int layer = 0; layer < layers; ++layer)
+        {
+            hough_circle_offsets(min_radius + layer, offsets);
+            for (size_t i = 0; i < offsets.size(); i += 2)
+                cells.insert(cells.end(), { offsets[i], offsets[i + 1], layer });
+            layer_first_vertex.push_back((GLint)(cells.size() / 3));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, offset_VBO_id);
+        glBufferData(GL_ARRAY_BUFFER, cells.size() * sizeof(int32_t), cells.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        this->min_radius = min_radius;
+        this->max_radius = max_radius;
+    }
+
+    //the layers are tiled in a grid as wide and as tall as the target can be; radii beyond one grid
+    //take further passes over the same target
+    int tile_columns = std::min(layers, max_target_size / std::max(width, 1));
+    int tile_rows = std::min((layers + std::max(tile_columns, 1) - 1) / std::max(tile_columns, 1), max_target_size / std::max(height, 1));
+    if (!prepare_target(width * std::max(tile_columns, 1), height * std::max(tile_rows, 1)))
+        return false;
+
+    upload_points(points);
+    circle_shader.use();
+    circle_shader.set_ivec2("imageSize", width, height);
+    circle_shader.set_ivec2("accumulatorSize", target.width, target.height);
+    circle_shader.set_int("tileColumns", tile_columns);
+    int layers_per_pass = tile_columns * tile_rows;
+    for (int first_layer = 0; first_layer < layers; first_layer += layers_per_pass)
+    {
+        int layer_count = std::min(layers_per_pass, layers - first_layer);
+        circle_shader.set_int("firstLayer", first_layer);
+        vote(circle_VAO_id, layer_first_vertex[first_layer], layer_first_vertex[first_layer + layer_count] - layer_first_vertex[first_layer]);
+        read(accumulator, first_layer, layer_count, tile_columns);
+    }
+    return true;
+}
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include "HoughTransform.h"
+
+void HoughAccumulator::resize(int width, int height, int layers)
+{
+    this->width = width;
+    this->height = height;
+    this->layers = layers;
+    votes.assign((size_t)width * height * layers, 0);
+}
+
+int hough_rho_offset(int width, int height)
+{
+    //ceil of the diagonal between the outermost pixel centers, one more for the rounding of the directions
+    int64_t squared = (int64_t)(width - 1) * (width - 1) + (int64_t)(height - 1) * (height - 1);
+    int offset = (int)std::sqrt((double)squared);
+    while ((int64_t)offset * offset < squared)
+        ++offset;
+    return offset + 1;
+}
+
+void hough_line_directions(int theta_bins, std::vector<int32_t>& directions)
+{
+    directions.resize((size_t)theta_bins * 2);
+    for (int t = 0; t < theta_bins; ++t)
+    {
+        double theta = t * 3.14159265358979323846 / theta_bins;
+        directions[2 * t] = (int32_t)std::lround(std::cos(theta) * 32768.0);
+        directions[2 * t + 1] = (int32_t)std::lround(std::sin(theta) * 32768.0);
+    }
+}
+
+void hough_circle_offsets(int radius, std::vector<int32_t>& offsets)
+{
+    //(radius - 1/2)^2 <= dx^2 + dy^2 < (radius + 1/2)^2, times four to stay in integers
+    offsets.clear();
+    int64_t inner = (int64_t)(2 * radius - 1) * (2 * radius - 1), outer = (int64_t)(2 * radius + 1) * (2 * radius + 1);
+    for (int dy = -radius; dy <= radius; ++dy)
+    {
+        for (int dx = -radius; dx <= radius; ++dx)
+        {
+            int64_t distance = 4 * ((int64_t)dx * dx + (int64_t)dy * dy);
+            if (distance >= inner && distance < outer)
+            {
+                offsets.push_back(dx);
+                offsets.push_back(dy);
+            }
+        }
+    }
+}
+
+//threads for count items of about cost votes each, small inputs stay on the caller
+static int hough_thread_count(int thread_count, size_t count, size_t cost)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    size_t work = count * cost;
+    return (int)std::max<size_t>(1, std::min<size_t>((size_t)thread_count, work / (1 << 20)));
+}
+
+static void vote_lines(const EdgePoint* points, size_t count, const int32_t* directions, int theta_bins, int rho_offset,
+                       uint32_t* votes)
+{
+    int32_t bias = (rho_offset << 15) + (1 << 14);
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t x = points[i].x, y = points[i].y;
+        for (int t = 0; t < theta_bins; ++t)
+        {
+            int rho = (x * directions[2 * t] + y * directions[2 * t + 1] + bias) >> 15;
+            ++votes[(size_t)rho * theta_bins + t];
+        }
+    }
+}
+
+void hough_lines_accumulate(const std::vector<EdgePoint>& points, int width, int height, int theta_bins,
+                            HoughAccumulator& accumulator, int thread_count)
+{
+    int rho_offset = hough_rho_offset(width, height);
+    accumulator.resize(theta_bins, 2 * rho_offset + 1, 1);
+    std::vector<int32_t> directions;
+    hough_line_directions(theta_bins, directions);
+
+    thread_count = hough_thread_count(thread_count, points.size(), (size_t)theta_bins);
+    if (thread_count == 1)
+    {
+        vote_lines(points.data(), points.size(), directions.data(), theta_bins, rho_offset, accumulator.votes.data());
+        return;
+    }
+
+    //the first share counts straight into the result, the others into their own accumulators
+    std::vector<std::vector<uint32_t>> private_votes(thread_count - 1, std::vector<uint32_t>(accumulator.votes.size(), 0));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+    {
+        size_t first = points.size() * i / thread_count;
+        size_t last = points.size() * (i + 1) / thread_count;
+        workers.emplace_back(vote_lines, points.data() + first, last - first, directions.data(), theta_bins, rho_offset,
+                             private_votes[i - 1].data());
+    }
+    vote_lines(points.data(), points.size() / thread_count, directions.data(), theta_bins, rho_offset, accumulator.votes.data());
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const std::vector<uint32_t>& votes : private_votes)
+    {
+        for (size_t i = 0; i < votes.size(); ++i)
+            accumulator.votes[i] += votes[i];
+    }
+}
+
+//layers [first_layer, last_layer), radius min_radius + layer
+static void vote_circles(const std::vector<EdgePoint>* points, int width, int height, int min_radius, int first_layer, int last_layer,
+                         uint32_t* votes)
+{
+    std::vector<int32_t> offsets;
+    for (int layer = first_layer; layer < last_layer; ++layer)
+    {
+        hough_circle_offsets(min_radius + layer, offsets);
+        uint32_t* plane = votes + (size_t)layer * width * height;
+        for (const EdgePoint& point : *points)
+        {
+            for (size_t i = 0; i < offsets.size(); i += 2)
+            {
+                int x = point.x + offsets[i], y = point.y + offsets[i + 1];
+                if ((unsigned)x < (unsigned)width && (unsigned)y < (unsigned)height)
+                    ++plane[(size_t)y * width + x];
+            }
+        }
+    }
+}
+
+void hough_circles_accumulate(const std::vector<EdgePoint>& points, int width, int height, int min_radius, int max_radius,
+                              HoughAccumulator& accumulator, int thread_count)
+{
+    int layers = std::max(0, max_radius - min_radius + 1);
+    accumulator.resize(width, height, layers);
+    if (layers == 0)
+        return;
+
+    //about 2 pi r cells per circle, layers are handed out so every thread gets a similar share of the votes
+    thread_count = std::min(layers, hough_thread_count(thread_count, points.size(), (size_t)(3 * (min_radius + max_radius) * layers)));
+    std::vector<int> bounds(thread_count + 1, layers);
+    bounds[0] = 0;
+    int64_t total = 0, share = 0;
+    for (int layer = 0; layer < layers; ++layer)
+        total += min_radius + layer + 1;
+    for (int layer = 0, next = 1; layer < layers && next < thread_count; ++layer)
+    {
+        share += min_radius + layer + 1;
+        if (share * thread_count >= total * next)
+            bounds[next++] = layer + 1;
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+        workers.emplace_back(vote_circles, &points, width, height, min_radius, bounds[i], bounds[i + 1], accumulator.votes.data());
+    vote_circles(&points, width, height, min_radius, bounds[0], bounds[1], accumulator.votes.data());
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+struct HoughCandidate
+{
+    int x;
+    int y;
+    int layer;
+    uint32_t votes;
+    float score;
+};
+
+//at least as many votes as the 8 neighbours in its layer (and the same cell in the layers next to it),
+//plateaus keep several cells, the suppression sorts them out
+static bool local_maximum(const HoughAccumulator& accumulator, int x, int y, int layer, uint32_t votes)
+{
+    for (int dy = -1; dy <= 1; ++dy)
+    {
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            int nx = x + dx, ny = y + dy;
+            if ((dx || dy) && nx >= 0 && nx < accumulator.width && ny >= 0 && ny < accumulator.height && accumulator.at(nx, ny, layer) > votes)
+                return false;
+        }
+    }
+    return !(layer > 0 && accumulator.at(x, y, layer - 1) > votes) && !(layer + 1 < accumulator.layers && accumulator.at(x, y, layer + 1) > votes);
+}
+
+static void sort_candidates(std::vector<HoughCandidate>& candidates)
+{
+    std::sort(candidates.begin(), candidates.end(), [](const HoughCandidate& a, const HoughCandidate& b)
+    {
+        if (a.score != b.score)
+            return a.score > b.score;
+        return a.layer != b.layer ? a.layer < b.layer : (a.y != b.y ? a.y < b.y : a.x < b.x);
+    });
+}
+
+void hough_line_peaks(const HoughAccumulator& accumulator, const HoughLineConfig& config, std::vector<HoughLine>& lines)
+{
+    lines.clear();
+    std::vector<HoughCandidate> candidates;
+    uint32_t min_votes = (uint32_t)std::max(1, config.min_votes);
+    for (int y = 0; y < accumulator.height; ++y)
+    {
+        for (int x = 0; x < accumulator.width; ++x)
+        {
+            uint32_t votes = accumulator.at(x, y);
+            if (votes >= min_votes && local_maximum(accumulator, x, y, 0, votes))
+                candidates.push_back({ x, y, 0, votes, (float)votes });
+        }
+    }
+    sort_candidates(candidates);
+
+    //theta bins wrap around at pi, where the same line has rho negated
+    int theta_bins = accumulator.width, rho_offset = accumulator.height / 2;
+    std::vector<HoughCandidate> kept;
+    for (const HoughCandidate& candidate : candidates)
+    {
+        if ((int)kept.size() >= config.max_lines)
+            break;
+        bool suppressed = false;
+        for (const HoughCandidate& peak : kept)
+        {
+            int theta = std::abs(candidate.x - peak.x);
+            int rho = std::abs(candidate.y - peak.y);
+            int wrapped_rho = std::abs((candidate.y - rho_offset) + (peak.y - rho_offset));
+            suppressed = (theta <= config.suppression && rho <= config.suppression) ||
+                         (theta_bins - theta <= config.suppression && wrapped_rho <= config.suppression);
+            if (suppressed)
+                break;
+        }
+        if (suppressed)
+            continue;
+        kept.push_back(candidate);
+        lines.push_back({ (float)(candidate.x * 3.14159265358979323846 / theta_bins), (float)(candidate.y - rho_offset), (int)candidate.votes });
+    }
+}
+
+void hough_circle_peaks(const HoughAccumulator& accumulator, const HoughCircleConfig& config, std::vector<HoughCircle>& circles)
+{
+    circles.clear();
+    std::vector<HoughCandidate> candidates;
+    std::vector<int32_t> offsets;
+    for (int layer = 0; layer < accumulator.layers; ++layer)
+    {
+        hough_circle_offsets(config.min_radius + layer, offsets);
+        float cells = (float)std::max<size_t>(1, offsets.size() / 2);
+        uint32_t min_votes = (uint32_t)std::max(1.0f, std::ceil(config.min_coverage * cells));
+        for (int y = 0; y < accumulator.height; ++y)
+        {
+            for (int x = 0; x < accumulator.width; ++x)
+            {
+                uint32_t votes = accumulator.at(x, y, layer);
+                if (votes >= min_votes && local_maximum(accumulator, x, y, layer, votes))
+                    candidates.push_back({ x, y, layer, votes, (float)votes / cells });
+            }
+        }
+    }
+    sort_candidates(candidates);
+
+    std::vector<HoughCandidate> kept;
+    for (const HoughCandidate& candidate : candidates)
+    {
+        if ((int)kept.size() >= config.max_circles)
+            break;
+        bool suppressed = std::any_of(kept.begin(), kept.end(), [&](const HoughCandidate& peak)
+        {
+            return std::abs(candidate.x - peak.x) <= config.suppression && std::abs(candidate.y - peak.y) <= config.suppression &&
+                   std::abs(candidate.layer - peak.layer) <= config.suppression;
+        });
+        if (suppressed)
+            continue;
+        kept.push_back(candidate);
+        circles.push_back({ candidate.x, candidate.y, config.min_radius + candidate.layer, (int)candidate.votes });
+    }
+}
+
+void hough_lines(const BinaryEdgeMap& map, const HoughLineConfig& config, std::vector<HoughLine>& lines)
+{
+    std::vector<EdgePoint> points;
+    edge_points(map, points);
+    HoughAccumulator accumulator;
+    hough_lines_accumulate(points, map.width(), map.height(), config.theta_bins, accumulator, config.thread_count);
+    hough_line_peaks(accumulator, config, lines);
+}
+
+void hough_circles(const BinaryEdgeMap& map, const HoughCircleConfig& config, std::vector<HoughCircle>& circles)
+{
+    std::vector<EdgePoint> points;
+    edge_points(map, points);
+    HoughAccumulator accumulator;
+    hough_circles_accumulate(points, map.width(), map.height(), config.min_radius, config.max_radius, accumulator, config.thread_count);
+    hough_circle_peaks(accumulator, config, circles);
+}
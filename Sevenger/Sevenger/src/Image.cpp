@@ -0,0 +1,220 @@
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "Image.h"
+
+void* aligned_allocate(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    //aligned_alloc wants the size to be a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+void aligned_free(void* pointer)
+{
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+ImagePool::~ImagePool()
+{
+    trim();
+}
+
+void* ImagePool::acquire(size_t size, size_t& capacity)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        //best fit among blocks that would not be more than half empty
+        size_t best = free_blocks.size();
+        for (size_t i = 0; i < free_blocks.size(); ++i)
+        {
+            size_t block_capacity = free_blocks[i].capacity;
+            if (block_capacity >= size && block_capacity / 2 <= size &&
+                (best == free_blocks.size() || block_capacity < free_blocks[best].capacity))
+                best = i;
+        }
+        if (best != free_blocks.size())
+        {
+            Block block = free_blocks[best];
+            free_blocks[best] = free_blocks.back();
+            free_blocks.pop_back();
+            cached_bytes -= block.capacity;
+            ++reuse_count;
+            capacity = block.capacity;
+            return block.pointer;
+        }
+        ++allocation_count;
+    }
+
+    capacity = size;
+    return aligned_allocate(size, IMAGE_ALIGNMENT);
+}
+
+void ImagePool::release(void* pointer, size_t capacity)
+{
+    if (!pointer)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    free_blocks.push_back({ pointer, capacity });
+    cached_bytes += capacity;
+}
+
+void ImagePool::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Block& block : free_blocks)
+        aligned_free(block.pointer);
+    free_blocks.clear();
+    cached_bytes = 0;
+}
+
+uint64_t ImagePool::heap_allocations() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return allocation_count;
+}
+
+uint64_t ImagePool::reuses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return reuse_count;
+}
+
+size_t ImagePool::bytes_cached() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached_bytes;
+}
+
+Image::Image(int width, int height, int channels, PixelLayout layout, ImagePool* pool)
+    : pool(pool), image_width(width), image_height(height), image_channels(channels), pixel_layout(layout)
+{
+    size_t row_bytes = (size_t)width * (size_t)pixel_stride();
+    row_stride = (row_bytes + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+
+    size_t size = plane_size() * (size_t)plane_count() + IMAGE_ALIGNMENT;
+    if (pool)
+    {
+        pixels = (unsigned char*)pool->acquire(size, capacity);
+    }
+    else
+    {
+        pixels = (unsigned char*)aligned_allocate(size, IMAGE_ALIGNMENT);
+        capacity = size;
+    }
+}
+
+Image::~Image()
+{
+    release();
+}
+
+Image::Image(Image&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Image& Image::operator=(Image&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        pixels = other.pixels;
+        capacity = other.capacity;
+        pool = other.pool;
+        image_width = other.image_width;
+        image_height = other.image_height;
+        image_channels = other.image_channels;
+        pixel_layout = other.pixel_layout;
+        row_stride = other.row_stride;
+        other.pixels = nullptr;
+        other.capacity = 0;
+    }
+    return *this;
+}
+
+void Image::release()
+{
+    if (!pixels)
+        return;
+
+    if (pool)
+        pool->release(pixels, capacity);
+    else
+        aligned_free(pixels);
+
+    pixels = nullptr;
+    capacity = 0;
+}
+
+void Image::copy_from_interleaved(const unsigned char* src, size_t src_stride)
+{
+    size_t row_bytes = (size_t)image_width * image_channels;
+    for (int y = 0; y < image_height; ++y)
+    {
+        const unsigned char* in = src + (size_t)y * src_stride;
+        if (pixel_layout == PixelLayout::INTERLEAVED)
+        {
+            std::memcpy(row(y), in, row_bytes);
+            continue;
+        }
+        for (int c = 0; c < image_channels; ++c)
+        {
+            unsigned char* out = row(y, c);
+            for (int x = 0; x < image_width; ++x)
+                out[x] = in[x * image_channels + c];
+        }
+    }
+}
+
+void Image::copy_to_interleaved(unsigned char* dst, size_t dst_stride) const
+{
+    size_t row_bytes = (size_t)image_width * image_channels;
+    for (int y = 0; y < image_height; ++y)
+    {
+        unsigned char* out = dst + (size_t)y * dst_stride;
+        if (pixel_layout == PixelLayout::INTERLEAVED)
+        {
+            std::memcpy(out, row(y), row_bytes);
+            continue;
+        }
+        for (int c = 0; c < image_channels; ++c)
+        {
+            const unsigned char* in = row(y, c);
+            for (int x = 0; x < image_width; ++x)
+                out[x * image_channels + c] = in[x];
+        }
+    }
+}
+
+bool load_image(const char* path, Image& image, int desired_channels, PixelLayout layout, ImagePool* pool)
+{
+    int width, height, channels;
+    unsigned char* data = stbi_load(path, &width, &height, &channels, desired_channels);
+    if (!data)
+    {
+        std::cout << "Failed to load image: " << path << std::endl;
+        return false;
+    }
+    if (desired_channels != 0)
+        channels = desired_channels;
+
+    //reuse the current buffer when the shape matches, otherwise go through the pool
+    if (image.empty() || image.width() != width || image.height() != height ||
+        image.channels() != channels || image.layout() != layout)
+        image = Image(width, height, channels, layout, pool);
+
+    image.copy_from_interleaved(data, (size_t)width * channels);
+    stbi_image_free(data);
+    return true;
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include "ImageDiff.h"
+
+ImageDiff diff_images(const unsigned char* a, size_t a_stride, const unsigned char* b, size_t b_stride,
+                      int width, int height, int tolerance)
+{
+    ImageDiff diff;
+    double absolute_sum = 0.0, squared_sum = 0.0;
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* row_a = a + (size_t)y * a_stride;
+        const unsigned char* row_b = b + (size_t)y * b_stride;
+        for (int x = 0; x < width; ++x)
+        {
+            int error = std::abs(row_a[x] - row_b[x]);
+            absolute_sum += error;
+            squared_sum += (double)error * error;
+            diff.max_error = std::max(diff.max_error, error);
+            diff.over_tolerance += error > tolerance;
+        }
+    }
+
+    double pixel_count = std::max(1.0, (double)width * height);
+    double mse = squared_sum / pixel_count;
+    diff.mean_error = absolute_sum / pixel_count;
+    diff.psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+    return diff;
+}
+
+bool write_pgm(const std::string& path, const unsigned char* pixels, size_t stride, int width, int height)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "Failed to write image: " << path << std::endl;
+        return false;
+    }
+
+    bool ok = std::fprintf(file, "P5\n%d %d\n255\n", width, height) > 0;
+    for (int y = height - 1; ok && y >= 0; --y)
+        ok = std::fwrite(pixels + (size_t)y * stride, 1, (size_t)width, file) == (size_t)width;
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        std::cout << "Failed to write image: " << path << std::endl;
+    return ok;
+}
+
+bool read_pgm(const std::string& path, std::vector<unsigned char>& pixels, int& width, int& height)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    //only what write_pgm produces: no comments, maxval 255
+    int max_value = 0;
+    bool ok = std::fscanf(file, "P5 %d %d %d", &width, &height, &max_value) == 3 && max_value == 255 &&
+              width > 0 && height > 0 && std::fgetc(file) != EOF;
+    if (ok)
+    {
+        pixels.resize((size_t)width * height);
+        for (int y = height - 1; ok && y >= 0; --y)
+            ok = std::fread(pixels.data() + (size_t)y * width, 1, (size_t)width, file) == (size_t)width;
+    }
+    std::fclose(file);
+    if (!ok)
+        std::cout << "ERROR: INVALID PGM: " << path << std::endl;
+    return ok;
+}
@@ -0,0 +1,1162 @@
+#include <stb_image.h>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "ImageEncoder.h"
+
+bool parse_image_format(const std::string& name, ImageFormat& format)
+{
+    static const std::pair<const char*, ImageFormat> formats[] = {
+        { "pgm", ImageFormat::PGM }, { "pbm", ImageFormat::PBM }, { "png", ImageFormat::PNG }, { "qoi", ImageFormat::QOI },
+        { "edges", ImageFormat::EDGES }
+    };
+    for (const auto& [format_name, value] : formats)
+    {
+        if (name == format_name)
+        {
+            format = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* image_format_name(ImageFormat format)
+{
+    switch (format)
+    {
+    case ImageFormat::PGM: return "pgm";
+    case ImageFormat::PBM: return "pbm";
+    case ImageFormat::PNG: return "png";
+    case ImageFormat::QOI: return "qoi";
+    case ImageFormat::EDGES: return "edges";
+    }
+    return "unknown";
+}
+
+const char* image_format_extension(ImageFormat format)
+{
+    switch (format)
+    {
+    case ImageFormat::PGM: return ".pgm";
+    case ImageFormat::PBM: return ".pbm";
+    case ImageFormat::PNG: return ".png";
+    case ImageFormat::QOI: return ".qoi";
+    case ImageFormat::EDGES: return ".edges";
+    }
+    return "";
+}
+
+//rows [0, count) split into one contiguous range per thread, the calling thread takes the first
+template <typename Function>
+static void parallel_ranges(size_t count, int thread_count, const Function& function)
+{
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+        workers.emplace_back(function, i, count * i / thread_count, count * (i + 1) / thread_count);
+    function(0, (size_t)0, count / thread_count);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+//threads for an encode of this many bytes: a thread needs enough work to pay for starting it
+static int encode_threads(const ImageEncoderConfig& config, size_t bytes, size_t rows)
+{
+    int threads = config.thread_count > 0 ? config.thread_count : (int)std::max(1u, std::thread::hardware_concurrency());
+    return (int)std::clamp<size_t>(std::min<size_t>(bytes / (256 * 1024), rows), 1, (size_t)threads);
+}
+
+static void put_u32_be(std::vector<unsigned char>& out, uint32_t value)
+{
+    unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value };
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+static uint32_t get_u32_be(const unsigned char* bytes)
+{
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static void put_text(std::vector<unsigned char>& out, const char* text)
+{
+    out.insert(out.end(), text, text + std::strlen(text));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//PGM, PBM and EDGES
+
+static void encode_pgm(const unsigned char* pixels, size_t stride, int width, int height, std::vector<unsigned char>& file)
+{
+    char header[64];
+    std::snprintf(header, sizeof(header), "P5\n%d %d\n255\n", width, height);
+    put_text(file, header);
+    size_t offset = file.size();
+    file.resize(offset + (size_t)width * height);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(file.data() + offset + (size_t)y * width, pixels + (size_t)(height - 1 - y) * stride, width);
+}
+
+static void encode_pbm(const unsigned char* pixels, size_t stride, int width, int height, std::vector<unsigned char>& file,
+                       const ImageEncoderConfig& config)
+{
+    char header[64];
+    std::snprintf(header, sizeof(header), "P4\n%d %d\n", width, height);
+    put_text(file, header);
+    size_t row_bytes = ((size_t)width + 7) / 8;
+    size_t offset = file.size();
+    file.resize(offset + row_bytes * height);
+
+    BinaryEdgeMap map;
+    pack_edges_u8_threaded(pixels, stride, width, height, BINARY_EDGE_THRESHOLD, map, encode_threads(config, (size_t)width * height, height));
+    for (int y = 0; y < height; ++y)
+        std::memcpy(file.data() + offset + (size_t)y * row_bytes, map.row(height - 1 - y), row_bytes);
+}
+
+static void encode_edges(const unsigned char* pixels, size_t stride, int width, int height, std::vector<unsigned char>& file,
+                         const ImageEncoderConfig& config)
+{
+    BinaryEdgeMap map;
+    pack_edges_u8_threaded(pixels, stride, width, height, BINARY_EDGE_THRESHOLD, map, encode_threads(config, (size_t)width * height, height));
+    encode_binary_edges(map, file);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//deflate (RFC 1951) and the zlib wrapper (RFC 1950)
+//
+//every thread compresses its own contiguous part of the data into complete blocks, primed with the
+//32 KB before it so matches may reach back into the previous part, and ends with an empty stored
+//block that byte-aligns the stream; the parts then simply follow each other (the way pigz works)
+
+constexpr int DEFLATE_WINDOW = 32768;
+constexpr int DEFLATE_MIN_MATCH = 3;
+constexpr int DEFLATE_MAX_MATCH = 258;
+constexpr int DEFLATE_HASH_BITS = 15;
+constexpr size_t DEFLATE_BLOCK_SYMBOLS = 16384;
+constexpr int DEFLATE_LITERAL_CODES = 286;
+constexpr int DEFLATE_DISTANCE_CODES = 30;
+constexpr int DEFLATE_MAX_BITS = 15;
+
+static const uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                            1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distance_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+//order in which the code length code lengths are sent
+static const uint8_t code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+//length 3..258 to its code 0..28 (257..285 in the literal/length alphabet)
+static const uint8_t* length_codes()
+{
+    static const auto table = []
+    {
+        static uint8_t codes[DEFLATE_MAX_MATCH + 1] = {};
+        for (int code = 0; code < 29; ++code)
+        {
+            for (int length = length_base[code]; length < length_base[code] + (1 << length_extra[code]) && length <= DEFLATE_MAX_MATCH; ++length)
+                codes[length] = (uint8_t)code;
+        }
+        codes[DEFLATE_MAX_MATCH] = 28;
+        return codes;
+    }();
+    return table;
+}
+
+static int distance_code(int distance)
+{
+    unsigned x = (unsigned)distance - 1;
+    if (x < 4)
+        return (int)x;
+    int bits = 31 - std::countl_zero(x);
+    return 2 * bits + (int)((x >> (bits - 1)) & 1);
+}
+
+//literal byte (length 0) or a match of length bytes distance bytes back
+struct DeflateSymbol
+{
+    uint16_t length;
+    uint16_t value;
+};
+
+//LSB-first bit packing as deflate wants it, whole 32-bit words go out at once
+class BitWriter
+{
+public:
+
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    //count <= 32
+    void put(uint32_t value, int count)
+    {
+        bits |= (uint64_t)value << bit_count;
+        bit_count += count;
+        if (bit_count >= 32)
+        {
+            unsigned char bytes[4] = { (unsigned char)bits, (unsigned char)(bits >> 8), (unsigned char)(bits >> 16), (unsigned char)(bits >> 24) };
+            out.insert(out.end(), bytes, bytes + 4);
+            bits >>= 32;
+            bit_count -= 32;
+        }
+    }
+
+    //pads to a byte boundary and hands out every pending byte
+    void align()
+    {
+        if (bit_count % 8)
+            put(0, 8 - bit_count % 8);
+        for (; bit_count > 0; bit_count -= 8)
+        {
+            out.push_back((unsigned char)bits);
+            bits >>= 8;
+        }
+        bits = 0;
+    }
+
+    //raw bytes after align()
+    void put_bytes(const unsigned char* data, size_t size)
+    {
+        out.insert(out.end(), data, data + size);
+    }
+
+private:
+
+    std::vector<unsigned char>& out;
+    uint64_t bits = 0;
+    int bit_count = 0;
+};
+
+//optimal code lengths of at most max_bits (package-merge); a lone symbol gets a partner so
+//every code is complete, which strict inflaters require
+static void huffman_lengths(const uint32_t* frequencies, int count, int max_bits, uint8_t* lengths)
+{
+    struct Node
+    {
+        uint64_t weight;
+        int leaf;  //index into leaves, -1 for a package of two nodes of the previous list
+        int left;
+    };
+
+    std::fill(lengths, lengths + count, (uint8_t)0);
+    std::vector<std::pair<uint32_t, int>> leaves;
+    for (int symbol = 0; symbol < count; ++symbol)
+    {
+        if (frequencies[symbol])
+            leaves.push_back({ frequencies[symbol], symbol });
+    }
+    if (leaves.empty())
+        return;
+    if (leaves.size() == 1)
+    {
+        lengths[leaves[0].second] = 1;
+        lengths[leaves[0].second == 0 ? 1 : 0] = 1;
+        return;
+    }
+    std::sort(leaves.begin(), leaves.end());
+
+    //list l holds the leaves merged with the pairs of list l-1, each list sorted by weight
+    std::vector<std::vector<Node>> lists(max_bits);
+    for (size_t i = 0; i < leaves.size(); ++i)
+        lists[0].push_back({ leaves[i].first, (int)i, -1 });
+    for (int level = 1; level < max_bits; ++level)
+    {
+        const std::vector<Node>& previous = lists[level - 1];
+        std::vector<Node>& list = lists[level];
+        size_t leaf = 0, pair = 0, pairs = previous.size() / 2;
+        while (leaf < leaves.size() || pair < pairs)
+        {
+            uint64_t package = pair < pairs ? previous[2 * pair].weight + previous[2 * pair + 1].weight : UINT64_MAX;
+            if (leaf < leaves.size() && leaves[leaf].first <= package)
+            {
+                list.push_back({ leaves[leaf].first, (int)leaf, -1 });
+                ++leaf;
+            }
+            else
+            {
+                list.push_back({ package, -1, (int)(2 * pair) });
+                ++pair;
+            }
+        }
+    }
+
+    //every appearance of a leaf among the first 2n-2 nodes of the last list adds one bit
+    auto count_leaves = [&](auto& self, int level, int index) -> void
+    {
+        const Node& node = lists[level][index];
+        if (node.leaf >= 0)
+        {
+            ++lengths[leaves[node.leaf].second];
+            return;
+        }
+        self(self, level - 1, node.left);
+        self(self, level - 1, node.left + 1);
+    };
+    for (size_t i = 0; i < 2 * leaves.size() - 2; ++i)
+        count_leaves(count_leaves, max_bits - 1, (int)i);
+}
+
+//canonical codes, bit-reversed because deflate sends Huffman codes starting with the most significant bit
+static void canonical_codes(const uint8_t* lengths, int count, uint16_t* codes)
+{
+    int length_counts[DEFLATE_MAX_BITS + 1] = {};
+    for (int i = 0; i < count; ++i)
+        ++length_counts[lengths[i]];
+    length_counts[0] = 0;
+
+    int next_code[DEFLATE_MAX_BITS + 1] = {};
+    int code = 0;
+    for (int bits = 1; bits <= DEFLATE_MAX_BITS; ++bits)
+    {
+        code = (code + length_counts[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        int length = lengths[i];
+        if (length == 0)
+            continue;
+        unsigned value = (unsigned)next_code[length]++;
+        unsigned reversed = 0;
+        for (int bit = 0; bit < length; ++bit)
+            reversed |= ((value >> bit) & 1) << (length - 1 - bit);
+        codes[i] = (uint16_t)reversed;
+    }
+}
+
+static void write_stored_blocks(BitWriter& writer, const unsigned char* raw, size_t size, bool final)
+{
+    do
+    {
+        size_t block = std::min<size_t>(size, 65535);
+        bool last = final && block == size;
+        writer.put(last ? 1 : 0, 1);
+        writer.put(0, 2);
+        writer.align();
+        writer.put((uint32_t)block, 16);
+        writer.put((uint32_t)block ^ 0xffff, 16);
+        writer.align();
+        writer.put_bytes(raw, block);
+        raw += block;
+        size -= block;
+    } while (size > 0);
+}
+
+//one block in whichever of fixed Huffman, dynamic Huffman or stored is the smallest
+static void write_block(BitWriter& writer, const std::vector<DeflateSymbol>& symbols, const unsigned char* raw, size_t raw_size, bool final)
+{
+    const uint8_t* lengths_to_codes = length_codes();
+    uint32_t literal_frequencies[DEFLATE_LITERAL_CODES] = {};
+    uint32_t distance_frequencies[DEFLATE_DISTANCE_CODES] = {};
+    uint64_t extra_bits = 0;
+    for (const DeflateSymbol& symbol : symbols)
+    {
+        if (symbol.length == 0)
+        {
+            ++literal_frequencies[symbol.value];
+            continue;
+        }
+        int length_code = lengths_to_codes[symbol.length];
+        int code = distance_code(symbol.value);
+        ++literal_frequencies[257 + length_code];
+        ++distance_frequencies[code];
+        extra_bits += length_extra[length_code] + distance_extra[code];
+    }
+    literal_frequencies[256] = 1;
+
+    //dynamic trees; a block without matches still sends one distance code
+    uint8_t literal_lengths[DEFLATE_LITERAL_CODES], distance_lengths[DEFLATE_DISTANCE_CODES];
+    huffman_lengths(literal_frequencies, DEFLATE_LITERAL_CODES, DEFLATE_MAX_BITS, literal_lengths);
+    uint32_t used_distances[DEFLATE_DISTANCE_CODES];
+    std::memcpy(used_distances, distance_frequencies, sizeof(used_distances));
+    if (std::all_of(used_distances, used_distances + DEFLATE_DISTANCE_CODES, [](uint32_t f) { return f == 0; }))
+        used_distances[0] = 1;
+    huffman_lengths(used_distances, DEFLATE_DISTANCE_CODES, DEFLATE_MAX_BITS, distance_lengths);
+
+    int literal_count = DEFLATE_LITERAL_CODES, distance_count = DEFLATE_DISTANCE_CODES;
+    while (literal_count > 257 && literal_lengths[literal_count - 1] == 0)
+        --literal_count;
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0)
+        --distance_count;
+
+    //both length lists run-length coded with 16 (repeat previous 3-6), 17 (zeros 3-10) and 18 (zeros 11-138)
+    uint8_t all_lengths[DEFLATE_LITERAL_CODES + DEFLATE_DISTANCE_CODES];
+    std::memcpy(all_lengths, literal_lengths, literal_count);
+    std::memcpy(all_lengths + literal_count, distance_lengths, distance_count);
+    int all_count = literal_count + distance_count;
+    struct LengthSymbol
+    {
+        uint8_t symbol;
+        uint8_t extra;
+    };
+    std::vector<LengthSymbol> length_symbols;
+    uint32_t length_frequencies[19] = {};
+    for (int i = 0; i < all_count;)
+    {
+        uint8_t length = all_lengths[i];
+        int run = 1;
+        while (i + run < all_count && all_lengths[i + run] == length)
+            ++run;
+        i += run;
+        if (length == 0)
+        {
+            for (; run >= 11; run -= std::min(run, 138))
+                length_symbols.push_back({ 18, (uint8_t)(std::min(run, 138) - 11) });
+            if (run >= 3)
+            {
+                length_symbols.push_back({ 17, (uint8_t)(run - 3) });
+                run = 0;
+            }
+        }
+        else
+        {
+            length_symbols.push_back({ length, 0 });
+            --run;
+            for (; run >= 3; run -= std::min(run, 6))
+                length_symbols.push_back({ 16, (uint8_t)(std::min(run, 6) - 3) });
+        }
+        for (; run > 0; --run)
+            length_symbols.push_back({ length, 0 });
+    }
+    for (const LengthSymbol& symbol : length_symbols)
+        ++length_frequencies[symbol.symbol];
+    uint8_t code_lengths[19];
+    huffman_lengths(length_frequencies, 19, 7, code_lengths);
+    int code_length_count = 19;
+    while (code_length_count > 4 && code_lengths[code_length_order[code_length_count - 1]] == 0)
+        --code_length_count;
+
+    uint64_t dynamic_bits = 3 + 14 + 3 * (uint64_t)code_length_count + extra_bits;
+    uint64_t fixed_bits = 3 + extra_bits;
+    for (const LengthSymbol& symbol : length_symbols)
+        dynamic_bits += code_lengths[symbol.symbol] + (symbol.symbol == 16 ? 2 : symbol.symbol == 17 ? 3 : symbol.symbol == 18 ? 7 : 0);
+    for (int i = 0; i < DEFLATE_LITERAL_CODES; ++i)
+    {
+        dynamic_bits += (uint64_t)literal_frequencies[i] * literal_lengths[i];
+        fixed_bits += (uint64_t)literal_frequencies[i] * (i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+    }
+    for (int i = 0; i < DEFLATE_DISTANCE_CODES; ++i)
+    {
+        dynamic_bits += (uint64_t)distance_frequencies[i] * distance_lengths[i];
+        fixed_bits += (uint64_t)distance_frequencies[i] * 5;
+    }
+    uint64_t stored_bits = (raw_size / 65535 + 1) * 40 + (uint64_t)raw_size * 8;
+
+    if (stored_bits <= std::min(dynamic_bits, fixed_bits))
+    {
+        write_stored_blocks(writer, raw, raw_size, final);
+        return;
+    }
+
+    uint16_t literal_codes[DEFLATE_LITERAL_CODES + 2] = {}, distance_codes[DEFLATE_DISTANCE_CODES] = {};
+    writer.put(final ? 1 : 0, 1);
+    if (fixed_bits <= dynamic_bits)
+    {
+        writer.put(1, 2);
+        uint8_t fixed_lengths[DEFLATE_LITERAL_CODES + 2];
+        for (int i = 0; i < DEFLATE_LITERAL_CODES + 2; ++i)
+            fixed_lengths[i] = (uint8_t)(i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+        std::fill(distance_lengths, distance_lengths + DEFLATE_DISTANCE_CODES, (uint8_t)5);
+        canonical_codes(fixed_lengths, DEFLATE_LITERAL_CODES + 2, literal_codes);
+        canonical_codes(distance_lengths, DEFLATE_DISTANCE_CODES, distance_codes);
+        std::memcpy(literal_lengths, fixed_lengths, DEFLATE_LITERAL_CODES);
+    }
+    else
+    {
+        writer.put(2, 2);
+        writer.put(literal_count - 257, 5);
+        writer.put(distance_count - 1, 5);
+        writer.put(code_length_count - 4, 4);
+        for (int i = 0; i < code_length_count; ++i)
+            writer.put(code_lengths[code_length_order[i]], 3);
+
+        uint16_t length_codes_table[19] = {};
+        canonical_codes(code_lengths, 19, length_codes_table);
+        for (const LengthSymbol& symbol : length_symbols)
+        {
+            writer.put(length_codes_table[symbol.symbol], code_lengths[symbol.symbol]);
+            if (symbol.symbol >= 16)
+                writer.put(symbol.extra, symbol.symbol == 16 ? 2 : symbol.symbol == 17 ? 3 : 7);
+        }
+        canonical_codes(literal_lengths, DEFLATE_LITERAL_CODES, literal_codes);
+        canonical_codes(distance_lengths, DEFLATE_DISTANCE_CODES, distance_codes);
+    }
+
+    for (const DeflateSymbol& symbol : symbols)
+    {
+        if (symbol.length == 0)
+        {
+            writer.put(literal_codes[symbol.value], literal_lengths[symbol.value]);
+            continue;
+        }
+        int length_code = lengths_to_codes[symbol.length];
+        writer.put(literal_codes[257 + length_code], literal_lengths[257 + length_code]);
+        writer.put(symbol.length - length_base[length_code], length_extra[length_code]);
+        int code = distance_code(symbol.value);
+        writer.put(distance_codes[code], distance_lengths[code]);
+        writer.put(symbol.value - distance_base[code], distance_extra[code]);
+    }
+    writer.put(literal_codes[256], literal_lengths[256]);
+}
+
+struct DeflateLevel
+{
+    int chain;  //candidates tried per position
+    int nice;   //a match this long ends the search
+    bool lazy;  //try the next position before taking a match
+};
+
+static DeflateLevel deflate_level(int level)
+{
+    static const DeflateLevel levels[10] = {
+        { 0, 0, false }, { 4, 16, false }, { 8, 32, false }, { 16, 64, false }, { 16, 32, true },
+        { 32, 64, true }, { 64, 128, true }, { 128, 128, true }, { 512, 258, true }, { 4096, 258, true }
+    };
+    return levels[std::clamp(level, 0, 9)];
+}
+
+static size_t match_length(const unsigned char* a, const unsigned char* b, size_t max_length)
+{
+    size_t length = 0;
+    while (length + 8 <= max_length)
+    {
+        uint64_t x, y;
+        std::memcpy(&x, a + length, 8);
+        std::memcpy(&y, b + length, 8);
+        if (x != y)
+            return length + (size_t)(std::countr_zero(x ^ y) >> 3);
+        length += 8;
+    }
+    while (length < max_length && a[length] == b[length])
+        ++length;
+    return length;
+}
+
+//compresses data[begin, end) as non-final blocks followed by an empty stored block,
+//matches may start in the 32 KB before begin
+static void deflate_part(const unsigned char* data, size_t data_size, size_t begin, size_t end, int level, BitWriter& writer)
+{
+    DeflateLevel settings = deflate_level(level);
+    if (settings.chain == 0)
+    {
+        if (end > begin)
+            write_stored_blocks(writer, data + begin, end - begin, false);
+    }
+    else
+    {
+        std::vector<int64_t> head((size_t)1 << DEFLATE_HASH_BITS, -1);
+        std::vector<int64_t> previous(DEFLATE_WINDOW, -1);
+        auto hash = [&](size_t position)
+        {
+            uint32_t bytes = (uint32_t)data[position] | (uint32_t)data[position + 1] << 8 | (uint32_t)data[position + 2] << 16;
+            return (bytes * 0x9E3779B1u) >> (32 - DEFLATE_HASH_BITS);
+        };
+
+        size_t inserted = begin > (size_t)DEFLATE_WINDOW ? begin - DEFLATE_WINDOW : 0;
+        auto insert_until = [&](size_t limit)
+        {
+            for (; inserted < limit && inserted + DEFLATE_MIN_MATCH <= data_size; ++inserted)
+            {
+                uint32_t h = hash(inserted);
+                previous[inserted & (DEFLATE_WINDOW - 1)] = head[h];
+                head[h] = (int64_t)inserted;
+            }
+            inserted = std::max(inserted, limit);
+        };
+        auto find_match = [&](size_t position, size_t& distance) -> size_t
+        {
+            size_t max_length = std::min<size_t>(DEFLATE_MAX_MATCH, end - position);
+            if (max_length < DEFLATE_MIN_MATCH)
+                return 0;
+            size_t best = DEFLATE_MIN_MATCH - 1;
+            int64_t candidate = head[hash(position)];
+            for (int chain = settings.chain; candidate >= 0 && chain > 0; --chain)
+            {
+                size_t back = position - (size_t)candidate;
+                if (back > DEFLATE_WINDOW)
+                    break;
+                if (data[candidate + best] == data[position + best])
+                {
+                    size_t length = match_length(data + candidate, data + position, max_length);
+                    if (length > best)
+                    {
+                        best = length;
+                        distance = back;
+                        if (length >= (size_t)settings.nice || length == max_length)
+                            break;
+                    }
+                }
+                candidate = previous[candidate & (DEFLATE_WINDOW - 1)];
+            }
+            return best >= DEFLATE_MIN_MATCH ? best : 0;
+        };
+
+        std::vector<DeflateSymbol> symbols;
+        symbols.reserve(DEFLATE_BLOCK_SYMBOLS + 2);
+        size_t block_begin = begin;
+        size_t position = begin;
+        insert_until(begin);
+        while (position < end)
+        {
+            insert_until(position);
+            size_t distance = 0;
+            size_t length = find_match(position, distance);
+            if (settings.lazy && length > 0 && length < (size_t)settings.nice && position + 1 < end)
+            {
+                insert_until(position + 1);
+                size_t next_distance = 0;
+                size_t next_length = find_match(position + 1, next_distance);
+                if (next_length > length)
+                {
+                    symbols.push_back({ 0, data[position] });
+                    ++position;
+                    length = next_length;
+                    distance = next_distance;
+                }
+            }
+            if (length > 0)
+            {
+                symbols.push_back({ (uint16_t)length, (uint16_t)distance });
+                position += length;
+            }
+            else
+            {
+                symbols.push_back({ 0, data[position] });
+                ++position;
+            }
+
+            if (symbols.size() >= DEFLATE_BLOCK_SYMBOLS || position >= end)
+            {
+                write_block(writer, symbols, data + block_begin, position - block_begin, false);
+                symbols.clear();
+                block_begin = position;
+            }
+        }
+    }
+
+    //sync flush: an empty stored block ends on a byte boundary
+    writer.put(0, 3);
+    writer.align();
+    writer.put(0x0000, 16);
+    writer.put(0xffff, 16);
+    writer.align();
+}
+
+static uint32_t adler32(const unsigned char* data, size_t size)
+{
+    constexpr uint32_t base = 65521;
+    uint32_t a = 1, b = 0;
+    while (size > 0)
+    {
+        //5552 bytes is the most b can take before it overflows 32 bits
+        size_t block = std::min<size_t>(size, 5552);
+        for (size_t i = 0; i < block; ++i)
+        {
+            a += data[i];
+            b += a;
+        }
+        a %= base;
+        b %= base;
+        data += block;
+        size -= block;
+    }
+    return b << 16 | a;
+}
+
+//checksum of two parts from the checksums of each (zlib's adler32_combine)
+static uint32_t adler32_combine(uint32_t first, uint32_t second, size_t second_size)
+{
+    constexpr uint32_t base = 65521;
+    uint32_t remainder = (uint32_t)(second_size % base);
+    uint32_t sum1 = first & 0xffff;
+    uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % base);
+    sum1 += (second & 0xffff) + base - 1;
+    sum2 += (first >> 16) + (second >> 16) + base - remainder;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum1 >= base)
+        sum1 -= base;
+    if (sum2 >= 2 * base)
+        sum2 -= 2 * base;
+    if (sum2 >= base)
+        sum2 -= base;
+    return sum2 << 16 | sum1;
+}
+
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+{
+    static const auto table = []
+    {
+        static uint32_t entries[256];
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            entries[i] = value;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//PNG
+
+static void put_png_chunk(std::vector<unsigned char>& file, const char* type, const unsigned char* data, size_t size, uint32_t crc)
+{
+    put_u32_be(file, (uint32_t)size);
+    put_text(file, type);
+    file.insert(file.end(), data, data + size);
+    put_u32_be(file, crc);
+}
+
+static void put_png_chunk(std::vector<unsigned char>& file, const char* type, const std::vector<unsigned char>& data)
+{
+    uint32_t crc = crc32(crc32(0, (const unsigned char*)type, 4), data.data(), data.size());
+    put_png_chunk(file, type, data.data(), data.size(), crc);
+}
+
+//each row gets the filter whose output has the smallest sum of absolute values (as signed bytes),
+//the usual heuristic that PNG encoders use; one loop per filter so the compiler vectorizes them
+static void filter_row(const unsigned char* row, const unsigned char* above, size_t row_bytes, int bpp,
+                       unsigned char* out, std::vector<unsigned char>& scratch)
+{
+    //the first row is filtered against a row of zeros
+    scratch.resize(row_bytes * 6);
+    unsigned char* filtered[5];
+    for (int filter = 0; filter < 5; ++filter)
+        filtered[filter] = scratch.data() + row_bytes * filter;
+    if (!above)
+    {
+        std::memset(scratch.data() + row_bytes * 5, 0, row_bytes);
+        above = scratch.data() + row_bytes * 5;
+    }
+    unsigned char* sub = filtered[1];
+    unsigned char* up = filtered[2];
+    unsigned char* average = filtered[3];
+    unsigned char* paeth = filtered[4];
+    size_t lead = std::min(row_bytes, (size_t)bpp);
+
+    std::memcpy(filtered[0], row, row_bytes);
+    for (size_t i = 0; i < row_bytes; ++i)
+        up[i] = (unsigned char)(row[i] - above[i]);
+    //without a left neighbour Paeth predicts the byte above
+    for (size_t i = 0; i < lead; ++i)
+    {
+        sub[i] = row[i];
+        average[i] = (unsigned char)(row[i] - (above[i] >> 1));
+        paeth[i] = (unsigned char)(row[i] - above[i]);
+    }
+    for (size_t i = lead; i < row_bytes; ++i)
+    {
+        sub[i] = (unsigned char)(row[i] - row[i - bpp]);
+        average[i] = (unsigned char)(row[i] - ((row[i - bpp] + above[i]) >> 1));
+    }
+    for (size_t i = lead; i < row_bytes; ++i)
+    {
+        int a = row[i - bpp], b = above[i], c = above[i - bpp];
+        int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+        int predictor = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+        paeth[i] = (unsigned char)(row[i] - predictor);
+    }
+
+    int best_filter = 0;
+    uint64_t best_cost = UINT64_MAX;
+    for (int filter = 0; filter < 5; ++filter)
+    {
+        uint32_t cost = 0;
+        for (size_t i = 0; i < row_bytes; ++i)
+            cost += (uint32_t)std::abs((int)(signed char)filtered[filter][i]);
+        if (cost < best_cost)
+        {
+            best_cost = cost;
+            best_filter = filter;
+        }
+    }
+    out[0] = (unsigned char)best_filter;
+    std::memcpy(out + 1, filtered[best_filter], row_bytes);
+}
+
+static void encode_png(const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                       std::vector<unsigned char>& file, const ImageEncoderConfig& config)
+{
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.insert(file.end(), signature, signature + 8);
+
+    std::vector<unsigned char> header;
+    put_u32_be(header, (uint32_t)width);
+    put_u32_be(header, (uint32_t)height);
+    header.push_back(8);
+    header.push_back((unsigned char)(channels == 1 ? 0 : channels == 3 ? 2 : 6));
+    header.insert(header.end(), { 0, 0, 0 });
+    put_png_chunk(file, "IHDR", header);
+
+    //filter byte and pixels of every row, top row first
+    size_t row_bytes = (size_t)width * channels;
+    size_t filtered_row = row_bytes + 1;
+    std::vector<unsigned char> filtered(filtered_row * height);
+    int threads = encode_threads(config, filtered.size(), height);
+    parallel_ranges(height, threads, [&](int, size_t first, size_t last)
+    {
+        std::vector<unsigned char> scratch;
+        for (size_t y = first; y < last; ++y)
+        {
+            const unsigned char* row = pixels + (size_t)(height - 1 - y) * stride;
+            const unsigned char* above = y > 0 ? row + stride : nullptr;
+            filter_row(row, above, row_bytes, channels, filtered.data() + y * filtered_row, scratch);
+        }
+    });
+
+    //one IDAT per part, the first starts with the zlib header, a last one ends the stream
+    int level = std::clamp(config.png_level, 0, 9);
+    std::vector<std::vector<unsigned char>> parts(threads);
+    std::vector<uint32_t> part_crcs(threads), part_adlers(threads);
+    std::vector<size_t> part_sizes(threads);
+    parallel_ranges(height, threads, [&](int part, size_t first, size_t last)
+    {
+        std::vector<unsigned char>& out = parts[part];
+        out.reserve((last - first) * filtered_row / 4 + 64);
+        if (part == 0)
+        {
+            static const unsigned char level_flags[10] = { 0x01, 0x01, 0x5e, 0x5e, 0x5e, 0x5e, 0x9c, 0xda, 0xda, 0xda };
+            out.push_back(0x78);
+            out.push_back(level_flags[level]);
+        }
+        BitWriter writer(out);
+        deflate_part(filtered.data(), filtered.size(), first * filtered_row, last * filtered_row, level, writer);
+        part_adlers[part] = adler32(filtered.data() + first * filtered_row, (last - first) * filtered_row);
+        part_sizes[part] = (last - first) * filtered_row;
+        part_crcs[part] = crc32(crc32(0, (const unsigned char*)"IDAT", 4), out.data(), out.size());
+    });
+
+    uint32_t adler = 1;
+    for (int part = 0; part < threads; ++part)
+    {
+        adler = adler32_combine(adler, part_adlers[part], part_sizes[part]);
+        put_png_chunk(file, "IDAT", parts[part].data(), parts[part].size(), part_crcs[part]);
+    }
+    std::vector<unsigned char> trailer = { 0x01, 0x00, 0x00, 0xff, 0xff };
+    put_u32_be(trailer, adler);
+    put_png_chunk(file, "IDAT", trailer);
+    put_png_chunk(file, "IEND", {});
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+//QOI (qoiformat.org)
+//
+//the stream is sequential, but the encoder state at any pixel only depends on two things that can be
+//found in parallel: the previous pixel, and for each of the 64 index slots the last pixel that was
+//not part of a run (a pixel different from its predecessor) hashing to it; so every part first
+//collects its slots, the slots are chained in order, then every part encodes on its own and ends
+//its pending run early, which any decoder reads the same
+
+struct QoiPixel
+{
+    unsigned char r, g, b, a;
+    bool operator==(const QoiPixel& other) const { return r == other.r && g == other.g && b == other.b && a == other.a; }
+    bool operator!=(const QoiPixel& other) const { return !(*this == other); }
+};
+
+static int qoi_hash(const QoiPixel& pixel)
+{
+    return (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+}
+
+struct QoiSource
+{
+    const unsigned char* pixels;
+    size_t stride;
+    int width;
+    int height;
+    int channels;
+
+    QoiPixel at(size_t index) const
+    {
+        size_t y = index / width, x = index % width;
+        const unsigned char* p = pixels + (size_t)(height - 1 - y) * stride + x * channels;
+        if (channels == 1)
+            return { p[0], p[0], p[0], 255 };
+        return { p[0], p[1], p[2], (unsigned char)(channels == 4 ? p[3] : 255) };
+    }
+};
+
+static void encode_qoi_part(const QoiSource& source, size_t first, size_t last, QoiPixel previous, QoiPixel* index,
+                            std::vector<unsigned char>& out)
+{
+    int run = 0;
+    for (size_t i = first; i < last; ++i)
+    {
+        QoiPixel pixel = source.at(i);
+        if (pixel == previous)
+        {
+            if (++run == 62)
+            {
+                out.push_back((unsigned char)(0xc0 | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0)
+        {
+            out.push_back((unsigned char)(0xc0 | (run - 1)));
+            run = 0;
+        }
+
+        int slot = qoi_hash(pixel);
+        if (index[slot] == pixel)
+            out.push_back((unsigned char)slot);
+        else
+        {
+            index[slot] = pixel;
+            if (pixel.a == previous.a)
+            {
+                signed char dr = (signed char)(pixel.r - previous.r);
+                signed char dg = (signed char)(pixel.g - previous.g);
+                signed char db = (signed char)(pixel.b - previous.b);
+                signed char dr_dg = (signed char)(dr - dg), db_dg = (signed char)(db - dg);
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                    out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+                {
+                    out.push_back((unsigned char)(0x80 | (dg + 32)));
+                    out.push_back((unsigned char)((dr_dg + 8) << 4 | (db_dg + 8)));
+                }
+                else
+                    out.insert(out.end(), { 0xfe, pixel.r, pixel.g, pixel.b });
+            }
+            else
+                out.insert(out.end(), { 0xff, pixel.r, pixel.g, pixel.b, pixel.a });
+        }
+        previous = pixel;
+    }
+    if (run > 0)
+        out.push_back((unsigned char)(0xc0 | (run - 1)));
+}
+
+static void encode_qoi(const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                       std::vector<unsigned char>& file, const ImageEncoderConfig& config)
+{
+    put_text(file, "qoif");
+    put_u32_be(file, (uint32_t)width);
+    put_u32_be(file, (uint32_t)height);
+    file.push_back((unsigned char)(channels == 4 ? 4 : 3));
+    file.push_back(0);  //sRGB with linear alpha
+
+    QoiSource source = { pixels, stride, width, height, channels };
+    const QoiPixel start = { 0, 0, 0, 255 };
+    int threads = encode_threads(config, (size_t)width * height * 4, height);
+    auto part_begin = [&](int part) { return (size_t)height * part / threads * width; };
+
+    //last non-run pixel per slot in every part, a = 0 and a flag marks unused slots
+    std::vector<QoiPixel> slots((size_t)threads * 64);
+    std::vector<bool> slot_used((size_t)threads * 64, false);
+    if (threads > 1)
+    {
+        parallel_ranges(height, threads, [&](int part, size_t, size_t)
+        {
+            size_t first = part_begin(part), last = part_begin(part + 1);
+            QoiPixel previous = first == 0 ? start : source.at(first - 1);
+            QoiPixel* part_slots = slots.data() + (size_t)part * 64;
+            bool used[64] = {};
+            for (size_t i = first; i < last; ++i)
+            {
+                QoiPixel pixel = source.at(i);
+                if (pixel != previous)
+                {
+                    int slot = qoi_hash(pixel);
+                    part_slots[slot] = pixel;
+                    used[slot] = true;
+                }
+                previous = pixel;
+            }
+            for (int slot = 0; slot < 64; ++slot)
+                slot_used[(size_t)part * 64 + slot] = used[slot];
+        });
+    }
+
+    //index every part starts with: the one before it, updated with the previous part's slots
+    std::vector<QoiPixel> start_index((size_t)threads * 64, QoiPixel{ 0, 0, 0, 0 });
+    for (int part = 1; part < threads; ++part)
+    {
+        for (int slot = 0; slot < 64; ++slot)
+        {
+            size_t previous_part = (size_t)(part - 1) * 64 + slot;
+            start_index[(size_t)part * 64 + slot] = slot_used[previous_part] ? slots[previous_part] : start_index[previous_part];
+        }
+    }
+
+    std::vector<std::vector<unsigned char>> parts(threads);
+    parallel_ranges(height, threads, [&](int part, size_t, size_t)
+    {
+        size_t first = part_begin(part), last = part_begin(part + 1);
+        parts[part].reserve((last - first) / 2 + 16);
+        encode_qoi_part(source, first, last, first == 0 ? start : source.at(first - 1), start_index.data() + (size_t)part * 64, parts[part]);
+    });
+    for (const std::vector<unsigned char>& part : parts)
+        file.insert(file.end(), part.begin(), part.end());
+    file.insert(file.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+}
+
+static bool decode_qoi(const unsigned char* file, size_t size, std::vector<unsigned char>& pixels, int& width, int& height, int& channels)
+{
+    if (size < 22 || std::memcmp(file, "qoif", 4) != 0)
+        return false;
+    width = (int)get_u32_be(file + 4);
+    height = (int)get_u32_be(file + 8);
+    channels = file[12];
+    if (width <= 0 || height <= 0 || (channels != 3 && channels != 4))
+        return false;
+
+    pixels.resize((size_t)width * height * channels);
+    QoiPixel index[64] = {};
+    QoiPixel pixel = { 0, 0, 0, 255 };
+    size_t position = 14, end = size - 8;
+    int run = 0;
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        if (run > 0)
+            --run;
+        else if (position < end)
+        {
+            unsigned char op = file[position++];
+            if (op == 0xfe && position + 3 <= end)
+            {
+                pixel.r = file[position];
+                pixel.g = file[position + 1];
+                pixel.b = file[position + 2];
+                position += 3;
+            }
+            else if (op == 0xff && position + 4 <= end)
+            {
+                pixel = { file[position], file[position + 1], file[position + 2], file[position + 3] };
+                position += 4;
+            }
+            else if ((op & 0xc0) == 0x00)
+                pixel = index[op];
+            else if ((op & 0xc0) == 0x40)
+            {
+                pixel.r += ((op >> 4) & 3) - 2;
+                pixel.g += ((op >> 2) & 3) - 2;
+                pixel.b += (op & 3) - 2;
+            }
+            else if ((op & 0xc0) == 0x80 && position < end)
+            {
+                int dg = (op & 0x3f) - 32;
+                unsigned char next = file[position++];
+                pixel.r += dg - 8 + ((next >> 4) & 0x0f);
+                pixel.g += dg;
+                pixel.b += dg - 8 + (next & 0x0f);
+            }
+            else if ((op & 0xc0) == 0xc0)
+                run = op & 0x3f;
+            index[qoi_hash(pixel)] = pixel;
+        }
+        //rows go back bottom-up
+        size_t y = i / width, x = i % width;
+        unsigned char* out = pixels.data() + ((size_t)(height - 1 - y) * width + x) * channels;
+        out[0] = pixel.r;
+        out[1] = pixel.g;
+        out[2] = pixel.b;
+        if (channels == 4)
+            out[3] = pixel.a;
+    }
+    return true;
+}
+
+static bool decode_pbm(const unsigned char* file, size_t size, std::vector<unsigned char>& pixels, int& width, int& height)
+{
+    //only what encode_pbm produces: no comments
+    std::string header((const char*)file, std::min<size_t>(size, 64));
+    int header_size = 0;
+    if (std::sscanf(header.c_str(), "P4 %d %d%n", &width, &height, &header_size) != 2 || width <= 0 || height <= 0)
+        return false;
+    size_t row_bytes = ((size_t)width + 7) / 8;
+    const unsigned char* bits = file + header_size + 1;
+    if ((size_t)header_size + 1 + row_bytes * height > size)
+        return false;
+
+    pixels.resize((size_t)width * height);
+    for (int y = 0; y < height; ++y)
+    {
+        unsigned char* out = pixels.data() + (size_t)(height - 1 - y) * width;
+        for (int x = 0; x < width; ++x)
+            out[x] = (bits[(size_t)y * row_bytes + (x >> 3)] >> (7 - (x & 7))) & 1 ? 255 : 0;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+
+bool encode_image(ImageFormat format, const unsigned char* pixels, size_t stride, int width, int height, int channels,
+                  std::vector<unsigned char>& file, const ImageEncoderConfig& config)
+{
+    file.clear();
+    bool gray_only = format == ImageFormat::PGM || format == ImageFormat::PBM || format == ImageFormat::EDGES;
+    if (width <= 0 || height <= 0 || (gray_only ? channels != 1 : channels != 1 && channels != 3 && channels != 4))
+    {
+        std::cout << "ERROR: CANNOT ENCODE A " << width << "x" << height << "x" << channels << " IMAGE AS " << image_format_name(format) << std::endl;
+        return false;
+    }
+
+    switch (format)
+    {
+    case ImageFormat::PGM: encode_pgm(pixels, stride, width, height, file); break;
+    case ImageFormat::PBM: encode_pbm(pixels, stride, width, height, file, config); break;
+    case ImageFormat::PNG: encode_png(pixels, stride, width, height, channels, file, config); break;
+    case ImageFormat::QOI: encode_qoi(pixels, stride, width, height, channels, file, config); break;
+    case ImageFormat::EDGES: encode_edges(pixels, stride, width, height, file, config); break;
+    }
+    return true;
+}
+
+bool write_image(const std::string& path, ImageFormat format, const unsigned char* pixels, size_t stride, int width, int height,
+                 int channels, const ImageEncoderConfig& config)
+{
+    std::vector<unsigned char> file;
+    if (!encode_image(format, pixels, stride, width, height, channels, file, config))
+        return false;
+
+    std::FILE* output = std::fopen(path.c_str(), "wb");
+    bool ok = output && std::fwrite(file.data(), 1, file.size(), output) == file.size();
+    ok = output && std::fclose(output) == 0 && ok;
+    if (!ok)
+        std::cout << "Failed to write image: " << path << std::endl;
+    return ok;
+}
+
+bool decode_image(const unsigned char* file, size_t size, std::vector<unsigned char>& pixels, int& width, int& height, int& channels)
+{
+    if (size >= 4 && std::memcmp(file, "qoif", 4) == 0)
+        return decode_qoi(file, size, pixels, width, height, channels);
+    if (size >= 2 && file[0] == 'P' && file[1] == '4')
+    {
+        channels = 1;
+        return decode_pbm(file, size, pixels, width, height);
+    }
+    if (is_binary_edge_file(file, size))
+    {
+        BinaryEdgeMap map;
+        if (!decode_binary_edges(file, size, map))
+            return false;
+        width = map.width();
+        height = map.height();
+        channels = 1;
+        pixels.resize((size_t)width * height);
+        unpack_edges_u8(map, pixels.data(), width);
+        return true;
+    }
+
+    stbi_set_flip_vertically_on_load_thread(true);
+    unsigned char* data = stbi_load_from_memory(file, (int)size, &width, &height, &channels, 0);
+    if (!data)
+        return false;
+    pixels.assign(data, data + (size_t)width * height * channels);
+    stbi_image_free(data);
+    return true;
+}
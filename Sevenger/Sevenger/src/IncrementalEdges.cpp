@@ -0,0 +1,102 @@
+#include "IncrementalEdges.h"
+#include "SobelCpu.h"
+#include "TextureManager.h"
+
+//the ROI clipped to the frame, the whole frame when no ROI is set
+static Rect active_rect(const Rect& roi, int width, int height)
+{
+    Rect frame = { 0, 0, width, height };
+    return roi.empty() ? frame : intersect_rects(roi, frame);
+}
+
+void IncrementalEdgesCpu::reset(const unsigned char* pixels, size_t stride, int width, int height, int channels)
+{
+    if (luma.empty() || luma.width() != width || luma.height() != height)
+    {
+        luma = Image(width, height, 1, PixelLayout::PLANAR);
+        edge_map = Image(width, height, 1, PixelLayout::PLANAR);
+    }
+    this->channels = channels;
+    active = active_rect(roi_rect, width, height);
+
+    processed = 0;
+    recompute(pixels, stride, { 0, 0, width, height });
+}
+
+void IncrementalEdgesCpu::update(const unsigned char* pixels, size_t stride, const std::vector<Rect>& dirty)
+{
+    processed = 0;
+    for (const Rect& changed : dirty)
+        recompute(pixels, stride, changed);
+}
+
+void IncrementalEdgesCpu::recompute(const unsigned char* pixels, size_t stride, const Rect& changed)
+{
+    int width = luma.width(), height = luma.height();
+
+    //the kernel reads one pixel past the ROI, so luma is kept up to date there too
+    Rect luma_rect = intersect_rects(changed, expand_rect(active, 1, width, height));
+    Rect edge_rect = intersect_rects(expand_rect(changed, 1, width, height), active);
+    if (edge_rect.empty())
+        return;
+
+    luma_u8(pixels + (size_t)luma_rect.y * stride + (size_t)luma_rect.x * channels, stride, channels,
+            luma.row(luma_rect.y) + luma_rect.x, luma.stride(), luma_rect.width, luma_rect.height);
+    sobel_u8_simd_region(luma.row(0), luma.stride(), edge_map.row(0), edge_map.stride(), width, height, edge_rect);
+    processed += edge_rect.area();
+}
+
+IncrementalEdgesGpu::IncrementalEdgesGpu(Shader& edge_shader)
+    : pass(edge_shader)
+{
+}
+
+IncrementalEdgesGpu::~IncrementalEdgesGpu()
+{
+    destroy_render_target(target);
+    if (input_texture)
+    {
+        untrack_texture_memory(input_texture);
+        glDeleteTextures(1, &input_texture);
+    }
+}
+
+void IncrementalEdgesGpu::reset(const unsigned char* pixels, size_t stride, int width, int height, int channels)
+{
+    GLenum format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
+    if (!input_texture)
+        glGenTextures(1, &input_texture);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    track_texture_memory(GL_TEXTURE_2D, input_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    create_render_target(target, width, height);
+
+    this->channels = channels;
+    active = active_rect(roi_rect, width, height);
+
+    processed = 0;
+    update(pixels, stride, { { 0, 0, width, height } });
+}
+
+void IncrementalEdgesGpu::update(const unsigned char* pixels, size_t stride, const std::vector<Rect>& dirty)
+{
+    std::vector<Rect> regions;
+    processed = 0;
+    for (const Rect& changed : dirty)
+    {
+        Rect edge_rect = intersect_rects(expand_rect(changed, 1, target.width, target.height), active);
+        if (edge_rect.empty())
+            continue;
+
+        upload_texture_region(input_texture, pixels, stride, channels,
+                              intersect_rects(changed, expand_rect(active, 1, target.width, target.height)));
+        regions.push_back(edge_rect);
+        processed += edge_rect.area();
+    }
+    if (!regions.empty())
+        pass.run(input_texture, target, regions);
+}
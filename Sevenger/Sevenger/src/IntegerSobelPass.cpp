@@ -0,0 +1,181 @@
+#include "BinaryEdges.h"
+#include "IntegerSobelPass.h"
+#include "SubpixelEdges.h"
+#include "TextureManager.h"
+
+IntegerSobelPass::IntegerSobelPass(Shader& int_edge_shader)
+    : int_edge_shader(int_edge_shader), edge_pass(int_edge_shader)
+{
+    glGenTextures(1, &input_texture);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    //integer textures cannot be filtered
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+IntegerSobelPass::~IntegerSobelPass()
+{
+    untrack_texture_memory(input_texture);
+    glDeleteTextures(1, &input_texture);
+    destroy_render_target(target);
+    destroy_render_target(packed_target);
+    destroy_render_target(subpixel_target);
+}
+
+void IntegerSobelPass::set_kernel(GradientKernel kernel)
+{
+    this->kernel = kernel;
+}
+
+void IntegerSobelPass::set_thresholds(int low, int high)
+{
+    low_threshold = low;
+    high_threshold = high;
+}
+
+void IntegerSobelPass::upload(const unsigned char* pixels, size_t stride, int channels, int width, int height)
+{
+    static const GLenum internal_formats[] = { GL_R8UI, GL_RG8UI, GL_RGB8UI, GL_RGBA8UI };
+    static const GLenum formats[] = { GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER };
+    GLenum format = formats[channels - 1];
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    if (input_width != width || input_height != height || input_channels != channels)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_formats[channels - 1], width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        track_texture_memory(GL_TEXTURE_2D, input_texture);
+        input_width = width;
+        input_height = height;
+        input_channels = channels;
+    }
+
+    //the row length is counted in pixels, strides that are not a whole number of pixels go row by row
+    if (stride % channels == 0)
+    {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(stride / channels));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    else
+    {
+        for (int y = 0; y < height; ++y)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, width, 1, format, GL_UNSIGNED_BYTE, pixels + (size_t)y * stride);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void IntegerSobelPass::render(int channel_count, int width, int height)
+{
+    GradientWeights weights = gradient_weights(kernel);
+    int_edge_shader.use();
+    int_edge_shader.set_ivec2("smoothing", weights.a, weights.b);
+    int_edge_shader.set_int("magnitudeShift", weights.shift);
+    int_edge_shader.set_int("channelCount", channel_count);
+    int_edge_shader.set_ivec2("thresholds", low_threshold, high_threshold);
+
+    create_render_target(target, width, height, GL_R8UI);
+    edge_pass.run(input_texture, target);
+}
+
+void IntegerSobelPass::run_and_read(int channel_count, unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    render(channel_count, width, height);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)dst_stride);
+    glReadPixels(0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, dst);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void IntegerSobelPass::run(const unsigned char* luma, size_t luma_stride,
+                           unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    upload(luma, luma_stride, 1, width, height);
+    run_and_read(1, dst, dst_stride, width, height);
+}
+
+void IntegerSobelPass::run_color(const unsigned char* pixels, size_t stride, int channels,
+                                 unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    upload(pixels, stride, channels, width, height);
+    run_and_read(3, dst, dst_stride, width, height);
+}
+
+void IntegerSobelPass::enable_packing(Shader& pack_edges_shader)
+{
+    pack_shader = &pack_edges_shader;
+    pack_pass = std::make_unique<EdgePass>(pack_edges_shader);
+}
+
+void IntegerSobelPass::run_packed(const unsigned char* pixels, size_t stride, int channels, int width, int height, int threshold,
+                                  BinaryEdgeMap& map)
+{
+    upload(pixels, stride, channels, width, height);
+    render(channels == 1 ? 1 : 3, width, height);
+
+    //one R8UI texel per 8 pixels, the rows of the map are longer so their padding stays 0
+    int packed_width = (width + 7) / 8;
+    pack_shader->use();
+    pack_shader->set_int("edgeWidth", width);
+    pack_shader->set_int("threshold", threshold);
+    create_render_target(packed_target, packed_width, height, GL_R8UI);
+    pack_pass->run(target.texture, packed_target);
+
+    if (map.width() != width || map.height() != height)
+        map.resize(width, height);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, packed_target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)map.stride());
+    glReadPixels(0, 0, packed_width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, map.row(0));
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void IntegerSobelPass::enable_subpixel(Shader& subpixel_edge_shader)
+{
+    subpixel_shader = &subpixel_edge_shader;
+    subpixel_pass = std::make_unique<EdgePass>(subpixel_edge_shader);
+}
+
+void IntegerSobelPass::run_subpixel(const unsigned char* luma, size_t luma_stride,
+                                    unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    upload(luma, luma_stride, 1, width, height);
+
+    GradientWeights weights = gradient_weights(kernel);
+    subpixel_shader->use();
+    subpixel_shader->set_ivec2("smoothing", weights.a, weights.b);
+    subpixel_shader->set_int("magnitudeShift", weights.shift);
+    subpixel_shader->set_ivec2("thresholds", low_threshold, high_threshold);
+    glUniform1iv(glGetUniformLocation(subpixel_shader->shader_program_id, "atanTable"), 257, subpixel_atan_table());
+    create_render_target(subpixel_target, width, height, GL_RGBA8UI);
+    subpixel_pass->run(input_texture, subpixel_target);
+
+    //the pack row length counts pixels
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, subpixel_target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)(dst_stride / 4));
+    if (dst_stride % 4 == 0)
+        glReadPixels(0, 0, width, height, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, dst);
+    else
+    {
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+        for (int y = 0; y < height; ++y)
+            glReadPixels(0, y, width, 1, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, dst + (size_t)y * dst_stride);
+    }
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+GLuint IntegerSobelPass::output_texture() const
+{
+    return target.texture;
+}
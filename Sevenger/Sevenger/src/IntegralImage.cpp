@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "IntegralImage.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void IntegralImage::resize(int width, int height)
+{
+    this->width = width;
+    this->height = height;
+    sums.assign(((size_t)width + 1) * ((size_t)height + 1), 0);
+}
+
+//one table row: the running sum of the source row plus the table row above, out[0] stays 0
+static void scan_row_scalar(const unsigned char* in, const uint32_t* above, uint32_t* out, int width)
+{
+    uint32_t run = 0;
+    out[0] = 0;
+    for (int x = 0; x < width; ++x)
+    {
+        run += in[x];
+        out[x + 1] = above[x + 1] + run;
+    }
+}
+
+#ifdef SEVENGER_SSE2
+static void scan_row_simd(const unsigned char* in, const uint32_t* above, uint32_t* out, int width)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+    out[0] = 0;
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(in + x));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+        __m128i quads[4] = { _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+                             _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero) };
+        for (int q = 0; q < 4; ++q)
+        {
+            //prefix sum of 4 lanes in two shifted adds, then what came before
+            __m128i v = _mm_add_epi32(quads[q], _mm_slli_si128(quads[q], 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, carry);
+            carry = _mm_shuffle_epi32(v, 0xFF);
+            uint32_t* dst = out + x + 1 + 4 * q;
+            _mm_storeu_si128((__m128i*)dst, _mm_add_epi32(v, _mm_loadu_si128((const __m128i*)(above + x + 1 + 4 * q))));
+        }
+    }
+
+    uint32_t run = (uint32_t)_mm_cvtsi128_si32(carry);
+    for (; x < width; ++x)
+    {
+        run += in[x];
+        out[x + 1] = above[x + 1] + run;
+    }
+}
+#endif
+
+//table rows first_row + 1 to last_row + 1; above is the table row first_row, or zeros for a band on its own
+static void scan_rows(bool simd, const unsigned char* src, size_t src_stride, int width, int first_row, int last_row,
+                      const uint32_t* above, IntegralImage* integral)
+{
+    for (int y = first_row; y < last_row; ++y)
+    {
+        uint32_t* out = integral->sums.data() + (size_t)(y + 1) * integral->stride();
+#ifdef SEVENGER_SSE2
+        if (simd)
+            scan_row_simd(src + (size_t)y * src_stride, above, out, width);
+        else
+#else
+        (void)simd;
+#endif
+            scan_row_scalar(src + (size_t)y * src_stride, above, out, width);
+        above = out;
+    }
+}
+
+void integral_image_u8_scalar(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral)
+{
+    integral.resize(width, height);
+    scan_rows(false, src, src_stride, width, 0, height, integral.sums.data(), &integral);
+}
+
+void integral_image_u8_simd(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral)
+{
+    integral.resize(width, height);
+    scan_rows(true, src, src_stride, width, 0, height, integral.sums.data(), &integral);
+}
+
+//adds carry to table rows first_row + 1 to last_row + 1
+static void add_carry(const uint32_t* carry, int first_row, int last_row, IntegralImage* integral)
+{
+    size_t count = integral->stride();
+    for (int y = first_row; y < last_row; ++y)
+    {
+        uint32_t* row = integral->sums.data() + (size_t)(y + 1) * count;
+        size_t x = 0;
+#ifdef SEVENGER_SSE2
+        for (; x + 4 <= count; x += 4)
+            _mm_storeu_si128((__m128i*)(row + x), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(row + x)), _mm_loadu_si128((const __m128i*)(carry + x))));
+#endif
+        for (; x < count; ++x)
+            row[x] += carry[x];
+    }
+}
+
+void integral_image_u8_threaded(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral,
+                                int thread_count)
+{
+    integral.resize(width, height);
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max(1, std::min(thread_count, height / 16));
+    if (thread_count == 1)
+    {
+        scan_rows(true, src, src_stride, width, 0, height, integral.sums.data(), &integral);
+        return;
+    }
+
+    std::vector<int> bounds(thread_count + 1);
+    for (int i = 0; i <= thread_count; ++i)
+        bounds[i] = height * i / thread_count;
+
+    //the zero first row of the table starts every band
+    const uint32_t* zeros = integral.sums.data();
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+        workers.emplace_back(scan_rows, true, src, src_stride, width, bounds[i], bounds[i + 1], zeros, &integral);
+    scan_rows(true, src, src_stride, width, bounds[0], bounds[1], zeros, &integral);
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    //what the bands above add to band i: the sum of their last rows, the first band is complete already
+    size_t stride = integral.stride();
+    std::vector<std::vector<uint32_t>> carries(thread_count, std::vector<uint32_t>(stride, 0));
+    for (int i = 1; i < thread_count; ++i)
+    {
+        const uint32_t* last = integral.sums.data() + (size_t)bounds[i] * stride;
+        for (size_t x = 0; x < stride; ++x)
+            carries[i][x] = carries[i - 1][x] + last[x];
+    }
+
+    for (int i = 2; i < thread_count; ++i)
+        workers.emplace_back(add_carry, carries[i].data(), bounds[i], bounds[i + 1], &integral);
+    add_carry(carries[1].data(), bounds[1], bounds[2], &integral);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+//the clipped window of every pixel of rows [first_row, last_row)
+static void threshold_rows(bool simd, const IntegralImage* integral, const unsigned char* magnitude, size_t magnitude_stride,
+                           unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig* config, int first_row, int last_row)
+{
+    int width = integral->width, height = integral->height;
+    int radius = std::clamp(config->radius, 0, ADAPTIVE_THRESHOLD_MAX_RADIUS);
+    int offset = config->offset, min_magnitude = config->min_magnitude;
+    for (int y = first_row; y < last_row; ++y)
+    {
+        int y0 = std::max(0, y - radius), y1 = std::min(height, y + radius + 1);
+        const uint32_t* top = integral->sums.data() + (size_t)y0 * integral->stride();
+        const uint32_t* bottom = integral->sums.data() + (size_t)y1 * integral->stride();
+        const unsigned char* in = magnitude + (size_t)y * magnitude_stride;
+        unsigned char* out = dst + (size_t)y * dst_stride;
+
+        auto pixel = [&](int x)
+        {
+            int x0 = std::max(0, x - radius), x1 = std::min(width, x + radius + 1);
+            uint32_t sum = (bottom[x1] - bottom[x0]) - (top[x1] - top[x0]);
+            int64_t area = (int64_t)(x1 - x0) * (y1 - y0);
+            out[x] = in[x] >= min_magnitude && (int64_t)(in[x] - offset) * area >= (int64_t)sum ? 255 : 0;
+        };
+
+        //windows that are not clipped horizontally all have the same area
+        int x = 0;
+        int interior_end = width - radius - 1;
+        for (; x < std::min(radius, width); ++x)
+            pixel(x);
+#ifdef SEVENGER_SSE2
+        if (simd)
+        {
+            //both sides of the compare stay below 2^24, so floats hold them exactly
+            __m128 area = _mm_set1_ps((float)((2 * radius + 1) * (y1 - y0)));
+            __m128i offsets = _mm_set1_epi32(offset), below = _mm_set1_epi32(min_magnitude - 1), zero = _mm_setzero_si128();
+            for (; x + 4 <= interior_end + 1; x += 4)
+            {
+                __m128i right_bottom = _mm_loadu_si128((const __m128i*)(bottom + x + radius + 1));
+                __m128i left_bottom = _mm_loadu_si128((const __m128i*)(bottom + x - radius));
+                __m128i right_top = _mm_loadu_si128((const __m128i*)(top + x + radius + 1));
+                __m128i left_top = _mm_loadu_si128((const __m128i*)(top + x - radius));
+                __m128i sum = _mm_sub_epi32(_mm_sub_epi32(right_bottom, left_bottom), _mm_sub_epi32(right_top, left_top));
+
+                int32_t bytes;
+                std::memcpy(&bytes, in + x, 4);
+                __m128i m = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+                __m128 scaled = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(m, offsets)), area);
+                __m128i edge = _mm_and_si128(_mm_castps_si128(_mm_cmpge_ps(scaled, _mm_cvtepi32_ps(sum))), _mm_cmpgt_epi32(m, below));
+                edge = _mm_packs_epi16(_mm_packs_epi32(edge, edge), zero);
+                bytes = _mm_cvtsi128_si32(edge);
+                std::memcpy(out + x, &bytes, 4);
+            }
+        }
+#else
+        (void)simd;
+#endif
+        for (; x < width; ++x)
+            pixel(x);
+    }
+}
+
+void adaptive_threshold_u8_scalar(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                  unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config)
+{
+    threshold_rows(false, &integral, magnitude, magnitude_stride, dst, dst_stride, &config, 0, integral.height);
+}
+
+void adaptive_threshold_u8_simd(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config)
+{
+    threshold_rows(true, &integral, magnitude, magnitude_stride, dst, dst_stride, &config, 0, integral.height);
+}
+
+void adaptive_threshold_u8_threaded(const IntegralImage& integral, const unsigned char* magnitude, size_t magnitude_stride,
+                                    unsigned char* dst, size_t dst_stride, const AdaptiveThresholdConfig& config)
+{
+    int height = integral.height;
+    int thread_count = config.thread_count > 0 ? config.thread_count : (int)std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max(1, std::min(thread_count, height / 16));
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+        workers.emplace_back(threshold_rows, true, &integral, magnitude, magnitude_stride, dst, dst_stride, &config,
+                             height * i / thread_count, height * (i + 1) / thread_count);
+    threshold_rows(true, &integral, magnitude, magnitude_stride, dst, dst_stride, &config, 0, height / thread_count);
+    for (std::thread& worker : workers)
+        worker.join();
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include "IntegralImagePass.h"
+#include "TextureManager.h"
+
+IntegralImagePass::IntegralImagePass(Shader& scan_shader, Shader& threshold_shader)
+    : scan_shader(scan_shader), threshold_shader(threshold_shader), scan_pass(scan_shader), threshold_pass(threshold_shader)
+{
+    glGenTextures(1, &input_texture);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+IntegralImagePass::~IntegralImagePass()
+{
+    untrack_texture_memory(input_texture);
+    glDeleteTextures(1, &input_texture);
+    for (RenderTarget& target : targets)
+        destroy_render_target(target);
+    destroy_render_target(threshold_target);
+}
+
+const RenderTarget& IntegralImagePass::scan(const unsigned char* src, size_t src_stride, int width, int height)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    if (input_width != width || input_height != height)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+        track_texture_memory(GL_TEXTURE_2D, input_texture);
+        input_width = width;
+        input_height = height;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)src_stride);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, src);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    create_render_target(targets[0], width, height, GL_R32UI);
+    create_render_target(targets[1], width, height, GL_R32UI);
+
+    //rows, then columns; the first pass always runs so the table ends up in a target even for 1x1
+    GLuint source = input_texture;
+    int pass = 0;
+    scan_shader.use();
+    scan_shader.set_int("inputTexture", 0);
+    for (int step = 1; step == 1 || step < width; step *= 4, ++pass)
+    {
+        scan_shader.set_ivec2("step", step, 0);
+        scan_pass.run(source, targets[pass % 2]);
+        source = targets[pass % 2].texture;
+    }
+    for (int step = 1; step < height; step *= 4, ++pass)
+    {
+        scan_shader.set_ivec2("step", 0, step);
+        scan_pass.run(source, targets[pass % 2]);
+        source = targets[pass % 2].texture;
+    }
+    return targets[(pass - 1) % 2];
+}
+
+void IntegralImagePass::run(const unsigned char* src, size_t src_stride, int width, int height, IntegralImage& integral)
+{
+    integral.resize(width, height);
+    const RenderTarget& table = scan(src, src_stride, width, height);
+
+    //the inclusive sums land right of the zero column and above the zero row
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, table.framebuffer);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)integral.stride());
+    glReadPixels(0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_INT, integral.sums.data() + integral.stride() + 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void IntegralImagePass::run_adaptive(const unsigned char* magnitude, size_t magnitude_stride, unsigned char* dst, size_t dst_stride,
+                                     int width, int height, const AdaptiveThresholdConfig& config)
+{
+    const RenderTarget& table = scan(magnitude, magnitude_stride, width, height);
+
+    threshold_shader.use();
+    threshold_shader.set_int("sumTexture", 0);
+    threshold_shader.set_int("magnitudeTexture", 1);
+    threshold_shader.set_int("radius", std::clamp(config.radius, 0, ADAPTIVE_THRESHOLD_MAX_RADIUS));
+    threshold_shader.set_int("offset", config.offset);
+    threshold_shader.set_int("minMagnitude", config.min_magnitude);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, input_texture);
+    glActiveTexture(GL_TEXTURE0);
+    create_render_target(threshold_target, width, height, GL_R8UI);
+    threshold_pass.run(table.texture, threshold_target);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, threshold_target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)dst_stride);
+    glReadPixels(0, 0, width, height, GL_RED_INTEGER, GL_UNSIGNED_BYTE, dst);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include "LocalSocket.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#define poll WSAPoll
+typedef SOCKET native_socket;
+static void close_handle(intptr_t handle) { closesocket((SOCKET)handle); }
+#else
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+typedef int native_socket;
+static void close_handle(intptr_t handle) { ::close((int)handle); }
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//sockets of a process are all local, Winsock only has to start once
+static bool start_sockets()
+{
+#ifdef _WIN32
+    static bool started = []
+    {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return started;
+#else
+    return true;
+#endif
+}
+
+static bool make_address(const std::string& path, sockaddr_un& address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+LocalSocket::~LocalSocket()
+{
+    close();
+}
+
+LocalSocket::LocalSocket(LocalSocket&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+LocalSocket& LocalSocket::operator=(LocalSocket&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(handle, other.handle);
+        std::swap(bound_path, other.bound_path);
+    }
+    return *this;
+}
+
+bool LocalSocket::listen(const std::string& path, int backlog)
+{
+    close();
+
+    sockaddr_un address;
+    if (!start_sockets() || !make_address(path, address))
+        return false;
+
+    handle = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handle == -1)
+        return false;
+
+    std::remove(path.c_str());
+    if (bind((native_socket)handle, (const sockaddr*)&address, sizeof(address)) != 0 ||
+        ::listen((native_socket)handle, backlog) != 0)
+    {
+        close();
+        return false;
+    }
+    bound_path = path;
+    return true;
+}
+
+LocalSocket LocalSocket::accept()
+{
+    LocalSocket connection;
+    connection.handle = (intptr_t)::accept((native_socket)handle, nullptr, nullptr);
+    return connection;
+}
+
+bool LocalSocket::connect(const std::string& path)
+{
+    close();
+
+    sockaddr_un address;
+    if (!start_sockets() || !make_address(path, address))
+        return false;
+
+    handle = (intptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+    if (handle == -1)
+        return false;
+
+    if (::connect((native_socket)handle, (const sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool LocalSocket::send_all(const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+    while (size > 0)
+    {
+        int chunk = (int)std::min<size_t>(size, 1 << 30);
+        auto sent = send((native_socket)handle, bytes, chunk, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+bool LocalSocket::receive_all(void* data, size_t size)
+{
+    char* bytes = (char*)data;
+    while (size > 0)
+    {
+        int chunk = (int)std::min<size_t>(size, 1 << 30);
+        auto received = recv((native_socket)handle, bytes, chunk, 0);
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= (size_t)received;
+    }
+    return true;
+}
+
+bool LocalSocket::receive_some(void* data, size_t size, size_t& received)
+{
+    received = 0;
+    auto result = recv((native_socket)handle, (char*)data, (int)std::min<size_t>(size, 1 << 30), 0);
+    if (result <= 0)
+        return false;
+    received = (size_t)result;
+    return true;
+}
+
+void LocalSocket::close()
+{
+    if (handle != -1)
+        close_handle(handle);
+    if (!bound_path.empty())
+        std::remove(bound_path.c_str());
+    handle = -1;
+    bound_path.clear();
+}
+
+bool poll_readable(const std::vector<LocalSocket*>& sockets, int timeout_ms, std::vector<bool>& readable)
+{
+    std::vector<pollfd> descriptors(sockets.size());
+    for (size_t i = 0; i < sockets.size(); ++i)
+    {
+        descriptors[i].fd = (native_socket)sockets[i]->handle;
+        descriptors[i].events = POLLIN;
+        descriptors[i].revents = 0;
+    }
+
+    readable.assign(sockets.size(), false);
+    if (poll(descriptors.data(), (unsigned long)descriptors.size(), timeout_ms) < 0)
+        return false;
+    //a closed peer reports POLLHUP, the next receive_all sees it and fails
+    for (size_t i = 0; i < sockets.size(); ++i)
+        readable[i] = (descriptors[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+    return true;
+}
@@ -0,0 +1,135 @@
+#include <utility>
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(view, other.view);
+        std::swap(view_size, other.view_size);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(file_handle, other.file_handle);
+        std::swap(mapping_handle, other.mapping_handle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    view_size = (size_t)file_size.QuadPart;
+    opened = true;
+    if (view_size == 0)
+        return true;
+
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle)
+        view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    view = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    view_size = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(descriptor, &file_stat) != 0)
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    view_size = (size_t)file_stat.st_size;
+    if (view_size > 0)
+    {
+        void* mapped = mmap(nullptr, view_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED)
+        {
+            ::close(descriptor);
+            view_size = 0;
+            return false;
+        }
+        view = mapped;
+    }
+
+    //the mapping keeps the file alive
+    ::close(descriptor);
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (view)
+        munmap(view, view_size);
+    view = nullptr;
+    view_size = 0;
+    opened = false;
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include "Pyramid.h"
+#include "SobelCpu.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+//one output row, columns [x_begin, x_end)
+static void downsample_row_scalar(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                                  int x_begin, int x_end, int width)
+{
+    for (int x = x_begin; x < x_end; ++x)
+    {
+        int x0 = std::min(2 * x, width - 1);
+        int x1 = std::min(2 * x + 1, width - 1);
+        out[x] = (unsigned char)((row0[x0] + row0[x1] + row1[x0] + row1[x1] + 2) >> 2);
+    }
+}
+
+void downsample_2x2_u8_scalar(const unsigned char* src, size_t src_stride,
+                              unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    int dst_width = std::max(1, width / 2);
+    int dst_height = std::max(1, height / 2);
+    for (int y = 0; y < dst_height; ++y)
+    {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, height - 1) * src_stride;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * src_stride;
+        downsample_row_scalar(row0, row1, dst + (size_t)y * dst_stride, 0, dst_width, width);
+    }
+}
+
+#ifdef SEVENGER_SSE2
+
+//sum of each even/odd byte pair of two rows in 16-bit lanes
+static inline __m128i pair_sums_epi16(__m128i row0, __m128i row1)
+{
+    const __m128i low_bytes = _mm_set1_epi16(0x00FF);
+    __m128i even = _mm_add_epi16(_mm_and_si128(row0, low_bytes), _mm_and_si128(row1, low_bytes));
+    __m128i odd = _mm_add_epi16(_mm_srli_epi16(row0, 8), _mm_srli_epi16(row1, 8));
+    return _mm_add_epi16(even, odd);
+}
+
+static void downsample_row_sse2(const unsigned char* row0, const unsigned char* row1, unsigned char* out,
+                                int dst_width, int width)
+{
+    const __m128i rounding = _mm_set1_epi16(2);
+
+    //16 outputs from 32 source columns, the scalar tail clamps the odd last column
+    int x = 0;
+    for (; 2 * x + 32 <= width && x + 16 <= dst_width; x += 16)
+    {
+        __m128i low = pair_sums_epi16(_mm_loadu_si128((const __m128i*)(row0 + 2 * x)), _mm_loadu_si128((const __m128i*)(row1 + 2 * x)));
+        __m128i high = pair_sums_epi16(_mm_loadu_si128((const __m128i*)(row0 + 2 * x + 16)), _mm_loadu_si128((const __m128i*)(row1 + 2 * x + 16)));
+        low = _mm_srli_epi16(_mm_add_epi16(low, rounding), 2);
+        high = _mm_srli_epi16(_mm_add_epi16(high, rounding), 2);
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(low, high));
+    }
+    downsample_row_scalar(row0, row1, out, x, dst_width, width);
+}
+
+#endif
+
+void downsample_2x2_u8_simd(const unsigned char* src, size_t src_stride,
+                            unsigned char* dst, size_t dst_stride, int width, int height)
+{
+#ifdef SEVENGER_SSE2
+    int dst_width = std::max(1, width / 2);
+    int dst_height = std::max(1, height / 2);
+    for (int y = 0; y < dst_height; ++y)
+    {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, height - 1) * src_stride;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * src_stride;
+        downsample_row_sse2(row0, row1, dst + (size_t)y * dst_stride, dst_width, width);
+    }
+#else
+    downsample_2x2_u8_scalar(src, src_stride, dst, dst_stride, width, height);
+#endif
+}
+
+//out = max(out, in) over one row
+static void max_row_u8(unsigned char* out, const unsigned char* in, int width)
+{
+    int x = 0;
+#ifdef SEVENGER_SSE2
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(out + x));
+        __m128i b = _mm_loadu_si128((const __m128i*)(in + x));
+        _mm_storeu_si128((__m128i*)(out + x), _mm_max_epu8(a, b));
+    }
+#endif
+    for (; x < width; ++x)
+        out[x] = std::max(out[x], in[x]);
+}
+
+void LumaPyramid::build(const Image& luma, int level_count, ImagePool* pool)
+{
+    base = &luma;
+    levels.resize((size_t)std::max(0, level_count - 1));
+
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const Image& source = level((int)i);
+        int width = std::max(1, source.width() / 2);
+        int height = std::max(1, source.height() / 2);
+        if (levels[i].empty() || levels[i].width() != width || levels[i].height() != height)
+            levels[i] = Image(width, height, 1, PixelLayout::PLANAR, pool);
+        downsample_2x2_u8_simd(source.row(0), source.stride(), levels[i].row(0), levels[i].stride(), source.width(), source.height());
+    }
+}
+
+void sobel_multiscale_u8(const LumaPyramid& pyramid, int first_level, int level_count, Image& edges, ImagePool* pool)
+{
+    first_level = std::clamp(first_level, 0, pyramid.level_count() - 1);
+    int last_level = std::min(first_level + std::max(1, level_count), pyramid.level_count());
+
+    const Image& finest = pyramid.level(first_level);
+    int width = finest.width(), height = finest.height();
+    if (edges.empty() || edges.width() != width || edges.height() != height)
+        edges = Image(width, height, 1, PixelLayout::PLANAR, pool);
+    sobel_u8_simd(finest.row(0), finest.stride(), edges.row(0), edges.stride(), width, height);
+
+    Image coarse_edges;
+    std::vector<unsigned char> expanded((size_t)width);
+    for (int level = first_level + 1; level < last_level; ++level)
+    {
+        const Image& source = pyramid.level(level);
+        coarse_edges = Image(source.width(), source.height(), 1, PixelLayout::PLANAR, pool);
+        sobel_u8_simd(source.row(0), source.stride(), coarse_edges.row(0), coarse_edges.stride(), source.width(), source.height());
+
+        //each coarse row is expanded once and then shared by the 2^shift output rows it covers
+        int shift = level - first_level;
+        int expanded_row = -1;
+        for (int y = 0; y < height; ++y)
+        {
+            int coarse_y = std::min(y >> shift, source.height() - 1);
+            if (coarse_y != expanded_row)
+            {
+                const unsigned char* in = coarse_edges.row(coarse_y);
+                int step = 1 << shift;
+                int x = 0;
+                for (int coarse_x = 0; coarse_x < source.width() && x < width; ++coarse_x)
+                {
+                    int end = std::min(x + step, width);
+                    for (; x < end; ++x)
+                        expanded[x] = in[coarse_x];
+                }
+                //odd sizes leave a few columns past the last coarse pixel
+                for (; x < width; ++x)
+                    expanded[x] = in[source.width() - 1];
+                expanded_row = coarse_y;
+            }
+            max_row_u8(edges.row(y), expanded.data(), width);
+        }
+    }
+}
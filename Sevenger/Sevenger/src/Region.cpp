@@ -0,0 +1,82 @@
+#include <algorithm>
+#include "Region.h"
+
+Rect intersect_rects(const Rect& a, const Rect& b)
+{
+    int x0 = std::max(a.x, b.x);
+    int y0 = std::max(a.y, b.y);
+    int x1 = std::min(a.x + a.width, b.x + b.width);
+    int y1 = std::min(a.y + a.height, b.y + b.height);
+    if (x1 <= x0 || y1 <= y0)
+        return Rect();
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+Rect bounding_rect(const Rect& a, const Rect& b)
+{
+    if (a.empty())
+        return b;
+    if (b.empty())
+        return a;
+
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    return { x0, y0, x1 - x0, y1 - y0 };
+}
+
+Rect expand_rect(const Rect& rect, int halo, int width, int height)
+{
+    if (rect.empty())
+        return Rect();
+    return intersect_rects({ rect.x - halo, rect.y - halo, rect.width + 2 * halo, rect.height + 2 * halo }, { 0, 0, width, height });
+}
+
+//true when the rects overlap or share an edge
+static bool rects_touch(const Rect& a, const Rect& b)
+{
+    return a.x <= b.x + b.width && b.x <= a.x + a.width &&
+           a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+void DirtyRegion::add(const Rect& rect)
+{
+    if (rect.empty())
+        return;
+
+    //a merged rect can now touch ones it missed before, so keep going until nothing merges
+    Rect merged = rect;
+    bool merging = true;
+    while (merging)
+    {
+        merging = false;
+        for (size_t i = 0; i < rect_list.size(); ++i)
+        {
+            if (rects_touch(merged, rect_list[i]))
+            {
+                merged = bounding_rect(merged, rect_list[i]);
+                rect_list.erase(rect_list.begin() + i);
+                merging = true;
+                break;
+            }
+        }
+    }
+    rect_list.push_back(merged);
+
+    if (rect_list.size() > max_rects)
+    {
+        Rect bounds;
+        for (const Rect& dirty : rect_list)
+            bounds = bounding_rect(bounds, dirty);
+        rect_list.assign(1, bounds);
+    }
+}
+
+size_t DirtyRegion::area() const
+{
+    size_t total = 0;
+    for (const Rect& rect : rect_list)
+        total += rect.area();
+    return total;
+}
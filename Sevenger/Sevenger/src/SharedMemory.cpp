@@ -0,0 +1,183 @@
+#include <utility>
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SharedMemory::~SharedMemory()
+{
+    close();
+}
+
+SharedMemory::SharedMemory(SharedMemory&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+SharedMemory& SharedMemory::operator=(SharedMemory&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        std::swap(view, other.view);
+        std::swap(view_size, other.view_size);
+        std::swap(owner, other.owner);
+        std::swap(segment_name, other.segment_name);
+#ifdef _WIN32
+        std::swap(mapping_handle, other.mapping_handle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+std::string shared_memory_name(const std::string& prefix, unsigned tag)
+{
+    return "Local\\" + prefix + "-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(tag);
+}
+
+bool SharedMemory::create(const std::string& name, size_t size)
+{
+    close();
+
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        (DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xffffffffu), name.c_str());
+    if (!mapping)
+        return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_handle = mapping;
+    view_size = size;
+    owner = true;
+    segment_name = name;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name, size_t size)
+{
+    close();
+
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!mapping)
+        return false;
+
+    //a short segment would fault on access instead of failing here; mapping all of it and asking for
+    //the size of the view gives the segment size rounded up to whole pages, which are all accessible
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info;
+    if (view && (VirtualQuery(view, &info, sizeof(info)) != sizeof(info) || info.RegionSize < size))
+    {
+        UnmapViewOfFile(view);
+        view = nullptr;
+    }
+    if (!view)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_handle = mapping;
+    view_size = size;
+    segment_name = name;
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    view = nullptr;
+    mapping_handle = nullptr;
+    view_size = 0;
+    owner = false;
+    segment_name.clear();
+}
+
+#else
+
+std::string shared_memory_name(const std::string& prefix, unsigned tag)
+{
+    return "/" + prefix + "-" + std::to_string(getpid()) + "-" + std::to_string(tag);
+}
+
+bool SharedMemory::create(const std::string& name, size_t size)
+{
+    close();
+
+    int descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (descriptor < 0)
+        return false;
+
+    void* mapped = MAP_FAILED;
+    if (ftruncate(descriptor, (off_t)size) == 0)
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapped == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    view = mapped;
+    view_size = size;
+    owner = true;
+    segment_name = name;
+    return true;
+}
+
+bool SharedMemory::open(const std::string& name, size_t size)
+{
+    close();
+
+    int descriptor = shm_open(name.c_str(), O_RDWR, 0600);
+    if (descriptor < 0)
+        return false;
+
+    //a short segment would fault on access instead of failing here
+    struct stat segment_stat;
+    void* mapped = MAP_FAILED;
+    if (fstat(descriptor, &segment_stat) == 0 && (size_t)segment_stat.st_size >= size)
+        mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+    ::close(descriptor);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    view = mapped;
+    view_size = size;
+    segment_name = name;
+    return true;
+}
+
+void SharedMemory::close()
+{
+    if (view)
+        munmap(view, view_size);
+    if (owner)
+        shm_unlink(segment_name.c_str());
+    view = nullptr;
+    view_size = 0;
+    owner = false;
+    segment_name.clear();
+}
+
+#endif
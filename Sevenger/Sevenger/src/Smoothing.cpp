@@ -0,0 +1,486 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "Smoothing.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+bool parse_smoothing_filter(const std::string& name, SmoothingFilter& filter)
+{
+    if (name == "none")
+        filter = SmoothingFilter::NONE;
+    else if (name == "gaussian")
+        filter = SmoothingFilter::GAUSSIAN;
+    else if (name == "box")
+        filter = SmoothingFilter::BOX;
+    else if (name == "deriche")
+        filter = SmoothingFilter::DERICHE;
+    else
+        return false;
+    return true;
+}
+
+const char* smoothing_filter_name(SmoothingFilter filter)
+{
+    switch (filter)
+    {
+    case SmoothingFilter::GAUSSIAN: return "gaussian";
+    case SmoothingFilter::BOX:      return "box";
+    case SmoothingFilter::DERICHE:  return "deriche";
+    default:                        return "none";
+    }
+}
+
+void smoothing_weights(SmoothingFilter filter, float sigma, std::vector<float>& weights)
+{
+    weights.clear();
+    double s = std::min(sigma, SMOOTHING_MAX_SIGMA);
+    if (!(s > 0.0) || (filter != SmoothingFilter::GAUSSIAN && filter != SmoothingFilter::DERICHE))
+        return;
+
+    std::vector<double> taps;
+    if (filter == SmoothingFilter::GAUSSIAN)
+    {
+        int radius = std::max(1, (int)std::ceil(3.0 * s));
+        for (int i = 0; i <= radius; ++i)
+            taps.push_back(std::exp(-(double)i * i / (2.0 * s * s)));
+    }
+    else
+    {
+        double alpha = 2.0 / s;
+        taps.push_back(1.0);
+        for (int i = 1; taps.back() >= 0.001; ++i)
+            taps.push_back((alpha * i + 1.0) * std::exp(-alpha * i));
+    }
+
+    double sum = taps[0];
+    for (size_t i = 1; i < taps.size(); ++i)
+        sum += 2.0 * taps[i];
+    for (double tap : taps)
+        weights.push_back((float)(tap / sum));
+}
+
+void smoothing_box_widths(float sigma, int widths[3])
+{
+    //three boxes of width w have variance 3 (w^2 - 1) / 12, m of them get the lower odd width, the rest the next one
+    double s = std::clamp((double)sigma, 0.0, (double)SMOOTHING_MAX_SIGMA);
+    int lower = (int)std::floor(std::sqrt(4.0 * s * s + 1.0));
+    if (lower % 2 == 0)
+        --lower;
+    int lower_count = (int)std::lround((12.0 * s * s - 3.0 * lower * lower - 12.0 * lower - 9.0) / (-4.0 * lower - 4.0));
+    for (int i = 0; i < 3; ++i)
+        widths[i] = i < lower_count ? lower : lower + 2;
+}
+
+//everything a line filter needs, worked out once per call
+struct SmoothingPlan
+{
+    SmoothingFilter filter = SmoothingFilter::NONE;
+    std::vector<float> weights;
+    int box_widths[3] = { 1, 1, 1 };
+    //Deriche: y1[n] = a1 x[n] + a2 x[n-1] + b1 y1[n-1] + b2 y1[n-2], y2[n] = a3 x[n+1] + a4 x[n+2] + b1 y2[n+1] + b2 y2[n+2]
+    float a1 = 0.0f, a2 = 0.0f, a3 = 0.0f, a4 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    //steady state of y1 and y2 over a constant border, per unit of the border pixel
+    float causal_gain = 0.0f, anticausal_gain = 0.0f;
+    int padding = 0;
+};
+
+//false if the filter leaves the plane as it is
+static bool make_plan(SmoothingFilter filter, float sigma, SmoothingPlan& plan)
+{
+    plan.filter = filter;
+    float s = std::min(sigma, SMOOTHING_MAX_SIGMA);
+    if (filter == SmoothingFilter::NONE || !(s > 0.0f))
+        return false;
+
+    if (filter == SmoothingFilter::GAUSSIAN)
+    {
+        smoothing_weights(filter, s, plan.weights);
+        plan.padding = (int)plan.weights.size() - 1;
+        return true;
+    }
+    if (filter == SmoothingFilter::BOX)
+    {
+        smoothing_box_widths(s, plan.box_widths);
+        plan.padding = std::max({ plan.box_widths[0], plan.box_widths[1], plan.box_widths[2] }) / 2;
+        return plan.padding > 0;
+    }
+
+    double alpha = 2.0 / s, decay = std::exp(-alpha), decay2 = std::exp(-2.0 * alpha);
+    double k = (1.0 - decay) * (1.0 - decay) / (1.0 + 2.0 * alpha * decay - decay2);
+    double b1 = 2.0 * decay, b2 = -decay2;
+    double a1 = k, a2 = k * decay * (alpha - 1.0), a3 = k * decay * (alpha + 1.0), a4 = -k * decay2;
+    plan.a1 = (float)a1;
+    plan.a2 = (float)a2;
+    plan.a3 = (float)a3;
+    plan.a4 = (float)a4;
+    plan.b1 = (float)b1;
+    plan.b2 = (float)b2;
+    plan.causal_gain = (float)((a1 + a2) / (1.0 - b1 - b2));
+    plan.anticausal_gain = (float)((a3 + a4) / (1.0 - b1 - b2));
+    return true;
+}
+
+//one float per lane, or four with SSE2; the line filters only use these, so both do the same operations
+struct ScalarLanes
+{
+    typedef float V;
+    static const int width = 1;
+    static V splat(float value) { return value; }
+    static V load(const float* p) { return *p; }
+    static void store(float* p, V v) { *p = v; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+};
+
+#ifdef SEVENGER_SSE2
+struct SseLanes
+{
+    typedef __m128 V;
+    static const int width = 4;
+    static V splat(float value) { return _mm_set1_ps(value); }
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+};
+#endif
+
+//a line of length positions with count floats each (several rows or columns side by side), position p at
+//line[p * count]; padded gets radius copies of the first and last position on either side
+static void pad_line(const float* line, float* padded, int length, int count, int radius)
+{
+    for (int p = -radius; p < length + radius; ++p)
+    {
+        const float* in = line + (size_t)std::clamp(p, 0, length - 1) * count;
+        std::memcpy(padded + (size_t)(p + radius) * count, in, count * sizeof(float));
+    }
+}
+
+template <typename L>
+static void gaussian_line(const SmoothingPlan& plan, float* line, float* padded, int length, int count)
+{
+    typedef typename L::V V;
+    int radius = (int)plan.weights.size() - 1;
+    pad_line(line, padded, length, count, radius);
+    for (int c = 0; c < count; c += L::width)
+    {
+        const float* in = padded + (size_t)radius * count + c;
+        for (int i = 0; i < length; ++i)
+        {
+            const float* center = in + (size_t)i * count;
+            V sum = L::mul(L::splat(plan.weights[0]), L::load(center));
+            for (int k = 1; k <= radius; ++k)
+                sum = L::add(sum, L::mul(L::splat(plan.weights[k]), L::add(L::load(center - (size_t)k * count), L::load(center + (size_t)k * count))));
+            L::store(line + (size_t)i * count + c, sum);
+        }
+    }
+}
+
+//running sum over a window of width positions: one add and one subtract per position whatever the width
+template <typename L>
+static void box_line(float* line, float* padded, int length, int count, int width)
+{
+    typedef typename L::V V;
+    int radius = width / 2;
+    if (radius == 0)
+        return;
+    pad_line(line, padded, length, count, radius);
+    V scale = L::splat(1.0f / width);
+    for (int c = 0; c < count; c += L::width)
+    {
+        const float* in = padded + c;
+        V sum = L::load(in);
+        for (int j = 1; j < width; ++j)
+            sum = L::add(sum, L::load(in + (size_t)j * count));
+        L::store(line + c, L::mul(sum, scale));
+        for (int i = 1; i < length; ++i)
+        {
+            sum = L::sub(L::add(sum, L::load(in + (size_t)(i + 2 * radius) * count)), L::load(in + (size_t)(i - 1) * count));
+            L::store(line + (size_t)i * count + c, L::mul(sum, scale));
+        }
+    }
+}
+
+//causal pass into causal, anticausal pass backwards adding onto it; the recursions start from their
+//steady state over the border pixel, as if the line went on with it forever
+template <typename L>
+static void deriche_line(const SmoothingPlan& plan, float* line, float* causal, int length, int count)
+{
+    typedef typename L::V V;
+    V a1 = L::splat(plan.a1), a2 = L::splat(plan.a2), a3 = L::splat(plan.a3), a4 = L::splat(plan.a4);
+    V b1 = L::splat(plan.b1), b2 = L::splat(plan.b2);
+    for (int c = 0; c < count; c += L::width)
+    {
+        V x1 = L::load(line + c);
+        V y1 = L::mul(L::splat(plan.causal_gain), x1), y2 = y1;
+        for (int i = 0; i < length; ++i)
+        {
+            V x = L::load(line + (size_t)i * count + c);
+            V y = L::add(L::add(L::mul(a1, x), L::mul(a2, x1)), L::add(L::mul(b1, y1), L::mul(b2, y2)));
+            L::store(causal + (size_t)i * count + c, y);
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        x1 = L::load(line + (size_t)(length - 1) * count + c);
+        V x2 = x1;
+        y1 = L::mul(L::splat(plan.anticausal_gain), x1);
+        y2 = y1;
+        for (int i = length - 1; i >= 0; --i)
+        {
+            V y = L::add(L::add(L::mul(a3, x1), L::mul(a4, x2)), L::add(L::mul(b1, y1), L::mul(b2, y2)));
+            V x = L::load(line + (size_t)i * count + c);
+            L::store(line + (size_t)i * count + c, L::add(L::load(causal + (size_t)i * count + c), y));
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+    }
+}
+
+//count must be a multiple of L::width
+template <typename L>
+static void filter_line(const SmoothingPlan& plan, float* line, std::vector<float>& scratch, int length, int count)
+{
+    size_t needed = (size_t)(plan.filter == SmoothingFilter::DERICHE ? length : length + 2 * plan.padding) * count;
+    if (scratch.size() < needed)
+        scratch.resize(needed);
+
+    if (plan.filter == SmoothingFilter::GAUSSIAN)
+        gaussian_line<L>(plan, line, scratch.data(), length, count);
+    else if (plan.filter == SmoothingFilter::BOX)
+    {
+        for (int width : plan.box_widths)
+            box_line<L>(line, scratch.data(), length, count, width);
+    }
+    else
+        deriche_line<L>(plan, line, scratch.data(), length, count);
+}
+
+static unsigned char to_u8(float value)
+{
+    return (unsigned char)std::clamp((int)(value + 0.5f), 0, 255);
+}
+
+//columns are filtered this many at a time, a 16 byte load per row
+constexpr int SMOOTHING_STRIP = 16;
+
+static void row_pass(const SmoothingPlan& plan, bool simd, const unsigned char* src, size_t src_stride,
+                     unsigned char* dst, size_t dst_stride, int width, int first_row, int last_row)
+{
+    std::vector<float> line((size_t)width * 4), scratch;
+    int y = first_row;
+#ifdef SEVENGER_SSE2
+    //4 rows side by side, transposed 16 pixels at a time
+    std::vector<unsigned char> packed((size_t)width * 4 + 16);
+    for (; simd && y + 4 <= last_row; y += 4)
+    {
+        const unsigned char* rows[4];
+        for (int k = 0; k < 4; ++k)
+            rows[k] = src + (size_t)(y + k) * src_stride;
+
+        __m128i zero = _mm_setzero_si128();
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(rows[0] + x)), b = _mm_loadu_si128((const __m128i*)(rows[1] + x));
+            __m128i c = _mm_loadu_si128((const __m128i*)(rows[2] + x)), d = _mm_loadu_si128((const __m128i*)(rows[3] + x));
+            __m128i ab_low = _mm_unpacklo_epi8(a, b), ab_high = _mm_unpackhi_epi8(a, b);
+            __m128i cd_low = _mm_unpacklo_epi8(c, d), cd_high = _mm_unpackhi_epi8(c, d);
+            __m128i quads[4] = { _mm_unpacklo_epi16(ab_low, cd_low), _mm_unpackhi_epi16(ab_low, cd_low),
+                                 _mm_unpacklo_epi16(ab_high, cd_high), _mm_unpackhi_epi16(ab_high, cd_high) };
+            for (int q = 0; q < 4; ++q)
+            {
+                __m128i low = _mm_unpacklo_epi8(quads[q], zero), high = _mm_unpackhi_epi8(quads[q], zero);
+                float* out = line.data() + (size_t)(x + 4 * q) * 4;
+                _mm_storeu_ps(out, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+                _mm_storeu_ps(out + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+                _mm_storeu_ps(out + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+                _mm_storeu_ps(out + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+            }
+        }
+        for (; x < width; ++x)
+        {
+            for (int k = 0; k < 4; ++k)
+                line[(size_t)x * 4 + k] = rows[k][x];
+        }
+
+        filter_line<SseLanes>(plan, line.data(), scratch, width, 4);
+
+        //same rounding as to_u8, the saturating packs do the clamp
+        __m128 half = _mm_set1_ps(0.5f);
+        for (x = 0; x + 4 <= width; x += 4)
+        {
+            const float* in = line.data() + (size_t)x * 4;
+            __m128i p0 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in), half));
+            __m128i p1 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 4), half));
+            __m128i p2 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 8), half));
+            __m128i p3 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 12), half));
+            __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+            _mm_storeu_si128((__m128i*)(packed.data() + (size_t)x * 4), bytes);
+        }
+        for (; x < width; ++x)
+        {
+            for (int k = 0; k < 4; ++k)
+                packed[(size_t)x * 4 + k] = to_u8(line[(size_t)x * 4 + k]);
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            unsigned char* out = dst + (size_t)(y + k) * dst_stride;
+            for (x = 0; x < width; ++x)
+                out[x] = packed[(size_t)x * 4 + k];
+        }
+    }
+#else
+    (void)simd;
+#endif
+    for (; y < last_row; ++y)
+    {
+        const unsigned char* in = src + (size_t)y * src_stride;
+        for (int x = 0; x < width; ++x)
+            line[x] = in[x];
+        filter_line<ScalarLanes>(plan, line.data(), scratch, width, 1);
+        unsigned char* out = dst + (size_t)y * dst_stride;
+        for (int x = 0; x < width; ++x)
+            out[x] = to_u8(line[x]);
+    }
+}
+
+//columns [first_column, last_column) of the row-filtered plane, in place, a strip of columns at a time
+static void column_pass(const SmoothingPlan& plan, bool simd, unsigned char* plane, size_t stride,
+                        int height, int first_column, int last_column)
+{
+    std::vector<float> line((size_t)height * SMOOTHING_STRIP), scratch;
+    for (int x = first_column; x < last_column; x += SMOOTHING_STRIP)
+    {
+        int count = std::min(SMOOTHING_STRIP, last_column - x);
+#ifdef SEVENGER_SSE2
+        if (simd && count == SMOOTHING_STRIP)
+        {
+            __m128i zero = _mm_setzero_si128();
+            for (int y = 0; y < height; ++y)
+            {
+                __m128i bytes = _mm_loadu_si128((const __m128i*)(plane + (size_t)y * stride + x));
+                __m128i low = _mm_unpacklo_epi8(bytes, zero), high = _mm_unpackhi_epi8(bytes, zero);
+                float* out = line.data() + (size_t)y * SMOOTHING_STRIP;
+                _mm_storeu_ps(out, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+                _mm_storeu_ps(out + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+                _mm_storeu_ps(out + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+                _mm_storeu_ps(out + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+            }
+
+            filter_line<SseLanes>(plan, line.data(), scratch, height, SMOOTHING_STRIP);
+
+            __m128 half = _mm_set1_ps(0.5f);
+            for (int y = 0; y < height; ++y)
+            {
+                const float* in = line.data() + (size_t)y * SMOOTHING_STRIP;
+                __m128i p0 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in), half));
+                __m128i p1 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 4), half));
+                __m128i p2 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 8), half));
+                __m128i p3 = _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + 12), half));
+                _mm_storeu_si128((__m128i*)(plane + (size_t)y * stride + x),
+                                 _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3)));
+            }
+            continue;
+        }
+#else
+        (void)simd;
+#endif
+        for (int y = 0; y < height; ++y)
+        {
+            const unsigned char* in = plane + (size_t)y * stride + x;
+            for (int k = 0; k < count; ++k)
+                line[(size_t)y * count + k] = in[k];
+        }
+        filter_line<ScalarLanes>(plan, line.data(), scratch, height, count);
+        for (int y = 0; y < height; ++y)
+        {
+            unsigned char* out = plane + (size_t)y * stride + x;
+            for (int k = 0; k < count; ++k)
+                out[k] = to_u8(line[(size_t)y * count + k]);
+        }
+    }
+}
+
+static void copy_plane(const unsigned char* src, size_t src_stride, unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    if (src == dst)
+        return;
+    for (int y = 0; y < height; ++y)
+        std::memcpy(dst + (size_t)y * dst_stride, src + (size_t)y * src_stride, width);
+}
+
+void smooth_u8_scalar(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    SmoothingPlan plan;
+    if (width <= 0 || height <= 0 || !make_plan(filter, sigma, plan))
+    {
+        copy_plane(src, src_stride, dst, dst_stride, width, height);
+        return;
+    }
+    row_pass(plan, false, src, src_stride, dst, dst_stride, width, 0, height);
+    column_pass(plan, false, dst, dst_stride, height, 0, width);
+}
+
+void smooth_u8_simd(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                    unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    SmoothingPlan plan;
+    if (width <= 0 || height <= 0 || !make_plan(filter, sigma, plan))
+    {
+        copy_plane(src, src_stride, dst, dst_stride, width, height);
+        return;
+    }
+    row_pass(plan, true, src, src_stride, dst, dst_stride, width, 0, height);
+    column_pass(plan, true, dst, dst_stride, height, 0, width);
+}
+
+void smooth_u8_threaded(SmoothingFilter filter, float sigma, const unsigned char* src, size_t src_stride,
+                        unsigned char* dst, size_t dst_stride, int width, int height, int thread_count)
+{
+    SmoothingPlan plan;
+    if (width <= 0 || height <= 0 || !make_plan(filter, sigma, plan))
+    {
+        copy_plane(src, src_stride, dst, dst_stride, width, height);
+        return;
+    }
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    //rows in bands of whole 4 row groups, then columns in strips of whole SMOOTHING_STRIP groups
+    int row_threads = std::max(1, std::min(thread_count, height / 16));
+    std::vector<std::thread> workers;
+    for (int i = 1; i < row_threads; ++i)
+    {
+        int first = height / 4 * i / row_threads * 4, last = i + 1 == row_threads ? height : height / 4 * (i + 1) / row_threads * 4;
+        workers.emplace_back(row_pass, std::cref(plan), true, src, src_stride, dst, dst_stride, width, first, last);
+    }
+    row_pass(plan, true, src, src_stride, dst, dst_stride, width, 0, row_threads > 1 ? height / 4 / row_threads * 4 : height);
+    for (std::thread& worker : workers)
+        worker.join();
+    workers.clear();
+
+    int strips = (width + SMOOTHING_STRIP - 1) / SMOOTHING_STRIP;
+    int column_threads = std::max(1, std::min(thread_count, strips));
+    for (int i = 1; i < column_threads; ++i)
+    {
+        int first = strips * i / column_threads * SMOOTHING_STRIP;
+        int last = std::min(width, strips * (i + 1) / column_threads * SMOOTHING_STRIP);
+        workers.emplace_back(column_pass, std::cref(plan), true, dst, dst_stride, height, first, last);
+    }
+    column_pass(plan, true, dst, dst_stride, height, 0, std::min(width, strips / column_threads * SMOOTHING_STRIP));
+    for (std::thread& worker : workers)
+        worker.join();
+}
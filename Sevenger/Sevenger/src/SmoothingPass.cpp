@@ -0,0 +1,178 @@
+#include "SmoothingPass.h"
+#include "TextureManager.h"
+
+float smoothing_gl_max_sigma(SmoothingFilter filter)
+{
+    if (filter != SmoothingFilter::GAUSSIAN && filter != SmoothingFilter::DERICHE)
+        return SMOOTHING_MAX_SIGMA;
+
+    //the kernel radius grows with sigma, bisect for the last sigma that still fits
+    std::vector<float> weights;
+    float low = 0.0f, high = SMOOTHING_MAX_SIGMA;
+    for (int i = 0; i < 32; ++i)
+    {
+        float middle = 0.5f * (low + high);
+        smoothing_weights(filter, middle, weights);
+        if ((int)weights.size() - 1 <= SMOOTHING_GL_MAX_RADIUS)
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+SmoothingPass::SmoothingPass(Shader& smoothing_shader, Shader& box_scan_shader, Shader& box_shader)
+    : smoothing_shader(smoothing_shader), box_scan_shader(box_scan_shader), box_shader(box_shader),
+      pass(smoothing_shader), scan_pass(box_scan_shader), box_pass(box_shader)
+{
+    glGenTextures(1, &luma_texture);
+    glBindTexture(GL_TEXTURE_2D, luma_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+SmoothingPass::~SmoothingPass()
+{
+    untrack_texture_memory(luma_texture);
+    glDeleteTextures(1, &luma_texture);
+    for (RenderTarget& target : sum_targets)
+        destroy_render_target(target);
+    destroy_render_target(level_target);
+    destroy_render_target(row_target);
+    destroy_render_target(output_target);
+}
+
+void SmoothingPass::draw(GLuint input_texture, const RenderTarget& target, int dx, int dy, const std::vector<float>& weights)
+{
+    smoothing_shader.use();
+    smoothing_shader.set_int("inputTexture", 0);
+    smoothing_shader.set_ivec2("direction", dx, dy);
+    smoothing_shader.set_int("radius", (int)weights.size() - 1);
+    glUniform1fv(glGetUniformLocation(smoothing_shader.shader_program_id, "weights"), (GLsizei)weights.size(), weights.data());
+    pass.run(input_texture, target);
+}
+
+bool SmoothingPass::run_box(GLuint input_texture, int width, int height, const std::vector<int>& radii, bool single_channel)
+{
+    GLenum sum_format = single_channel ? GL_R32UI : GL_RGBA32UI;
+    GLenum level_format = single_channel ? GL_R32F : GL_RGBA32F;
+    for (RenderTarget& target : sum_targets)
+    {
+        if (!create_render_target(target, width, height, sum_format))
+            return false;
+    }
+    if (radii.size() > 1 && !create_render_target(level_target, width, height, level_format))
+        return false;
+
+    box_scan_shader.use();
+    box_scan_shader.set_int("valueTexture", 1);
+    box_scan_shader.set_int("sumTexture", 0);
+    box_shader.use();
+    box_shader.set_int("sumTexture", 0);
+
+    for (int direction = 0; direction < 2; ++direction)
+    {
+        int dx = direction == 0 ? 1 : 0, dy = 1 - dx;
+        int length = direction == 0 ? width : height;
+        GLuint source = direction == 0 ? input_texture : row_target.texture;
+        const RenderTarget& result = direction == 0 ? row_target : output_target;
+        for (size_t i = 0; i < radii.size(); ++i)
+        {
+            //the first scan pass reads the 8-bit input or the previous box's levels, the first one always
+            //runs so the sums end up in a target even for a line of one pixel
+            box_scan_shader.use();
+            box_scan_shader.set_float("valueScale", source == level_target.texture ? 65536.0f : 255.0f * 65536.0f);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, source);
+            glActiveTexture(GL_TEXTURE0);
+            int pass_index = 0;
+            for (int step = 1; step == 1 || step < length; step *= 4, ++pass_index)
+            {
+                box_scan_shader.set_bool("firstPass", step == 1);
+                box_scan_shader.set_ivec2("step", step * dx, step * dy);
+                scan_pass.run(pass_index == 0 ? 0 : sum_targets[(pass_index - 1) % 2].texture, sum_targets[pass_index % 2]);
+            }
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glActiveTexture(GL_TEXTURE0);
+
+            bool last = i + 1 == radii.size();
+            box_shader.use();
+            box_shader.set_ivec2("direction", dx, dy);
+            box_shader.set_int("radius", radii[i]);
+            box_shader.set_bool("toColor", last);
+            box_pass.run(sum_targets[(pass_index - 1) % 2].texture, last ? result : level_target);
+            source = level_target.texture;
+        }
+    }
+    return true;
+}
+
+bool SmoothingPass::run(GLuint input_texture, int width, int height, SmoothingFilter filter, float sigma)
+{
+    return run(input_texture, width, height, filter, sigma, false);
+}
+
+bool SmoothingPass::run(GLuint input_texture, int width, int height, SmoothingFilter filter, float sigma, bool single_channel)
+{
+    if (!create_render_target(row_target, width, height, GL_RGBA8) || !create_render_target(output_target, width, height, GL_RGBA8))
+        return false;
+
+    if (filter == SmoothingFilter::BOX && sigma > 0.0f)
+    {
+        int widths[3];
+        smoothing_box_widths(sigma, widths);
+        std::vector<int> radii;
+        for (int box_width : widths)
+        {
+            if (box_width > 1)
+                radii.push_back(box_width / 2);
+        }
+        if (!radii.empty())
+            return run_box(input_texture, width, height, radii, single_channel);
+    }
+
+    //the kernel halves of one direction's passes, the same for rows and columns
+    std::vector<float> weights;
+    smoothing_weights(filter, sigma, weights);
+    if ((int)weights.size() - 1 > SMOOTHING_GL_MAX_RADIUS)
+        smoothing_weights(filter, smoothing_gl_max_sigma(filter), weights);
+    if (weights.empty())
+        weights = { 1.0f };
+
+    draw(input_texture, row_target, 1, 0, weights);
+    draw(row_target.texture, output_target, 0, 1, weights);
+    return true;
+}
+
+bool SmoothingPass::run(const unsigned char* luma, size_t luma_stride, unsigned char* dst, size_t dst_stride,
+                        int width, int height, SmoothingFilter filter, float sigma)
+{
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, luma_texture);
+    if (luma_width != width || luma_height != height)
+    {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+        track_texture_memory(GL_TEXTURE_2D, luma_texture);
+        luma_width = width;
+        luma_height = height;
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)luma_stride);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, luma);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!run(luma_texture, width, height, filter, sigma, true))
+        return false;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, output_target.framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)dst_stride);
+    glReadPixels(0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, dst);
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return true;
+}
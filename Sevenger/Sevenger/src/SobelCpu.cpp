@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Image.h"
+#include "Region.h"
+#include "SobelCpu.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void luma_u8(const unsigned char* src, size_t src_stride, int channels,
+             unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* in = src + (size_t)y * src_stride;
+        unsigned char* out = dst + (size_t)y * dst_stride;
+        if (channels < 3)
+        {
+            for (int x = 0; x < width; ++x)
+                out[x] = in[x * channels];
+            continue;
+        }
+        for (int x = 0; x < width; ++x)
+        {
+            const unsigned char* p = in + x * channels;
+            out[x] = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+        }
+    }
+}
+
+void luma_u8_planar(const unsigned char* r, const unsigned char* g, const unsigned char* b, size_t src_stride,
+                    unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        size_t offset = (size_t)y * src_stride;
+        const unsigned char* r_row = r + offset;
+        const unsigned char* g_row = g + offset;
+        const unsigned char* b_row = b + offset;
+        unsigned char* out = dst + (size_t)y * dst_stride;
+        for (int x = 0; x < width; ++x)
+            out[x] = (unsigned char)((77 * r_row[x] + 150 * g_row[x] + 29 * b_row[x] + 128) >> 8);
+    }
+}
+
+void luma_u8(const Image& src, Image& luma)
+{
+    if (src.layout() == PixelLayout::PLANAR && src.channels() >= 3)
+        luma_u8_planar(src.plane(0), src.plane(1), src.plane(2), src.stride(), luma.row(0), luma.stride(), src.width(), src.height());
+    else
+        luma_u8(src.row(0), src.stride(), src.pixel_stride(), luma.row(0), luma.stride(), src.width(), src.height());
+}
+
+GradientWeights gradient_weights(GradientKernel kernel)
+{
+    switch (kernel)
+    {
+    case GradientKernel::PREWITT:
+        return { 1, 1, 0 };
+    case GradientKernel::SCHARR:
+        return { 3, 10, 2 };
+    default:
+        return { 1, 2, 0 };
+    }
+}
+
+//one output row, columns [x_begin, x_end) with clamped neighbours
+//A and B are the [A B A] smoothing weights, SHIFT scales the magnitude back (see gradient_weights)
+template <int A, int B, int SHIFT>
+static void gradient_row_scalar(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                                unsigned char* out, int x_begin, int x_end, int width)
+{
+    for (int x = x_begin; x < x_end; ++x)
+    {
+        int l = x > 0 ? x - 1 : 0;
+        int r = x < width - 1 ? x + 1 : width - 1;
+        int gx = A * (up[r] - up[l]) + B * (mid[r] - mid[l]) + A * (down[r] - down[l]);
+        int gy = (A * down[l] + B * down[x] + A * down[r]) - (A * up[l] + B * up[x] + A * up[r]);
+        out[x] = (unsigned char)std::min((std::abs(gx) + std::abs(gy)) >> SHIFT, 255);
+    }
+}
+
+#ifdef SEVENGER_SSE2
+
+static inline __m128i abs_epi16(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+//A * (l + r) + B * c, the Sobel and Prewitt weights only need adds
+template <int A, int B>
+static inline __m128i weighted_sum_epi16(__m128i l, __m128i c, __m128i r)
+{
+    if constexpr (A == 1 && B == 2)
+        return _mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(c, c));
+    else if constexpr (A == 1 && B == 1)
+        return _mm_add_epi16(_mm_add_epi16(l, r), c);
+    else
+        return _mm_add_epi16(_mm_mullo_epi16(_mm_add_epi16(l, r), _mm_set1_epi16(A)), _mm_mullo_epi16(c, _mm_set1_epi16(B)));
+}
+
+//eight pixels in 16-bit lanes, |gx| + |gy| is at most 2 * 16 * 255 (Scharr) so nothing overflows
+template <int A, int B, int SHIFT>
+static inline __m128i gradient_epi16(__m128i up_l, __m128i up_c, __m128i up_r,
+                                     __m128i mid_l, __m128i mid_r,
+                                     __m128i down_l, __m128i down_c, __m128i down_r)
+{
+    __m128i gx = weighted_sum_epi16<A, B>(_mm_sub_epi16(up_r, up_l), _mm_sub_epi16(mid_r, mid_l), _mm_sub_epi16(down_r, down_l));
+    __m128i gy = _mm_sub_epi16(weighted_sum_epi16<A, B>(down_l, down_c, down_r), weighted_sum_epi16<A, B>(up_l, up_c, up_r));
+    __m128i magnitude = _mm_add_epi16(abs_epi16(gx), abs_epi16(gy));
+    if constexpr (SHIFT > 0)
+        magnitude = _mm_srli_epi16(magnitude, SHIFT);
+    return magnitude;
+}
+
+template <int A, int B, int SHIFT>
+static void gradient_row_sse2(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                              unsigned char* out, int x_begin, int x_end, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    //borders and the tail go through the scalar path, x + 16 must stay inside the row for the right neighbours
+    int x = std::max(x_begin, 1);
+    gradient_row_scalar<A, B, SHIFT>(up, mid, down, out, x_begin, std::min(x, x_end), width);
+    for (; x + 16 < width && x + 16 <= x_end; x += 16)
+    {
+        __m128i u_l = _mm_loadu_si128((const __m128i*)(up + x - 1));
+        __m128i u_c = _mm_loadu_si128((const __m128i*)(up + x));
+        __m128i u_r = _mm_loadu_si128((const __m128i*)(up + x + 1));
+        __m128i m_l = _mm_loadu_si128((const __m128i*)(mid + x - 1));
+        __m128i m_r = _mm_loadu_si128((const __m128i*)(mid + x + 1));
+        __m128i d_l = _mm_loadu_si128((const __m128i*)(down + x - 1));
+        __m128i d_c = _mm_loadu_si128((const __m128i*)(down + x));
+        __m128i d_r = _mm_loadu_si128((const __m128i*)(down + x + 1));
+
+        __m128i low = gradient_epi16<A, B, SHIFT>(_mm_unpacklo_epi8(u_l, zero), _mm_unpacklo_epi8(u_c, zero), _mm_unpacklo_epi8(u_r, zero),
+                                                  _mm_unpacklo_epi8(m_l, zero), _mm_unpacklo_epi8(m_r, zero),
+                                                  _mm_unpacklo_epi8(d_l, zero), _mm_unpacklo_epi8(d_c, zero), _mm_unpacklo_epi8(d_r, zero));
+        __m128i high = gradient_epi16<A, B, SHIFT>(_mm_unpackhi_epi8(u_l, zero), _mm_unpackhi_epi8(u_c, zero), _mm_unpackhi_epi8(u_r, zero),
+                                                   _mm_unpackhi_epi8(m_l, zero), _mm_unpackhi_epi8(m_r, zero),
+                                                   _mm_unpackhi_epi8(d_l, zero), _mm_unpackhi_epi8(d_c, zero), _mm_unpackhi_epi8(d_r, zero));
+
+        //unsigned saturation clamps the magnitude to 255
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(low, high));
+    }
+    gradient_row_scalar<A, B, SHIFT>(up, mid, down, out, x, x_end, width);
+}
+
+#endif
+
+using GradientRow = void (*)(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                             unsigned char* out, int x_begin, int x_end, int width);
+
+//the SIMD rows fall back to the scalar ones without SSE2
+static GradientRow gradient_row(GradientKernel kernel, bool simd)
+{
+#ifdef SEVENGER_SSE2
+    if (simd)
+    {
+        switch (kernel)
+        {
+        case GradientKernel::PREWITT:
+            return gradient_row_sse2<1, 1, 0>;
+        case GradientKernel::SCHARR:
+            return gradient_row_sse2<3, 10, 2>;
+        default:
+            return gradient_row_sse2<1, 2, 0>;
+        }
+    }
+#endif
+    switch (kernel)
+    {
+    case GradientKernel::PREWITT:
+        return gradient_row_scalar<1, 1, 0>;
+    case GradientKernel::SCHARR:
+        return gradient_row_scalar<3, 10, 2>;
+    default:
+        return gradient_row_scalar<1, 2, 0>;
+    }
+}
+
+static void gradient_rows(GradientRow row, const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, const Rect& region)
+{
+    Rect clipped = intersect_rects(region, { 0, 0, width, height });
+    for (int y = clipped.y; y < clipped.y + clipped.height; ++y)
+    {
+        const unsigned char* up = src + (size_t)(y > 0 ? y - 1 : 0) * src_stride;
+        const unsigned char* mid = src + (size_t)y * src_stride;
+        const unsigned char* down = src + (size_t)(y < height - 1 ? y + 1 : height - 1) * src_stride;
+        row(up, mid, down, dst + (size_t)y * dst_stride, clipped.x, clipped.x + clipped.width, width);
+    }
+}
+
+void gradient_u8_scalar(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                        unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    gradient_rows(gradient_row(kernel, false), src, src_stride, dst, dst_stride, width, height, { 0, 0, width, height });
+}
+
+void gradient_u8_simd(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                      unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    gradient_rows(gradient_row(kernel, true), src, src_stride, dst, dst_stride, width, height, { 0, 0, width, height });
+}
+
+void gradient_u8_simd_region(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                             unsigned char* dst, size_t dst_stride, int width, int height, const Rect& region)
+{
+    gradient_rows(gradient_row(kernel, true), src, src_stride, dst, dst_stride, width, height, region);
+}
+
+void gradient_u8_threaded(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max(1, std::min(thread_count, height / 16));
+
+    //bands of whole rows, each reads its one row halo straight from the shared source
+    GradientRow row = gradient_row(kernel, true);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+    {
+        int y0 = height * i / thread_count;
+        int y1 = height * (i + 1) / thread_count;
+        workers.emplace_back(gradient_rows, row, src, src_stride, dst, dst_stride, width, height, Rect{ 0, y0, width, y1 - y0 });
+    }
+    gradient_rows(row, src, src_stride, dst, dst_stride, width, height, { 0, 0, width, height / thread_count });
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void sobel_u8_scalar(const unsigned char* src, size_t src_stride,
+                     unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    gradient_u8_scalar(GradientKernel::SOBEL, src, src_stride, dst, dst_stride, width, height);
+}
+
+void sobel_u8_simd(const unsigned char* src, size_t src_stride,
+                   unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    gradient_u8_simd(GradientKernel::SOBEL, src, src_stride, dst, dst_stride, width, height);
+}
+
+void sobel_u8_simd_region(const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, const Rect& region)
+{
+    gradient_u8_simd_region(GradientKernel::SOBEL, src, src_stride, dst, dst_stride, width, height, region);
+}
+
+void sobel_u8_threaded(const unsigned char* src, size_t src_stride,
+                       unsigned char* dst, size_t dst_stride, int width, int height, int thread_count)
+{
+    gradient_u8_threaded(GradientKernel::SOBEL, src, src_stride, dst, dst_stride, width, height, thread_count);
+}
+
+void sobel_rgb_reference(const unsigned char* src, size_t src_stride, int channels,
+                         unsigned char* dst, size_t dst_stride, int width, int height)
+{
+    int color_channels = std::min(channels, 3);
+    for (int y = 0; y < height; ++y)
+    {
+        //GL_REPEAT, the row above the first one is the last one
+        const unsigned char* up = src + (size_t)((y + height - 1) % height) * src_stride;
+        const unsigned char* mid = src + (size_t)y * src_stride;
+        const unsigned char* down = src + (size_t)((y + 1) % height) * src_stride;
+        unsigned char* out = dst + (size_t)y * dst_stride;
+        for (int x = 0; x < width; ++x)
+        {
+            int left = ((x + width - 1) % width) * channels;
+            int center = x * channels;
+            int right = ((x + 1) % width) * channels;
+            float gx_squared = 0.0f, gy_squared = 0.0f;
+            for (int c = 0; c < color_channels; ++c)
+            {
+                float gx = (float)(up[right + c] + 2 * mid[right + c] + down[right + c] - up[left + c] - 2 * mid[left + c] - down[left + c]);
+                float gy = (float)(down[left + c] + 2 * down[center + c] + down[right + c] - up[left + c] - 2 * up[center + c] - up[right + c]);
+                gx_squared += gx * gx;
+                gy_squared += gy * gy;
+            }
+            float magnitude = std::sqrt(gx_squared) + std::sqrt(gy_squared);
+            out[x] = (unsigned char)std::min(255.0f, magnitude + 0.5f);
+        }
+    }
+}
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Image.h"
+#include "SubpixelEdges.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SEVENGER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+const int* subpixel_atan_table()
+{
+    static const std::vector<int> table = []
+    {
+        std::vector<int> turns(257);
+        for (int i = 0; i <= 256; ++i)
+            turns[i] = (int)std::lround(std::atan(i / 256.0) * 256.0 / (2.0 * 3.14159265358979323846));
+        return turns;
+    }();
+    return table.data();
+}
+
+//gx, gy and the unclamped magnitude of one row, columns [x_begin, x_end) with clamped neighbours
+template <int A, int B, int SHIFT>
+static void gradient_terms_row_scalar(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                                      int16_t* gx_out, int16_t* gy_out, int16_t* magnitude_out, int x_begin, int x_end, int width)
+{
+    for (int x = x_begin; x < x_end; ++x)
+    {
+        int l = x > 0 ? x - 1 : 0;
+        int r = x < width - 1 ? x + 1 : width - 1;
+        int gx = A * (up[r] - up[l]) + B * (mid[r] - mid[l]) + A * (down[r] - down[l]);
+        int gy = (A * down[l] + B * down[x] + A * down[r]) - (A * up[l] + B * up[x] + A * up[r]);
+        gx_out[x] = (int16_t)gx;
+        gy_out[x] = (int16_t)gy;
+        magnitude_out[x] = (int16_t)((std::abs(gx) + std::abs(gy)) >> SHIFT);
+    }
+}
+
+#ifdef SEVENGER_SSE2
+
+static inline __m128i abs_epi16(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+//A * (l + r) + B * c
+template <int A, int B>
+static inline __m128i weighted_sum_epi16(__m128i l, __m128i c, __m128i r)
+{
+    if constexpr (A == 1 && B == 2)
+        return _mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(c, c));
+    else if constexpr (A == 1 && B == 1)
+        return _mm_add_epi16(_mm_add_epi16(l, r), c);
+    else
+        return _mm_add_epi16(_mm_mullo_epi16(_mm_add_epi16(l, r), _mm_set1_epi16(A)), _mm_mullo_epi16(c, _mm_set1_epi16(B)));
+}
+
+static inline __m128i load_epi16(const unsigned char* p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+
+//eight pixels in 16-bit lanes, |gx| and |gy| stay below 16 * 255 (Scharr)
+template <int A, int B, int SHIFT>
+static void gradient_terms_row_sse2(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                                    int16_t* gx_out, int16_t* gy_out, int16_t* magnitude_out, int x_begin, int x_end, int width)
+{
+    //borders and the tail go through the scalar path, x + 8 must stay inside the row for the right neighbours
+    int x = std::max(x_begin, 1);
+    gradient_terms_row_scalar<A, B, SHIFT>(up, mid, down, gx_out, gy_out, magnitude_out, x_begin, std::min(x, x_end), width);
+    for (; x + 8 < width && x + 8 <= x_end; x += 8)
+    {
+        __m128i u_l = load_epi16(up + x - 1), u_c = load_epi16(up + x), u_r = load_epi16(up + x + 1);
+        __m128i m_l = load_epi16(mid + x - 1), m_r = load_epi16(mid + x + 1);
+        __m128i d_l = load_epi16(down + x - 1), d_c = load_epi16(down + x), d_r = load_epi16(down + x + 1);
+
+        __m128i gx = weighted_sum_epi16<A, B>(_mm_sub_epi16(u_r, u_l), _mm_sub_epi16(m_r, m_l), _mm_sub_epi16(d_r, d_l));
+        __m128i gy = _mm_sub_epi16(weighted_sum_epi16<A, B>(d_l, d_c, d_r), weighted_sum_epi16<A, B>(u_l, u_c, u_r));
+        __m128i magnitude = _mm_add_epi16(abs_epi16(gx), abs_epi16(gy));
+        if constexpr (SHIFT > 0)
+            magnitude = _mm_srli_epi16(magnitude, SHIFT);
+        _mm_storeu_si128((__m128i*)(gx_out + x), gx);
+        _mm_storeu_si128((__m128i*)(gy_out + x), gy);
+        _mm_storeu_si128((__m128i*)(magnitude_out + x), magnitude);
+    }
+    gradient_terms_row_scalar<A, B, SHIFT>(up, mid, down, gx_out, gy_out, magnitude_out, x, x_end, width);
+}
+
+#endif
+
+using GradientTermsRow = void (*)(const unsigned char* up, const unsigned char* mid, const unsigned char* down,
+                                  int16_t* gx_out, int16_t* gy_out, int16_t* magnitude_out, int x_begin, int x_end, int width);
+
+//the SIMD rows fall back to the scalar ones without SSE2
+static GradientTermsRow gradient_terms_row(GradientKernel kernel, bool simd)
+{
+#ifdef SEVENGER_SSE2
+    if (simd)
+    {
+        switch (kernel)
+        {
+        case GradientKernel::PREWITT:
+            return gradient_terms_row_sse2<1, 1, 0>;
+        case GradientKernel::SCHARR:
+            return gradient_terms_row_sse2<3, 10, 2>;
+        default:
+            return gradient_terms_row_sse2<1, 2, 0>;
+        }
+    }
+#endif
+    switch (kernel)
+    {
+    case GradientKernel::PREWITT:
+        return gradient_terms_row_scalar<1, 1, 0>;
+    case GradientKernel::SCHARR:
+        return gradient_terms_row_scalar<3, 10, 2>;
+    default:
+        return gradient_terms_row_scalar<1, 2, 0>;
+    }
+}
+
+//0 to 255 turns, integer ratios into the table so edge_detection_subpixel.fs gets the same answer
+static inline int direction_turns(int gx, int gy, const int* atan_table)
+{
+    int ax = std::abs(gx), ay = std::abs(gy);
+    if (ax == 0 && ay == 0)
+        return 0;
+    int angle = ax >= ay ? atan_table[(ay * 256 + ax / 2) / ax] : 64 - atan_table[(ax * 256 + ay / 2) / ay];
+    if (gx < 0)
+        angle = 128 - angle;
+    if (gy < 0)
+        angle = 256 - angle;
+    return angle & 255;
+}
+
+struct GradientTerms
+{
+    const int16_t* gx;
+    const int16_t* gy;
+    const int16_t* magnitude;
+};
+
+//columns [x_begin, x_end) of one output row
+static void subpixel_row_scalar(const GradientTerms& up, const GradientTerms& mid, const GradientTerms& down, unsigned char* out,
+                                int x_begin, int x_end, int width, int low_threshold, int high_threshold, const int* atan_table)
+{
+    out += 4 * x_begin;
+    for (int x = x_begin; x < x_end; ++x, out += 4)
+    {
+        int magnitude = mid.magnitude[x];
+        int edge = std::min(magnitude, 255);
+        edge = edge < low_threshold ? 0 : (edge >= high_threshold ? 255 : edge);
+        if (edge == 0)
+        {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            continue;
+        }
+
+        int gx = mid.gx[x], gy = mid.gy[x];
+        bool vertical = std::abs(gy) > std::abs(gx);
+        int before = vertical ? up.magnitude[x] : mid.magnitude[x > 0 ? x - 1 : 0];
+        int after = vertical ? down.magnitude[x] : mid.magnitude[x < width - 1 ? x + 1 : width - 1];
+        int flags = vertical ? SUBPIXEL_EDGE_VERTICAL : 0;
+        int offset = 0;
+        if (magnitude > before && magnitude >= after)
+        {
+            //peak of the parabola through (-1, before), (0, magnitude), (1, after) at rise / (2 * curvature),
+            //inside half a pixel since the middle is the largest
+            int curvature = 2 * magnitude - before - after;
+            int rise = after - before;
+            offset = (64 * std::abs(rise) + curvature / 2) / curvature;
+            offset = rise < 0 ? -offset : offset;
+            flags |= SUBPIXEL_EDGE_MAXIMUM;
+        }
+        out[0] = (unsigned char)edge;
+        out[1] = (unsigned char)direction_turns(gx, gy, atan_table);
+        out[2] = (unsigned char)(offset & 255);
+        out[3] = (unsigned char)flags;
+    }
+}
+
+#ifdef SEVENGER_SSE2
+
+//(a * scale + b) / c truncated, for non-negative 16-bit lanes; a * scale + b is exact in a float and the
+//quotients here stay at or below 256 with c below 8192, where a correctly rounded division never reaches
+//the next integer, so this is the integer division of the scalar path
+static inline __m128i scaled_quotient_epi16(__m128i a, float scale, __m128i b, __m128i c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128 s = _mm_set1_ps(scale);
+    __m128 low = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(a, zero)), s), _mm_cvtepi32_ps(_mm_unpacklo_epi16(b, zero))),
+                            _mm_cvtepi32_ps(_mm_unpacklo_epi16(c, zero)));
+    __m128 high = _mm_div_ps(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(a, zero)), s), _mm_cvtepi32_ps(_mm_unpackhi_epi16(b, zero))),
+                             _mm_cvtepi32_ps(_mm_unpackhi_epi16(c, zero)));
+    return _mm_packs_epi32(_mm_cvttps_epi32(low), _mm_cvttps_epi32(high));
+}
+
+static inline __m128i select_epi16(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+//subpixel_row_scalar on eight pixels at once, only the table lookups stay scalar
+static void subpixel_row_sse2(const GradientTerms& up, const GradientTerms& mid, const GradientTerms& down, unsigned char* out,
+                              int x_begin, int x_end, int width, int low_threshold, int high_threshold, const int* atan_table)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i byte_mask = _mm_set1_epi16(255);
+    const __m128i low = _mm_set1_epi16((short)low_threshold);
+    const __m128i high = _mm_set1_epi16((short)(high_threshold - 1));
+
+    //the first and last column clamp their neighbours, x + 8 must stay inside the row
+    int x = std::max(x_begin, 1);
+    subpixel_row_scalar(up, mid, down, out, x_begin, std::min(x, x_end), width, low_threshold, high_threshold, atan_table);
+    for (; x + 8 < width && x + 8 <= x_end; x += 8)
+    {
+        __m128i magnitude = _mm_loadu_si128((const __m128i*)(mid.magnitude + x));
+        __m128i edge = _mm_min_epi16(magnitude, byte_mask);
+        edge = _mm_andnot_si128(_mm_cmplt_epi16(edge, low), edge);
+        edge = select_epi16(_mm_cmpgt_epi16(edge, high), byte_mask, edge);
+        __m128i keep = _mm_xor_si128(_mm_cmpeq_epi16(edge, zero), _mm_set1_epi16(-1));
+        if (_mm_movemask_epi8(keep) == 0)
+        {
+            _mm_storeu_si128((__m128i*)(out + 4 * x), zero);
+            _mm_storeu_si128((__m128i*)(out + 4 * x + 16), zero);
+            continue;
+        }
+
+        __m128i gx = _mm_loadu_si128((const __m128i*)(mid.gx + x));
+        __m128i gy = _mm_loadu_si128((const __m128i*)(mid.gy + x));
+        __m128i ax = abs_epi16(gx), ay = abs_epi16(gy);
+        __m128i vertical = _mm_cmpgt_epi16(ay, ax);
+        __m128i before = select_epi16(vertical, _mm_loadu_si128((const __m128i*)(up.magnitude + x)), _mm_loadu_si128((const __m128i*)(mid.magnitude + x - 1)));
+        __m128i after = select_epi16(vertical, _mm_loadu_si128((const __m128i*)(down.magnitude + x)), _mm_loadu_si128((const __m128i*)(mid.magnitude + x + 1)));
+        __m128i maximum = _mm_andnot_si128(_mm_cmpgt_epi16(after, magnitude), _mm_cmpgt_epi16(magnitude, before));
+
+        __m128i curvature = _mm_sub_epi16(_mm_add_epi16(magnitude, magnitude), _mm_add_epi16(before, after));
+        curvature = select_epi16(maximum, curvature, one);
+        __m128i rise = _mm_sub_epi16(after, before);
+        __m128i offset = scaled_quotient_epi16(abs_epi16(rise), 64.0f, _mm_srli_epi16(curvature, 1), curvature);
+        offset = select_epi16(_mm_cmplt_epi16(rise, zero), _mm_sub_epi16(zero, offset), offset);
+        offset = _mm_and_si128(_mm_and_si128(offset, maximum), byte_mask);
+
+        __m128i larger = _mm_max_epi16(ax, ay), smaller = _mm_min_epi16(ax, ay);
+        __m128i index = scaled_quotient_epi16(smaller, 256.0f, _mm_srli_epi16(larger, 1), _mm_max_epi16(larger, one));
+        alignas(16) int16_t lanes[8];
+        _mm_store_si128((__m128i*)lanes, index);
+        for (int16_t& lane : lanes)
+            lane = (int16_t)atan_table[lane];
+        __m128i angle = _mm_load_si128((const __m128i*)lanes);
+        angle = select_epi16(vertical, _mm_sub_epi16(_mm_set1_epi16(64), angle), angle);
+        angle = select_epi16(_mm_cmplt_epi16(gx, zero), _mm_sub_epi16(_mm_set1_epi16(128), angle), angle);
+        angle = select_epi16(_mm_cmplt_epi16(gy, zero), _mm_sub_epi16(_mm_set1_epi16(256), angle), angle);
+        angle = _mm_and_si128(angle, byte_mask);
+
+        __m128i flags = _mm_or_si128(_mm_and_si128(vertical, _mm_set1_epi16(SUBPIXEL_EDGE_VERTICAL)), _mm_and_si128(maximum, one));
+
+        //edge | direction << 8 and offset | flags << 8 interleave to the 4 byte pixels
+        __m128i first = _mm_and_si128(_mm_or_si128(edge, _mm_slli_epi16(angle, 8)), keep);
+        __m128i second = _mm_and_si128(_mm_or_si128(offset, _mm_slli_epi16(flags, 8)), keep);
+        _mm_storeu_si128((__m128i*)(out + 4 * x), _mm_unpacklo_epi16(first, second));
+        _mm_storeu_si128((__m128i*)(out + 4 * x + 16), _mm_unpackhi_epi16(first, second));
+    }
+    subpixel_row_scalar(up, mid, down, out, x, x_end, width, low_threshold, high_threshold, atan_table);
+}
+
+#endif
+
+using SubpixelRow = void (*)(const GradientTerms& up, const GradientTerms& mid, const GradientTerms& down, unsigned char* out,
+                             int x_begin, int x_end, int width, int low_threshold, int high_threshold, const int* atan_table);
+
+static SubpixelRow subpixel_row(bool simd)
+{
+#ifdef SEVENGER_SSE2
+    if (simd)
+        return subpixel_row_sse2;
+#endif
+    return subpixel_row_scalar;
+}
+
+//rows [y0, y1), the gradients of three rows are kept in a ring so every row is computed once
+static void subpixel_rows(GradientTermsRow row, SubpixelRow output, const unsigned char* src, size_t src_stride,
+                          unsigned char* dst, size_t dst_stride, int width, int height, int y0, int y1,
+                          int low_threshold, int high_threshold)
+{
+    const int* atan_table = subpixel_atan_table();
+    std::vector<int16_t> buffer((size_t)width * 9);
+    GradientTerms ring[3];
+    auto compute = [&](int y, int slot)
+    {
+        y = std::clamp(y, 0, height - 1);
+        const unsigned char* up = src + (size_t)(y > 0 ? y - 1 : 0) * src_stride;
+        const unsigned char* mid = src + (size_t)y * src_stride;
+        const unsigned char* down = src + (size_t)(y < height - 1 ? y + 1 : height - 1) * src_stride;
+        int16_t* terms = buffer.data() + (size_t)slot * 3 * width;
+        row(up, mid, down, terms, terms + width, terms + 2 * width, 0, width, width);
+        ring[slot] = { terms, terms + width, terms + 2 * width };
+    };
+
+    compute(y0 - 1, 0);
+    compute(y0, 1);
+    for (int y = y0; y < y1; ++y)
+    {
+        int i = y - y0;
+        compute(y + 1, (i + 2) % 3);
+        output(ring[i % 3], ring[(i + 1) % 3], ring[(i + 2) % 3], dst + (size_t)y * dst_stride,
+               0, width, width, low_threshold, high_threshold, atan_table);
+    }
+}
+
+void subpixel_edges_u8_scalar(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                              unsigned char* dst, size_t dst_stride, int width, int height,
+                              int low_threshold, int high_threshold)
+{
+    subpixel_rows(gradient_terms_row(kernel, false), subpixel_row(false), src, src_stride, dst, dst_stride, width, height, 0, height,
+                  low_threshold, high_threshold);
+}
+
+void subpixel_edges_u8_simd(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                            unsigned char* dst, size_t dst_stride, int width, int height,
+                            int low_threshold, int high_threshold)
+{
+    subpixel_rows(gradient_terms_row(kernel, true), subpixel_row(true), src, src_stride, dst, dst_stride, width, height, 0, height,
+                  low_threshold, high_threshold);
+}
+
+void subpixel_edges_u8_threaded(GradientKernel kernel, const unsigned char* src, size_t src_stride,
+                                unsigned char* dst, size_t dst_stride, int width, int height,
+                                int low_threshold, int high_threshold, int thread_count)
+{
+    if (thread_count <= 0)
+        thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max(1, std::min(thread_count, height / 16));
+
+    //bands of whole rows, each computes the gradients of its two halo rows again
+    GradientTermsRow row = gradient_terms_row(kernel, true);
+    SubpixelRow output = subpixel_row(true);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+    {
+        int y0 = height * i / thread_count;
+        int y1 = height * (i + 1) / thread_count;
+        workers.emplace_back(subpixel_rows, row, output, src, src_stride, dst, dst_stride, width, height, y0, y1, low_threshold, high_threshold);
+    }
+    subpixel_rows(row, output, src, src_stride, dst, dst_stride, width, height, 0, height / thread_count, low_threshold, high_threshold);
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void subpixel_edge_points(const Image& edges, std::vector<SubpixelEdgePoint>& points)
+{
+    points.clear();
+    for (int y = 0; y < edges.height(); ++y)
+    {
+        const unsigned char* row = edges.row(y);
+        for (int x = 0; x < edges.width(); ++x, row += 4)
+        {
+            if (!(row[3] & SUBPIXEL_EDGE_MAXIMUM))
+                continue;
+            float offset = (float)(signed char)row[2] / 128.0f;
+            bool vertical = (row[3] & SUBPIXEL_EDGE_VERTICAL) != 0;
+            SubpixelEdgePoint point;
+            point.x = (float)x + (vertical ? 0.0f : offset);
+            point.y = (float)y + (vertical ? offset : 0.0f);
+            point.direction = (float)row[1] * (2.0f * 3.14159265f / 256.0f);
+            point.magnitude = row[0];
+            points.push_back(point);
+        }
+    }
+}
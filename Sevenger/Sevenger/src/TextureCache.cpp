@@ -0,0 +1,356 @@
+#include <stb_image.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "SobelCpu.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+
+static size_t align_offset(size_t offset)
+{
+    return (offset + 63) / 64 * 64;
+}
+
+static GLenum pixel_format(int channels)
+{
+    if (channels == 1)
+        return GL_RED;
+    else if (channels == 3)
+        return GL_RGB;
+    return GL_RGBA;
+}
+
+//2x2 box filter, odd edges reuse the last row/column like glGenerateMipmap implementations do
+static void downsample_2x2(const unsigned char* src, int width, int height, int channels, unsigned char* dst)
+{
+    int dst_width = std::max(1, width / 2);
+    int dst_height = std::max(1, height / 2);
+    for (int y = 0; y < dst_height; ++y)
+    {
+        const unsigned char* row0 = src + (size_t)std::min(2 * y, height - 1) * width * channels;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * channels;
+        unsigned char* out = dst + (size_t)y * dst_width * channels;
+        for (int x = 0; x < dst_width; ++x)
+        {
+            int x0 = std::min(2 * x, width - 1) * channels;
+            int x1 = std::min(2 * x + 1, width - 1) * channels;
+            for (int c = 0; c < channels; ++c)
+                out[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+static bool read_file(const char* path, std::vector<unsigned char>& bytes)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    std::streamsize size = file.tellg();
+    file.seekg(0);
+    bytes.resize((size_t)size);
+    return (bool)file.read((char*)bytes.data(), size);
+}
+
+uint64_t hash_bytes(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+TextureCache::TextureCache(const std::string& directory, uint32_t flags)
+    : directory(directory), flags(flags)
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+}
+
+//a level inside size bytes, at least as large as width x height needs; written so a corrupt
+//offset or size cannot overflow the compare
+static bool level_fits(const TextureCacheLevel& level, uint64_t needed, size_t size)
+{
+    return level.width <= 65536 && level.height <= 65536 && level.offset <= size &&
+           level.size <= size - level.offset && level.size >= needed;
+}
+
+bool cached_image_fits(const TextureCacheHeader& header, size_t size)
+{
+    if (size < sizeof(TextureCacheHeader) || std::memcmp(header.magic, "SVTC", 4) != 0 || header.version != TEXTURE_CACHE_VERSION ||
+        header.level_count == 0 || header.level_count > (uint32_t)TEXTURE_CACHE_MAX_LEVELS ||
+        header.channels == 0 || header.channels > 4)
+        return false;
+
+    for (uint32_t i = 0; i < header.level_count; ++i)
+    {
+        const TextureCacheLevel& level = header.levels[i];
+        uint64_t needed = header.format ? compressed_size(header.format, (int)std::min(level.width, 65536u), (int)std::min(level.height, 65536u))
+                                        : (uint64_t)level.width * level.height * header.channels;
+        if (!level_fits(level, needed, size))
+            return false;
+    }
+    return header.edges.size == 0 || level_fits(header.edges, (uint64_t)header.edges.width * header.edges.height, size);
+}
+
+bool TextureCache::validate(const CachedImage& image, uint64_t source_hash) const
+{
+    if (image.file.size() < sizeof(TextureCacheHeader))
+        return false;
+
+    const TextureCacheHeader* header = image.header;
+    return header->source_hash == source_hash && header->flags == flags && cached_image_fits(*header, image.file.size());
+}
+
+bool TextureCache::load(const char* path, CachedImage& image)
+{
+    std::vector<unsigned char> source;
+    if (!read_file(path, source))
+    {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return false;
+    }
+
+    uint64_t source_hash = hash_bytes(source.data(), source.size());
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%u.svtc", (unsigned long long)source_hash, flags);
+    std::string cache_path = (std::filesystem::path(directory) / name).string();
+
+    if (image.file.open(cache_path))
+    {
+        image.header = (const TextureCacheHeader*)image.file.data();
+        if (validate(image, source_hash))
+        {
+            ++hit_count;
+            return true;
+        }
+        image.file.close();
+    }
+
+    ++miss_count;
+    if (!build(source, source_hash, cache_path) || !image.file.open(cache_path))
+        return false;
+
+    image.header = (const TextureCacheHeader*)image.file.data();
+    return validate(image, source_hash);
+}
+
+bool encode_cached_image(const unsigned char* source, size_t source_size, uint64_t source_hash, uint32_t flags, std::vector<unsigned char>& blob)
+{
+    //same orientation as load_texture
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, channels;
+    unsigned char* data = stbi_load_from_memory(source, (int)source_size, &width, &height, &channels, 0);
+    if (data && channels == 2)
+    {
+        stbi_image_free(data);
+        data = stbi_load_from_memory(source, (int)source_size, &width, &height, &channels, 4);
+        channels = 4;
+    }
+    if (!data)
+        return false;
+
+    TextureCacheHeader header = {};
+    std::memcpy(header.magic, "SVTC", 4);
+    header.version = TEXTURE_CACHE_VERSION;
+    header.source_hash = source_hash;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.channels = (uint32_t)channels;
+    header.flags = flags;
+
+    //level 0 plus the box filtered chain down to 1x1
+    std::vector<std::vector<unsigned char>> levels;
+    levels.emplace_back(data, data + (size_t)width * height * channels);
+    stbi_image_free(data);
+
+    int level_width = width, level_height = height;
+    header.levels[0] = { 0, levels[0].size(), (uint32_t)width, (uint32_t)height };
+    while ((flags & TEXTURE_CACHE_MIPMAPS) && (level_width > 1 || level_height > 1) && levels.size() < (size_t)TEXTURE_CACHE_MAX_LEVELS)
+    {
+        int next_width = std::max(1, level_width / 2);
+        int next_height = std::max(1, level_height / 2);
+        std::vector<unsigned char> next((size_t)next_width * next_height * channels);
+        downsample_2x2(levels.back().data(), level_width, level_height, channels, next.data());
+        header.levels[levels.size()] = { 0, next.size(), (uint32_t)next_width, (uint32_t)next_height };
+        levels.push_back(std::move(next));
+        level_width = next_width;
+        level_height = next_height;
+    }
+    header.level_count = (uint32_t)levels.size();
+
+    std::vector<unsigned char> edges;
+    if (flags & TEXTURE_CACHE_EDGES)
+    {
+        std::vector<unsigned char> luma((size_t)width * height);
+        edges.resize(luma.size());
+        luma_u8(levels[0].data(), (size_t)width * channels, channels, luma.data(), width, width, height);
+        sobel_u8_simd(luma.data(), width, edges.data(), width, width, height);
+        header.edges = { 0, edges.size(), (uint32_t)width, (uint32_t)height };
+    }
+
+    //compress after the mips are filtered, every level is transcoded from the uncompressed one above it
+    if (flags & TEXTURE_CACHE_COMPRESSED)
+    {
+        header.format = compressed_format(channels);
+        for (size_t i = 0; i < levels.size(); ++i)
+        {
+            std::vector<unsigned char> blocks;
+            compress_image(header.format, levels[i].data(), (int)header.levels[i].width, (int)header.levels[i].height, channels, blocks);
+            header.levels[i].size = blocks.size();
+            levels[i] = std::move(blocks);
+        }
+    }
+
+    size_t offset = align_offset(sizeof(TextureCacheHeader));
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        header.levels[i].offset = offset;
+        offset = align_offset(offset + levels[i].size());
+    }
+    if (!edges.empty())
+    {
+        header.edges.offset = offset;
+        offset += edges.size();
+    }
+
+    blob.assign(offset, 0);
+    std::memcpy(blob.data(), &header, sizeof(header));
+    for (size_t i = 0; i < levels.size(); ++i)
+        std::memcpy(blob.data() + header.levels[i].offset, levels[i].data(), levels[i].size());
+    if (!edges.empty())
+        std::memcpy(blob.data() + header.edges.offset, edges.data(), edges.size());
+    return true;
+}
+
+bool TextureCache::build(const std::vector<unsigned char>& source, uint64_t source_hash, const std::string& cache_path)
+{
+    std::vector<unsigned char> blob;
+    if (!encode_cached_image(source.data(), source.size(), source_hash, flags, blob))
+    {
+        std::cout << "Failed to decode texture for cache: " << cache_path << std::endl;
+        return false;
+    }
+
+    //write next to the final name and rename, readers never see a partial file
+    std::string temp_path = cache_path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "Failed to write texture cache: " << temp_path << std::endl;
+        return false;
+    }
+    bool ok = std::fwrite(blob.data(), 1, blob.size(), file) == blob.size();
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(temp_path, cache_path, error);
+    if (!ok || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        std::cout << "Failed to write texture cache: " << cache_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+GLuint upload_cached_texture(const CachedImage& image)
+{
+    return upload_cached_texture(*image.header, image.file.data());
+}
+
+GLuint upload_cached_texture(const TextureCacheHeader& header, const unsigned char* base)
+{
+    GLenum format = pixel_format((int)header.channels);
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t i = 0; i < header.level_count; ++i)
+    {
+        const TextureCacheLevel& level = header.levels[i];
+        if (header.format)
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, header.format, (GLsizei)level.width, (GLsizei)level.height, 0, (GLsizei)level.size, base + level.offset);
+        else
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, (GLsizei)level.width, (GLsizei)level.height, 0, format, GL_UNSIGNED_BYTE, base + level.offset);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)header.level_count - 1);
+    if (header.level_count == 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture_id;
+}
+
+GLuint upload_cached_edges(const CachedImage& image)
+{
+    const unsigned char* edges = image.edges();
+    if (!edges)
+        return 0;
+
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, (GLsizei)image.header->edges.width, (GLsizei)image.header->edges.height, 0, GL_RED, GL_UNSIGNED_BYTE, edges);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture_id;
+}
+
+GLuint load_texture(const char* path)
+{
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+    if (data) {
+        GLenum format;
+        if (channels == 1)
+            format = GL_RED;
+        else if (channels == 3)
+            format = GL_RGB;
+        else if (channels == 4)
+            format = GL_RGBA;
+        else {
+            stbi_image_free(data);
+            return 0; 
+        }
+
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        stbi_image_free(data);
+        glBindTexture(GL_TEXTURE_2D, 0);  // Unbind the texture
+    }
+    else {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return 0;
+    }
+
+    return texture_id;
+}
+
+GLuint load_texture_cached(TextureCache& cache, const char* path)
+{
+    CachedImage image;
+    if (!cache.load(path, image))
+        return 0;
+    return upload_cached_texture(image);
+}
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include "TextureCompression.h"
+
+GLenum compressed_format(int channels)
+{
+    if (channels == 1)
+        return COMPRESSED_RED_BC4;
+    else if (channels == 3)
+        return COMPRESSED_RGB_BC1;
+    return COMPRESSED_RGBA_BC7;
+}
+
+size_t compressed_block_size(GLenum format)
+{
+    return format == COMPRESSED_RGBA_BC7 ? 16 : 8;
+}
+
+size_t compressed_size(GLenum format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * compressed_block_size(format);
+}
+
+bool compressed_formats_supported()
+{
+    bool s3tc = false, bptc = false;
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (GLint i = 0; i < extension_count; ++i)
+    {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (std::strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+            s3tc = true;
+        else if (std::strcmp(name, "GL_ARB_texture_compression_bptc") == 0)
+            bptc = true;
+    }
+
+    //RGTC is core since 3.0, BPTC since 4.2
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 2))
+        bptc = true;
+    return s3tc && bptc;
+}
+
+//16 texels as RGBA, gray is replicated and missing alpha is opaque
+static void load_block(const unsigned char* pixels, int width, int height, int channels, int block_x, int block_y, unsigned char texels[16][4])
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        int source_y = std::min(block_y * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x)
+        {
+            int source_x = std::min(block_x * 4 + x, width - 1);
+            const unsigned char* p = pixels + ((size_t)source_y * width + source_x) * channels;
+            unsigned char* texel = texels[y * 4 + x];
+            texel[0] = p[0];
+            texel[1] = channels >= 3 ? p[1] : p[0];
+            texel[2] = channels >= 3 ? p[2] : p[0];
+            texel[3] = channels == 4 ? p[3] : 255;
+        }
+    }
+}
+
+//endpoints at the extremes of the block along its principal axis, a few power iterations are plenty
+static void principal_endpoints(const unsigned char texels[16][4], int components, float low[4], float high[4])
+{
+    float mean[4] = {};
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < components; ++c)
+            mean[c] += texels[i][c] / 16.0f;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i)
+        for (int a = 0; a < components; ++a)
+            for (int b = 0; b < components; ++b)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int a = 0; a < components; ++a)
+        {
+            for (int b = 0; b < components; ++b)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length == 0.0f)
+            break;
+        for (int a = 0; a < components; ++a)
+            axis[a] = next[a] / length;
+    }
+
+    float min_t = 1e30f, max_t = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < components; ++c)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+
+    float axis_length = 0.0f;
+    for (int c = 0; c < components; ++c)
+        axis_length += axis[c] * axis[c];
+    if (axis_length == 0.0f)
+        axis_length = 1.0f;
+    for (int c = 0; c < components; ++c)
+    {
+        low[c] = std::clamp(mean[c] + axis[c] * min_t / axis_length, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * max_t / axis_length, 0.0f, 255.0f);
+    }
+}
+
+static int squared_error(const unsigned char* a, const int* b, int components)
+{
+    int error = 0;
+    for (int c = 0; c < components; ++c)
+        error += (a[c] - b[c]) * (a[c] - b[c]);
+    return error;
+}
+
+static uint16_t pack_565(const float color[3])
+{
+    int r = (int)std::lround(color[0] * 31.0f / 255.0f);
+    int g = (int)std::lround(color[1] * 63.0f / 255.0f);
+    int b = (int)std::lround(color[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+//least squares endpoints for fixed interpolation weights: minimizes sum |(1 - w) * e0 + w * e1 - texel|^2
+//returns false when every texel uses the same weight and the system is singular
+static bool refine_endpoints(const unsigned char texels[16][4], const float weight[16], int components, float e0[4], float e1[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        float a = 1.0f - weight[i], b = weight[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < components; ++c)
+        {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+    for (int c = 0; c < components; ++c)
+    {
+        e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+        e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+//encodes one BC1 block from float endpoints, returns the squared error and the weight each texel got
+static int encode_bc1_block(const unsigned char texels[16][4], const float high[4], const float low[4], unsigned char* block, float weight[16])
+{
+    static const float palette_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    uint16_t color0 = pack_565(high), color1 = pack_565(low);
+    bool swapped = color0 < color1;
+    if (swapped)
+        std::swap(color0, color1);
+
+    int palette[4][3];
+    unpack_565(color0, palette[0]);
+    unpack_565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    //color0 > color1 selects the four color mode, equal endpoints use index 0 everywhere
+    uint32_t indices = 0;
+    int total_error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, best_error = squared_error(texels[i], palette[0], 3);
+        for (int p = 1; p < 4 && color0 != color1; ++p)
+        {
+            int error = squared_error(texels[i], palette[p], 3);
+            if (error < best_error)
+            {
+                best = p;
+                best_error = error;
+            }
+        }
+        indices |= (uint32_t)best << (2 * i);
+        total_error += best_error;
+        weight[i] = swapped ? palette_weights[best] : 1.0f - palette_weights[best];
+    }
+
+    block[0] = (unsigned char)(color0 & 0xFF);
+    block[1] = (unsigned char)(color0 >> 8);
+    block[2] = (unsigned char)(color1 & 0xFF);
+    block[3] = (unsigned char)(color1 >> 8);
+    for (int i = 0; i < 4; ++i)
+        block[4 + i] = (unsigned char)(indices >> (8 * i));
+    return total_error;
+}
+
+static void compress_bc1_block(const unsigned char texels[16][4], unsigned char* block)
+{
+    //weights are measured from low (0) to high (1)
+    float low[4], high[4], weight[16];
+    principal_endpoints(texels, 3, low, high);
+    int error = encode_bc1_block(texels, high, low, block, weight);
+
+    //one refinement of the endpoints for the chosen indices, kept only if it helps
+    unsigned char refined[8];
+    if (error > 0 && refine_endpoints(texels, weight, 3, low, high) &&
+        encode_bc1_block(texels, high, low, refined, weight) < error)
+        std::memcpy(block, refined, sizeof(refined));
+}
+
+static void compress_bc4_block(const unsigned char texels[16][4], unsigned char* block)
+{
+    int red0 = 0, red1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        red0 = std::max(red0, (int)texels[i][0]);
+        red1 = std::min(red1, (int)texels[i][0]);
+    }
+
+    //red0 > red1 selects the eight value mode: red0, red1 and six interpolated values
+    int palette[8] = { red0, red1 };
+    for (int i = 2; i < 8; ++i)
+        palette[i] = ((8 - i) * red0 + (i - 1) * red1) / 7;
+
+    uint64_t indices = 0;
+    if (red0 != red1)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, best_error = 256;
+            for (int p = 0; p < 8; ++p)
+            {
+                int error = std::abs(texels[i][0] - palette[p]);
+                if (error < best_error)
+                {
+                    best = p;
+                    best_error = error;
+                }
+            }
+            indices |= (uint64_t)best << (3 * i);
+        }
+    }
+
+    block[0] = (unsigned char)red0;
+    block[1] = (unsigned char)red1;
+    for (int i = 0; i < 6; ++i)
+        block[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+//appends bits least significant first, the order every BC7 field is stored in
+struct BlockBitWriter
+{
+    unsigned char* block;
+    int position = 0;
+
+    void write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; ++i, ++position)
+        {
+            if (value & (1u << i))
+                block[position >> 3] |= (unsigned char)(1u << (position & 7));
+        }
+    }
+};
+
+//7 bits per component plus a shared p-bit, the p-bit that fits both endpoints best wins
+static void quantize_bc7_endpoint(const float endpoint[4], int quantized[4], int& p_bit)
+{
+    int best_error = 1 << 30;
+    for (int p = 0; p < 2; ++p)
+    {
+        int candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; ++c)
+        {
+            candidate[c] = std::clamp((int)std::lround((endpoint[c] - p) / 2.0f), 0, 127);
+            int decoded = (candidate[c] << 1) | p;
+            error += (decoded - (int)endpoint[c]) * (decoded - (int)endpoint[c]);
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            p_bit = p;
+            std::memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+//mode 6: one subset, RGBA 7.7.7.7 + p-bit endpoints, 4-bit indices
+//returns the squared error and the weight each texel got, measured from low (0) to high (1)
+static int encode_bc7_block(const unsigned char texels[16][4], const float low[4], const float high[4], unsigned char* block, float weight[16])
+{
+    static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    int endpoint[2][4], p_bit[2];
+    quantize_bc7_endpoint(low, endpoint[0], p_bit[0]);
+    quantize_bc7_endpoint(high, endpoint[1], p_bit[1]);
+
+    int palette[16][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        int e0 = (endpoint[0][c] << 1) | p_bit[0];
+        int e1 = (endpoint[1][c] << 1) | p_bit[1];
+        for (int i = 0; i < 16; ++i)
+            palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+    }
+
+    int indices[16];
+    int total_error = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        int best = 0, best_error = squared_error(texels[i], palette[0], 4);
+        for (int p = 1; p < 16; ++p)
+        {
+            int error = squared_error(texels[i], palette[p], 4);
+            if (error < best_error)
+            {
+                best = p;
+                best_error = error;
+            }
+        }
+        indices[i] = best;
+        total_error += best_error;
+        weight[i] = weights[best] / 64.0f;
+    }
+
+    //the anchor index is stored with 3 bits, so its top bit must be 0: swap endpoints if needed
+    if (indices[0] >= 8)
+    {
+        std::swap(endpoint[0], endpoint[1]);
+        std::swap(p_bit[0], p_bit[1]);
+        for (int i = 0; i < 16; ++i)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(block, 0, 16);
+    BlockBitWriter writer = { block };
+    writer.write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.write((uint32_t)endpoint[0][c], 7);
+        writer.write((uint32_t)endpoint[1][c], 7);
+    }
+    writer.write((uint32_t)p_bit[0], 1);
+    writer.write((uint32_t)p_bit[1], 1);
+    writer.write((uint32_t)indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+        writer.write((uint32_t)indices[i], 4);
+    return total_error;
+}
+
+static void compress_bc7_block(const unsigned char texels[16][4], unsigned char* block)
+{
+    float low[4], high[4], weight[16];
+    principal_endpoints(texels, 4, low, high);
+    int error = encode_bc7_block(texels, low, high, block, weight);
+
+    unsigned char refined[16];
+    if (error > 0 && refine_endpoints(texels, weight, 4, low, high) &&
+        encode_bc7_block(texels, low, high, refined, weight) < error)
+        std::memcpy(block, refined, sizeof(refined));
+}
+
+static void compress_rows(GLenum format, const unsigned char* pixels, int width, int height, int channels,
+                          unsigned char* blocks, int first_row, int last_row)
+{
+    int blocks_x = (width + 3) / 4;
+    size_t block_size = compressed_block_size(format);
+    unsigned char texels[16][4];
+    for (int block_y = first_row; block_y < last_row; ++block_y)
+    {
+        for (int block_x = 0; block_x < blocks_x; ++block_x)
+        {
+            unsigned char* block = blocks + ((size_t)block_y * blocks_x + block_x) * block_size;
+            load_block(pixels, width, height, channels, block_x, block_y, texels);
+            if (format == COMPRESSED_RED_BC4)
+                compress_bc4_block(texels, block);
+            else if (format == COMPRESSED_RGB_BC1)
+                compress_bc1_block(texels, block);
+            else
+                compress_bc7_block(texels, block);
+        }
+    }
+}
+
+void compress_image(GLenum format, const unsigned char* pixels, int width, int height, int channels, std::vector<unsigned char>& blocks)
+{
+    blocks.assign(compressed_size(format, width, height), 0);
+    int blocks_y = (height + 3) / 4;
+
+    //small mips are not worth a thread
+    int thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+    if ((size_t)width * height < 256 * 256)
+        thread_count = 1;
+    thread_count = std::min(thread_count, blocks_y);
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < thread_count; ++i)
+    {
+        workers.emplace_back(compress_rows, format, pixels, width, height, channels, blocks.data(),
+                             blocks_y * i / thread_count, blocks_y * (i + 1) / thread_count);
+    }
+    compress_rows(format, pixels, width, height, channels, blocks.data(), 0, blocks_y / thread_count);
+    for (std::thread& worker : workers)
+        worker.join();
+}
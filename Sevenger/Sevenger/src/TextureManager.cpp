@@ -0,0 +1,211 @@
+#include <iostream>
+#include "TextureManager.h"
+
+//the one the track_*_memory functions report to, GL memory belongs to the current context the same way
+static TextureManager* current_manager = nullptr;
+
+static size_t texel_bytes(GLint internal_format)
+{
+    switch (internal_format)
+    {
+    case GL_R8: case GL_R8UI: case GL_RED:
+        return 1;
+    case GL_RG8: case GL_RG8UI: case GL_R16F: case GL_R16UI: case GL_RG:
+        return 2;
+    case GL_RGBA16F: case GL_RG32F:
+        return 8;
+    case GL_RGBA32F: case GL_RGBA32UI:
+        return 16;
+    case GL_R32F: case GL_R32UI: case GL_RG16F:
+        return 4;
+    default:
+        //RGB8 is padded to 4 bytes by every driver we care about
+        return 4;
+    }
+}
+
+size_t texture_bytes(GLenum target, GLuint texture)
+{
+    GLint previous = 0;
+    glGetIntegerv(target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &previous);
+    glBindTexture(target, texture);
+
+    size_t bytes = 0;
+    for (GLint level = 0; level < 16; ++level)
+    {
+        GLint width = 0, height = 0, depth = 1, compressed = 0, internal_format = 0;
+        glGetTexLevelParameteriv(target, level, GL_TEXTURE_WIDTH, &width);
+        if (width == 0)
+            break;
+        glGetTexLevelParameteriv(target, level, GL_TEXTURE_HEIGHT, &height);
+        if (target == GL_TEXTURE_2D_ARRAY)
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_DEPTH, &depth);
+        glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED, &compressed);
+        if (compressed)
+        {
+            GLint size = 0;
+            glGetTexLevelParameteriv(target, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            bytes += (size_t)size;
+            continue;
+        }
+        glGetTexLevelParameteriv(target, level, GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+        bytes += (size_t)width * height * depth * texel_bytes(internal_format);
+    }
+
+    glBindTexture(target, (GLuint)previous);
+    return bytes;
+}
+
+TextureManager::TextureManager(size_t budget_bytes, TextureLoader loader)
+    : loader(std::move(loader))
+{
+    memory.budget_bytes = budget_bytes;
+}
+
+TextureManager::~TextureManager()
+{
+    if (current_manager == this)
+        current_manager = nullptr;
+    clear();
+}
+
+GLuint TextureManager::acquire(const std::string& path)
+{
+    auto found = entries.find(path);
+    if (found != entries.end())
+    {
+        ++memory.hits;
+        lru.splice(lru.begin(), lru, found->second.lru_position);
+        return found->second.texture;
+    }
+
+    GLuint texture = loader(path);
+    if (texture == 0)
+        return 0;
+
+    ++memory.loads;
+    lru.push_front(path);
+    Entry entry = { texture, texture_bytes(GL_TEXTURE_2D, texture), lru.begin() };
+    entries.emplace(path, entry);
+    memory.resident_bytes += entry.bytes;
+    memory.resident_count = entries.size();
+
+    evict_to_budget(path);
+    return texture;
+}
+
+void TextureManager::release(const std::string& path)
+{
+    auto found = entries.find(path);
+    if (found == entries.end())
+        return;
+
+    glDeleteTextures(1, &found->second.texture);
+    memory.resident_bytes -= found->second.bytes;
+    lru.erase(found->second.lru_position);
+    entries.erase(found);
+    memory.resident_count = entries.size();
+}
+
+void TextureManager::clear()
+{
+    for (auto& [path, entry] : entries)
+        glDeleteTextures(1, &entry.texture);
+    entries.clear();
+    lru.clear();
+    memory.resident_bytes = 0;
+    memory.resident_count = 0;
+}
+
+void TextureManager::track(GLenum target, GLuint texture)
+{
+    if (texture == 0)
+        return;
+
+    untrack(texture);
+    size_t bytes = texture_bytes(target, texture);
+    pinned[texture] = bytes;
+    memory.pinned_bytes += bytes;
+    memory.pinned_count = pinned.size() + pinned_buffers.size();
+}
+
+void TextureManager::untrack(GLuint texture)
+{
+    auto found = pinned.find(texture);
+    if (found == pinned.end())
+        return;
+
+    memory.pinned_bytes -= found->second;
+    pinned.erase(found);
+    memory.pinned_count = pinned.size() + pinned_buffers.size();
+}
+
+void TextureManager::track_buffer(GLuint buffer, size_t bytes)
+{
+    if (buffer == 0)
+        return;
+
+    untrack_buffer(buffer);
+    pinned_buffers[buffer] = bytes;
+    memory.pinned_bytes += bytes;
+    memory.pinned_count = pinned.size() + pinned_buffers.size();
+}
+
+void TextureManager::untrack_buffer(GLuint buffer)
+{
+    auto found = pinned_buffers.find(buffer);
+    if (found == pinned_buffers.end())
+        return;
+
+    memory.pinned_bytes -= found->second;
+    pinned_buffers.erase(found);
+    memory.pinned_count = pinned.size() + pinned_buffers.size();
+}
+
+void TextureManager::make_current()
+{
+    current_manager = this;
+}
+
+void TextureManager::set_budget(size_t budget_bytes)
+{
+    memory.budget_bytes = budget_bytes;
+    evict_to_budget(std::string());
+}
+
+void TextureManager::evict_to_budget(const std::string& keep)
+{
+    //the texture being acquired always stays, even if it alone is over budget
+    while (memory.resident_bytes + memory.pinned_bytes > memory.budget_bytes && !lru.empty() && lru.back() != keep)
+    {
+        ++memory.evictions;
+        release(lru.back());
+    }
+
+    if (memory.resident_bytes + memory.pinned_bytes > memory.budget_bytes && !keep.empty())
+        std::cout << "WARNING: TEXTURE BUDGET EXCEEDED BY " << keep << std::endl;
+}
+
+void track_texture_memory(GLenum target, GLuint texture)
+{
+    if (current_manager)
+        current_manager->track(target, texture);
+}
+
+void untrack_texture_memory(GLuint texture)
+{
+    if (current_manager)
+        current_manager->untrack(texture);
+}
+
+void track_buffer_memory(GLuint buffer, size_t bytes)
+{
+    if (current_manager)
+        current_manager->track_buffer(buffer, bytes);
+}
+
+void untrack_buffer_memory(GLuint buffer)
+{
+    if (current_manager)
+        current_manager->untrack_buffer(buffer);
+}
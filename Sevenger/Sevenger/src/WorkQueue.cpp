@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "WorkQueue.h"
+
+constexpr const char* WORK_QUEUE_MAGIC = "sevenger-job 1";
+
+static size_t count_markers(const std::string& directory)
+{
+    std::error_code error;
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.path().extension() != ".tmp")
+            ++count;
+    }
+    return count;
+}
+
+//write next to the final name and rename, other workers never see a partial file
+static bool write_file_atomically(const std::string& path, const std::string& contents)
+{
+    std::string temp_path = path + ".tmp";
+    std::FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    ok = std::fclose(file) == 0 && ok;
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(temp_path, path, error);
+    if (!ok || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
+
+bool WorkQueue::create(const std::string& directory, const std::vector<std::string>& items, size_t chunk_size,
+                       const std::string& settings)
+{
+    std::error_code error;
+    std::string job_path = (std::filesystem::path(directory) / "job.txt").string();
+    if (std::filesystem::exists(job_path, error))
+    {
+        std::cout << "ERROR: " << directory << " ALREADY HOLDS A JOB" << std::endl;
+        return false;
+    }
+    if (items.empty() || chunk_size == 0 || settings.find('\n') != std::string::npos)
+        return false;
+
+    std::filesystem::create_directories(std::filesystem::path(directory) / "claims", error);
+    std::filesystem::create_directories(std::filesystem::path(directory) / "done", error);
+
+    std::string contents = std::string(WORK_QUEUE_MAGIC) + "\nsettings " + settings + "\nchunk " + std::to_string(chunk_size) +
+                           "\nitems " + std::to_string(items.size()) + "\n";
+    for (const std::string& item : items)
+        contents += item + "\n";
+    if (error || !write_file_atomically(job_path, contents))
+    {
+        std::cout << "Failed to write job: " << job_path << std::endl;
+        return false;
+    }
+    return open(directory);
+}
+
+bool WorkQueue::open(const std::string& directory)
+{
+    std::string job_path = (std::filesystem::path(directory) / "job.txt").string();
+    std::ifstream file(job_path);
+    if (!file)
+    {
+        std::cout << "Failed to open job: " << job_path << std::endl;
+        return false;
+    }
+
+    std::string magic, settings_line, chunk_line, items_line;
+    std::getline(file, magic);
+    std::getline(file, settings_line);
+    std::getline(file, chunk_line);
+    std::getline(file, items_line);
+    size_t count = 0;
+    bool ok = magic == WORK_QUEUE_MAGIC && settings_line.rfind("settings ", 0) == 0 &&
+              std::sscanf(chunk_line.c_str(), "chunk %zu", &chunk_size) == 1 && chunk_size > 0 &&
+              std::sscanf(items_line.c_str(), "items %zu", &count) == 1;
+    items.clear();
+    for (std::string item; ok && items.size() < count && std::getline(file, item);)
+        items.push_back(item);
+    if (!ok || items.size() != count || count == 0)
+    {
+        std::cout << "ERROR: INVALID JOB FILE: " << job_path << std::endl;
+        items.clear();
+        return false;
+    }
+
+    job_directory = directory;
+    job_settings = settings_line.substr(9);
+    next_chunk = 0;
+    return true;
+}
+
+void WorkQueue::chunk_items(size_t chunk, size_t& first, size_t& last) const
+{
+    first = std::min(chunk * chunk_size, items.size());
+    last = std::min(first + chunk_size, items.size());
+}
+
+std::string WorkQueue::claim_path(size_t chunk) const
+{
+    return (std::filesystem::path(job_directory) / "claims" / std::to_string(chunk)).string();
+}
+
+std::string WorkQueue::done_path(size_t chunk) const
+{
+    return (std::filesystem::path(job_directory) / "done" / std::to_string(chunk)).string();
+}
+
+bool WorkQueue::claim(const std::string& worker, size_t& chunk)
+{
+    //exclusive creation decides between workers racing for the same chunk; claims stay after
+    //completion, so finished chunks fail the same way; a second pass from the start picks up
+    //chunks that were released behind this worker's position
+    size_t count = chunk_count();
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        for (; next_chunk < count; ++next_chunk)
+        {
+            std::FILE* file = std::fopen(claim_path(next_chunk).c_str(), "wx");
+            if (!file)
+                continue;
+            std::fputs(worker.c_str(), file);
+            std::fclose(file);
+            chunk = next_chunk++;
+            return true;
+        }
+        next_chunk = 0;
+    }
+    next_chunk = count;
+    return false;
+}
+
+bool WorkQueue::complete(size_t chunk, const ChunkResult& result)
+{
+    char line[128];
+    std::snprintf(line, sizeof(line), " %zu %zu %.3f\n", result.processed, result.failed, result.seconds);
+    if (!write_file_atomically(done_path(chunk), result.worker + line))
+    {
+        std::cout << "Failed to mark chunk " << chunk << " done in " << job_directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WorkQueue::is_complete(size_t chunk) const
+{
+    std::error_code error;
+    return std::filesystem::exists(done_path(chunk), error);
+}
+
+bool WorkQueue::read_result(size_t chunk, ChunkResult& result) const
+{
+    std::ifstream file(done_path(chunk));
+    return (bool)(file >> result.worker >> result.processed >> result.failed >> result.seconds);
+}
+
+size_t WorkQueue::release_unfinished(const std::string& worker)
+{
+    size_t released = 0;
+    for (size_t chunk = 0; chunk < chunk_count(); ++chunk)
+    {
+        std::string path = claim_path(chunk);
+        std::ifstream file(path);
+        std::string owner;
+        if (!file || is_complete(chunk))
+            continue;
+        std::getline(file, owner);
+        file.close();
+
+        std::error_code error;
+        if ((worker.empty() || owner == worker) && std::filesystem::remove(path, error))
+            ++released;
+    }
+    return released;
+}
+
+size_t WorkQueue::completed_count() const
+{
+    return count_markers((std::filesystem::path(job_directory) / "done").string());
+}
+
+size_t WorkQueue::unclaimed_count() const
+{
+    size_t claimed = count_markers((std::filesystem::path(job_directory) / "claims").string());
+    return chunk_count() - std::min(claimed, chunk_count());
+}
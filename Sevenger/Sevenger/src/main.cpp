@@ -4,11 +4,34 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
 #include "Shader.h"
+#include "AssetPack.h"
+#include "BinaryEdges.h"
+#include "BinaryEdgeTexture.h"
+#include "ContactSheet.h"
+#include "EdgeDetector.h"
+#include "FramePipeline.h"
+#include "Image.h"
+#include "Smoothing.h"
+#include "SmoothingPass.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include "TextureManager.h"
 
 GLint SCREEN_WIDTH = 800;
 GLint SCREEN_HEIGHT = 600;
 bool detection_on = false;
+bool contact_sheet_on = false;
+int texture_step = 0;
+bool multiscale_on = false;
 
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -21,45 +44,342 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     {
         detection_on = !detection_on;
     }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS)
+    {
+        contact_sheet_on = !contact_sheet_on;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+    {
+        multiscale_on = !multiscale_on;
+    }
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
+    {
+        ++texture_step;
+    }
 }
 
-GLuint load_texture(const char* path) 
+struct Options
 {
-    GLuint texture_id;
-    glGenTextures(1, &texture_id);
-    int width, height, channels;
+    std::string sequence_pattern;
+    std::string raw_path;
+    std::string raw_format_name = "rgb24";
+    int raw_width = 0;
+    int raw_height = 0;
+    bool raw_loop = false;
+    std::string output_pattern;
+    FramePipelineConfig pipeline;
+    bool use_cache = true;
+    std::string cache_directory = "cache";
+    uint32_t cache_flags = TEXTURE_CACHE_MIPMAPS;
+    std::string pack_path;
+    std::string build_pack_path;
+    int contact_sheet_cells = 0;
+    size_t vram_budget_mb = 256;
+    int multiscale_base = 0;
+    int multiscale_levels = 3;
+    int synthetic_frames = 0;
+    bool use_edge_detector = false;
+    bool edge_binary = false;
+    EdgeDetectorConfig edge_detector;
+};
+
+void print_usage()
+{
+    std::cout << "usage: Sevenger [options]\n"
+              << "  --sequence <pattern>     numbered images, e.g. frames/frame_%04d.png\n"
+              << "  --raw <file>             raw frames, needs --raw-size and --raw-format\n"
+              << "  --raw-size <WxH>         size of one raw frame\n"
+              << "  --raw-format <format>    gray8, rgb24, rgba32 or yuv420p\n"
+              << "  --synthetic <frames>     sprite moving over a static bundled texture\n"
+              << "  --loop                   restart the raw file when it ends\n"
+              << "  --queue-depth <n>        frames buffered between pipeline stages (default 3)\n"
+              << "  --fps <rate>             pace the source like a camera\n"
+              << "  --drop                   drop the oldest frame instead of stalling the source\n"
+              << "  --output <pattern>       write RGBA edge maps, e.g. out/edge_%04d.rgba\n"
+              << "  --compress               store cached textures BC1/BC4/BC7 compressed\n"
+              << "  --no-cache               decode textures on every launch\n"
+              << "  --cache-dir <dir>        texture cache location (default cache)\n"
+              << "  --cache-edges            also store precomputed edge maps in the cache\n"
+              << "  --pack <file>            load shaders and textures from an asset pack\n"
+              << "  --build-pack <file>      pack everything under assets/ into <file> and exit\n"
+              << "  --contact-sheet <n>      start in contact sheet mode (key C) with n cells\n"
+              << "  --vram-budget <MB>       texture memory budget, least recently used textures are evicted (default 256)\n"
+              << "  --multiscale <levels>    start with multi-scale edges (key M) over this many mip levels (default 3)\n"
+              << "  --multiscale-base <n>    finest mip level of the multi-scale edges (default 0)\n"
+              << "  --edge-backend <name>    fixed-point edges of the static texture with auto, scalar, simd, threaded or gl\n"
+              << "  --edge-kernel <name>     sobel, prewitt or scharr for --edge-backend (default sobel)\n"
+              << "  --edge-channels <mode>   luma, or max for the strongest edge of R, G and B (default luma)\n"
+              << "  --edge-thresholds <l,h>  magnitudes below l become 0, at or above h 255 (default 0,255)\n"
+              << "  --edge-binary            keep those edges at one bit per pixel, expanded on the GPU while drawing\n"
+              << "  --edge-adaptive <r,o>    edges are magnitudes at least o above the mean of a (2r+1)^2 window\n"
+              << "  --smooth <filter>        gaussian, box or deriche smoothing before the edges, GPU or edge library (default none)\n"
+              << "  --smooth-sigma <px>      sigma of --smooth (default 1.5), up to 64; the GPU clamps gaussian to 21 and\n"
+              << "                           deriche to 13.6 (its kernel radius limit), the edge library and box take any\n"
+              << "                           sigma up to 64\n";
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sequence" && has_value)
+            options.sequence_pattern = argv[++i];
+        else if (arg == "--raw" && has_value)
+            options.raw_path = argv[++i];
+        else if (arg == "--raw-size" && has_value)
+            std::sscanf(argv[++i], "%dx%d", &options.raw_width, &options.raw_height);
+        else if (arg == "--raw-format" && has_value)
+            options.raw_format_name = argv[++i];
+        else if (arg == "--synthetic" && has_value)
+            options.synthetic_frames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--loop")
+            options.raw_loop = true;
+        else if (arg == "--queue-depth" && has_value)
+            options.pipeline.queue_depth = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--fps" && has_value)
+            options.pipeline.source_fps = std::atof(argv[++i]);
+        else if (arg == "--drop")
+            options.pipeline.drop_when_full = true;
+        else if (arg == "--output" && has_value)
+            options.output_pattern = argv[++i];
+        else if (arg == "--compress")
+            options.cache_flags |= TEXTURE_CACHE_COMPRESSED;
+        else if (arg == "--no-cache")
+            options.use_cache = false;
+        else if (arg == "--cache-dir" && has_value)
+            options.cache_directory = argv[++i];
+        else if (arg == "--cache-edges")
+            options.cache_flags |= TEXTURE_CACHE_EDGES;
+        else if (arg == "--pack" && has_value)
+            options.pack_path = argv[++i];
+        else if (arg == "--build-pack" && has_value)
+            options.build_pack_path = argv[++i];
+        else if (arg == "--contact-sheet" && has_value)
+        {
+            options.contact_sheet_cells = std::max(1, std::atoi(argv[++i]));
+            contact_sheet_on = true;
+        }
+        else if (arg == "--multiscale" && has_value)
+        {
+            options.multiscale_levels = std::clamp(std::atoi(argv[++i]), 1, 8);
+            multiscale_on = true;
+        }
+        else if (arg == "--multiscale-base" && has_value)
+            options.multiscale_base = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--vram-budget" && has_value)
+            options.vram_budget_mb = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--edge-backend" && has_value && parse_edge_backend(argv[i + 1], options.edge_detector.backend))
+        {
+            options.use_edge_detector = true;
+            ++i;
+        }
+        else if (arg == "--edge-kernel" && has_value && parse_gradient_kernel(argv[i + 1], options.edge_detector.kernel))
+        {
+            options.use_edge_detector = true;
+            ++i;
+        }
+        else if (arg == "--edge-channels" && has_value)
+        {
+            std::string mode = argv[++i];
+            if (mode != "luma" && mode != "max")
+            {
+                print_usage();
+                return false;
+            }
+            options.edge_detector.channels = mode == "max" ? EdgeChannels::MAX : EdgeChannels::LUMA;
+            options.use_edge_detector = true;
+        }
+        else if (arg == "--edge-thresholds" && has_value)
+        {
+            int low = 0, high = 255;
+            std::sscanf(argv[++i], "%d,%d", &low, &high);
+            options.edge_detector.low_threshold = std::clamp(low, 0, 255);
+            options.edge_detector.high_threshold = std::clamp(high, options.edge_detector.low_threshold, 255);
+            options.use_edge_detector = true;
+        }
+        else if (arg == "--edge-binary")
+        {
+            options.edge_binary = true;
+            options.use_edge_detector = true;
+        }
+        else if (arg == "--edge-adaptive" && has_value)
+        {
+            int radius = 7, offset = 8;
+            std::sscanf(argv[++i], "%d,%d", &radius, &offset);
+            options.edge_detector.adaptive_threshold = true;
+            options.edge_detector.adaptive.radius = std::clamp(radius, 0, ADAPTIVE_THRESHOLD_MAX_RADIUS);
+            options.edge_detector.adaptive.offset = std::clamp(offset, -255, 255);
+            options.use_edge_detector = true;
+        }
+        else if (arg == "--smooth" && has_value && parse_smoothing_filter(argv[i + 1], options.edge_detector.smoothing))
+            ++i;
+        else if (arg == "--smooth-sigma" && has_value)
+            options.edge_detector.smoothing_sigma = std::clamp((float)std::atof(argv[++i]), 0.0f, SMOOTHING_MAX_SIGMA);
+        else
+        {
+            print_usage();
+            return false;
+        }
+    }
+
+    //only the GPU smoothing of the static texture is limited, the edge library smooths at any sigma
+    float gl_sigma = smoothing_gl_max_sigma(options.edge_detector.smoothing);
+    if (!options.use_edge_detector && options.edge_detector.smoothing_sigma > gl_sigma)
+        std::cout << "WARNING: --smooth-sigma " << options.edge_detector.smoothing_sigma << " IS CLAMPED TO " << gl_sigma << " ON THE GPU" << std::endl;
+    return true;
+}
+
+std::unique_ptr<FramePipeline> create_pipeline(const Options& options, Shader& edge_detection)
+{
+    std::unique_ptr<FrameSource> source;
+    if (!options.sequence_pattern.empty())
+    {
+        source = std::make_unique<ImageSequenceSource>(options.sequence_pattern);
+    }
+    else if (!options.raw_path.empty())
+    {
+        RawFormat raw_format;
+        if (!parse_raw_format(options.raw_format_name, raw_format) || options.raw_width <= 0 || options.raw_height <= 0)
+        {
+            print_usage();
+            return nullptr;
+        }
+        source = std::make_unique<RawFrameSource>(options.raw_path, options.raw_width, options.raw_height, raw_format, options.raw_loop);
+    }
+    else if (options.synthetic_frames > 0)
+    {
+        source = std::make_unique<SyntheticSequenceSource>("assets/textures/world_map.png", "assets/textures/awesomeface.png", options.synthetic_frames);
+    }
+    else
+    {
+        return nullptr;
+    }
+
+    FramePipeline::FrameSink sink;
+    if (!options.output_pattern.empty())
+    {
+        sink = [output_pattern = options.output_pattern](const Frame& frame)
+        {
+            char path[1024];
+            std::snprintf(path, sizeof(path), output_pattern.c_str(), frame.index);
+            if (std::FILE* file = std::fopen(path, "wb"))
+            {
+                std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), file);
+                std::fclose(file);
+            }
+        };
+    }
+
+    return std::make_unique<FramePipeline>(std::move(source), edge_detection, options.pipeline, std::move(sink));
+}
+
+void print_pipeline_metrics(const FramePipelineMetrics& metrics)
+{
+    std::cout << "frames decoded: " << metrics.frames_decoded
+              << ", completed: " << metrics.frames_completed
+              << ", dropped: " << metrics.frames_dropped << "\n"
+              << "latency ms: mean " << metrics.latency_mean_ms
+              << ", p50 " << metrics.latency_p50_ms
+              << ", p95 " << metrics.latency_p95_ms
+              << ", p99 " << metrics.latency_p99_ms
+              << ", max " << metrics.latency_max_ms << "\n"
+              << "throughput: " << metrics.throughput_fps << " fps over " << metrics.elapsed_seconds << " s" << std::endl;
+}
+
+std::vector<std::string> bundled_textures()
+{
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator("assets/textures"))
+    {
+        if (entry.path().extension() == ".png")
+            paths.push_back(entry.path().generic_string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+//every bundled texture as one layer, taken from the pack or the cache so no full size decode is repeated
+//thumbnails are resampled on the CPU, so the cache must hold uncompressed levels
+void build_contact_sheet(ContactSheet& sheet, const AssetPack& pack, const std::string& cache_directory)
+{
+    TextureCache cache(cache_directory);
+    for (const std::string& path : bundled_textures())
+    {
+        AssetView view;
+        CachedImage image;
+        if (pack.is_open() && pack.find(path, view) && view.kind == AssetKind::IMAGE)
+            sheet.add_cached_image(*(const TextureCacheHeader*)view.data, view.data);
+        else if (cache.load(path.c_str(), image))
+            sheet.add_cached_image(*image.header, image.file.data());
+    }
+    sheet.upload();
+}
+
+//--edge-backend view of a static texture: the fixed-point edges come from EdgeDetector and are shown as gray
+GLuint create_detector_texture(EdgeDetector& detector, const std::string& path)
+{
+    Image image, edges;
     stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
-    if (data) {
-        GLenum format;
-        if (channels == 1)
-            format = GL_RED;
-        else if (channels == 3)
-            format = GL_RGB;
-        else if (channels == 4)
-            format = GL_RGBA;
-        else {
-            stbi_image_free(data);
-            return 0; 
-        }
-
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        stbi_image_free(data);
-        glBindTexture(GL_TEXTURE_2D, 0);  // Unbind the texture
-    }
-    else {
-        std::cout << "Failed to load texture: " << path << std::endl;
+    if (!load_image(path.c_str(), image))
+        return 0;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!detector.process(image, edges))
+    {
+        std::cout << "Failed to detect edges: " << path << std::endl;
         return 0;
     }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << path << ": " << edge_backend_name(detector.last_backend()) << " edges in " << elapsed_ms << " ms" << std::endl;
 
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)edges.stride());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, edges.width(), edges.height(), 0, GL_RED, GL_UNSIGNED_BYTE, edges.row(0));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    glBindTexture(GL_TEXTURE_2D, 0);
     return texture_id;
 }
 
-int main()
+//--edge-binary: the same edges packed to one bit per pixel, an eighth of the upload and video memory
+bool create_detector_binary_texture(EdgeDetector& detector, const std::string& path, BinaryEdgeTexture& texture)
+{
+    Image image;
+    BinaryEdgeMap edges;
+    stbi_set_flip_vertically_on_load(true);
+    if (!load_image(path.c_str(), image))
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!detector.process_binary(image, edges))
+    {
+        std::cout << "Failed to detect edges: " << path << std::endl;
+        return false;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    texture.upload(edges);
+    std::cout << path << ": " << edge_backend_name(detector.last_backend()) << " binary edges in " << elapsed_ms << " ms, "
+              << edges.count() << " edge pixels, " << texture.memory_bytes() / 1024 << " KB packed" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
 {
+    Options options;
+    if (!parse_options(argc, argv, options))
+        return -1;
+
+    if (!options.build_pack_path.empty())
+        return build_asset_pack("assets", options.build_pack_path) ? 0 : -1;
+
     //glfw initialize and configure
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -83,9 +403,15 @@ int main()
         return -1;
     }
 
+    //map the asset pack, anything it does not contain is read from the loose files
+    AssetPack asset_pack;
+    if (!options.pack_path.empty())
+        asset_pack.open(options.pack_path);
+
     //build and compile shader
-    Shader edge_detection("assets/shaders/edge_detection.vs", "assets/shaders/edge_detection.fs");
-    Shader texture_shader("assets/shaders/texture.vs"       , "assets/shaders/texture.fs");
+    Shader edge_detection = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/edge_detection.fs");
+    Shader texture_shader = load_shader(asset_pack, "assets/shaders/texture.vs"       , "assets/shaders/texture.fs");
+    Shader edge_detection_multiscale = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/edge_detection_multiscale.fs");
 
     //set up vertex data and buffer, configure vertex attributes
     float vertices[] = {
@@ -126,15 +452,74 @@ int main()
     glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
-    //load and create texture 
-    GLuint texture_ID = load_texture("assets/textures/world_map.png");
-    //GLuint texture_ID = load_texture("assets/textures/Tex_A1x.png");
-    //GLuint texture_ID = load_texture("assets/textures/awesomeface.png");
-    //GLuint texture_ID = load_texture("assets/textures/Tex_4.png");
+    if ((options.cache_flags & TEXTURE_CACHE_COMPRESSED) && !compressed_formats_supported())
+    {
+        std::cout << "ERROR: BC1/BC7 TEXTURES ARE NOT SUPPORTED BY THIS DRIVER, USING UNCOMPRESSED TEXTURES" << std::endl;
+        options.cache_flags &= ~TEXTURE_CACHE_COMPRESSED;
+    }
+
+    //load and create texture, decoded images are cached so later launches skip the PNG decode
+    //and the manager reloads evicted textures from that cache
+    TextureCache texture_cache(options.cache_directory, options.cache_flags);
+    TextureManager texture_manager(options.vram_budget_mb << 20, [&](const std::string& path)
+    {
+        GLuint texture_id = load_texture_packed(asset_pack, path.c_str());
+        if (texture_id == 0)
+            texture_id = options.use_cache ? load_texture_cached(texture_cache, path.c_str()) : load_texture(path.c_str());
+        return texture_id;
+    });
+    //render targets, input textures and PBOs allocated from here on report to this manager
+    texture_manager.make_current();
+
+    //key T steps through the bundled textures, starting at the world map
+    std::vector<std::string> texture_paths = bundled_textures();
+    int first_texture = (int)(std::find(texture_paths.begin(), texture_paths.end(), "assets/textures/world_map.png") - texture_paths.begin());
+    if (first_texture == (int)texture_paths.size())
+        texture_paths.push_back("assets/textures/world_map.png");
+
+    //thumbnails of every bundled texture, built the first time the view is shown
+    Shader contact_sheet_shader = load_shader(asset_pack, "assets/shaders/contact_sheet.vs", "assets/shaders/contact_sheet.fs");
+    auto contact_sheet = std::make_unique<ContactSheet>(contact_sheet_shader);
+    //built on first use; a sheet without layers (no pack and a cold cache) is not rebuilt every frame
+    bool contact_sheet_built = false;
+
+    //optional frame stream, its edge maps replace the static texture
+    std::unique_ptr<FramePipeline> pipeline = create_pipeline(options, edge_detection);
+    bool pipeline_running = pipeline != nullptr;
+    double last_title_update = 0.0;
+
+    //with --edge-backend and friends the static texture's edges come from the edge library instead of edge_detection.fs
+    auto edge_detector = std::make_unique<EdgeDetector>(options.edge_detector);
+    Shader edge_detection_int = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/edge_detection_int.fs");
+    Shader edge_pack = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/edge_pack.fs");
+    Shader binary_edges_shader = load_shader(asset_pack, "assets/shaders/texture.vs", "assets/shaders/binary_edges.fs");
+    if (options.use_edge_detector)
+    {
+        edge_detector->enable_gl(edge_detection_int);
+        edge_detector->enable_gl_packing(edge_pack);
+    }
+    std::string detector_path;
+    GLuint detector_texture = 0;
+    BinaryEdgeTexture detector_binary;
+
+    //with --smooth edge_detection.fs runs on a smoothed copy of the static texture, made once per texture
+    Shader smoothing_shader = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/smoothing.fs");
+    Shader box_scan_shader = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/box_scan.fs");
+    Shader box_smoothing_shader = load_shader(asset_pack, "assets/shaders/edge_detection.vs", "assets/shaders/box_smoothing.fs");
+    auto smoothing_pass = std::make_unique<SmoothingPass>(smoothing_shader, box_scan_shader, box_smoothing_shader);
+    std::string smoothed_path;
+    bool smoothed_ok = false;
  
     //main loop
     while (!glfwWindowShouldClose(window))
     {
+        //advance the frame pipeline, it renders off screen so run it before setting the viewport
+        if (pipeline_running && !pipeline->pump())
+        {
+            pipeline_running = false;
+            print_pipeline_metrics(pipeline->metrics());
+        }
+
         glfwGetFramebufferSize(window, &SCREEN_WIDTH, &SCREEN_HEIGHT);
         glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
@@ -146,10 +531,96 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT);
 
         //render
-        glBindTexture(GL_TEXTURE_2D, texture_ID);
-        (detection_on) ? edge_detection.use() : texture_shader.use();
-        glBindVertexArray(VAO_id);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        if (contact_sheet_on)
+        {
+            if (!contact_sheet_built)
+            {
+                build_contact_sheet(*contact_sheet, asset_pack, options.cache_directory);
+                contact_sheet_built = true;
+                if (contact_sheet->layer_count() == 0)
+                    std::cout << "WARNING: contact sheet has no layers, no packed or cached textures found" << std::endl;
+            }
+            int cells = options.contact_sheet_cells > 0 ? options.contact_sheet_cells : contact_sheet->layer_count();
+            contact_sheet->draw(cells, (float)SCREEN_WIDTH / (float)std::max(SCREEN_HEIGHT, 1), detection_on);
+        }
+        else if (pipeline && pipeline->latest_output_texture() != 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, pipeline->latest_output_texture());
+            texture_shader.use();
+        }
+        else
+        {
+            const std::string& path = texture_paths[(first_texture + texture_step) % texture_paths.size()];
+            GLuint texture = texture_manager.acquire(path);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            if (detection_on && options.use_edge_detector && !multiscale_on && path != detector_path)
+            {
+                untrack_texture_memory(detector_texture);
+                glDeleteTextures(1, &detector_texture);
+                detector_texture = 0;
+                detector_binary.release();
+                if (options.edge_binary)
+                    create_detector_binary_texture(*edge_detector, path, detector_binary);
+                else
+                {
+                    detector_texture = create_detector_texture(*edge_detector, path);
+                    track_texture_memory(GL_TEXTURE_2D, detector_texture);
+                }
+                detector_path = path;
+            }
+            if (detection_on && options.use_edge_detector && !multiscale_on && detector_binary.texture() != 0)
+            {
+                detector_binary.bind(binary_edges_shader);
+            }
+            else if (detection_on && options.use_edge_detector && !multiscale_on && detector_texture != 0)
+            {
+                glBindTexture(GL_TEXTURE_2D, detector_texture);
+                texture_shader.use();
+            }
+            else if (detection_on && multiscale_on)
+            {
+                edge_detection_multiscale.use();
+                edge_detection_multiscale.set_int("baseLevel", options.multiscale_base);
+                edge_detection_multiscale.set_int("levelCount", options.multiscale_levels);
+            }
+            else
+            {
+                if (detection_on && options.edge_detector.smoothing != SmoothingFilter::NONE)
+                {
+                    if (path != smoothed_path)
+                    {
+                        GLint width = 0, height = 0;
+                        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+                        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+                        smoothed_ok = smoothing_pass->run(texture, width, height, options.edge_detector.smoothing, options.edge_detector.smoothing_sigma);
+                        smoothed_path = path;
+                        glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+                    }
+                    if (smoothed_ok)
+                        glBindTexture(GL_TEXTURE_2D, smoothing_pass->output_texture());
+                }
+                (detection_on) ? edge_detection.use() : texture_shader.use();
+            }
+        }
+        if (!contact_sheet_on)
+        {
+            glBindVertexArray(VAO_id);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        }
+
+        //live texture memory in the title bar, once a second
+        double now = glfwGetTime();
+        if (now - last_title_update >= 1.0)
+        {
+            last_title_update = now;
+            const TextureMemoryStats& memory = texture_manager.stats();
+            char title[160];
+            std::snprintf(title, sizeof(title), "Edge Detection - VRAM %.1f / %zu MB (%zu textures, %zu pinned, %llu loads, %llu evictions)",
+                          (memory.resident_bytes + memory.pinned_bytes) / 1048576.0, options.vram_budget_mb,
+                          memory.resident_count, memory.pinned_count,
+                          (unsigned long long)memory.loads, (unsigned long long)memory.evictions);
+            glfwSetWindowTitle(window, title);
+        }
 
         //glfw swap buffers
         glfwSwapBuffers(window);
@@ -159,6 +630,20 @@ int main()
     }
 
     //de-allocate
+    if (pipeline_running)
+    {
+        pipeline->stop();
+        pipeline->run();
+        print_pipeline_metrics(pipeline->metrics());
+    }
+    pipeline.reset();
+    contact_sheet.reset();
+    edge_detector.reset();
+    smoothing_pass.reset();
+    untrack_texture_memory(detector_texture);
+    glDeleteTextures(1, &detector_texture);
+    detector_binary.release();
+    texture_manager.clear();
     glDeleteVertexArrays(1, &VAO_id);
     glDeleteBuffers(1, &VBO_id);
     glDeleteBuffers(1, &EBO_id);
@@ -0,0 +1,581 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BinaryEdges.h"
+#include "ChildProcess.h"
+#include "EdgeContours.h"
+#include "EdgeDetector.h"
+#include "GlContext.h"
+#include "Image.h"
+#include "ImageEncoder.h"
+#include "IntegralImage.h"
+#include "Shader.h"
+#include "Smoothing.h"
+#include "WorkQueue.h"
+
+//SevengerBatch: edge maps of a list of images, sharded across worker processes through a WorkQueue
+//
+//    SevengerBatch --job <dir> --inputs <dir|list> --output <dir> --workers <n>   start a job
+//    SevengerBatch --job <dir> --workers <n>                                   join it, e.g. from another machine
+//    SevengerBatch --job <dir> --resume                                        continue an interrupted job
+
+//what every worker of a job has to agree on, stored in the job so joining machines cannot differ
+struct JobSettings
+{
+    std::string output_directory;
+    std::string kernel = "sobel";
+    std::string channels = "luma";
+    int low_threshold = 0;
+    int high_threshold = 255;
+    ImageFormat format = ImageFormat::PNG;
+    int png_level = 6;
+    std::string contours;          //"svg" or "svec" writes the traced outlines next to every edge map
+    float contour_epsilon = 1.0f;
+    std::string smoothing = "none";
+    float smoothing_sigma = 1.5f;
+    int adaptive_radius = -1;      //local-mean threshold window, off when negative
+    int adaptive_offset = 8;
+};
+
+struct BatchOptions
+{
+    std::string job_directory;
+    std::string inputs;
+    std::string assets_directory = "assets";
+    JobSettings job;
+    size_t chunk_size = 16;
+    int workers = 0;  //hardware threads for the CPU backends, 1 for GL
+    int retries = 2;
+    bool resume = false;
+    EdgeBackend backend = EdgeBackend::SIMD;
+    int thread_count = 1;      //threaded backend and the encoder
+    std::string worker_name;  //set when this process is a worker
+};
+
+void print_usage()
+{
+    std::cout << "usage: SevengerBatch --job <dir> [options]\n"
+              << "new job:\n"
+              << "  --inputs <dir|file>      images of a directory, or a text file with one path per line\n"
+              << "  --output <dir>           where the edge maps go (default <job>/edges)\n"
+              << "  --format <name>          png (default), qoi, pgm, pbm or edges (1 bit per pixel)\n"
+              << "  --png-level <n>          0 (stored) to 9 (smallest), default 6\n"
+              << "  --contours <svg|svec>    also write the outlines of the edges as vectors\n"
+              << "  --epsilon <px>           Douglas-Peucker tolerance of the outlines (default 1)\n"
+              << "  --chunk <n>              images a worker takes at once (default 16)\n"
+              << "  --edge-kernel <name>     sobel, prewitt or scharr (default sobel)\n"
+              << "  --edge-channels <mode>   luma or max (default luma)\n"
+              << "  --edge-thresholds <l,h>  magnitudes below l become 0, at or above h 255 (default 0,255)\n"
+              << "  --smooth <filter>        gaussian, box or deriche smoothing before the edges (default none)\n"
+              << "  --smooth-sigma <px>      sigma of --smooth (default 1.5)\n"
+              << "  --adaptive <r,offset>    edges are magnitudes at least offset above the mean of a (2r+1)^2 window (default off)\n"
+              << "workers on this machine:\n"
+              << "  --workers <n>            worker processes (default: hardware threads, 1 for gl)\n"
+              << "  --backend <name>         simd (default), scalar, threaded, gl or auto\n"
+              << "  --threads <n>            threads per worker for the threaded backend and encoding (default 1)\n"
+              << "  --retries <n>            restarts of a worker that failed (default 2)\n"
+              << "  --assets <dir>           asset directory with the shaders (default assets)\n"
+              << "  --resume                 hand out again the chunks of workers that were interrupted,\n"
+              << "                           only while no other machine works on the job\n";
+}
+
+bool parse_options(int argc, char* argv[], BatchOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        GradientKernel kernel;
+        SmoothingFilter smoothing;
+        if (arg == "--job" && has_value)
+            options.job_directory = argv[++i];
+        else if (arg == "--inputs" && has_value)
+            options.inputs = argv[++i];
+        else if (arg == "--output" && has_value)
+            options.job.output_directory = argv[++i];
+        else if (arg == "--chunk" && has_value)
+            options.chunk_size = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--format" && has_value && parse_image_format(argv[i + 1], options.job.format))
+            ++i;
+        else if (arg == "--png-level" && has_value)
+            options.job.png_level = std::clamp(std::atoi(argv[++i]), 0, 9);
+        else if (arg == "--contours" && has_value && (std::string(argv[i + 1]) == "svg" || std::string(argv[i + 1]) == "svec"))
+            options.job.contours = argv[++i];
+        else if (arg == "--epsilon" && has_value)
+            options.job.contour_epsilon = std::max(0.0f, (float)std::atof(argv[++i]));
+        else if (arg == "--smooth" && has_value && parse_smoothing_filter(argv[i + 1], smoothing))
+            options.job.smoothing = argv[++i];
+        else if (arg == "--smooth-sigma" && has_value)
+            options.job.smoothing_sigma = std::clamp((float)std::atof(argv[++i]), 0.0f, SMOOTHING_MAX_SIGMA);
+        else if (arg == "--adaptive" && has_value)
+        {
+            int radius = 7, offset = 8;
+            std::sscanf(argv[++i], "%d,%d", &radius, &offset);
+            options.job.adaptive_radius = std::clamp(radius, 0, ADAPTIVE_THRESHOLD_MAX_RADIUS);
+            options.job.adaptive_offset = std::clamp(offset, -255, 255);
+        }
+        else if (arg == "--edge-kernel" && has_value && parse_gradient_kernel(argv[i + 1], kernel))
+            options.job.kernel = argv[++i];
+        else if (arg == "--edge-channels" && has_value && (std::string(argv[i + 1]) == "luma" || std::string(argv[i + 1]) == "max"))
+            options.job.channels = argv[++i];
+        else if (arg == "--edge-thresholds" && has_value)
+        {
+            int low = 0, high = 255;
+            std::sscanf(argv[++i], "%d,%d", &low, &high);
+            options.job.low_threshold = std::clamp(low, 0, 255);
+            options.job.high_threshold = std::clamp(high, options.job.low_threshold, 255);
+        }
+        else if (arg == "--workers" && has_value)
+            options.workers = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--backend" && has_value && parse_edge_backend(argv[i + 1], options.backend))
+            ++i;
+        else if (arg == "--threads" && has_value)
+            options.thread_count = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--retries" && has_value)
+            options.retries = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--assets" && has_value)
+            options.assets_directory = argv[++i];
+        else if (arg == "--resume")
+            options.resume = true;
+        else if (arg == "--worker" && has_value)
+            options.worker_name = argv[++i];
+        else
+        {
+            print_usage();
+            return false;
+        }
+    }
+    if (options.job_directory.empty())
+    {
+        print_usage();
+        return false;
+    }
+    if (options.workers == 0)
+        options.workers = options.backend == EdgeBackend::GL ? 1 : std::max(1, (int)std::thread::hardware_concurrency());
+    return true;
+}
+
+//tab separated key=value pairs, paths never hold tabs
+static std::string encode_settings(const JobSettings& settings)
+{
+    return "output=" + settings.output_directory + "\tkernel=" + settings.kernel + "\tchannels=" + settings.channels +
+           "\tlow=" + std::to_string(settings.low_threshold) + "\thigh=" + std::to_string(settings.high_threshold) +
+           "\tformat=" + image_format_name(settings.format) + "\tpng_level=" + std::to_string(settings.png_level) +
+           "\tcontours=" + settings.contours + "\tepsilon=" + std::to_string(settings.contour_epsilon) +
+           "\tsmooth=" + settings.smoothing + "\tsigma=" + std::to_string(settings.smoothing_sigma) +
+           "\tadaptive=" + std::to_string(settings.adaptive_radius) + "\tadaptive_offset=" + std::to_string(settings.adaptive_offset);
+}
+
+static bool decode_settings(const std::string& line, JobSettings& settings)
+{
+    std::map<std::string, std::string> values;
+    size_t begin = 0;
+    while (begin < line.size())
+    {
+        size_t end = std::min(line.find('\t', begin), line.size());
+        size_t equals = line.find('=', begin);
+        if (equals < end)
+            values[line.substr(begin, equals - begin)] = line.substr(equals + 1, end - equals - 1);
+        begin = end + 1;
+    }
+    GradientKernel kernel;
+    if (values["output"].empty() || !parse_gradient_kernel(values["kernel"], kernel) || !parse_image_format(values["format"], settings.format))
+        return false;
+    settings.output_directory = values["output"];
+    settings.kernel = values["kernel"];
+    settings.channels = values["channels"] == "max" ? "max" : "luma";
+    settings.low_threshold = std::atoi(values["low"].c_str());
+    settings.high_threshold = std::atoi(values["high"].c_str());
+    settings.png_level = std::atoi(values["png_level"].c_str());
+    ContourFormat contour_format;
+    settings.contours = parse_contour_format(values["contours"], contour_format) ? values["contours"] : "";
+    settings.contour_epsilon = values["epsilon"].empty() ? 1.0f : (float)std::atof(values["epsilon"].c_str());
+    SmoothingFilter smoothing;
+    settings.smoothing = parse_smoothing_filter(values["smooth"], smoothing) ? values["smooth"] : "none";
+    settings.smoothing_sigma = values["sigma"].empty() ? 1.5f : (float)std::atof(values["sigma"].c_str());
+    settings.adaptive_radius = values["adaptive"].empty() ? -1 : std::atoi(values["adaptive"].c_str());
+    settings.adaptive_offset = values["adaptive_offset"].empty() ? 8 : std::atoi(values["adaptive_offset"].c_str());
+    return true;
+}
+
+//absolute paths, so workers started from another directory or machine find the same files
+static bool gather_inputs(const std::string& inputs, std::vector<std::string>& items)
+{
+    std::error_code error;
+    if (std::filesystem::is_directory(inputs, error))
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(inputs, error))
+        {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (entry.is_regular_file() && (extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+                                            extension == ".bmp" || extension == ".tga"))
+                items.push_back(std::filesystem::absolute(entry.path()).string());
+        }
+        std::sort(items.begin(), items.end());
+    }
+    else
+    {
+        std::ifstream list(inputs);
+        if (!list)
+        {
+            std::cout << "Failed to open input list: " << inputs << std::endl;
+            return false;
+        }
+        for (std::string line; std::getline(list, line);)
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                items.push_back(std::filesystem::absolute(line).string());
+        }
+    }
+    if (items.empty())
+        std::cout << "ERROR: NO IMAGES IN " << inputs << std::endl;
+    return !items.empty();
+}
+
+//<index>_<stem><extension>, the index keeps images with the same name in different directories apart
+static std::string output_path(const WorkQueue& queue, const JobSettings& settings, size_t index, const char* extension)
+{
+    size_t digits = std::to_string(queue.item_count() - 1).size();
+    std::string number = std::to_string(index);
+    number.insert(0, digits - number.size(), '0');
+    std::string stem = std::filesystem::path(queue.item(index)).stem().string();
+    return (std::filesystem::path(settings.output_directory) / (number + "_" + stem + extension)).string();
+}
+
+//a claimed chunk between loading and writing
+struct ChunkWork
+{
+    size_t chunk = 0;
+    size_t first = 0;
+    std::vector<Image> images;
+    std::vector<bool> loaded;
+    uint64_t ticket = 0;
+    double seconds = 0.0;  //decoding and writing, not the time spent waiting behind the other chunk
+};
+
+//decodes the images of work.chunk and submits them, GL batches keep running after it returns
+static void load_chunk(const WorkQueue& queue, ImagePool& pool, ChunkWork& work, EdgeDetector& detector)
+{
+    size_t last = 0;
+    auto begin = std::chrono::steady_clock::now();
+    queue.chunk_items(work.chunk, work.first, last);
+    work.images.resize(last - work.first);
+    work.loaded.assign(work.images.size(), false);
+
+    std::vector<const Image*> loaded_images;
+    for (size_t i = 0; i < work.images.size(); ++i)
+    {
+        work.loaded[i] = load_image(queue.item(work.first + i).c_str(), work.images[i], 0, PixelLayout::INTERLEAVED, &pool);
+        if (work.loaded[i])
+            loaded_images.push_back(&work.images[i]);
+    }
+    work.ticket = detector.submit_batch(loaded_images);
+    work.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static bool finish_chunk(WorkQueue& queue, const JobSettings& settings, const ImageEncoderConfig& encoder, const std::string& worker,
+                         ChunkWork& work, EdgeDetector& detector, std::vector<Image>& edges)
+{
+    auto begin = std::chrono::steady_clock::now();
+    //edges would still hold the previous chunk's maps, the claim stays so the coordinator hands the chunk out again
+    if (!detector.collect_batch(work.ticket, edges))
+    {
+        std::cout << "ERROR: EDGE BATCH FAILED FOR CHUNK " << work.chunk << std::endl;
+        return false;
+    }
+
+    ChunkResult result;
+    result.worker = worker;
+    size_t next_edges = 0;
+    for (size_t i = 0; i < work.images.size(); ++i)
+    {
+        if (!work.loaded[i])
+        {
+            ++result.failed;
+            continue;
+        }
+        const Image& edge_map = edges[next_edges++];
+        std::string path = output_path(queue, settings, work.first + i, image_format_extension(settings.format));
+        std::string temp_path = path + ".tmp";
+
+        //a worker that dies mid-chunk leaves at most a .tmp file, the chunk is redone on resume
+        std::error_code error;
+        bool ok = !edge_map.empty() && write_image(temp_path, settings.format, edge_map.row(0), edge_map.stride(), edge_map.width(),
+                                                   edge_map.height(), 1, encoder);
+        if (ok)
+            std::filesystem::rename(temp_path, path, error);
+
+        ContourFormat contour_format;
+        if (ok && !error && parse_contour_format(settings.contours, contour_format))
+        {
+            BinaryEdgeMap bits;
+            pack_edges_u8_simd(edge_map.row(0), edge_map.stride(), edge_map.width(), edge_map.height(), BINARY_EDGE_THRESHOLD, bits);
+            ContourConfig config;
+            config.epsilon = settings.contour_epsilon;
+            config.thread_count = encoder.thread_count;
+            std::vector<EdgeContour> contours;
+            trace_contours(bits, contours, config);
+
+            path = output_path(queue, settings, work.first + i, contour_format_extension(contour_format));
+            temp_path = path + ".tmp";
+            ok = write_contours(temp_path, contour_format, contours, edge_map.width(), edge_map.height());
+            if (ok)
+                std::filesystem::rename(temp_path, path, error);
+        }
+        if (!ok || error)
+        {
+            std::filesystem::remove(temp_path, error);
+            ++result.failed;
+            continue;
+        }
+        ++result.processed;
+    }
+    result.seconds = work.seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return queue.complete(work.chunk, result);
+}
+
+int run_worker(const BatchOptions& options)
+{
+    WorkQueue queue;
+    JobSettings settings;
+    if (!queue.open(options.job_directory))
+        return 1;
+    if (!decode_settings(queue.settings(), settings))
+    {
+        std::cout << "ERROR: INVALID JOB SETTINGS IN " << options.job_directory << std::endl;
+        return 1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(settings.output_directory, error);
+
+    //every worker has its own context, they share the GPU like any other processes would
+    bool gl = options.backend == EdgeBackend::GL || options.backend == EdgeBackend::AUTO;
+    if (gl && !create_headless_gl_context())
+    {
+        if (options.backend == EdgeBackend::GL)
+            return 1;
+        gl = false;
+    }
+
+    int result = 0;
+    {
+        std::unique_ptr<Shader> int_shader, batch_shader;
+        EdgeDetectorConfig config;
+        parse_gradient_kernel(settings.kernel, config.kernel);
+        config.channels = settings.channels == "max" ? EdgeChannels::MAX : EdgeChannels::LUMA;
+        config.low_threshold = settings.low_threshold;
+        config.high_threshold = settings.high_threshold;
+        config.backend = options.backend;
+        config.thread_count = options.thread_count;
+        parse_smoothing_filter(settings.smoothing, config.smoothing);
+        config.smoothing_sigma = settings.smoothing_sigma;
+        config.adaptive_threshold = settings.adaptive_radius >= 0;
+        config.adaptive.radius = std::max(0, settings.adaptive_radius);
+        config.adaptive.offset = settings.adaptive_offset;
+        EdgeDetector detector(config);
+        if (gl)
+        {
+            std::string shader_directory = options.assets_directory + "/shaders/";
+            int_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_int.fs").c_str());
+            batch_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_batch.fs").c_str());
+            detector.enable_gl(*int_shader);
+            detector.enable_gl_batch(*batch_shader);
+        }
+
+        ImageEncoderConfig encoder;
+        encoder.thread_count = options.thread_count;
+        encoder.png_level = settings.png_level;
+
+        //images are bottom-up in memory, the encoders flip them back on disk
+        stbi_set_flip_vertically_on_load(true);
+
+        //one chunk on the GPU while the next one is decoded, CPU backends finish in submit_batch anyway
+        ImagePool pool;
+        ChunkWork work[2];
+        std::vector<Image> edges;
+        int current = 0;
+        bool pending = queue.claim(options.worker_name, work[current].chunk);
+        if (pending)
+            load_chunk(queue, pool, work[current], detector);
+        while (pending)
+        {
+            int next = current ^ 1;
+            bool more = queue.claim(options.worker_name, work[next].chunk);
+            if (more)
+                load_chunk(queue, pool, work[next], detector);
+            if (!finish_chunk(queue, settings, encoder, options.worker_name, work[current], detector, edges))
+                result = 1;
+            current = next;
+            pending = more;
+        }
+    }
+
+    if (gl)
+        destroy_headless_gl_context();
+    return result;
+}
+
+struct WorkerSlot
+{
+    ChildProcess process;
+    std::string name;
+    int attempt = 0;
+    int failures = 0;
+};
+
+static bool start_worker(const BatchOptions& options, const std::string& program, int slot, WorkerSlot& worker)
+{
+    worker.name = host_name() + "-" + std::to_string(current_process_id()) + "-" + std::to_string(slot) + "." + std::to_string(worker.attempt++);
+    std::vector<std::string> arguments = { program, "--job", options.job_directory, "--worker", worker.name,
+                                           "--backend", edge_backend_name(options.backend),
+                                           "--threads", std::to_string(options.thread_count),
+                                           "--assets", options.assets_directory };
+    if (!worker.process.start(arguments))
+    {
+        std::cout << "Failed to start worker " << worker.name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int run_coordinator(const BatchOptions& options, const std::string& program)
+{
+    WorkQueue queue;
+    std::error_code error;
+    if (std::filesystem::exists(std::filesystem::path(options.job_directory) / "job.txt", error))
+    {
+        if (!queue.open(options.job_directory))
+            return 1;
+        if (!options.inputs.empty())
+            std::cout << "joining the existing job in " << options.job_directory << ", --inputs and the job settings are ignored" << std::endl;
+    }
+    else
+    {
+        std::vector<std::string> items;
+        if (options.inputs.empty())
+        {
+            std::cout << "ERROR: NO JOB IN " << options.job_directory << " AND NO --inputs TO START ONE" << std::endl;
+            return 1;
+        }
+        if (!gather_inputs(options.inputs, items))
+            return 1;
+        JobSettings settings = options.job;
+        if (settings.output_directory.empty())
+            settings.output_directory = (std::filesystem::path(options.job_directory) / "edges").string();
+        settings.output_directory = std::filesystem::absolute(settings.output_directory).string();
+        if (!queue.create(options.job_directory, items, options.chunk_size, encode_settings(settings)))
+            return 1;
+    }
+
+    if (options.resume)
+    {
+        size_t released = queue.release_unfinished();
+        if (released)
+            std::cout << "resuming " << released << " interrupted chunks" << std::endl;
+    }
+    size_t chunk_count = queue.chunk_count();
+    size_t completed_before = queue.completed_count();
+    std::cout << queue.item_count() << " images in " << chunk_count << " chunks, " << completed_before << " done, "
+              << options.workers << " " << edge_backend_name(options.backend) << " workers" << std::endl;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<WorkerSlot> workers(options.workers);
+    for (int i = 0; i < options.workers && queue.unclaimed_count() > 0; ++i)
+        start_worker(options, program, i, workers[i]);
+
+    //restart failed workers while there is work nobody claimed, their claims go back first
+    size_t reported = completed_before;
+    auto last_report = begin;
+    while (true)
+    {
+        bool running = false;
+        for (int i = 0; i < options.workers; ++i)
+        {
+            WorkerSlot& worker = workers[i];
+            int exit_code = 0;
+            if (worker.process.is_running() && worker.process.try_wait(exit_code) && exit_code != 0)
+            {
+                ++worker.failures;
+                size_t released = queue.release_unfinished(worker.name);
+                std::cout << "worker " << worker.name << " failed (exit code " << exit_code << "), " << released << " chunks released" << std::endl;
+                if (worker.failures <= options.retries && queue.unclaimed_count() > 0)
+                    start_worker(options, program, i, worker);
+            }
+            running = running || worker.process.is_running();
+        }
+        if (!running)
+            break;
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(1))
+        {
+            size_t completed = queue.completed_count();
+            if (completed != reported)
+            {
+                double seconds = std::chrono::duration<double>(now - begin).count();
+                std::cout << completed << "/" << chunk_count << " chunks, " << (double)(completed - completed_before) / seconds << " chunks/s" << std::endl;
+                reported = completed;
+            }
+            last_report = now;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    //the whole job, including chunks of earlier runs and other machines
+    std::map<std::string, ChunkResult> per_worker;
+    size_t processed = 0, failed = 0, unfinished = 0;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        ChunkResult result;
+        if (!queue.read_result(chunk, result))
+        {
+            ++unfinished;
+            continue;
+        }
+        ChunkResult& total = per_worker[result.worker];
+        total.processed += result.processed;
+        total.failed += result.failed;
+        total.seconds += result.seconds;
+        processed += result.processed;
+        failed += result.failed;
+    }
+    for (const auto& [name, total] : per_worker)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-32s %8zu images %6zu failed %10.2f s busy", name.c_str(), total.processed, total.failed, total.seconds);
+        std::cout << line << "\n";
+    }
+
+    size_t new_chunks = queue.completed_count() - completed_before;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%zu images written, %zu failed, %zu/%zu chunks done; this run %.2f s, %.1f chunks/s",
+                  processed, failed, chunk_count - unfinished, chunk_count, seconds, seconds > 0.0 ? new_chunks / seconds : 0.0);
+    std::cout << line << std::endl;
+    if (unfinished)
+        std::cout << unfinished << " chunks are unfinished or still running elsewhere, run again with --resume once no worker is left" << std::endl;
+    return unfinished == 0 && failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    BatchOptions options;
+    if (!parse_options(argc, argv, options))
+        return -1;
+    return options.worker_name.empty() ? run_coordinator(options, argv[0]) : run_worker(options);
+}
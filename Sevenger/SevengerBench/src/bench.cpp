@@ -0,0 +1,1532 @@
+#include <glad/glad.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BatchSobelPass.h"
+#include "BinaryEdges.h"
+#include "EdgeContours.h"
+#include "EdgePass.h"
+#include "GlContext.h"
+#include "HoughPass.h"
+#include "HoughTransform.h"
+#include "Image.h"
+#include "ImageDiff.h"
+#include "ImageEncoder.h"
+#include "IncrementalEdges.h"
+#include "IntegralImage.h"
+#include "IntegralImagePass.h"
+#include "IntegerSobelPass.h"
+#include "Pyramid.h"
+#include "Shader.h"
+#include "Smoothing.h"
+#include "SmoothingPass.h"
+#include "SobelCpu.h"
+#include "SubpixelEdges.h"
+#include "TextureCache.h"
+#include "TextureCompression.h"
+#include "TileDiff.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//the Hough backends cast hundreds to thousands of votes per edge pixel, larger inputs take minutes
+constexpr int64_t HOUGH_BENCH_MAX_PIXELS = 2048 * 2048;
+
+//bumped whenever the output fields change, so tracking scripts can tell runs apart
+constexpr int BENCH_FORMAT_VERSION = 2;
+
+static size_t peak_memory_bytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+struct BenchOptions
+{
+    std::string assets_directory = "assets";
+    std::string json_path;
+    std::vector<int> sizes = { 256, 512, 1024, 2048, 4096, 8192, 16384 };
+    int max_size = 16384;
+    std::vector<std::string> backends;  //every backend of the mode when empty
+    bool textures = true;
+    double time_budget_ms = 1000.0;
+    int threads = 0;
+    int batch_size = 16;
+    int png_level = 6;
+    float epsilon = 1.0f;
+    float sigma = 2.0f;
+    std::string golden_directory;
+    bool write_golden = false;
+    int tolerance = -1;  //per family default when negative
+
+    //checks that print their own report, run instead of the timing and golden modes
+    std::vector<std::string> int_check_paths;
+    std::vector<std::string> compress_check_paths;
+    int compress_tolerance = 64;
+    std::vector<std::string> pyramid_bench_paths;
+    std::vector<std::string> roi_bench_paths;
+    bool cache_bench = false;
+    std::string cache_directory = "cache";
+};
+
+struct BenchInput
+{
+    std::string name;
+    Image luma;
+};
+
+struct BenchResult
+{
+    std::string backend;
+    std::string input;
+    int width = 0;
+    int height = 0;
+    int runs = 0;
+    double min_ms = 0.0;
+    double p50_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+    double max_ms = 0.0;
+    double megapixels_per_second = 0.0;
+    size_t working_set_bytes = 0;
+    size_t peak_memory_bytes = 0;
+    size_t mismatches = 0;
+    size_t output_bytes = 0;  //encoded size of the encode_* and contour backends
+    std::string note;         //why a backend was skipped
+};
+
+void print_usage()
+{
+    std::cout << "usage: SevengerBench [options]\n"
+              << "  --assets <dir>           asset directory (default assets)\n"
+              << "  --sizes <n,n,...>        synthetic square sizes (default 256 to 16384)\n"
+              << "  --max-size <n>           skip synthetic sizes above n\n"
+              << "  --backends <a,b,...>     scalar, simd, threaded, gl_fragment, gl_batch, gl_compute,\n"
+              << "                           encode_<format> and encode_<format>_threaded for png, qoi, pbm, pgm, edges,\n"
+              << "                           pack_scalar, pack_simd, pack_threaded, pack_gl, contours, contours_threaded,\n"
+              << "                           subpixel_scalar, subpixel_simd, subpixel_threaded, subpixel_gl,\n"
+              << "                           hough_lines[_threaded|_gl], hough_circles[_threaded|_gl],\n"
+              << "                           smooth_<gaussian|box|deriche>_<scalar|simd|threaded|gl>,\n"
+              << "                           integral_<scalar|simd|threaded|gl>, adaptive_<scalar|simd|threaded|gl>,\n"
+              << "                           temporal_<simd|hash|gl> (timing)\n"
+              << "                           cpu_float, gl_float, scalar, simd, threaded, gl_fragment (golden)\n"
+              << "  --no-textures            only run the synthetic sizes\n"
+              << "  --time-budget <ms>       time spent per backend and input (default 1000)\n"
+              << "  --threads <n>            threads of the threaded backend and encoders (default all)\n"
+              << "  --png-level <n>          deflate level of encode_png (default 6)\n"
+              << "  --epsilon <px>           Douglas-Peucker tolerance of the contour backends (default 1)\n"
+              << "  --sigma <px>             sigma of the smooth backends (default 2), the gaussian and deriche GL passes\n"
+              << "                           skip sigmas above 21 and 13.6 (smoothing_gl_max_sigma)\n"
+              << "  --batch <n>              copies of the input per gl_batch submission, times are per image (default 16)\n"
+              << "  --json <file>            also write one JSON object per result (JSON lines)\n"
+              << "  --golden <dir>           compare every bundled texture against the golden edge maps in dir\n"
+              << "  --write-golden           record the golden edge maps first (reference and fixed-point families)\n"
+              << "  --tolerance <n>          allowed per-pixel error (default 2 for the reference family, 0 for fixed-point)\n"
+              << "checks, run instead of the backends:\n"
+              << "  --int-check <image>      compare the fixed-point Sobel backends, repeatable\n"
+              << "  --compress-check <image> compare edges of compressed and uncompressed input, repeatable\n"
+              << "  --compress-tolerance <n> per pixel edge magnitude difference the check allows (default 64)\n"
+              << "  --pyramid-bench <image>  time the CPU pyramid and multi-scale Sobel, repeatable\n"
+              << "  --roi-bench <image>      time dirty-rect edge updates against full recomputes, repeatable\n"
+              << "  --cache-bench            time texture startup with and without the cache\n"
+              << "  --cache-dir <dir>        where --cache-bench builds its cache (default cache)\n";
+}
+
+static std::vector<std::string> split_list(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > begin)
+            items.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return items;
+}
+
+bool parse_options(int argc, char* argv[], BenchOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--assets" && has_value)
+            options.assets_directory = argv[++i];
+        else if (arg == "--sizes" && has_value)
+        {
+            options.sizes.clear();
+            for (const std::string& size : split_list(argv[++i]))
+                options.sizes.push_back(std::max(1, std::atoi(size.c_str())));
+        }
+        else if (arg == "--max-size" && has_value)
+            options.max_size = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--backends" && has_value)
+            options.backends = split_list(argv[++i]);
+        else if (arg == "--no-textures")
+            options.textures = false;
+        else if (arg == "--time-budget" && has_value)
+            options.time_budget_ms = std::max(1.0, std::atof(argv[++i]));
+        else if (arg == "--threads" && has_value)
+            options.threads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--png-level" && has_value)
+            options.png_level = std::clamp(std::atoi(argv[++i]), 0, 9);
+        else if (arg == "--epsilon" && has_value)
+            options.epsilon = std::max(0.0f, (float)std::atof(argv[++i]));
+        else if (arg == "--sigma" && has_value)
+            options.sigma = std::clamp((float)std::atof(argv[++i]), 0.0f, SMOOTHING_MAX_SIGMA);
+        else if (arg == "--batch" && has_value)
+            options.batch_size = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--json" && has_value)
+            options.json_path = argv[++i];
+        else if (arg == "--golden" && has_value)
+            options.golden_directory = argv[++i];
+        else if (arg == "--write-golden")
+            options.write_golden = true;
+        else if (arg == "--tolerance" && has_value)
+            options.tolerance = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--int-check" && has_value)
+            options.int_check_paths.push_back(argv[++i]);
+        else if (arg == "--compress-check" && has_value)
+            options.compress_check_paths.push_back(argv[++i]);
+        else if (arg == "--compress-tolerance" && has_value)
+            options.compress_tolerance = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--pyramid-bench" && has_value)
+            options.pyramid_bench_paths.push_back(argv[++i]);
+        else if (arg == "--roi-bench" && has_value)
+            options.roi_bench_paths.push_back(argv[++i]);
+        else if (arg == "--cache-bench")
+            options.cache_bench = true;
+        else if (arg == "--cache-dir" && has_value)
+            options.cache_directory = argv[++i];
+        else
+        {
+            print_usage();
+            return false;
+        }
+    }
+    return true;
+}
+
+//rings, a diagonal ramp and hashed noise, every size gets the same kind of content
+static Image make_synthetic_luma(int size)
+{
+    Image luma(size, size, 1, PixelLayout::PLANAR);
+    for (int y = 0; y < size; ++y)
+    {
+        unsigned char* row = luma.row(y);
+        for (int x = 0; x < size; ++x)
+        {
+            int dx = x - size / 2, dy = y - size / 2;
+            int ring = (int)(((int64_t)dx * dx + (int64_t)dy * dy) * 64 / ((int64_t)size * size / 16 + 1)) & 64;
+            uint32_t noise = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u;
+            row[x] = (unsigned char)(ring + ((x + y) * 96 / (2 * size)) + (noise >> 28));
+        }
+    }
+    return luma;
+}
+
+//the square sprite of the temporal backends, an eighth of the shorter side bouncing a few pixels per frame
+//like the viewer's SyntheticSequenceSource
+static Rect temporal_sprite_rect(int width, int height, int index)
+{
+    auto bounce = [](int t, int range)
+    {
+        if (range <= 0)
+            return 0;
+        int position = t % (2 * range);
+        return position < range ? position : 2 * range - position;
+    };
+    int size = std::max(1, std::min(width, height) / 8);
+    return { bounce(index * 7, width - size), bounce(index * 5, height - size), size, size };
+}
+
+//moves the sprite of frame index - 1 to index over the still background, only the two sprite rects are written
+static void draw_temporal_frame(const Image& background, Image& frame, int index)
+{
+    int width = background.width(), height = background.height();
+    if (index > 0)
+    {
+        Rect previous = temporal_sprite_rect(width, height, index - 1);
+        for (int y = previous.y; y < previous.y + previous.height; ++y)
+            std::memcpy(frame.row(y) + previous.x, background.row(y) + previous.x, previous.width);
+    }
+    Rect sprite = temporal_sprite_rect(width, height, index);
+    for (int y = 0; y < sprite.height; ++y)
+    {
+        unsigned char* row = frame.row(sprite.y + y) + sprite.x;
+        for (int x = 0; x < sprite.width; ++x)
+            row[x] = ((x ^ y) & 8) ? 255 : 0;
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+//at least 3 runs, then as many as fit into the time budget (capped at 1000)
+static void measure(BenchResult& result, double time_budget_ms, const std::function<void()>& run)
+{
+    std::vector<double> samples;
+    double total_ms = 0.0;
+    while (samples.size() < 3 || (total_ms < time_budget_ms && samples.size() < 1000))
+    {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        samples.push_back(ms);
+        total_ms += ms;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    result.runs = (int)samples.size();
+    result.min_ms = samples.front();
+    result.p50_ms = percentile(samples, 0.50);
+    result.p95_ms = percentile(samples, 0.95);
+    result.p99_ms = percentile(samples, 0.99);
+    result.max_ms = samples.back();
+    result.megapixels_per_second = (double)result.width * result.height / 1e6 / (result.p50_ms / 1000.0);
+}
+
+static size_t count_mismatches(const Image& a, const Image& b)
+{
+    size_t mismatches = 0;
+    for (int y = 0; y < a.height(); ++y)
+    {
+        const unsigned char* row_a = a.row(y);
+        const unsigned char* row_b = b.row(y);
+        for (int x = 0; x < a.width(); ++x)
+            mismatches += row_a[x] != row_b[x];
+    }
+    return mismatches;
+}
+
+static std::vector<std::string> bundled_textures(const std::string& assets_directory)
+{
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(assets_directory + "/textures", error))
+    {
+        if (entry.path().extension() == ".png")
+            paths.push_back(entry.path().generic_string());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static bool uses_gl(const BenchOptions& options)
+{
+    for (const std::string& backend : options.backends)
+    {
+        if (backend == "gl_fragment" || backend == "gl_batch" || backend == "gl_float" || backend == "pack_gl" ||
+            backend == "subpixel_gl" || backend == "hough_lines_gl" || backend == "hough_circles_gl" ||
+            backend == "integral_gl" || backend == "adaptive_gl" || backend == "temporal_gl" ||
+            (backend.rfind("smooth_", 0) == 0 && backend.ends_with("_gl")))
+            return true;
+    }
+    return false;
+}
+
+//every backend, run in this order when --backends is not given
+static const char* const default_backends[] = {
+    "scalar", "simd", "threaded", "gl_fragment", "gl_batch", "gl_compute",
+    "encode_png", "encode_png_threaded", "encode_qoi", "encode_qoi_threaded",
+    "encode_pbm", "encode_pgm", "encode_edges",
+    "pack_scalar", "pack_simd", "pack_threaded", "pack_gl", "contours", "contours_threaded",
+    "subpixel_scalar", "subpixel_simd", "subpixel_threaded", "subpixel_gl",
+    "hough_lines", "hough_lines_threaded", "hough_lines_gl", "hough_circles", "hough_circles_threaded", "hough_circles_gl",
+    "smooth_gaussian_scalar", "smooth_gaussian_simd", "smooth_gaussian_threaded", "smooth_gaussian_gl",
+    "smooth_box_scalar", "smooth_box_simd", "smooth_box_threaded", "smooth_box_gl",
+    "smooth_deriche_scalar", "smooth_deriche_simd", "smooth_deriche_threaded", "smooth_deriche_gl",
+    "integral_scalar", "integral_simd", "integral_threaded", "integral_gl",
+    "adaptive_scalar", "adaptive_simd", "adaptive_threaded", "adaptive_gl",
+    "temporal_simd", "temporal_hash", "temporal_gl" };
+
+//the backend column fits the longest registered name so the table stays aligned as backends are added
+static int backend_column_width()
+{
+    size_t width = 0;
+    for (const char* backend : default_backends)
+        width = std::max(width, std::strlen(backend));
+    return (int)width;
+}
+
+static void print_result(const BenchResult& result)
+{
+    char line[512];
+    int column = backend_column_width();
+    if (!result.note.empty())
+    {
+        std::snprintf(line, sizeof(line), "%-*s %-26s %5dx%-5d  skipped: %s",
+                      column, result.backend.c_str(), result.input.c_str(), result.width, result.height, result.note.c_str());
+    }
+    else
+    {
+        std::snprintf(line, sizeof(line), "%-*s %-26s %5dx%-5d %9.1f MP/s  p50 %9.3f  p95 %9.3f  p99 %9.3f ms  %7.1f MB  peak %7.1f MB  mismatches %zu",
+                      column, result.backend.c_str(), result.input.c_str(), result.width, result.height, result.megapixels_per_second,
+                      result.p50_ms, result.p95_ms, result.p99_ms, result.working_set_bytes / 1048576.0,
+                      result.peak_memory_bytes / 1048576.0, result.mismatches);
+    }
+    if (result.output_bytes)
+    {
+        size_t length = std::strlen(line);
+        std::snprintf(line + length, sizeof(line) - length, "  output %.1f KB (%.2f bits/pixel)",
+                      result.output_bytes / 1024.0, result.output_bytes * 8.0 / ((double)result.width * result.height));
+    }
+    std::cout << line << std::endl;
+}
+
+static void write_json(std::FILE* file, const BenchResult& result)
+{
+    std::fprintf(file, "{\"type\":\"result\",\"backend\":\"%s\",\"input\":\"%s\",\"width\":%d,\"height\":%d,\"runs\":%d,"
+                       "\"min_ms\":%.6f,\"p50_ms\":%.6f,\"p95_ms\":%.6f,\"p99_ms\":%.6f,\"max_ms\":%.6f,"
+                       "\"megapixels_per_second\":%.3f,\"working_set_bytes\":%zu,\"peak_memory_bytes\":%zu,"
+                       "\"mismatches\":%zu,\"output_bytes\":%zu,\"skipped\":\"%s\"}\n",
+                 result.backend.c_str(), result.input.c_str(), result.width, result.height, result.runs,
+                 result.min_ms, result.p50_ms, result.p95_ms, result.p99_ms, result.max_ms,
+                 result.megapixels_per_second, result.working_set_bytes, result.peak_memory_bytes,
+                 result.mismatches, result.output_bytes, result.note.c_str());
+}
+
+//times every backend on every input, mismatches are counted against the scalar output
+int run_timing(const BenchOptions& options, std::FILE* json)
+{
+    //bundled textures first, then the synthetic sizes, built one at a time so only one large input is alive
+    std::vector<std::function<bool(BenchInput&)>> inputs;
+    if (options.textures)
+    {
+        for (const std::string& path : bundled_textures(options.assets_directory))
+        {
+            inputs.push_back([path](BenchInput& input)
+            {
+                Image source;
+                if (!load_image(path.c_str(), source, 0, PixelLayout::PLANAR))
+                    return false;
+                input.name = std::filesystem::path(path).filename().string();
+                input.luma = Image(source.width(), source.height(), 1, PixelLayout::PLANAR);
+                luma_u8(source, input.luma);
+                return true;
+            });
+        }
+    }
+    for (int size : options.sizes)
+    {
+        if (size > options.max_size)
+            continue;
+        inputs.push_back([size](BenchInput& input)
+        {
+            input.name = "synthetic";
+            input.luma = make_synthetic_luma(size);
+            return true;
+        });
+    }
+
+    std::unique_ptr<Shader> int_shader;
+    std::unique_ptr<IntegerSobelPass> gpu_pass;
+    std::unique_ptr<Shader> batch_shader;
+    std::unique_ptr<BatchSobelPass> batch_pass;
+    std::unique_ptr<Shader> pack_shader;
+    std::unique_ptr<Shader> subpixel_shader;
+    std::unique_ptr<Shader> hough_line_shader;
+    std::unique_ptr<Shader> hough_circle_shader;
+    std::unique_ptr<HoughPass> hough_pass;
+    std::unique_ptr<Shader> smoothing_shader;
+    std::unique_ptr<Shader> box_scan_shader;
+    std::unique_ptr<Shader> box_smoothing_shader;
+    std::unique_ptr<SmoothingPass> smoothing_pass;
+    std::unique_ptr<Shader> scan_shader;
+    std::unique_ptr<Shader> adaptive_shader;
+    std::unique_ptr<IntegralImagePass> integral_pass;
+    std::unique_ptr<Shader> edge_shader;
+    GLint max_texture_size = 0;
+    if (uses_gl(options))
+    {
+        std::string shader_directory = options.assets_directory + "/shaders/";
+        int_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_int.fs").c_str());
+        gpu_pass = std::make_unique<IntegerSobelPass>(*int_shader);
+        pack_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_pack.fs").c_str());
+        gpu_pass->enable_packing(*pack_shader);
+        subpixel_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_subpixel.fs").c_str());
+        gpu_pass->enable_subpixel(*subpixel_shader);
+        hough_line_shader = std::make_unique<Shader>((shader_directory + "hough_lines.vs").c_str(), (shader_directory + "hough_vote.fs").c_str());
+        hough_circle_shader = std::make_unique<Shader>((shader_directory + "hough_circles.vs").c_str(), (shader_directory + "hough_vote.fs").c_str());
+        hough_pass = std::make_unique<HoughPass>(*hough_line_shader, *hough_circle_shader);
+        smoothing_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "smoothing.fs").c_str());
+        box_scan_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "box_scan.fs").c_str());
+        box_smoothing_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "box_smoothing.fs").c_str());
+        smoothing_pass = std::make_unique<SmoothingPass>(*smoothing_shader, *box_scan_shader, *box_smoothing_shader);
+        scan_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "integral_scan.fs").c_str());
+        adaptive_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "adaptive_threshold.fs").c_str());
+        integral_pass = std::make_unique<IntegralImagePass>(*scan_shader, *adaptive_shader);
+        batch_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_batch.fs").c_str());
+        batch_pass = std::make_unique<BatchSobelPass>(*batch_shader);
+        edge_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection.fs").c_str());
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    }
+
+    int result_code = 0;
+    for (auto& make_input : inputs)
+    {
+        BenchInput input;
+        if (!make_input(input))
+        {
+            result_code = -1;
+            continue;
+        }
+
+        int width = input.luma.width(), height = input.luma.height();
+        const Image& luma = input.luma;
+        Image reference(width, height, 1, PixelLayout::PLANAR);
+        Image output(width, height, 1, PixelLayout::PLANAR);
+        sobel_u8_scalar(luma.row(0), luma.stride(), reference.row(0), reference.stride(), width, height);
+        size_t image_bytes = luma.stride() * (size_t)height;
+        BinaryEdgeMap reference_bits, bits;
+        pack_edges_u8_scalar(reference.row(0), reference.stride(), width, height, BINARY_EDGE_THRESHOLD, reference_bits);
+        //sub-pixel edges of the scalar path, made by the first subpixel backend
+        Image reference_subpixel, subpixel;
+        //edge points of the packed map and the single threaded accumulators, made by the first hough backend
+        std::vector<EdgePoint> edge_point_list;
+        HoughAccumulator reference_lines, reference_circles, hough_votes;
+        //smoothed luma of the scalar path for the filter of the last smooth backend
+        Image smoothed_reference;
+        SmoothingFilter smoothed_filter = SmoothingFilter::NONE;
+        //summed-area table and adaptive threshold of the reference edge map on the scalar path, made by the first
+        //integral or adaptive backend
+        IntegralImage reference_sums, sums;
+        Image reference_adaptive;
+
+        for (const std::string& backend : options.backends)
+        {
+            BenchResult result;
+            result.backend = backend;
+            result.input = input.name;
+            result.width = width;
+            result.height = height;
+            result.working_set_bytes = 2 * image_bytes;
+
+            if (backend == "scalar")
+                measure(result, options.time_budget_ms, [&] { sobel_u8_scalar(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height); });
+            else if (backend == "simd")
+                measure(result, options.time_budget_ms, [&] { sobel_u8_simd(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height); });
+            else if (backend == "threaded")
+                measure(result, options.time_budget_ms, [&] { sobel_u8_threaded(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height, options.threads); });
+            else if (backend == "gl_fragment")
+            {
+                if (width > max_texture_size || height > max_texture_size)
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                {
+                    //upload, draw and readback, what a caller with CPU images pays
+                    result.working_set_bytes += 2 * (size_t)width * height;
+                    measure(result, options.time_budget_ms, [&] { gpu_pass->run(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height); });
+                }
+            }
+            else if (backend == "gl_batch")
+            {
+                if (width > max_texture_size || height > max_texture_size)
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                {
+                    //batch_size copies in one submission, the per image cost once uploads and draws are grouped
+                    BatchImage copy;
+                    copy.pixels = luma.row(0);
+                    copy.stride = luma.stride();
+                    copy.width = width;
+                    copy.height = height;
+                    std::vector<BatchImage> batch(options.batch_size, copy);
+                    std::vector<Image> batch_edges;
+                    result.working_set_bytes += 2 * (size_t)width * height * options.batch_size;
+                    measure(result, options.time_budget_ms, [&] { batch_pass->collect(batch_pass->submit(batch), batch_edges); });
+
+                    double images = (double)options.batch_size;
+                    for (double* ms : { &result.min_ms, &result.p50_ms, &result.p95_ms, &result.p99_ms, &result.max_ms })
+                        *ms /= images;
+                    result.megapixels_per_second *= images;
+                    for (const Image& edges : batch_edges)
+                        result.mismatches += edges.empty() ? (size_t)width * height : count_mismatches(reference, edges);
+                }
+            }
+            else if (backend == "gl_compute")
+                result.note = "compute shaders need OpenGL 4.3, the loader targets 3.3 core";
+            else if (backend == "pack_scalar" || backend == "pack_simd" || backend == "pack_threaded" || backend == "pack_gl")
+            {
+                //thresholding the edge map down to one bit per pixel; pack_gl runs Sobel and packs on the GPU,
+                //reading back an eighth of gl_fragment's bytes
+                if (backend == "pack_scalar")
+                    measure(result, options.time_budget_ms, [&] { pack_edges_u8_scalar(reference.row(0), reference.stride(), width, height, BINARY_EDGE_THRESHOLD, bits); });
+                else if (backend == "pack_simd")
+                    measure(result, options.time_budget_ms, [&] { pack_edges_u8_simd(reference.row(0), reference.stride(), width, height, BINARY_EDGE_THRESHOLD, bits); });
+                else if (backend == "pack_threaded")
+                    measure(result, options.time_budget_ms, [&] { pack_edges_u8_threaded(reference.row(0), reference.stride(), width, height, BINARY_EDGE_THRESHOLD, bits, options.threads); });
+                else if (width > max_texture_size || height > max_texture_size)
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                    measure(result, options.time_budget_ms, [&] { gpu_pass->run_packed(luma.row(0), luma.stride(), 1, width, height, BINARY_EDGE_THRESHOLD, bits); });
+                result.output_bytes = bits.size_bytes();
+                result.working_set_bytes = image_bytes + bits.size_bytes();
+                if (result.note.empty())
+                {
+                    for (int y = 0; y < height; ++y)
+                        for (int x = 0; x < width; ++x)
+                            result.mismatches += bits.test(x, y) != reference_bits.test(x, y);
+                }
+            }
+            else if (backend == "contours" || backend == "contours_threaded")
+            {
+                //tracing and simplifying the packed map, output_bytes is the SVEC file; checked by filling
+                //an unsimplified trace, which has to give the packed map back
+                ContourConfig config;
+                config.epsilon = options.epsilon;
+                config.thread_count = backend == "contours" ? 1 : options.threads;
+                std::vector<EdgeContour> contours;
+                measure(result, options.time_budget_ms, [&] { trace_contours(reference_bits, contours, config); });
+                std::vector<unsigned char> file;
+                encode_contours(ContourFormat::SVEC, contours, width, height, file);
+                result.output_bytes = file.size();
+                result.working_set_bytes = reference_bits.size_bytes() + contour_point_count(contours) * sizeof(ContourPoint);
+
+                config.epsilon = 0.0f;
+                trace_contours(reference_bits, contours, config);
+                rasterize_contours(contours, width, height, bits);
+                for (int y = 0; y < height; ++y)
+                    for (int x = 0; x < width; ++x)
+                        result.mismatches += bits.test(x, y) != reference_bits.test(x, y);
+            }
+            else if (backend == "subpixel_scalar" || backend == "subpixel_simd" || backend == "subpixel_threaded" || backend == "subpixel_gl")
+            {
+                //magnitude, direction, offset and flags in one pass, 4 bytes per pixel written; every byte has to match
+                //the scalar path and the magnitudes the reference edge map
+                if (reference_subpixel.empty())
+                {
+                    reference_subpixel = Image(width, height, 4);
+                    subpixel_edges_u8_scalar(GradientKernel::SOBEL, luma.row(0), luma.stride(), reference_subpixel.row(0),
+                                             reference_subpixel.stride(), width, height);
+                }
+                if (subpixel.empty())
+                    subpixel = Image(width, height, 4);
+                result.working_set_bytes = image_bytes + subpixel.stride() * (size_t)height;
+
+                if (backend == "subpixel_scalar")
+                    measure(result, options.time_budget_ms, [&] { subpixel_edges_u8_scalar(GradientKernel::SOBEL, luma.row(0), luma.stride(), subpixel.row(0), subpixel.stride(), width, height); });
+                else if (backend == "subpixel_simd")
+                    measure(result, options.time_budget_ms, [&] { subpixel_edges_u8_simd(GradientKernel::SOBEL, luma.row(0), luma.stride(), subpixel.row(0), subpixel.stride(), width, height); });
+                else if (backend == "subpixel_threaded")
+                    measure(result, options.time_budget_ms, [&] { subpixel_edges_u8_threaded(GradientKernel::SOBEL, luma.row(0), luma.stride(), subpixel.row(0), subpixel.stride(), width, height, 0, 255, options.threads); });
+                else if (width > max_texture_size || height > max_texture_size)
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                    measure(result, options.time_budget_ms, [&] { gpu_pass->run_subpixel(luma.row(0), luma.stride(), subpixel.row(0), subpixel.stride(), width, height); });
+
+                if (result.note.empty())
+                {
+                    for (int y = 0; y < height; ++y)
+                    {
+                        const unsigned char* row = subpixel.row(y);
+                        const unsigned char* expected = reference_subpixel.row(y);
+                        const unsigned char* magnitude = reference.row(y);
+                        for (int x = 0; x < width; ++x)
+                            result.mismatches += std::memcmp(row + 4 * x, expected + 4 * x, 4) != 0 || row[4 * x] != magnitude[x];
+                    }
+                }
+            }
+            else if (backend == "hough_lines" || backend == "hough_lines_threaded" || backend == "hough_lines_gl" ||
+                     backend == "hough_circles" || backend == "hough_circles_threaded" || backend == "hough_circles_gl")
+            {
+                //accumulating the votes of every edge point of the packed map, the peaks are left out of the timing;
+                //every backend has to count exactly the votes of the single threaded one
+                bool lines = backend.rfind("hough_lines", 0) == 0;
+                bool gl = backend.ends_with("_gl");
+                HoughLineConfig line_config;
+                HoughCircleConfig circle_config;
+                if ((int64_t)width * height > HOUGH_BENCH_MAX_PIXELS)
+                    result.note = "larger than the Hough bench limit";
+                else
+                {
+                    if (edge_point_list.empty())
+                        edge_points(reference_bits, edge_point_list);
+                    HoughAccumulator& reference_votes = lines ? reference_lines : reference_circles;
+                    if (reference_votes.votes.empty() && lines)
+                        hough_lines_accumulate(edge_point_list, width, height, line_config.theta_bins, reference_votes, 1);
+                    else if (reference_votes.votes.empty())
+                        hough_circles_accumulate(edge_point_list, width, height, circle_config.min_radius, circle_config.max_radius, reference_votes, 1);
+
+                    int threads = backend.ends_with("_threaded") ? options.threads : 1;
+                    bool ok = true;
+                    if (lines && gl)
+                        measure(result, options.time_budget_ms, [&] { ok = hough_pass->accumulate_lines(edge_point_list, width, height, line_config.theta_bins, hough_votes); });
+                    else if (lines)
+                        measure(result, options.time_budget_ms, [&] { hough_lines_accumulate(edge_point_list, width, height, line_config.theta_bins, hough_votes, threads); });
+                    else if (gl)
+                        measure(result, options.time_budget_ms, [&] { ok = hough_pass->accumulate_circles(edge_point_list, width, height, circle_config.min_radius, circle_config.max_radius, hough_votes); });
+                    else
+                        measure(result, options.time_budget_ms, [&] { hough_circles_accumulate(edge_point_list, width, height, circle_config.min_radius, circle_config.max_radius, hough_votes, threads); });
+
+                    result.working_set_bytes = edge_point_list.size() * sizeof(EdgePoint) + hough_votes.votes.size() * sizeof(uint32_t);
+                    if (!ok)
+                        result.note = "accumulator larger than GL_MAX_TEXTURE_SIZE";
+                    else
+                    {
+                        for (size_t i = 0; i < reference_votes.votes.size(); ++i)
+                            result.mismatches += hough_votes.votes[i] != reference_votes.votes[i];
+                    }
+                }
+            }
+            else if (backend.rfind("smooth_", 0) == 0)
+            {
+                //pre-smoothing of the luma at --sigma; the CPU flavours have to match the scalar path byte for byte,
+                //the GPU passes (see SmoothingPass.h) within SMOOTHING_GL_TOLERANCE
+                size_t split = backend.find('_', 7);
+                std::string flavour = split == std::string::npos ? "" : backend.substr(split + 1);
+                SmoothingFilter filter = SmoothingFilter::NONE;
+                if (split == std::string::npos || !parse_smoothing_filter(backend.substr(7, split - 7), filter) || filter == SmoothingFilter::NONE ||
+                    (flavour != "scalar" && flavour != "simd" && flavour != "threaded" && flavour != "gl"))
+                    result.note = "unknown backend";
+                else
+                {
+                    if (smoothed_reference.empty() || smoothed_filter != filter)
+                    {
+                        smoothed_reference = Image(width, height, 1, PixelLayout::PLANAR);
+                        smooth_u8_scalar(filter, options.sigma, luma.row(0), luma.stride(), smoothed_reference.row(0), smoothed_reference.stride(), width, height);
+                        smoothed_filter = filter;
+                    }
+                    result.working_set_bytes = 2 * image_bytes;
+
+                    bool ok = true;
+                    if (flavour == "scalar")
+                        measure(result, options.time_budget_ms, [&] { smooth_u8_scalar(filter, options.sigma, luma.row(0), luma.stride(), output.row(0), output.stride(), width, height); });
+                    else if (flavour == "simd")
+                        measure(result, options.time_budget_ms, [&] { smooth_u8_simd(filter, options.sigma, luma.row(0), luma.stride(), output.row(0), output.stride(), width, height); });
+                    else if (flavour == "threaded")
+                        measure(result, options.time_budget_ms, [&] { smooth_u8_threaded(filter, options.sigma, luma.row(0), luma.stride(), output.row(0), output.stride(), width, height, options.threads); });
+                    else if (width > max_texture_size || height > max_texture_size)
+                        result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                    else if (options.sigma > smoothing_gl_max_sigma(filter))
+                        result.note = "sigma above smoothing_gl_max_sigma";
+                    else
+                        measure(result, options.time_budget_ms, [&] { ok = smoothing_pass->run(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height, filter, options.sigma); });
+
+                    if (!ok)
+                        result.note = "render target failed";
+                    else if (result.note.empty())
+                    {
+                        int tolerance = flavour == "gl" ? SMOOTHING_GL_TOLERANCE : 0;
+                        for (int y = 0; y < height; ++y)
+                        {
+                            const unsigned char* row = output.row(y);
+                            const unsigned char* expected = smoothed_reference.row(y);
+                            for (int x = 0; x < width; ++x)
+                                result.mismatches += std::abs(row[x] - expected[x]) > tolerance;
+                        }
+                    }
+                }
+            }
+            else if (backend.rfind("integral_", 0) == 0 || backend.rfind("adaptive_", 0) == 0)
+            {
+                //integral: the summed-area table of the luma; adaptive: table and local-mean threshold of the reference
+                //edge map with the default AdaptiveThresholdConfig; both have to match the scalar path exactly
+                bool adaptive = backend.rfind("adaptive_", 0) == 0;
+                std::string flavour = backend.substr(9);
+                const Image& plane = adaptive ? reference : luma;
+                AdaptiveThresholdConfig config;
+                config.thread_count = options.threads;
+                if (flavour != "scalar" && flavour != "simd" && flavour != "threaded" && flavour != "gl")
+                    result.note = "unknown backend";
+                else if (flavour == "gl" && (width > max_texture_size || height > max_texture_size))
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                {
+                    if (reference_sums.sums.empty())
+                    {
+                        integral_image_u8_scalar(luma.row(0), luma.stride(), width, height, reference_sums);
+                        IntegralImage magnitude_sums;
+                        integral_image_u8_scalar(reference.row(0), reference.stride(), width, height, magnitude_sums);
+                        reference_adaptive = Image(width, height, 1, PixelLayout::PLANAR);
+                        adaptive_threshold_u8_scalar(magnitude_sums, reference.row(0), reference.stride(), reference_adaptive.row(0),
+                                                     reference_adaptive.stride(), config);
+                    }
+                    result.working_set_bytes = image_bytes + reference_sums.sums.size() * sizeof(uint32_t) + (adaptive ? image_bytes : 0);
+
+                    auto build = [&]
+                    {
+                        if (flavour == "scalar")
+                            integral_image_u8_scalar(plane.row(0), plane.stride(), width, height, sums);
+                        else if (flavour == "simd")
+                            integral_image_u8_simd(plane.row(0), plane.stride(), width, height, sums);
+                        else
+                            integral_image_u8_threaded(plane.row(0), plane.stride(), width, height, sums, options.threads);
+                    };
+                    if (!adaptive && flavour == "gl")
+                        measure(result, options.time_budget_ms, [&] { integral_pass->run(luma.row(0), luma.stride(), width, height, sums); });
+                    else if (!adaptive)
+                        measure(result, options.time_budget_ms, build);
+                    else if (flavour == "gl")
+                        measure(result, options.time_budget_ms, [&] { integral_pass->run_adaptive(reference.row(0), reference.stride(), output.row(0), output.stride(), width, height, config); });
+                    else
+                    {
+                        measure(result, options.time_budget_ms, [&]
+                        {
+                            build();
+                            if (flavour == "scalar")
+                                adaptive_threshold_u8_scalar(sums, reference.row(0), reference.stride(), output.row(0), output.stride(), config);
+                            else if (flavour == "simd")
+                                adaptive_threshold_u8_simd(sums, reference.row(0), reference.stride(), output.row(0), output.stride(), config);
+                            else
+                                adaptive_threshold_u8_threaded(sums, reference.row(0), reference.stride(), output.row(0), output.stride(), config);
+                        });
+                    }
+
+                    if (adaptive)
+                        result.mismatches = count_mismatches(reference_adaptive, output);
+                    else
+                    {
+                        for (size_t i = 0; i < sums.sums.size(); ++i)
+                            result.mismatches += sums.sums[i] != reference_sums.sums[i];
+                    }
+                }
+            }
+            else if (backend.rfind("temporal_", 0) == 0)
+            {
+                //a sprite moving over the still luma: tile differencing and incremental edges per frame, the first
+                //frame (a full computation) is not timed; the CPU flavours have to match sobel_u8_simd on the last
+                //frame exactly, temporal_gl a full IncrementalEdgesGpu::reset of it
+                std::string flavour = backend.substr(9);
+                if (flavour != "simd" && flavour != "hash" && flavour != "gl")
+                    result.note = "unknown backend";
+                else if (flavour == "gl" && (width > max_texture_size || height > max_texture_size))
+                    result.note = "larger than GL_MAX_TEXTURE_SIZE";
+                else
+                {
+                    Image frame(width, height, 1, PixelLayout::PLANAR);
+                    for (int y = 0; y < height; ++y)
+                        std::memcpy(frame.row(y), luma.row(y), width);
+                    int index = 0;
+                    draw_temporal_frame(luma, frame, index);
+
+                    TileDiff diff(32, flavour == "hash" ? TileCompare::HASH : TileCompare::SIMD);
+                    diff.compare(frame.row(0), frame.stride(), width, height, 1);
+                    result.working_set_bytes = 2 * image_bytes + (flavour == "simd" ? image_bytes : 0);
+                    if (flavour == "gl")
+                    {
+                        IncrementalEdgesGpu edges(*edge_shader), full(*edge_shader);
+                        edges.reset(frame.row(0), frame.stride(), width, height, 1);
+                        measure(result, options.time_budget_ms, [&]
+                        {
+                            draw_temporal_frame(luma, frame, ++index);
+                            edges.update(frame.row(0), frame.stride(), diff.compare(frame.row(0), frame.stride(), width, height, 1));
+                            glFinish();
+                        });
+                        full.reset(frame.row(0), frame.stride(), width, height, 1);
+
+                        std::vector<unsigned char> pixels((size_t)width * height * 4), reference_pixels(pixels.size());
+                        glBindFramebuffer(GL_FRAMEBUFFER, edges.render_target().framebuffer);
+                        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                        glBindFramebuffer(GL_FRAMEBUFFER, full.render_target().framebuffer);
+                        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, reference_pixels.data());
+                        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                        for (size_t i = 0; i < pixels.size(); ++i)
+                            result.mismatches += pixels[i] != reference_pixels[i];
+                    }
+                    else
+                    {
+                        IncrementalEdgesCpu edges;
+                        edges.reset(frame.row(0), frame.stride(), width, height, 1);
+                        measure(result, options.time_budget_ms, [&]
+                        {
+                            draw_temporal_frame(luma, frame, ++index);
+                            edges.update(frame.row(0), frame.stride(), diff.compare(frame.row(0), frame.stride(), width, height, 1));
+                        });
+                        sobel_u8_simd(frame.row(0), frame.stride(), output.row(0), output.stride(), width, height);
+                        result.mismatches = count_mismatches(edges.edges(), output);
+                    }
+                }
+            }
+            else if (backend.rfind("encode_", 0) == 0)
+            {
+                //writing the scalar edge map, what a batch job pays per image; checked by decoding it again
+                bool threaded = backend.ends_with("_threaded");
+                std::string format_name = backend.substr(7, backend.size() - 7 - (threaded ? 9 : 0));
+                ImageFormat format;
+                if (!parse_image_format(format_name, format))
+                    result.note = "unknown backend";
+                else
+                {
+                    ImageEncoderConfig encoder;
+                    encoder.thread_count = threaded ? options.threads : 1;
+                    encoder.png_level = options.png_level;
+                    std::vector<unsigned char> file;
+                    measure(result, options.time_budget_ms, [&] { encode_image(format, reference.row(0), reference.stride(), width, height, 1, file, encoder); });
+                    result.output_bytes = file.size();
+                    result.working_set_bytes = image_bytes + file.capacity();
+
+                    std::vector<unsigned char> decoded;
+                    int decoded_width = 0, decoded_height = 0, decoded_channels = 0;
+                    if (!decode_image(file.data(), file.size(), decoded, decoded_width, decoded_height, decoded_channels) ||
+                        decoded_width != width || decoded_height != height)
+                        result.mismatches = (size_t)width * height;
+                    else
+                    {
+                        for (int y = 0; y < height; ++y)
+                        {
+                            const unsigned char* row = reference.row(y);
+                            for (int x = 0; x < width; ++x)
+                            {
+                                bool binary = format == ImageFormat::PBM || format == ImageFormat::EDGES;
+                                int expected = binary ? (row[x] >= BINARY_EDGE_THRESHOLD ? 255 : 0) : row[x];
+                                result.mismatches += decoded[((size_t)y * width + x) * decoded_channels] != expected;
+                            }
+                        }
+                    }
+                }
+            }
+            else
+                result.note = "unknown backend";
+
+            //gl_batch, the packers, the encoders, the contour, subpixel, hough, smooth, integral, adaptive and temporal
+            //backends counted their own mismatches
+            if (result.note.empty() && backend != "gl_batch" && backend.rfind("encode_", 0) != 0 && backend.rfind("pack_", 0) != 0 &&
+                backend.rfind("contours", 0) != 0 && backend.rfind("subpixel_", 0) != 0 &&
+                backend.rfind("hough_", 0) != 0 && backend.rfind("smooth_", 0) != 0 && backend.rfind("integral_", 0) != 0 &&
+                backend.rfind("adaptive_", 0) != 0 && backend.rfind("temporal_", 0) != 0)
+                result.mismatches = count_mismatches(reference, output);
+            if (result.mismatches != 0)
+                result_code = 1;
+            result.peak_memory_bytes = peak_memory_bytes();
+            print_result(result);
+            if (json)
+            {
+                write_json(json, result);
+                std::fflush(json);
+            }
+        }
+    }
+
+    return result_code;
+}
+
+//one golden edge map per family and texture, every backend of the family is compared against it
+//    reference: edge_detection.fs as the viewer runs it, recorded from gl_float
+//    fixed:     the fixed-point luma Sobel of SobelCpu.h, recorded from scalar
+struct GoldenBackend
+{
+    const char* name;
+    const char* family;
+};
+
+static const GoldenBackend golden_backends[] = {
+    { "gl_float", "reference" },
+    { "cpu_float", "reference" },
+    { "scalar", "fixed" },
+    { "simd", "fixed" },
+    { "threaded", "fixed" },
+    { "gl_fragment", "fixed" }
+};
+
+int run_golden(const BenchOptions& options, std::FILE* json)
+{
+    std::error_code error;
+    if (options.write_golden)
+        std::filesystem::create_directories(options.golden_directory, error);
+
+    std::unique_ptr<Shader> float_shader, int_shader;
+    std::unique_ptr<EdgePass> float_pass;
+    std::unique_ptr<IntegerSobelPass> int_pass;
+    GLint max_texture_size = 0;
+    if (uses_gl(options) || options.write_golden)
+    {
+        std::string shader_directory = options.assets_directory + "/shaders/";
+        float_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection.fs").c_str());
+        int_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_int.fs").c_str());
+        float_pass = std::make_unique<EdgePass>(*float_shader);
+        int_pass = std::make_unique<IntegerSobelPass>(*int_shader);
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    }
+
+    int result_code = 0;
+    for (const std::string& path : bundled_textures(options.assets_directory))
+    {
+        Image source;
+        if (!load_image(path.c_str(), source) || (source.channels() == 2 && !load_image(path.c_str(), source, 4)))
+        {
+            result_code = -1;
+            continue;
+        }
+
+        int width = source.width(), height = source.height(), channels = source.channels();
+        Image luma(width, height, 1, PixelLayout::PLANAR);
+        Image output(width, height, 1, PixelLayout::PLANAR);
+        luma_u8(source, luma);
+
+        //fills output, false if the backend cannot run on this image
+        auto render = [&](const std::string& backend)
+        {
+            bool gpu = backend == "gl_float" || backend == "gl_fragment";
+            if (gpu && (!float_pass || width > max_texture_size || height > max_texture_size))
+                return false;
+
+            if (backend == "cpu_float")
+                sobel_rgb_reference(source.row(0), source.stride(), channels, output.row(0), output.stride(), width, height);
+            else if (backend == "scalar")
+                sobel_u8_scalar(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height);
+            else if (backend == "simd")
+                sobel_u8_simd(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height);
+            else if (backend == "threaded")
+                sobel_u8_threaded(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height, options.threads);
+            else if (backend == "gl_fragment")
+                int_pass->run(luma.row(0), luma.stride(), output.row(0), output.stride(), width, height);
+            else if (backend == "gl_float")
+            {
+                //same texture state as load_texture: GL_REPEAT, mipmapped, RGBA8 target like the screen
+                std::vector<unsigned char> pixels((size_t)width * height * channels);
+                source.copy_to_interleaved(pixels.data(), (size_t)width * channels);
+                GLenum format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
+
+                GLuint texture = 0;
+                glGenTextures(1, &texture);
+                glBindTexture(GL_TEXTURE_2D, texture);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels.data());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glBindTexture(GL_TEXTURE_2D, 0);
+
+                RenderTarget target;
+                create_render_target(target, width, height);
+                float_pass->run(texture, target);
+
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, target.framebuffer);
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glPixelStorei(GL_PACK_ROW_LENGTH, (GLint)output.stride());
+                glReadPixels(0, 0, width, height, GL_RED, GL_UNSIGNED_BYTE, output.row(0));
+                glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+                destroy_render_target(target);
+                glDeleteTextures(1, &texture);
+            }
+            else
+                return false;
+            return true;
+        };
+
+        std::string stem = std::filesystem::path(path).stem().string();
+        for (const char* family : { "reference", "fixed" })
+        {
+            std::string golden_path = options.golden_directory + "/" + stem + "." + family + ".pgm";
+            if (options.write_golden)
+            {
+                const char* recorder = std::string(family) == "reference" ? "gl_float" : "scalar";
+                if (!render(recorder) || !write_pgm(golden_path, output.row(0), output.stride(), width, height))
+                {
+                    std::cout << "Failed to record golden image: " << golden_path << std::endl;
+                    result_code = -1;
+                    continue;
+                }
+            }
+
+            std::vector<unsigned char> golden;
+            int golden_width = 0, golden_height = 0;
+            if (!read_pgm(golden_path, golden, golden_width, golden_height) || golden_width != width || golden_height != height)
+            {
+                std::cout << "ERROR: MISSING OR MISMATCHED GOLDEN IMAGE: " << golden_path << std::endl;
+                result_code = -1;
+                continue;
+            }
+
+            int tolerance = options.tolerance >= 0 ? options.tolerance : (std::string(family) == "reference" ? 2 : 0);
+            for (const GoldenBackend& backend : golden_backends)
+            {
+                if (backend.family != std::string(family) ||
+                    std::find(options.backends.begin(), options.backends.end(), backend.name) == options.backends.end())
+                    continue;
+
+                char line[512];
+                if (!render(backend.name))
+                {
+                    std::snprintf(line, sizeof(line), "%-12s %-10s %-18s skipped", backend.name, family, stem.c_str());
+                    std::cout << line << std::endl;
+                    continue;
+                }
+
+                ImageDiff diff = diff_images(output.row(0), output.stride(), golden.data(), (size_t)width, width, height, tolerance);
+                bool passed = diff.over_tolerance == 0;
+                std::snprintf(line, sizeof(line), "%-12s %-10s %-18s max %3d  mean %7.4f  PSNR %6.2f dB  %zu over %d  %s",
+                              backend.name, family, stem.c_str(), diff.max_error, diff.mean_error, diff.psnr,
+                              diff.over_tolerance, tolerance, passed ? "ok" : "FAILED");
+                std::cout << line << std::endl;
+                if (json)
+                {
+                    std::fprintf(json, "{\"type\":\"golden\",\"backend\":\"%s\",\"family\":\"%s\",\"input\":\"%s\",\"width\":%d,\"height\":%d,"
+                                       "\"max_error\":%d,\"mean_error\":%.6f,\"psnr\":%.3f,\"over_tolerance\":%zu,\"tolerance\":%d,\"passed\":%s}\n",
+                                 backend.name, family, stem.c_str(), width, height, diff.max_error, diff.mean_error, diff.psnr,
+                                 diff.over_tolerance, tolerance, passed ? "true" : "false");
+                    std::fflush(json);
+                }
+                if (!passed && result_code == 0)
+                    result_code = 1;
+            }
+        }
+    }
+    return result_code;
+}
+
+//best of several runs in milliseconds
+template <typename Function>
+static double time_ms(Function function, int runs = 5)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        function();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+//runs the fixed-point Sobel on every backend and checks they agree bit for bit
+//buffers come from one pool, so after the first image of a given size the batch
+//performs no further heap allocations for pixel data
+int run_int_check(const std::vector<std::string>& paths, Shader& edge_detection_int)
+{
+    ImagePool pool;
+    IntegerSobelPass gpu_pass(edge_detection_int);
+    Image source, luma, scalar, simd, gpu;
+    int result = 0;
+
+    for (const std::string& path : paths)
+    {
+        if (!load_image(path.c_str(), source, 0, PixelLayout::PLANAR, &pool))
+        {
+            result = -1;
+            continue;
+        }
+
+        int width = source.width(), height = source.height();
+        if (luma.empty() || luma.width() != width || luma.height() != height)
+        {
+            luma = Image(width, height, 1, PixelLayout::PLANAR, &pool);
+            scalar = Image(width, height, 1, PixelLayout::PLANAR, &pool);
+            simd = Image(width, height, 1, PixelLayout::PLANAR, &pool);
+            gpu = Image(width, height, 1, PixelLayout::PLANAR, &pool);
+        }
+        luma_u8(source, luma);
+
+        double scalar_ms = time_ms([&] { sobel_u8_scalar(luma.row(0), luma.stride(), scalar.row(0), scalar.stride(), width, height); });
+        double simd_ms = time_ms([&] { sobel_u8_simd(luma.row(0), luma.stride(), simd.row(0), simd.stride(), width, height); });
+        double gpu_ms = time_ms([&] { gpu_pass.run(luma.row(0), luma.stride(), gpu.row(0), gpu.stride(), width, height); });
+
+        size_t simd_mismatches = count_mismatches(scalar, simd);
+        size_t gpu_mismatches = count_mismatches(scalar, gpu);
+        double megapixels = (double)width * height / 1e6;
+        std::cout << path << " " << width << "x" << height << "\n"
+                  << "  scalar: " << scalar_ms << " ms (" << megapixels / (scalar_ms / 1000.0) << " MP/s)\n"
+                  << "  simd:   " << simd_ms << " ms (" << megapixels / (simd_ms / 1000.0) << " MP/s), mismatches " << simd_mismatches << "\n"
+                  << "  gpu:    " << gpu_ms << " ms incl. upload/readback, mismatches " << gpu_mismatches << std::endl;
+
+        if (result == 0 && (simd_mismatches != 0 || gpu_mismatches != 0))
+            result = 1;
+    }
+
+    std::cout << "image pool: " << pool.heap_allocations() << " heap allocations, " << pool.reuses() << " reuses" << std::endl;
+    return result;
+}
+
+//BC compresses each image, lets the driver decode it and runs the fixed-point Sobel on both versions
+//fails when more than 1% of the edge pixels differ by more than the tolerance
+int run_compress_check(const std::vector<std::string>& paths, int tolerance)
+{
+    int result = 0;
+    for (const std::string& path : paths)
+    {
+        int width, height, channels;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+        if (data && channels == 2)
+        {
+            stbi_image_free(data);
+            data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+            channels = 4;
+        }
+        if (!data)
+        {
+            std::cout << "Failed to load image: " << path << std::endl;
+            result = -1;
+            continue;
+        }
+
+        GLenum format = compressed_format(channels);
+        GLenum pixel_format = channels == 1 ? GL_RED : (channels == 3 ? GL_RGB : GL_RGBA);
+        std::vector<unsigned char> blocks;
+        double compress_ms = time_ms([&] { compress_image(format, data, width, height, channels, blocks); }, 1);
+
+        //upload cost of level 0 in both forms
+        GLuint texture_id = 0;
+        glGenTextures(1, &texture_id);
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        double raw_upload_ms = time_ms([&]
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, pixel_format, width, height, 0, pixel_format, GL_UNSIGNED_BYTE, data);
+            glFinish();
+        });
+        double compressed_upload_ms = time_ms([&]
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, (GLsizei)blocks.size(), blocks.data());
+            glFinish();
+        });
+
+        std::vector<unsigned char> decoded((size_t)width * height * channels);
+        glGetTexImage(GL_TEXTURE_2D, 0, pixel_format, GL_UNSIGNED_BYTE, decoded.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &texture_id);
+
+        std::vector<unsigned char> luma((size_t)width * height), edges(luma.size()), compressed_edges(luma.size());
+        luma_u8(data, (size_t)width * channels, channels, luma.data(), width, width, height);
+        sobel_u8_simd(luma.data(), width, edges.data(), width, width, height);
+        luma_u8(decoded.data(), (size_t)width * channels, channels, luma.data(), width, width, height);
+        sobel_u8_simd(luma.data(), width, compressed_edges.data(), width, width, height);
+        stbi_image_free(data);
+
+        double squared_sum = 0.0, absolute_sum = 0.0;
+        int max_error = 0;
+        size_t over_tolerance = 0;
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            int error = std::abs(edges[i] - compressed_edges[i]);
+            absolute_sum += error;
+            squared_sum += (double)error * error;
+            max_error = std::max(max_error, error);
+            over_tolerance += error > tolerance;
+        }
+        double mse = squared_sum / edges.size();
+        double psnr = mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+        double over_percent = 100.0 * over_tolerance / edges.size();
+        bool passed = over_percent <= 1.0;
+
+        std::cout << path << " " << width << "x" << height << " " << (format == COMPRESSED_RGB_BC1 ? "BC1" : format == COMPRESSED_RED_BC4 ? "BC4" : "BC7") << "\n"
+                  << "  size:   " << (size_t)width * height * channels / 1024 << " KB -> " << blocks.size() / 1024 << " KB, compressed in " << compress_ms << " ms\n"
+                  << "  upload: " << raw_upload_ms << " ms raw, " << compressed_upload_ms << " ms compressed\n"
+                  << "  edges:  mean error " << absolute_sum / edges.size() << ", max " << max_error << ", PSNR " << psnr << " dB, "
+                  << over_percent << "% over " << tolerance << (passed ? " ok" : " FAILED") << std::endl;
+
+        if (result == 0 && !passed)
+            result = 1;
+    }
+    return result;
+}
+
+//full resolution Sobel against the pyramid and multi-scale Sobel at a few base levels
+//also checks the SIMD downsampling against the scalar one on every level
+int run_pyramid_bench(const std::vector<std::string>& paths)
+{
+    ImagePool pool;
+    int result = 0;
+    for (const std::string& path : paths)
+    {
+        Image source;
+        if (!load_image(path.c_str(), source, 0, PixelLayout::PLANAR, &pool))
+        {
+            result = -1;
+            continue;
+        }
+
+        int width = source.width(), height = source.height();
+        Image luma(width, height, 1, PixelLayout::PLANAR, &pool);
+        Image edges(width, height, 1, PixelLayout::PLANAR, &pool);
+        luma_u8(source, luma);
+
+        LumaPyramid pyramid;
+        double full_ms = time_ms([&] { sobel_u8_simd(luma.row(0), luma.stride(), edges.row(0), edges.stride(), width, height); });
+        double pyramid_ms = time_ms([&] { pyramid.build(luma, 5, &pool); });
+
+        size_t mismatches = 0;
+        for (int level = 1; level < pyramid.level_count(); ++level)
+        {
+            const Image& above = pyramid.level(level - 1);
+            const Image& simd = pyramid.level(level);
+            Image scalar(simd.width(), simd.height(), 1, PixelLayout::PLANAR, &pool);
+            downsample_2x2_u8_scalar(above.row(0), above.stride(), scalar.row(0), scalar.stride(), above.width(), above.height());
+            mismatches += count_mismatches(scalar, simd);
+        }
+        double scalar_ms = time_ms([&]
+        {
+            Image half(std::max(1, width / 2), std::max(1, height / 2), 1, PixelLayout::PLANAR, &pool);
+            downsample_2x2_u8_scalar(luma.row(0), luma.stride(), half.row(0), half.stride(), width, height);
+        });
+        double simd_ms = time_ms([&]
+        {
+            Image half(std::max(1, width / 2), std::max(1, height / 2), 1, PixelLayout::PLANAR, &pool);
+            downsample_2x2_u8_simd(luma.row(0), luma.stride(), half.row(0), half.stride(), width, height);
+        });
+
+        std::cout << path << " " << width << "x" << height << "\n"
+                  << "  full resolution sobel: " << full_ms << " ms\n"
+                  << "  pyramid (5 levels):    " << pyramid_ms << " ms, first level scalar " << scalar_ms
+                  << " ms, simd " << simd_ms << " ms, mismatches " << mismatches << "\n";
+        for (int base : { 0, 1, 2 })
+        {
+            Image multiscale;
+            double multiscale_ms = time_ms([&] { sobel_multiscale_u8(pyramid, base, 3, multiscale, &pool); });
+            std::cout << "  levels " << base << "-" << base + 2 << " at " << multiscale.width() << "x" << multiscale.height()
+                      << ": " << multiscale_ms << " ms (" << 100.0 * multiscale_ms / full_ms << "% of full resolution)\n";
+        }
+        std::cout << std::flush;
+
+        if (result == 0 && mismatches != 0)
+            result = 1;
+    }
+    return result;
+}
+
+//paints a few small rects per frame like annotation strokes and keeps the edges current
+//with dirty-rect updates, every frame is checked against a full recompute on both backends
+int run_roi_bench(const std::vector<std::string>& paths, Shader& edge_detection)
+{
+    const int frame_count = 30;
+    const int strokes_per_frame = 4;
+    const int stroke_size = 24;
+
+    int result = 0;
+    for (const std::string& path : paths)
+    {
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+        if (!data)
+        {
+            std::cout << "Failed to load image: " << path << std::endl;
+            result = -1;
+            continue;
+        }
+        channels = 4;
+        size_t stride = (size_t)width * channels;
+        std::vector<unsigned char> frame(data, data + stride * height);
+        stbi_image_free(data);
+
+        IncrementalEdgesCpu cpu;
+        IncrementalEdgesGpu gpu(edge_detection);
+        IncrementalEdgesGpu gpu_reference(edge_detection);
+        cpu.reset(frame.data(), stride, width, height, channels);
+        gpu.reset(frame.data(), stride, width, height, channels);
+
+        Image luma(width, height, 1, PixelLayout::PLANAR), full(width, height, 1, PixelLayout::PLANAR);
+        std::vector<unsigned char> incremental_pixels(stride * height), reference_pixels(stride * height);
+        DirtyRegion dirty;
+        double cpu_incremental_ms = 0.0, cpu_full_ms = 0.0, gpu_incremental_ms = 0.0, gpu_full_ms = 0.0;
+        size_t processed = 0, cpu_mismatches = 0, gpu_mismatches = 0;
+        std::srand(7);
+
+        for (int i = 0; i < frame_count; ++i)
+        {
+            dirty.clear();
+            for (int stroke = 0; stroke < strokes_per_frame; ++stroke)
+            {
+                Rect rect = intersect_rects({ std::rand() % width, std::rand() % height, stroke_size, stroke_size }, { 0, 0, width, height });
+                unsigned char color = (unsigned char)(std::rand() & 0xFF);
+                for (int y = rect.y; y < rect.y + rect.height; ++y)
+                    std::fill(frame.begin() + y * stride + rect.x * channels, frame.begin() + y * stride + (rect.x + rect.width) * channels, color);
+                dirty.add(rect);
+            }
+
+            cpu_incremental_ms += time_ms([&] { cpu.update(frame.data(), stride, dirty.rects()); }, 1);
+            cpu_full_ms += time_ms([&]
+            {
+                luma_u8(frame.data(), stride, channels, luma.row(0), luma.stride(), width, height);
+                sobel_u8_simd(luma.row(0), luma.stride(), full.row(0), full.stride(), width, height);
+            }, 1);
+            cpu_mismatches += count_mismatches(cpu.edges(), full);
+            processed += cpu.pixels_processed();
+
+            gpu_incremental_ms += time_ms([&] { gpu.update(frame.data(), stride, dirty.rects()); glFinish(); }, 1);
+            gpu_full_ms += time_ms([&] { gpu_reference.reset(frame.data(), stride, width, height, channels); glFinish(); }, 1);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, gpu.render_target().framebuffer);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, incremental_pixels.data());
+            glBindFramebuffer(GL_FRAMEBUFFER, gpu_reference.render_target().framebuffer);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, reference_pixels.data());
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            for (size_t p = 0; p < incremental_pixels.size(); ++p)
+                gpu_mismatches += incremental_pixels[p] != reference_pixels[p];
+        }
+
+        double frame_pixels = (double)width * height * frame_count;
+        std::cout << path << " " << width << "x" << height << ", " << frame_count << " frames of " << strokes_per_frame
+                  << " " << stroke_size << "x" << stroke_size << " strokes\n"
+                  << "  recomputed: " << 100.0 * processed / frame_pixels << "% of the pixels\n"
+                  << "  cpu: " << cpu_incremental_ms / frame_count << " ms incremental, " << cpu_full_ms / frame_count
+                  << " ms full, mismatches " << cpu_mismatches << "\n"
+                  << "  gpu: " << gpu_incremental_ms / frame_count << " ms incremental, " << gpu_full_ms / frame_count
+                  << " ms full (incl. upload), mismatches " << gpu_mismatches << std::endl;
+
+        if (result == 0 && (cpu_mismatches != 0 || gpu_mismatches != 0))
+            result = 1;
+    }
+    return result;
+}
+
+//startup cost of every bundled texture: PNG decode + glGenerateMipmap, first cached
+//load (decode + build + write) and a warm cached load (map + upload)
+int run_cache_bench(const std::string& assets_directory, const std::string& cache_directory)
+{
+    std::vector<std::string> paths = bundled_textures(assets_directory);
+
+    //always start cold
+    std::string bench_directory = (std::filesystem::path(cache_directory) / "bench").string();
+    std::error_code error;
+    std::filesystem::remove_all(bench_directory, error);
+    TextureCache cache(bench_directory, TEXTURE_CACHE_MIPMAPS);
+
+    auto time_load = [](auto load)
+    {
+        return time_ms([&]
+        {
+            GLuint texture_id = load();
+            glFinish();
+            glDeleteTextures(1, &texture_id);
+        }, 1);
+    };
+
+    double total_decode = 0.0, total_cold = 0.0, total_warm = 0.0;
+    for (const std::string& path : paths)
+    {
+        double decode_ms = time_load([&] { return load_texture(path.c_str()); });
+        double cold_ms = time_load([&] { return load_texture_cached(cache, path.c_str()); });
+        double warm_ms = time_load([&] { return load_texture_cached(cache, path.c_str()); });
+        total_decode += decode_ms;
+        total_cold += cold_ms;
+        total_warm += warm_ms;
+        std::cout << path << ": decode " << decode_ms << " ms, cache build " << cold_ms << " ms, cache hit " << warm_ms << " ms" << std::endl;
+    }
+    std::cout << "total: decode " << total_decode << " ms, cache build " << total_cold << " ms, cache hit " << total_warm << " ms" << std::endl;
+    return 0;
+}
+
+static bool checks_use_gl(const BenchOptions& options)
+{
+    return !options.int_check_paths.empty() || !options.compress_check_paths.empty() || !options.roi_bench_paths.empty() ||
+           options.cache_bench;
+}
+
+static bool has_checks(const BenchOptions& options)
+{
+    return checks_use_gl(options) || !options.pyramid_bench_paths.empty();
+}
+
+//every requested check runs, the first failure is the result
+int run_checks(const BenchOptions& options)
+{
+    std::string shader_directory = options.assets_directory + "/shaders/";
+    int result_code = 0;
+    auto keep = [&](int result)
+    {
+        if (result_code == 0)
+            result_code = result;
+    };
+
+    if (!options.int_check_paths.empty())
+    {
+        Shader edge_detection_int((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_int.fs").c_str());
+        keep(run_int_check(options.int_check_paths, edge_detection_int));
+    }
+    if (!options.compress_check_paths.empty())
+    {
+        if (compressed_formats_supported())
+            keep(run_compress_check(options.compress_check_paths, options.compress_tolerance));
+        else
+        {
+            std::cout << "ERROR: BC1/BC7 TEXTURES ARE NOT SUPPORTED BY THIS DRIVER" << std::endl;
+            keep(-1);
+        }
+    }
+    if (!options.pyramid_bench_paths.empty())
+        keep(run_pyramid_bench(options.pyramid_bench_paths));
+    if (!options.roi_bench_paths.empty())
+    {
+        Shader edge_detection((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection.fs").c_str());
+        keep(run_roi_bench(options.roi_bench_paths, edge_detection));
+    }
+    if (options.cache_bench)
+        keep(run_cache_bench(options.assets_directory, options.cache_directory));
+    return result_code;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    if (!parse_options(argc, argv, options))
+        return -1;
+
+    if (options.backends.empty() && options.golden_directory.empty())
+        options.backends.assign(std::begin(default_backends), std::end(default_backends));
+    else if (options.backends.empty())
+        options.backends = { "cpu_float", "gl_float", "scalar", "simd", "threaded", "gl_fragment" };
+
+    //recording golden images always needs the reference shader
+    bool checks = has_checks(options);
+    bool needs_gl = checks ? checks_use_gl(options) : uses_gl(options) || options.write_golden;
+    if (needs_gl && !create_headless_gl_context())
+        return -1;
+
+    std::FILE* json = nullptr;
+    if (!options.json_path.empty())
+    {
+        json = std::fopen(options.json_path.c_str(), "w");
+        if (!json)
+        {
+            std::cout << "Failed to open " << options.json_path << std::endl;
+            return -1;
+        }
+        std::fprintf(json, "{\"type\":\"run\",\"format\":%d,\"time\":%lld,\"hardware_threads\":%u,\"renderer\":\"%s\"}\n",
+                     BENCH_FORMAT_VERSION, (long long)std::time(nullptr), std::thread::hardware_concurrency(),
+                     needs_gl ? gl_renderer_name() : "");
+    }
+    if (needs_gl)
+        std::cout << "renderer: " << gl_renderer_name() << "\n";
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    int result_code = 0;
+    if (checks)
+        result_code = run_checks(options);
+    else
+        result_code = options.golden_directory.empty() ? run_timing(options, json) : run_golden(options, json);
+
+    if (json)
+        std::fclose(json);
+    if (needs_gl)
+        destroy_headless_gl_context();
+    return result_code;
+}
@@ -0,0 +1,289 @@
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "EdgeDetector.h"
+#include "EdgeService.h"
+#include "GlContext.h"
+#include "Image.h"
+#include "Shader.h"
+
+//SevengerService: the edge detection daemon (--serve) and a load generator for it (--load)
+
+struct ServiceOptions
+{
+    std::string assets_directory = "assets";
+    std::string serve_path;
+    std::string load_path;
+    EdgeServerConfig server;
+    int clients = 4;
+    int requests = 200;
+    int width = 512;
+    int height = 512;
+    int channels = 1;
+    EdgeDetectorConfig edges;
+    bool stop_server = false;
+};
+
+void print_usage()
+{
+    std::cout << "usage: SevengerService --serve <socket> [options] | --load <socket> [options]\n"
+              << "server:\n"
+              << "  --serve <socket>         answer edge requests on this Unix domain socket until SIGINT or --stop\n"
+              << "  --backend <name>         gl (batched, default), auto, scalar, simd or threaded\n"
+              << "  --max-batch <n>          requests served per round (default 64)\n"
+              << "  --batch-window <ms>      time a round waits for more clients (default 0)\n"
+              << "  --threads <n>            threads of the threaded backend (default all)\n"
+              << "  --assets <dir>           asset directory with the shaders (default assets)\n"
+              << "load generator:\n"
+              << "  --load <socket>          send requests from several clients and report throughput and latency\n"
+              << "  --clients <n>            concurrent connections (default 4)\n"
+              << "  --requests <n>           requests per client (default 200)\n"
+              << "  --size <WxH>             image size (default 512x512)\n"
+              << "  --channels <n>           1, 3 or 4 interleaved channels (default 1)\n"
+              << "  --kernel <name>          sobel, prewitt or scharr (default sobel)\n"
+              << "  --edge-channels <mode>   luma or max (default luma)\n"
+              << "  --stop                   shut the server down afterwards\n";
+}
+
+bool parse_options(int argc, char* argv[], ServiceOptions& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--serve" && has_value)
+            options.serve_path = argv[++i];
+        else if (arg == "--load" && has_value)
+            options.load_path = argv[++i];
+        else if (arg == "--backend" && has_value && parse_edge_backend(argv[i + 1], options.server.backend))
+            ++i;
+        else if (arg == "--max-batch" && has_value)
+            options.server.max_batch = (size_t)std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--batch-window" && has_value)
+            options.server.batch_window_ms = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--threads" && has_value)
+            options.server.thread_count = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--assets" && has_value)
+            options.assets_directory = argv[++i];
+        else if (arg == "--clients" && has_value)
+            options.clients = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--requests" && has_value)
+            options.requests = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--size" && has_value)
+            std::sscanf(argv[++i], "%dx%d", &options.width, &options.height);
+        else if (arg == "--channels" && has_value)
+            options.channels = std::atoi(argv[++i]);
+        else if (arg == "--kernel" && has_value && parse_gradient_kernel(argv[i + 1], options.edges.kernel))
+            ++i;
+        else if (arg == "--edge-channels" && has_value)
+            options.edges.channels = std::string(argv[++i]) == "max" ? EdgeChannels::MAX : EdgeChannels::LUMA;
+        else if (arg == "--stop")
+            options.stop_server = true;
+        else
+        {
+            print_usage();
+            return false;
+        }
+    }
+    if (options.serve_path.empty() == options.load_path.empty() || options.width <= 0 || options.height <= 0 ||
+        (options.channels != 1 && options.channels != 3 && options.channels != 4))
+    {
+        print_usage();
+        return false;
+    }
+    return true;
+}
+
+static EdgeServer* running_server = nullptr;
+
+static void stop_server(int)
+{
+    if (running_server)
+        running_server->stop();
+}
+
+int run_server(const ServiceOptions& options)
+{
+    //the CPU backends do not need a context, AUTO uses one when it can get it
+    bool gl = options.server.backend == EdgeBackend::GL || options.server.backend == EdgeBackend::AUTO;
+    if (gl && !create_headless_gl_context())
+    {
+        if (options.server.backend == EdgeBackend::GL)
+            return -1;
+        gl = false;
+    }
+
+    std::unique_ptr<Shader> int_shader, batch_shader;
+    if (gl)
+    {
+        std::string shader_directory = options.assets_directory + "/shaders/";
+        int_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_int.fs").c_str());
+        batch_shader = std::make_unique<Shader>((shader_directory + "edge_detection.vs").c_str(), (shader_directory + "edge_detection_batch.fs").c_str());
+        std::cout << "renderer: " << gl_renderer_name() << "\n";
+    }
+
+    int result = 0;
+    {
+        EdgeServer server(options.server);
+        if (server.start(int_shader.get(), batch_shader.get()))
+        {
+            running_server = &server;
+            std::signal(SIGINT, stop_server);
+            std::signal(SIGTERM, stop_server);
+            std::cout << "serving " << edge_backend_name(options.server.backend) << " edges on " << options.serve_path << std::endl;
+            server.run();
+            running_server = nullptr;
+
+            const EdgeServerStats& stats = server.stats();
+            std::cout << "connections " << stats.connections << ", requests " << stats.requests << " (" << stats.failed << " failed), rounds "
+                      << stats.rounds << ", mean round " << (stats.rounds ? (double)stats.requests / stats.rounds : 0.0)
+                      << ", largest round " << stats.largest_round << std::endl;
+        }
+        else
+        {
+            result = -1;
+        }
+    }
+
+    int_shader.reset();
+    batch_shader.reset();
+    if (gl)
+        destroy_headless_gl_context();
+    return result;
+}
+
+struct ClientResult
+{
+    std::vector<double> latencies_ms;
+    double service_ms = 0.0;
+    uint64_t batch_sizes = 0;
+    size_t errors = 0;
+    size_t mismatches = 0;
+};
+
+//one client thread: its own connection, segment and input, every response is checked against the local scalar backend
+static void run_client(const ServiceOptions& options, int client, ClientResult& result)
+{
+    int width = options.width, height = options.height, channels = options.channels;
+    size_t stride = (size_t)width * channels;
+    EdgeClient connection;
+    if (!connection.connect(options.load_path, std::max(stride, (size_t)width) * height))
+    {
+        result.errors = (size_t)options.requests;
+        return;
+    }
+
+    //rings and hashed noise, shifted per client so the server sees different images
+    unsigned char* input = connection.input();
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width * channels; ++x)
+        {
+            int dx = x / channels - width / 2 + client * 7, dy = y - height / 2;
+            uint32_t noise = (uint32_t)(x + client) * 73856093u ^ (uint32_t)y * 19349663u;
+            input[(size_t)y * stride + x] = (unsigned char)((((dx * dx + dy * dy) >> 6) & 64) + (x % channels) * 40 + (noise >> 28));
+        }
+    }
+
+    EdgeDetectorConfig reference_config = options.edges;
+    reference_config.backend = EdgeBackend::SCALAR;
+    EdgeDetector reference_detector(reference_config);
+    std::vector<unsigned char> reference((size_t)width * height);
+    reference_detector.process(input, stride, width, height, channels, reference.data(), (size_t)width);
+
+    result.latencies_ms.reserve(options.requests);
+    for (int i = 0; i < options.requests; ++i)
+    {
+        EdgeServiceResponse response;
+        auto begin = std::chrono::steady_clock::now();
+        bool sent = connection.detect(width, height, channels, stride, options.edges, response);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        if (!sent)
+        {
+            result.errors += (size_t)(options.requests - i);
+            break;
+        }
+        if (response.status != (uint32_t)EdgeServiceStatus::OK)
+        {
+            ++result.errors;
+            continue;
+        }
+        result.latencies_ms.push_back(ms);
+        result.service_ms += response.service_ms;
+        result.batch_sizes += response.batch_size;
+        if (std::memcmp(connection.output(), reference.data(), reference.size()) != 0)
+            ++result.mismatches;
+    }
+}
+
+static double percentile(const std::vector<double>& sorted, double fraction)
+{
+    size_t index = (size_t)(fraction * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int run_load(const ServiceOptions& options)
+{
+    std::vector<ClientResult> results(options.clients);
+    std::vector<std::thread> clients;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.clients; ++i)
+        clients.emplace_back(run_client, std::cref(options), i, std::ref(results[i]));
+    for (std::thread& client : clients)
+        client.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<double> latencies;
+    double service_ms = 0.0;
+    uint64_t batch_sizes = 0;
+    size_t errors = 0, mismatches = 0;
+    for (const ClientResult& result : results)
+    {
+        latencies.insert(latencies.end(), result.latencies_ms.begin(), result.latencies_ms.end());
+        service_ms += result.service_ms;
+        batch_sizes += result.batch_sizes;
+        errors += result.errors;
+        mismatches += result.mismatches;
+    }
+
+    if (options.stop_server)
+    {
+        EdgeClient control;
+        if (!control.connect(options.load_path, 64) || !control.shutdown_server())
+            std::cout << "Failed to stop the server" << std::endl;
+    }
+
+    std::cout << options.clients << " clients, " << options.width << "x" << options.height << "x" << options.channels
+              << ": " << latencies.size() << " requests, " << errors << " errors, " << mismatches << " mismatches" << std::endl;
+    if (latencies.empty())
+        return -1;
+
+    std::sort(latencies.begin(), latencies.end());
+    double count = (double)latencies.size();
+    char line[512];
+    std::snprintf(line, sizeof(line), "%.1f requests/s  %.1f MP/s  latency min %.3f  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms  server %.3f ms  mean round %.1f",
+                  count / seconds, count * options.width * options.height / 1e6 / seconds,
+                  latencies.front(), percentile(latencies, 0.50), percentile(latencies, 0.95), percentile(latencies, 0.99), latencies.back(),
+                  service_ms / count, (double)batch_sizes / count);
+    std::cout << line << std::endl;
+    return errors == 0 && mismatches == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    ServiceOptions options;
+    if (!parse_options(argc, argv, options))
+        return -1;
+    options.server.socket_path = options.serve_path;
+    return options.serve_path.empty() ? run_load(options) : run_server(options);
+}